@@ -26,6 +26,7 @@ class MessageLoop;
 namespace history {
 class HistoryBackend;
 class URLDatabase;
+class URLPrefixIndex;
 }
 
 // How history autocomplete works
@@ -41,7 +42,7 @@ class URLDatabase;
 //         -> SuggestExactInput
 //         [params_ allocated]
 //         -> DoAutocomplete (for inline autocomplete)
-//           -> URLDatabase::AutocompleteForPrefix (on in-memory DB)
+//           -> URLPrefixIndex::Find (on in-memory DB's index)
 //         -> HistoryService::ScheduleAutocomplete
 //         (return to controller) ----
 //                                   /
@@ -199,9 +200,11 @@ class HistoryURLProvider : public HistoryProvider {
                      HistoryURLProviderParams* params);
 
   // Actually runs the autocomplete job on the given database, which is
-  // guaranteed not to be NULL.
+  // guaranteed not to be NULL. If |prefix_index| is non-NULL, it indexes the
+  // typed URLs of |db| and is used to find the matching URLs instead.
   void DoAutocomplete(history::HistoryBackend* backend,
                       history::URLDatabase* db,
+                      const history::URLPrefixIndex* prefix_index,
                       HistoryURLProviderParams* params);
 
   // Dispatches the results to the autocomplete controller. Called on the
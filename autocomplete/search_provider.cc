@@ -27,7 +27,7 @@
 #include "chrome/browser/autocomplete/url_prefix.h"
 #include "chrome/browser/history/history_service.h"
 #include "chrome/browser/history/history_service_factory.h"
-#include "chrome/browser/history/in_memory_database.h"
+#include "chrome/browser/history/keyword_search_term_index.h"
 #include "chrome/browser/metrics/variations/variations_http_header_provider.h"
 #include "chrome/browser/omnibox/omnibox_field_trial.h"
 #include "chrome/browser/profiles/profile.h"
@@ -238,6 +238,17 @@ bool SearchProvider::Results::HasServerProvidedScores() const {
   return false;
 }
 
+// SearchProvider::CachedResults ----------------------------------------------
+
+SearchProvider::CachedResults::CachedResults(const Results& results,
+                                             base::TimeTicks time)
+    : results(results),
+      time(time) {
+}
+
+SearchProvider::CachedResults::~CachedResults() {
+}
+
 
 // SearchProvider -------------------------------------------------------------
 
@@ -245,6 +256,8 @@ bool SearchProvider::Results::HasServerProvidedScores() const {
 const int SearchProvider::kDefaultProviderURLFetcherID = 1;
 const int SearchProvider::kKeywordProviderURLFetcherID = 2;
 int SearchProvider::kMinimumTimeBetweenSuggestQueriesMs = 100;
+const size_t SearchProvider::kMaxCachedSuggestResponses = 32;
+int SearchProvider::kSuggestCacheTimeToLiveMs = 60 * 1000;
 const char SearchProvider::kRelevanceFromServerKey[] = "relevance_from_server";
 const char SearchProvider::kShouldPrefetchKey[] = "should_prefetch";
 const char SearchProvider::kSuggestMetadataKey[] = "suggest_metadata";
@@ -257,6 +270,7 @@ SearchProvider::SearchProvider(AutocompleteProviderListener* listener,
           AutocompleteProvider::TYPE_SEARCH),
       providers_(TemplateURLServiceFactory::GetForProfile(profile)),
       suggest_results_pending_(0),
+      suggest_cache_(kMaxCachedSuggestResponses),
       field_trial_triggered_(false),
       field_trial_triggered_in_session_(false) {
 }
@@ -606,6 +620,8 @@ void SearchProvider::OnURLFetchComplete(const net::URLFetcher* source) {
     deserializer.set_allow_trailing_comma(true);
     scoped_ptr<Value> data(deserializer.Deserialize(NULL, NULL));
     results_updated = data.get() && ParseSuggestResults(data.get(), is_keyword);
+    if (results_updated)
+      CacheSuggestResults(is_keyword);
   }
 
   UpdateMatches();
@@ -618,10 +634,16 @@ void SearchProvider::Run() {
   suggest_results_pending_ = 0;
   time_suggest_request_sent_ = base::TimeTicks::Now();
 
-  default_fetcher_.reset(CreateSuggestFetcher(kDefaultProviderURLFetcherID,
-      providers_.GetDefaultProviderURL(), input_));
-  keyword_fetcher_.reset(CreateSuggestFetcher(kKeywordProviderURLFetcherID,
-      providers_.GetKeywordProviderURL(), keyword_input_));
+  // Responses to the current input which are still cached are not fetched
+  // again.
+  if (!ReadCachedSuggestResults(false)) {
+    default_fetcher_.reset(CreateSuggestFetcher(kDefaultProviderURLFetcherID,
+        providers_.GetDefaultProviderURL(), input_));
+  }
+  if (!ReadCachedSuggestResults(true)) {
+    keyword_fetcher_.reset(CreateSuggestFetcher(kKeywordProviderURLFetcherID,
+        providers_.GetKeywordProviderURL(), keyword_input_));
+  }
 
   // Both the above can fail if the providers have been modified or deleted
   // since the query began.
@@ -655,11 +677,11 @@ void SearchProvider::DoHistoryQuery(bool minimal_changes) {
   UMA_HISTOGRAM_TIMES("Omnibox.SearchProvider.GetHistoryServiceTime",
                       now - start_time);
   start_time = now;
-  history::URLDatabase* url_db = history_service ?
-      history_service->InMemoryDatabase() : NULL;
+  const history::KeywordSearchTermIndex* term_index = history_service ?
+      history_service->InMemoryKeywordSearchTermIndex() : NULL;
   UMA_HISTOGRAM_TIMES("Omnibox.SearchProvider.InMemoryDatabaseTime",
                       base::TimeTicks::Now() - start_time);
-  if (!url_db)
+  if (!term_index)
     return;
 
   // Request history for both the keyword and default provider.  We grab many
@@ -675,15 +697,15 @@ void SearchProvider::DoHistoryQuery(bool minimal_changes) {
   const TemplateURL* default_url = providers_.GetDefaultProviderURL();
   if (default_url) {
     start_time = base::TimeTicks::Now();
-    url_db->GetMostRecentKeywordSearchTerms(default_url->id(), input_.text(),
-        num_matches, &default_history_results_);
+    term_index->GetMostRecentKeywordSearchTerms(default_url->id(),
+        input_.text(), num_matches, &default_history_results_);
     UMA_HISTOGRAM_TIMES(
         "Omnibox.SearchProvider.GetMostRecentKeywordTermsDefaultProviderTime",
         base::TimeTicks::Now() - start_time);
   }
   const TemplateURL* keyword_url = providers_.GetKeywordProviderURL();
   if (keyword_url) {
-    url_db->GetMostRecentKeywordSearchTerms(keyword_url->id(),
+    term_index->GetMostRecentKeywordSearchTerms(keyword_url->id(),
         keyword_input_.text(), num_matches, &keyword_history_results_);
   }
   UMA_HISTOGRAM_TIMES("Omnibox.SearchProvider.DoHistoryQueryTime",
@@ -715,10 +737,25 @@ void SearchProvider::StartOrStopSuggestQuery(bool minimal_changes) {
   // Remove existing results that cannot inline autocomplete the new input.
   RemoveAllStaleResults();
 
+  // Show cached responses to the new input, e.g. after a backspace.  Failing
+  // that, show what a cached response to a prefix of it still has to offer
+  // while the new query runs.
+  const bool default_cached = ReadCachedSuggestResults(false);
+  if (!default_cached)
+    ReadCachedPrefixSuggestResults(false);
+  const bool keyword_cached = ReadCachedSuggestResults(true);
+  if (!keyword_cached)
+    ReadCachedPrefixSuggestResults(true);
+
   // We can't start a new query if we're only allowed synchronous results.
   if (input_.matches_requested() != AutocompleteInput::ALL_MATCHES)
     return;
 
+  // There is nothing to fetch if both responses are cached.
+  if (default_cached &&
+      (keyword_cached || GetSuggestCacheKey(true, string16()).first.empty()))
+    return;
+
   // To avoid flooding the suggest server, don't send a query until at
   // least 100 ms since the last query.
   base::TimeTicks next_suggest_time(time_suggest_request_sent_ +
@@ -829,6 +866,94 @@ void SearchProvider::RemoveAllStaleResults() {
   }
 }
 
+void SearchProvider::CacheSuggestResults(bool is_keyword) {
+  const SuggestCacheKey key(
+      GetSuggestCacheKey(is_keyword, GetSuggestInputText(is_keyword)));
+  if (key.first.empty())
+    return;
+  suggest_cache_.Put(key, CachedResults(
+      is_keyword ? keyword_results_ : default_results_,
+      base::TimeTicks::Now()));
+}
+
+bool SearchProvider::ReadCachedSuggestResults(bool is_keyword) {
+  const string16& text = GetSuggestInputText(is_keyword);
+  const SuggestCacheKey key(GetSuggestCacheKey(is_keyword, text));
+  if (key.first.empty() || text.empty())
+    return false;
+  SuggestCache::iterator it = suggest_cache_.Get(key);
+  if (it == suggest_cache_.end())
+    return false;
+  if (base::TimeTicks::Now() - it->second.time >=
+      base::TimeDelta::FromMilliseconds(kSuggestCacheTimeToLiveMs)) {
+    suggest_cache_.Erase(it);
+    return false;
+  }
+
+  Results* results = is_keyword ? &keyword_results_ : &default_results_;
+  *results = it->second.results;
+  // Calculated scores depend on more of the input than its text.
+  if (!results->HasServerProvidedScores()) {
+    ApplyCalculatedSuggestRelevance(&results->suggest_results);
+    ApplyCalculatedNavigationRelevance(&results->navigation_results);
+  }
+  return true;
+}
+
+void SearchProvider::ReadCachedPrefixSuggestResults(bool is_keyword) {
+  Results* results = is_keyword ? &keyword_results_ : &default_results_;
+  const string16& text = GetSuggestInputText(is_keyword);
+  if (!results->suggest_results.empty() ||
+      !results->navigation_results.empty() || (text.length() < 2))
+    return;
+
+  const base::TimeTicks now(base::TimeTicks::Now());
+  const base::TimeDelta time_to_live(
+      base::TimeDelta::FromMilliseconds(kSuggestCacheTimeToLiveMs));
+  for (size_t length = text.length() - 1; length > 0; --length) {
+    // Peek() so that looking at prefixes does not keep them in the cache.
+    SuggestCache::iterator it = suggest_cache_.Peek(
+        GetSuggestCacheKey(is_keyword, text.substr(0, length)));
+    if ((it == suggest_cache_.end()) || (now - it->second.time >= time_to_live))
+      continue;
+
+    // Like stale results, these keep the scores they came with; the verbatim
+    // score, which was for the prefix, is not taken.
+    const Results& cached = it->second.results;
+    for (SuggestResults::const_iterator i(cached.suggest_results.begin());
+         i != cached.suggest_results.end(); ++i) {
+      if (i->IsInlineable(text))
+        results->suggest_results.push_back(*i);
+    }
+    for (NavigationResults::const_iterator i(
+             cached.navigation_results.begin());
+         i != cached.navigation_results.end(); ++i) {
+      if (i->IsInlineable(text))
+        results->navigation_results.push_back(*i);
+    }
+    results->metadata = cached.metadata;
+    if (!cached.HasServerProvidedScores()) {
+      ApplyCalculatedSuggestRelevance(&results->suggest_results);
+      ApplyCalculatedNavigationRelevance(&results->navigation_results);
+    }
+    return;
+  }
+}
+
+const string16& SearchProvider::GetSuggestInputText(bool is_keyword) const {
+  return is_keyword ? keyword_input_.text() : input_.text();
+}
+
+SearchProvider::SuggestCacheKey SearchProvider::GetSuggestCacheKey(
+    bool is_keyword,
+    const string16& text) const {
+  const TemplateURL* template_url = is_keyword ?
+      providers_.GetKeywordProviderURL() : providers_.GetDefaultProviderURL();
+  if (!template_url)
+    return SuggestCacheKey();
+  return SuggestCacheKey(template_url->suggestions_url(), text);
+}
+
 void SearchProvider::ApplyCalculatedRelevance() {
   ApplyCalculatedSuggestRelevance(&keyword_results_.suggest_results);
   ApplyCalculatedSuggestRelevance(&default_results_.suggest_results);
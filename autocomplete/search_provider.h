@@ -13,10 +13,12 @@
 
 #include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/basictypes.h"
 #include "base/compiler_specific.h"
+#include "base/containers/mru_cache.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/time/time.h"
 #include "base/timer/timer.h"
@@ -115,6 +117,7 @@ class SearchProvider : public AutocompleteProvider,
   FRIEND_TEST_ALL_PREFIXES(SearchProviderTest, NavigationInlineDomainClassify);
   FRIEND_TEST_ALL_PREFIXES(SearchProviderTest, NavigationInlineSchemeSubstring);
   FRIEND_TEST_ALL_PREFIXES(SearchProviderTest, RemoveStaleResultsTest);
+  FRIEND_TEST_ALL_PREFIXES(SearchProviderTest, SuggestCache);
   FRIEND_TEST_ALL_PREFIXES(SearchProviderTest, SuggestRelevanceExperiment);
   FRIEND_TEST_ALL_PREFIXES(AutocompleteProviderTest, GetDestinationURL);
   FRIEND_TEST_ALL_PREFIXES(InstantExtendedPrefetchTest, ClearPrefetchedResults);
@@ -287,7 +290,8 @@ class SearchProvider : public AutocompleteProvider,
 
   // A simple structure bundling most of the information (including
   // both SuggestResults and NavigationResults) returned by a call to
-  // the suggest server.
+  // the suggest server.  Copyable so that responses can be kept in
+  // |suggest_cache_|.
   //
   // This has to be declared after the typedefs since it relies on some of them.
   struct Results {
@@ -315,11 +319,22 @@ class SearchProvider : public AutocompleteProvider,
 
     // The JSON metadata associated with this server response.
     std::string metadata;
+  };
 
-   private:
-    DISALLOW_COPY_AND_ASSIGN(Results);
+  // A parsed suggest response and the time it arrived.
+  struct CachedResults {
+    CachedResults(const Results& results, base::TimeTicks time);
+    ~CachedResults();
+
+    Results results;
+    base::TimeTicks time;
   };
 
+  // Responses are cached by the suggestions URL of the provider which sent
+  // them and the input text they answer.
+  typedef std::pair<std::string, string16> SuggestCacheKey;
+  typedef base::MRUCache<SuggestCacheKey, CachedResults> SuggestCache;
+
   virtual ~SearchProvider();
 
   // Removes non-inlineable results until either the top result can inline
@@ -381,6 +396,27 @@ class SearchProvider : public AutocompleteProvider,
                                         const TemplateURL* template_url,
                                         const AutocompleteInput& input);
 
+  // Adds the current results of the keyword or default provider, depending on
+  // |is_keyword|, to |suggest_cache_| as the response to the current input.
+  void CacheSuggestResults(bool is_keyword);
+
+  // Replaces the results of the keyword or default provider with a cached
+  // response to the current input, if one is fresh.  Returns whether it did.
+  bool ReadCachedSuggestResults(bool is_keyword);
+
+  // If the keyword or default provider has no results, fills them from the
+  // freshest cached response to the longest prefix of the current input, with
+  // only the results which can still inline autocomplete the input.  These
+  // are shown until the response to the input itself arrives.
+  void ReadCachedPrefixSuggestResults(bool is_keyword);
+
+  // Returns the text the keyword or default provider is queried for, and the
+  // cache key of its response to |text|; the key is empty for providers
+  // which do not suggest.
+  const string16& GetSuggestInputText(bool is_keyword) const;
+  SuggestCacheKey GetSuggestCacheKey(bool is_keyword,
+                                     const string16& text) const;
+
   // Parses results from the suggest server and updates the appropriate suggest
   // and navigation result lists, depending on whether |is_keyword| is true.
   // Returns whether the appropriate result list members were updated.
@@ -496,6 +532,12 @@ class SearchProvider : public AutocompleteProvider,
   // previous one.  Non-const because some unittests modify this value.
   static int kMinimumTimeBetweenSuggestQueriesMs;
 
+  // The number of suggest responses kept in |suggest_cache_|, and how long
+  // they may be reused for.  Non-const because some unittests modify the
+  // latter.
+  static const size_t kMaxCachedSuggestResponses;
+  static int kSuggestCacheTimeToLiveMs;
+
   // The following keys are used to record additional information on matches.
 
   // We annotate our AutocompleteMatches with whether their relevance scores
@@ -545,6 +587,10 @@ class SearchProvider : public AutocompleteProvider,
   Results default_results_;
   Results keyword_results_;
 
+  // Recent responses of the suggest servers, so that returning to an input,
+  // e.g. by backspacing, does not fetch its suggestions again.
+  SuggestCache suggest_cache_;
+
   // Whether a field trial, if any, has triggered in the most recent
   // autocomplete query.  This field is set to false in Start() and may be set
   // to true if either the default provider or keyword provider has completed
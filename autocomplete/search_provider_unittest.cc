@@ -210,6 +210,8 @@ void SearchProviderTest::SetUp() {
 
   provider_ = new SearchProvider(this, &profile_);
   provider_->kMinimumTimeBetweenSuggestQueriesMs = 0;
+  // Tests query the same input with different responses.
+  provider_->kSuggestCacheTimeToLiveMs = 0;
 }
 
 void SearchProviderTest::TearDown() {
@@ -2514,6 +2516,55 @@ TEST_F(SearchProviderTest, RemoveStaleResultsTest) {
   }
 }
 
+// Verifies that suggest responses are reused from the cache, and that a cached
+// response to a prefix of the input is shown while its own query runs.
+TEST_F(SearchProviderTest, SuggestCache) {
+  provider_->kSuggestCacheTimeToLiveMs = 60 * 1000;
+  AutocompleteMatch match;
+
+  QueryForInput(ASCIIToUTF16("a"), false, false);
+  net::TestURLFetcher* fetcher = test_factory_.GetFetcherByID(
+      SearchProvider::kDefaultProviderURLFetcherID);
+  ASSERT_TRUE(fetcher);
+  fetcher->set_response_code(200);
+  fetcher->SetResponseString("[\"a\",[\"abc\",\"xyz\"]]");
+  fetcher->delegate()->OnURLFetchComplete(fetcher);
+  RunTillProviderDone();
+  EXPECT_TRUE(FindMatchWithContents(ASCIIToUTF16("xyz"), &match));
+  provider_->Stop(true);
+
+  // While "ab" is fetched, the inlineable suggestions for "a" are shown.
+  QueryForInput(ASCIIToUTF16("ab"), false, false);
+  fetcher = test_factory_.GetFetcherByID(
+      SearchProvider::kDefaultProviderURLFetcherID);
+  ASSERT_TRUE(fetcher);
+  EXPECT_FALSE(provider_->done());
+  EXPECT_TRUE(FindMatchWithContents(ASCIIToUTF16("abc"), &match));
+  EXPECT_FALSE(FindMatchWithContents(ASCIIToUTF16("xyz"), &match));
+  fetcher->set_response_code(200);
+  fetcher->SetResponseString("[\"ab\",[\"abd\"]]");
+  fetcher->delegate()->OnURLFetchComplete(fetcher);
+  RunTillProviderDone();
+  EXPECT_TRUE(FindMatchWithContents(ASCIIToUTF16("abd"), &match));
+  EXPECT_FALSE(FindMatchWithContents(ASCIIToUTF16("abc"), &match));
+  provider_->Stop(true);
+
+  // Backspacing to "a" needs no fetch.
+  QueryForInput(ASCIIToUTF16("a"), false, false);
+  EXPECT_FALSE(test_factory_.GetFetcherByID(
+      SearchProvider::kDefaultProviderURLFetcherID));
+  EXPECT_TRUE(provider_->done());
+  EXPECT_TRUE(FindMatchWithContents(ASCIIToUTF16("abc"), &match));
+  EXPECT_TRUE(FindMatchWithContents(ASCIIToUTF16("xyz"), &match));
+  provider_->Stop(true);
+
+  // Expired responses are fetched again.
+  provider_->kSuggestCacheTimeToLiveMs = 0;
+  QueryForInput(ASCIIToUTF16("ab"), false, false);
+  EXPECT_TRUE(test_factory_.GetFetcherByID(
+      SearchProvider::kDefaultProviderURLFetcherID));
+}
+
 // A basic test that verifies the prefetch metadata parsing logic.
 TEST_F(SearchProviderTest, PrefetchMetadataParsing) {
   struct Match {
@@ -43,6 +43,20 @@ class DestinationURLEqualsURL {
   const GURL url_;
 };
 
+// A shortcut found for the input, and its score.
+struct ScoredShortcut {
+  int relevance;
+  const history::ShortcutsBackend::Shortcut* shortcut;
+};
+
+// Orders scored shortcuts like AutocompleteMatch::MoreRelevant() orders the
+// matches made of them.
+bool MoreRelevantShortcut(const ScoredShortcut& a, const ScoredShortcut& b) {
+  return (a.relevance == b.relevance) ?
+      (a.shortcut->match_core.contents < b.shortcut->match_core.contents) :
+      (a.relevance > b.relevance);
+}
+
 }  // namespace
 
 ShortcutsProvider::ShortcutsProvider(AutocompleteProviderListener* listener,
@@ -142,22 +156,27 @@ void ShortcutsProvider::GetMatches(const AutocompleteInput& input) {
       input.current_page_classification(), &max_relevance))
     max_relevance = AutocompleteResult::kLowestDefaultScore - 1;
 
-  for (history::ShortcutsBackend::ShortcutMap::const_iterator it =
-           FindFirstMatch(term_string, backend.get());
-       it != backend->shortcuts_map().end() &&
-           StartsWith(it->first, term_string, true); ++it) {
+  // Score every shortcut found, but only make matches of the best ones, as
+  // classifying a match is much more costly than scoring it.
+  history::ShortcutsBackend::ShortcutRange range(
+      backend->FindShortcuts(term_string));
+  std::vector<ScoredShortcut> scored;
+  for (history::ShortcutsBackend::ShortcutIndex::const_iterator it =
+           range.first; it != range.second; ++it) {
     // Don't return shortcuts with zero relevance.
-    int relevance = CalculateScore(term_string, it->second, max_relevance);
-    if (relevance)
-      matches_.push_back(ShortcutToACMatch(relevance, term_string, it->second));
+    ScoredShortcut shortcut = {
+      CalculateScore(term_string, *it->shortcut, max_relevance), it->shortcut
+    };
+    if (shortcut.relevance)
+      scored.push_back(shortcut);
   }
-  std::partial_sort(matches_.begin(),
-      matches_.begin() +
-          std::min(AutocompleteProvider::kMaxMatches, matches_.size()),
-      matches_.end(), &AutocompleteMatch::MoreRelevant);
-  if (matches_.size() > AutocompleteProvider::kMaxMatches) {
-    matches_.erase(matches_.begin() + AutocompleteProvider::kMaxMatches,
-                   matches_.end());
+  const size_t num_matches =
+      std::min(AutocompleteProvider::kMaxMatches, scored.size());
+  std::partial_sort(scored.begin(), scored.begin() + num_matches, scored.end(),
+                    &MoreRelevantShortcut);
+  for (size_t i = 0; i < num_matches; ++i) {
+    matches_.push_back(ShortcutToACMatch(scored[i].relevance, term_string,
+                                         *scored[i].shortcut));
   }
   // Reset relevance scores to guarantee no match is given a score that may
   // allow it to become the highest ranked match (i.e., the default match)
@@ -314,19 +333,6 @@ ACMatchClassifications ShortcutsProvider::ClassifyAllMatchesInString(
   return AutocompleteMatch::MergeClassifications(original_class, match_class);
 }
 
-history::ShortcutsBackend::ShortcutMap::const_iterator
-    ShortcutsProvider::FindFirstMatch(const string16& keyword,
-                                      history::ShortcutsBackend* backend) {
-  DCHECK(backend);
-  history::ShortcutsBackend::ShortcutMap::const_iterator it =
-      backend->shortcuts_map().lower_bound(keyword);
-  // Lower bound not necessarily matches the keyword, check for item pointed by
-  // the lower bound iterator to at least start with keyword.
-  return ((it == backend->shortcuts_map().end()) ||
-    StartsWith(it->first, keyword, true)) ? it :
-    backend->shortcuts_map().end();
-}
-
 int ShortcutsProvider::CalculateScore(
     const string16& terms,
     const history::ShortcutsBackend::Shortcut& shortcut,
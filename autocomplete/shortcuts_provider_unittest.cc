@@ -129,6 +129,17 @@ struct TestShortcutInfo {
     "Echo", "0,4", 1, 1},
 };
 
+// Returns true if |backend| has a shortcut selected with exactly |text|.
+bool HasShortcutWithText(ShortcutsBackend* backend, const string16& text) {
+  ShortcutsBackend::ShortcutRange range(backend->FindShortcuts(text));
+  for (ShortcutsBackend::ShortcutIndex::const_iterator it = range.first;
+       it != range.second; ++it) {
+    if (*it->lower_text == text)
+      return true;
+  }
+  return false;
+}
+
 }  // namespace
 
 class ShortcutsProviderTest : public testing::Test,
@@ -205,7 +216,7 @@ void ShortcutsProviderTest::TearDown() {
 
 void ShortcutsProviderTest::FillData(TestShortcutInfo* db, size_t db_size) {
   DCHECK(provider_.get());
-  size_t expected_size = backend_->shortcuts_map().size() + db_size;
+  size_t expected_size = backend_->shortcut_index().size() + db_size;
   for (size_t i = 0; i < db_size; ++i) {
     const TestShortcutInfo& cur = db[i];
     ShortcutsBackend::Shortcut shortcut(
@@ -223,7 +234,7 @@ void ShortcutsProviderTest::FillData(TestShortcutInfo* db, size_t db_size) {
         cur.typed_count);
     backend_->AddShortcut(shortcut);
   }
-  EXPECT_EQ(expected_size, backend_->shortcuts_map().size());
+  EXPECT_EQ(expected_size, backend_->shortcut_index().size());
 }
 
 ShortcutsProviderTest::SetShouldContain::SetShouldContain(
@@ -529,15 +540,13 @@ TEST_F(ShortcutsProviderTest, DeleteMatch) {
       "Erase this shortcut!", "0,0", 1, 1},
   };
 
-  size_t original_shortcuts_count = backend_->shortcuts_map().size();
+  size_t original_shortcuts_count = backend_->shortcut_index().size();
 
   FillData(shortcuts_to_test_delete, arraysize(shortcuts_to_test_delete));
 
-  EXPECT_EQ(original_shortcuts_count + 4, backend_->shortcuts_map().size());
-  EXPECT_FALSE(backend_->shortcuts_map().end() ==
-               backend_->shortcuts_map().find(ASCIIToUTF16("delete")));
-  EXPECT_FALSE(backend_->shortcuts_map().end() ==
-               backend_->shortcuts_map().find(ASCIIToUTF16("erase")));
+  EXPECT_EQ(original_shortcuts_count + 4, backend_->shortcut_index().size());
+  EXPECT_TRUE(HasShortcutWithText(backend_.get(), ASCIIToUTF16("delete")));
+  EXPECT_TRUE(HasShortcutWithText(backend_.get(), ASCIIToUTF16("erase")));
 
   AutocompleteMatch match(
       provider_.get(), 1200, true, AutocompleteMatchType::HISTORY_TITLE);
@@ -551,20 +560,17 @@ TEST_F(ShortcutsProviderTest, DeleteMatch) {
   // shortcuts_to_test_delete[0] and shortcuts_to_test_delete[1] should be
   // deleted, but not shortcuts_to_test_delete[2] or
   // shortcuts_to_test_delete[3], which have different URLs.
-  EXPECT_EQ(original_shortcuts_count + 2, backend_->shortcuts_map().size());
-  EXPECT_FALSE(backend_->shortcuts_map().end() ==
-               backend_->shortcuts_map().find(ASCIIToUTF16("delete")));
-  EXPECT_TRUE(backend_->shortcuts_map().end() ==
-              backend_->shortcuts_map().find(ASCIIToUTF16("erase")));
+  EXPECT_EQ(original_shortcuts_count + 2, backend_->shortcut_index().size());
+  EXPECT_TRUE(HasShortcutWithText(backend_.get(), ASCIIToUTF16("delete")));
+  EXPECT_FALSE(HasShortcutWithText(backend_.get(), ASCIIToUTF16("erase")));
 
   match.destination_url = GURL(shortcuts_to_test_delete[3].url);
   match.contents = ASCIIToUTF16(shortcuts_to_test_delete[3].contents);
   match.description = ASCIIToUTF16(shortcuts_to_test_delete[3].description);
 
   provider_->DeleteMatch(match);
-  EXPECT_EQ(original_shortcuts_count + 1, backend_->shortcuts_map().size());
-  EXPECT_TRUE(backend_->shortcuts_map().end() ==
-              backend_->shortcuts_map().find(ASCIIToUTF16("delete")));
+  EXPECT_EQ(original_shortcuts_count + 1, backend_->shortcut_index().size());
+  EXPECT_FALSE(HasShortcutWithText(backend_.get(), ASCIIToUTF16("delete")));
 }
 
 TEST_F(ShortcutsProviderTest, Extension) {
@@ -66,4 +66,5 @@ void AllDownloadItemNotifier::OnDownloadDestroyed(
     content::DownloadItem* item) {
   item->RemoveObserver(this);
   observing_.erase(item);
+  observer_->OnDownloadDestroyed(manager_, item);
 }
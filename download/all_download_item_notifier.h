@@ -51,6 +51,10 @@ class AllDownloadItemNotifier : public content::DownloadManager::Observer,
         content::DownloadManager* manager, content::DownloadItem* item) {}
     virtual void OnDownloadRemoved(
         content::DownloadManager* manager, content::DownloadItem* item) {}
+    // Items are destroyed without being removed when their manager goes down.
+    // |manager| is NULL by then.
+    virtual void OnDownloadDestroyed(
+        content::DownloadManager* manager, content::DownloadItem* item) {}
 
    private:
     DISALLOW_COPY_AND_ASSIGN(Observer);
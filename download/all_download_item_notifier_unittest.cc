@@ -9,6 +9,7 @@
 #include "testing/gmock/include/gmock/gmock.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
+using testing::IsNull;
 using testing::NiceMock;
 using testing::SetArgPointee;
 using testing::_;
@@ -29,6 +30,8 @@ class MockNotifierObserver : public AllDownloadItemNotifier::Observer {
       content::DownloadManager* manager, content::DownloadItem* item));
   MOCK_METHOD2(OnDownloadRemoved, void(
       content::DownloadManager* manager, content::DownloadItem* item));
+  MOCK_METHOD2(OnDownloadDestroyed, void(
+      content::DownloadManager* manager, content::DownloadItem* item));
 
  private:
   DISALLOW_COPY_AND_ASSIGN(MockNotifierObserver);
@@ -116,6 +119,7 @@ TEST_F(AllDownloadItemNotifierTest,
   NotifierAsManagerObserver()->ManagerGoingDown(&manager());
 
   EXPECT_CALL(item(), RemoveObserver(NotifierAsItemObserver()));
+  EXPECT_CALL(observer(), OnDownloadDestroyed(IsNull(), &item()));
   NotifierAsItemObserver()->OnDownloadDestroyed(&item());
 
   ClearNotifier();
@@ -73,27 +73,19 @@ static bool MatchesQuery(
     const std::vector<string16>& query_terms,
     const DownloadItem& item) {
   DCHECK(!query_terms.empty());
-  string16 url_raw(UTF8ToUTF16(item.GetOriginalUrl().spec()));
-  string16 url_formatted = url_raw;
-  if (item.GetBrowserContext()) {
-    Profile* profile = Profile::FromBrowserContext(item.GetBrowserContext());
-    url_formatted = net::FormatUrl(
-        item.GetOriginalUrl(),
-        profile->GetPrefs()->GetString(prefs::kAcceptLanguages));
-  }
-  string16 path(item.GetTargetFilePath().LossyDisplayName());
+  std::vector<string16> strings;
+  DownloadQuery::GetQueryStrings(item, &strings);
 
   for (std::vector<string16>::const_iterator it = query_terms.begin();
        it != query_terms.end(); ++it) {
     string16 term = base::i18n::ToLower(*it);
-    if (!base::i18n::StringSearchIgnoringCaseAndAccents(
-            term, url_raw, NULL, NULL) &&
-        !base::i18n::StringSearchIgnoringCaseAndAccents(
-            term, url_formatted, NULL, NULL) &&
-        !base::i18n::StringSearchIgnoringCaseAndAccents(
-            term, path, NULL, NULL)) {
-      return false;
+    bool found = false;
+    for (size_t i = 0; !found && i < strings.size(); ++i) {
+      found = base::i18n::StringSearchIgnoringCaseAndAccents(
+          term, strings[i], NULL, NULL);
     }
+    if (!found)
+      return false;
   }
   return true;
 }
@@ -238,7 +230,11 @@ static ComparisonType Compare(
 }  // anonymous namespace
 
 DownloadQuery::DownloadQuery()
-  : limit_(kuint32max) {
+  : limit_(kuint32max),
+    has_state_(false),
+    state_(DownloadItem::IN_PROGRESS),
+    has_danger_(false),
+    danger_(content::DOWNLOAD_DANGER_TYPE_NOT_DANGEROUS) {
 }
 
 DownloadQuery::~DownloadQuery() {
@@ -255,18 +251,44 @@ bool DownloadQuery::AddFilter(const DownloadQuery::FilterCallback& value) {
   return true;
 }
 
+// static
+void DownloadQuery::GetQueryStrings(const DownloadItem& item,
+                                    std::vector<string16>* strings) {
+  string16 url_raw(UTF8ToUTF16(item.GetOriginalUrl().spec()));
+  string16 url_formatted = url_raw;
+  if (item.GetBrowserContext()) {
+    Profile* profile = Profile::FromBrowserContext(item.GetBrowserContext());
+    url_formatted = net::FormatUrl(
+        item.GetOriginalUrl(),
+        profile->GetPrefs()->GetString(prefs::kAcceptLanguages));
+  }
+  strings->push_back(base::i18n::ToLower(url_raw));
+  strings->push_back(base::i18n::ToLower(url_formatted));
+  strings->push_back(
+      base::i18n::ToLower(item.GetTargetFilePath().LossyDisplayName()));
+}
+
 void DownloadQuery::AddFilter(DownloadItem::DownloadState state) {
+  if (!has_state_) {
+    has_state_ = true;
+    state_ = state;
+  }
   AddFilter(base::Bind(&FieldMatches<DownloadItem::DownloadState>, state, EQ,
       base::Bind(&GetState)));
 }
 
 void DownloadQuery::AddFilter(DownloadDangerType danger) {
+  if (!has_danger_) {
+    has_danger_ = true;
+    danger_ = danger;
+  }
   AddFilter(base::Bind(&FieldMatches<DownloadDangerType>, danger, EQ,
       base::Bind(&GetDangerType)));
 }
 
 bool DownloadQuery::AddFilter(DownloadQuery::FilterType type,
                               const base::Value& value) {
+  std::string time;
   switch (type) {
     case FILTER_BYTES_RECEIVED:
       return AddFilter(BuildFilter<int>(value, EQ, &GetReceivedBytes));
@@ -284,9 +306,13 @@ bool DownloadQuery::AddFilter(DownloadQuery::FilterType type,
       return AddFilter(BuildFilter<bool>(value, EQ, &IsPaused));
     case FILTER_QUERY: {
       std::vector<string16> query_terms;
-      return GetAs(value, &query_terms) &&
-             (query_terms.empty() ||
-              AddFilter(base::Bind(&MatchesQuery, query_terms)));
+      if (!GetAs(value, &query_terms))
+        return false;
+      if (query_terms.empty())
+        return true;
+      query_terms_.insert(query_terms_.end(), query_terms.begin(),
+                          query_terms.end());
+      return AddFilter(base::Bind(&MatchesQuery, query_terms));
     }
     case FILTER_ENDED_AFTER:
       return AddFilter(BuildFilter<std::string>(value, GT, &GetEndTime));
@@ -295,11 +321,24 @@ bool DownloadQuery::AddFilter(DownloadQuery::FilterType type,
     case FILTER_END_TIME:
       return AddFilter(BuildFilter<std::string>(value, EQ, &GetEndTime));
     case FILTER_STARTED_AFTER:
-      return AddFilter(BuildFilter<std::string>(value, GT, &GetStartTime));
+      if (!AddFilter(BuildFilter<std::string>(value, GT, &GetStartTime)))
+        return false;
+      if (GetAs(value, &time) && time > started_after_)
+        started_after_ = time;
+      return true;
     case FILTER_STARTED_BEFORE:
-      return AddFilter(BuildFilter<std::string>(value, LT, &GetStartTime));
+      if (!AddFilter(BuildFilter<std::string>(value, LT, &GetStartTime)))
+        return false;
+      if (GetAs(value, &time) &&
+          (started_before_.empty() || time < started_before_))
+        started_before_ = time;
+      return true;
     case FILTER_START_TIME:
-      return AddFilter(BuildFilter<std::string>(value, EQ, &GetStartTime));
+      if (!AddFilter(BuildFilter<std::string>(value, EQ, &GetStartTime)))
+        return false;
+      if (GetAs(value, &time) && start_time_.empty())
+        start_time_ = time;
+      return true;
     case FILTER_TOTAL_BYTES:
       return AddFilter(BuildFilter<int>(value, EQ, &GetTotalBytes));
     case FILTER_TOTAL_BYTES_GREATER:
@@ -430,6 +469,11 @@ void DownloadQuery::AddSorter(DownloadQuery::SortType type,
   }
 }
 
+// static
+std::string DownloadQuery::GetStartTimeString(const DownloadItem& item) {
+  return GetStartTime(item);
+}
+
 void DownloadQuery::FinishSearch(DownloadQuery::DownloadVector* results) const {
   if (!sorters_.empty())
     std::partial_sort(results->begin(),
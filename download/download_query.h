@@ -10,6 +10,7 @@
 #include <vector>
 
 #include "base/callback_forward.h"
+#include "base/strings/string16.h"
 #include "content/public/browser/download_item.h"
 
 namespace base {
@@ -132,7 +133,14 @@ class DownloadQuery {
     FinishSearch(results);
   }
 
+  // Appends to |strings| the lower-cased texts of |item| that FILTER_QUERY
+  // terms are searched in: its original url, raw and formatted for display,
+  // and its target filename.
+  static void GetQueryStrings(const content::DownloadItem& item,
+                              std::vector<string16>* strings);
+
  private:
+  friend class DownloadQueryIndex;
   struct Sorter;
   class DownloadComparator;
   typedef std::vector<FilterCallback> FilterCallbackVector;
@@ -144,10 +152,27 @@ class DownloadQuery {
   bool Matches(const content::DownloadItem& item) const;
   void FinishSearch(DownloadVector* results) const;
 
+  // Returns the start time of |item| as the filters compare it.
+  static std::string GetStartTimeString(const content::DownloadItem& item);
+
   FilterCallbackVector filters_;
   SorterVector sorters_;
   size_t limit_;
 
+  // What the state, danger, start time and query filters require, recorded
+  // so that a DownloadQueryIndex can look up the few items they can match
+  // instead of running every filter on every item. The filters themselves
+  // still decide which items match.
+  bool has_state_;
+  content::DownloadItem::DownloadState state_;
+  bool has_danger_;
+  content::DownloadDangerType danger_;
+  // ISO 8601 bounds on the start time; empty when unbounded.
+  std::string started_after_;
+  std::string started_before_;
+  std::string start_time_;
+  std::vector<string16> query_terms_;
+
   DISALLOW_COPY_AND_ASSIGN(DownloadQuery);
 };
 
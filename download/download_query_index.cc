@@ -0,0 +1,442 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/download/download_query_index.h"
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+#include "base/logging.h"
+#include "content/public/browser/download_manager.h"
+#include "third_party/icu/source/common/unicode/uchar.h"
+#include "third_party/icu/source/common/unicode/uloc.h"
+#include "third_party/icu/source/common/unicode/uset.h"
+#include "third_party/icu/source/i18n/unicode/ucol.h"
+#include "third_party/icu/source/i18n/unicode/ucoleitr.h"
+
+using content::DownloadDangerType;
+using content::DownloadItem;
+
+namespace {
+
+// Under the folding of GetASCIIFolding(), punctuation, symbols and spaces only
+// match punctuation, symbols and spaces. So wherever a term is found, each of
+// its words is found within a word.
+bool IsWordSeparator(char16 c) {
+  return (U_GET_GC_MASK(c) & (U_GC_P_MASK | U_GC_S_MASK | U_GC_Z_MASK)) != 0;
+}
+
+bool IsPrintableASCII(const string16& text) {
+  for (size_t i = 0; i < text.size(); ++i) {
+    if (text[i] < 0x20 || text[i] >= 0x7f)
+      return false;
+  }
+  return true;
+}
+
+// Returns the number of primary collation elements of |text| under
+// |collator|, or -1 on error.
+int CountPrimaries(const UCollator* collator, const string16& text) {
+  UErrorCode status = U_ZERO_ERROR;
+  UCollationElements* elements = ucol_openElements(
+      collator, text.data(), static_cast<int32_t>(text.size()), &status);
+  if (U_FAILURE(status))
+    return -1;
+  int count = 0;
+  int32_t order;
+  while ((order = ucol_next(elements, &status)) != UCOL_NULLORDER) {
+    if (ucol_primaryOrder(order) != 0)
+      ++count;
+  }
+  ucol_closeElements(elements);
+  return U_FAILURE(status) ? -1 : count;
+}
+
+// Returns whether |collator| has a contraction made only of printable ASCII.
+bool HasASCIIContraction(const UCollator* collator) {
+  UErrorCode status = U_ZERO_ERROR;
+  USet* tailored = ucol_getTailoredSet(collator, &status);
+  if (U_FAILURE(status))
+    return true;
+  bool found = false;
+  for (int32_t i = 0; !found && i < uset_getItemCount(tailored); ++i) {
+    UChar32 start, end;
+    status = U_ZERO_ERROR;
+    int32_t length = uset_getItem(tailored, i, &start, &end, NULL, 0, &status);
+    if (length == 0)
+      continue;  // A range of characters, not a string.
+    string16 contraction(length, 0);
+    status = U_ZERO_ERROR;
+    uset_getItem(tailored, i, &start, &end, &contraction[0], length, &status);
+    found = U_FAILURE(status) || IsPrintableASCII(contraction);
+  }
+  uset_close(tailored);
+  return found;
+}
+
+// DownloadQuery searches for query terms with
+// base::i18n::StringSearchIgnoringCaseAndAccents(), which compares at the
+// primary strength of the collator of the default locale. Returns, indexed by character, the first printable ASCII
+// character that collator deems equal to each printable ASCII character, and
+// 0 for the other characters. Within printable ASCII text, a term then matches
+// where its folding is a substring of the text's folding.
+//
+// Returns an empty string if the collator does not compare printable ASCII
+// one character at a time, with an ignorable character, an expansion or a
+// contraction, as some tailorings do. Other characters are not folded at all:
+// ß, æ and ligatures match several letters, and collators disagree on which.
+string16 GetASCIIFolding() {
+  UErrorCode status = U_ZERO_ERROR;
+  UCollator* collator = ucol_open(uloc_getDefault(), &status);
+  if (U_FAILURE(status))
+    return string16();
+  ucol_setStrength(collator, UCOL_PRIMARY);
+
+  string16 folding(0x80, 0);
+  for (UChar c = 0x20; c < 0x7f; ++c) {
+    if (CountPrimaries(collator, string16(1, c)) != 1) {
+      folding.clear();
+      break;
+    }
+    folding[c] = c;
+    for (UChar other = 0x20; other < c; ++other) {
+      if (folding[other] == other &&
+          ucol_strcoll(collator, &c, 1, &other, 1) == UCOL_EQUAL) {
+        folding[c] = other;
+        break;
+      }
+    }
+  }
+  if (!folding.empty() && HasASCIIContraction(collator))
+    folding.clear();
+  ucol_close(collator);
+  return folding;
+}
+
+// Folds |text| into |folded| with |folding|, as returned by
+// GetASCIIFolding(). Returns false if |text| has characters it cannot fold.
+bool FoldText(const string16& folding,
+              const string16& text,
+              string16* folded) {
+  folded->clear();
+  folded->reserve(text.size());
+  for (size_t i = 0; i < text.size(); ++i) {
+    if (text[i] >= folding.size() || !folding[text[i]])
+      return false;
+    folded->push_back(folding[text[i]]);
+  }
+  return true;
+}
+
+// Splits the folded |text| into words.
+void SplitWords(const string16& text, std::set<string16>* words) {
+  size_t start = 0;
+  for (size_t i = 0; i <= text.size(); ++i) {
+    if (i < text.size() && !IsWordSeparator(text[i]))
+      continue;
+    if (i > start)
+      words->insert(text.substr(start, i - start));
+    start = i + 1;
+  }
+}
+
+template <typename Key>
+void AddToSet(std::map<Key, std::set<DownloadItem*> >* sets,
+              const Key& key,
+              DownloadItem* item) {
+  (*sets)[key].insert(item);
+}
+
+template <typename Key>
+void RemoveFromSet(std::map<Key, std::set<DownloadItem*> >* sets,
+                   const Key& key,
+                   DownloadItem* item) {
+  typename std::map<Key, std::set<DownloadItem*> >::iterator it =
+      sets->find(key);
+  if (it == sets->end())
+    return;
+  it->second.erase(item);
+  if (it->second.empty())
+    sets->erase(it);
+}
+
+}  // namespace
+
+DownloadQueryIndex::Entry::Entry()
+    : state(DownloadItem::IN_PROGRESS),
+      danger(content::DOWNLOAD_DANGER_TYPE_NOT_DANGEROUS) {
+}
+
+DownloadQueryIndex::Entry::~Entry() {
+}
+
+DownloadQueryIndex::LiveQuery::LiveQuery() {
+}
+
+DownloadQueryIndex::LiveQuery::~LiveQuery() {
+}
+
+DownloadQueryIndex::DownloadQueryIndex()
+    : folding_(GetASCIIFolding()),
+      next_live_query_id_(0) {
+}
+
+DownloadQueryIndex::~DownloadQueryIndex() {
+}
+
+void DownloadQueryIndex::AddManager(content::DownloadManager* manager) {
+  notifiers_.push_back(new AllDownloadItemNotifier(manager, this));
+  // The notifier only reports the downloads created from now on.
+  content::DownloadManager::DownloadVector items;
+  manager->GetAllDownloads(&items);
+  for (content::DownloadManager::DownloadVector::const_iterator it =
+           items.begin();
+       it != items.end(); ++it) {
+    OnDownloadCreated(manager, *it);
+  }
+}
+
+void DownloadQueryIndex::Search(const DownloadQuery& query,
+                                DownloadVector* results) const {
+  results->clear();
+  FindMatches(query, results);
+  query.FinishSearch(results);
+}
+
+int DownloadQueryIndex::AddLiveQuery(scoped_ptr<DownloadQuery> query) {
+  int id = next_live_query_id_++;
+  LiveQuery& live_query = live_queries_[id];
+  DownloadVector matches;
+  FindMatches(*query, &matches);
+  live_query.matches.insert(matches.begin(), matches.end());
+  live_query.query.reset(query.release());
+  return id;
+}
+
+void DownloadQueryIndex::RemoveLiveQuery(int id) {
+  live_queries_.erase(id);
+}
+
+void DownloadQueryIndex::GetLiveResults(int id,
+                                        DownloadVector* results) const {
+  results->clear();
+  std::map<int, LiveQuery>::const_iterator it = live_queries_.find(id);
+  if (it == live_queries_.end()) {
+    NOTREACHED();
+    return;
+  }
+  results->assign(it->second.matches.begin(), it->second.matches.end());
+  it->second.query->FinishSearch(results);
+}
+
+void DownloadQueryIndex::OnDownloadCreated(content::DownloadManager* manager,
+                                           DownloadItem* item) {
+  OnDownloadUpdated(manager, item);
+}
+
+void DownloadQueryIndex::OnDownloadUpdated(content::DownloadManager* manager,
+                                           DownloadItem* item) {
+  IndexItem(item);
+  for (std::map<int, LiveQuery>::iterator it = live_queries_.begin();
+       it != live_queries_.end(); ++it) {
+    if (it->second.query->Matches(*item))
+      it->second.matches.insert(item);
+    else
+      it->second.matches.erase(item);
+  }
+}
+
+void DownloadQueryIndex::OnDownloadRemoved(content::DownloadManager* manager,
+                                           DownloadItem* item) {
+  UnindexItem(item);
+}
+
+void DownloadQueryIndex::OnDownloadDestroyed(content::DownloadManager* manager,
+                                             DownloadItem* item) {
+  UnindexItem(item);
+}
+
+void DownloadQueryIndex::IndexItem(DownloadItem* item) {
+  std::pair<std::map<DownloadItem*, Entry>::iterator, bool> inserted =
+      entries_.insert(std::make_pair(item, Entry()));
+  Entry& entry = inserted.first->second;
+  bool is_new = inserted.second;
+
+  if (is_new || entry.state != item->GetState()) {
+    if (!is_new)
+      RemoveFromSet(&by_state_, entry.state, item);
+    entry.state = item->GetState();
+    AddToSet(&by_state_, entry.state, item);
+  }
+  if (is_new || entry.danger != item->GetDangerType()) {
+    if (!is_new)
+      RemoveFromSet(&by_danger_, entry.danger, item);
+    entry.danger = item->GetDangerType();
+    AddToSet(&by_danger_, entry.danger, item);
+  }
+  std::string start_time = DownloadQuery::GetStartTimeString(*item);
+  if (is_new || entry.start_time != start_time) {
+    by_start_time_.erase(StartTimeKey(entry.start_time, item));
+    entry.start_time = start_time;
+    by_start_time_.insert(StartTimeKey(entry.start_time, item));
+  }
+
+  // The url does not change, so the words only have to be found again when
+  // the target is determined or renamed. Updates while the download is in
+  // progress do not pay for formatting the url.
+  if (is_new || entry.target_path != item->GetTargetFilePath()) {
+    UnindexWords(entry, item);
+    entry.target_path = item->GetTargetFilePath();
+    entry.words.clear();
+    std::vector<string16> strings;
+    DownloadQuery::GetQueryStrings(*item, &strings);
+    string16 folded;
+    for (size_t i = 0; i < strings.size(); ++i) {
+      if (!FoldText(folding_, strings[i], &folded)) {
+        // Every term lookup yields the item instead.
+        entry.words.clear();
+        unfolded_items_.insert(item);
+        break;
+      }
+      SplitWords(folded, &entry.words);
+    }
+    for (std::set<string16>::const_iterator it = entry.words.begin();
+         it != entry.words.end(); ++it) {
+      for (size_t start = 0; start < it->size(); ++start)
+        AddToSet(&by_word_suffix_, it->substr(start), item);
+    }
+  }
+}
+
+void DownloadQueryIndex::UnindexWords(const Entry& entry, DownloadItem* item) {
+  unfolded_items_.erase(item);
+  for (std::set<string16>::const_iterator it = entry.words.begin();
+       it != entry.words.end(); ++it) {
+    for (size_t start = 0; start < it->size(); ++start)
+      RemoveFromSet(&by_word_suffix_, it->substr(start), item);
+  }
+}
+
+void DownloadQueryIndex::UnindexItem(DownloadItem* item) {
+  std::map<DownloadItem*, Entry>::iterator found = entries_.find(item);
+  if (found == entries_.end())
+    return;
+  const Entry& entry = found->second;
+  RemoveFromSet(&by_state_, entry.state, item);
+  RemoveFromSet(&by_danger_, entry.danger, item);
+  by_start_time_.erase(StartTimeKey(entry.start_time, item));
+  UnindexWords(entry, item);
+  entries_.erase(found);
+
+  for (std::map<int, LiveQuery>::iterator it = live_queries_.begin();
+       it != live_queries_.end(); ++it) {
+    it->second.matches.erase(item);
+  }
+}
+
+void DownloadQueryIndex::FindMatches(const DownloadQuery& query,
+                                     DownloadVector* matches) const {
+  // Only the smallest set of candidates that one of the indexes yields is
+  // searched; the query's filters take care of the rest of its constraints.
+  const ItemSet* candidates = NULL;
+  if (query.has_state_) {
+    std::map<DownloadItem::DownloadState, ItemSet>::const_iterator it =
+        by_state_.find(query.state_);
+    if (it == by_state_.end())
+      return;
+    candidates = &it->second;
+  }
+  if (query.has_danger_) {
+    std::map<DownloadDangerType, ItemSet>::const_iterator it =
+        by_danger_.find(query.danger_);
+    if (it == by_danger_.end())
+      return;
+    if (!candidates || it->second.size() < candidates->size())
+      candidates = &it->second;
+  }
+  ItemSet started;
+  if (!query.started_after_.empty() || !query.started_before_.empty() ||
+      !query.start_time_.empty()) {
+    FindStartTimes(query, &started);
+    if (!candidates || started.size() < candidates->size())
+      candidates = &started;
+  }
+  ItemSet term_items[2];
+  for (size_t i = 0; i < query.query_terms_.size(); ++i) {
+    // |term_items| holds the smallest set found so far, and the next one.
+    ItemSet* items = &term_items[candidates == &term_items[0] ? 1 : 0];
+    items->clear();
+    if (FindTerm(query.query_terms_[i], items) &&
+        (!candidates || items->size() < candidates->size())) {
+      candidates = items;
+    }
+  }
+
+  if (candidates) {
+    DownloadVector searched;
+    query.Search(candidates->begin(), candidates->end(), &searched);
+    matches->insert(matches->end(), searched.begin(), searched.end());
+    return;
+  }
+  for (std::map<DownloadItem*, Entry>::const_iterator it = entries_.begin();
+       it != entries_.end(); ++it) {
+    if (query.Matches(*it->first))
+      matches->push_back(it->first);
+  }
+}
+
+void DownloadQueryIndex::FindStartTimes(const DownloadQuery& query,
+                                        ItemSet* items) const {
+  std::string lower = std::max(query.started_after_, query.start_time_);
+  for (std::set<StartTimeKey>::const_iterator it =
+           by_start_time_.lower_bound(StartTimeKey(lower, NULL));
+       it != by_start_time_.end(); ++it) {
+    const std::string& start_time = it->first;
+    if (!query.started_before_.empty() && start_time >= query.started_before_)
+      break;
+    if (!query.start_time_.empty() && start_time != query.start_time_)
+      break;
+    if (start_time == query.started_after_)
+      continue;
+    items->insert(it->second);
+  }
+}
+
+bool DownloadQueryIndex::FindTerm(const string16& term, ItemSet* items) const {
+  string16 folded;
+  if (!FoldText(folding_, term, &folded))
+    return false;
+  std::set<string16> term_words;
+  SplitWords(folded, &term_words);
+  if (term_words.empty())
+    return false;
+
+  // A word contains |term_word| if one of its suffixes starts with it, and
+  // those suffixes are next to each other in |by_word_suffix_|.
+  for (std::set<string16>::const_iterator term_word = term_words.begin();
+       term_word != term_words.end(); ++term_word) {
+    ItemSet word_items;
+    for (std::map<string16, ItemSet>::const_iterator suffix =
+             by_word_suffix_.lower_bound(*term_word);
+         suffix != by_word_suffix_.end() &&
+             suffix->first.compare(0, term_word->size(), *term_word) == 0;
+         ++suffix) {
+      word_items.insert(suffix->second.begin(), suffix->second.end());
+    }
+    if (term_word == term_words.begin()) {
+      items->swap(word_items);
+    } else {
+      ItemSet both;
+      std::set_intersection(items->begin(), items->end(),
+                            word_items.begin(), word_items.end(),
+                            std::inserter(both, both.begin()));
+      items->swap(both);
+    }
+    if (items->empty())
+      break;
+  }
+  items->insert(unfolded_items_.begin(), unfolded_items_.end());
+  return true;
+}
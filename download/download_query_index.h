@@ -0,0 +1,145 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_DOWNLOAD_DOWNLOAD_QUERY_INDEX_H_
+#define CHROME_BROWSER_DOWNLOAD_DOWNLOAD_QUERY_INDEX_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+
+#include "base/basictypes.h"
+#include "base/compiler_specific.h"
+#include "base/files/file_path.h"
+#include "base/memory/linked_ptr.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/scoped_vector.h"
+#include "base/strings/string16.h"
+#include "chrome/browser/download/all_download_item_notifier.h"
+#include "chrome/browser/download/download_query.h"
+
+// Indexes the DownloadItems of one or more DownloadManagers by state, danger
+// type, start time and the words of their urls and filenames, so that a
+// DownloadQuery only runs its filters on the items those can match instead of
+// on every download. Also keeps the matches of live queries, which are updated
+// an item at a time as downloads change instead of searched for again.
+//
+// DownloadQueryIndex index;
+// index.AddManager(manager);
+// scoped_ptr<DownloadQuery> query(new DownloadQuery);
+// query->AddFilter(DownloadItem::COMPLETE);
+// query->AddSorter(DownloadQuery::SORT_START_TIME, DownloadQuery::DESCENDING);
+// int id = index.AddLiveQuery(query.Pass());
+// ...
+// DownloadQuery::DownloadVector results;
+// index.GetLiveResults(id, &results);
+class DownloadQueryIndex : public AllDownloadItemNotifier::Observer {
+ public:
+  typedef DownloadQuery::DownloadVector DownloadVector;
+
+  DownloadQueryIndex();
+  virtual ~DownloadQueryIndex();
+
+  // Indexes the downloads of |manager|, and keeps them indexed until they are
+  // removed or destroyed.
+  void AddManager(content::DownloadManager* manager);
+
+  // Like DownloadQuery::Search() over all the indexed downloads. Items that
+  // all of |query|'s sorters compare equally come in no particular order.
+  void Search(const DownloadQuery& query, DownloadVector* results) const;
+
+  // Starts keeping the matches of |query|. Returns the id to pass to
+  // GetLiveResults() and RemoveLiveQuery().
+  int AddLiveQuery(scoped_ptr<DownloadQuery> query);
+  void RemoveLiveQuery(int id);
+
+  // Sorts and limits the current matches of the live query |id| into
+  // |results|, without searching the downloads again.
+  void GetLiveResults(int id, DownloadVector* results) const;
+
+  size_t size() const { return entries_.size(); }
+
+  // AllDownloadItemNotifier::Observer
+  virtual void OnDownloadCreated(
+      content::DownloadManager* manager,
+      content::DownloadItem* item) OVERRIDE;
+  virtual void OnDownloadUpdated(
+      content::DownloadManager* manager,
+      content::DownloadItem* item) OVERRIDE;
+  virtual void OnDownloadRemoved(
+      content::DownloadManager* manager,
+      content::DownloadItem* item) OVERRIDE;
+  virtual void OnDownloadDestroyed(
+      content::DownloadManager* manager,
+      content::DownloadItem* item) OVERRIDE;
+
+ private:
+  typedef std::set<content::DownloadItem*> ItemSet;
+  typedef std::pair<std::string, content::DownloadItem*> StartTimeKey;
+
+  // What an item is indexed under, so that it can be found again when it
+  // changes.
+  struct Entry {
+    Entry();
+    ~Entry();
+
+    content::DownloadItem::DownloadState state;
+    content::DownloadDangerType danger;
+    std::string start_time;
+    base::FilePath target_path;
+    // Folded for comparison as query terms are searched for. Empty if the
+    // item is in |unfolded_items_|.
+    std::set<string16> words;
+  };
+
+  struct LiveQuery {
+    LiveQuery();
+    ~LiveQuery();
+
+    linked_ptr<DownloadQuery> query;
+    ItemSet matches;
+  };
+
+  // Adds |item| to the indexes, or moves it to where it now belongs.
+  void IndexItem(content::DownloadItem* item);
+  void UnindexItem(content::DownloadItem* item);
+  void UnindexWords(const Entry& entry, content::DownloadItem* item);
+
+  // Appends the items matching |query| to |matches|, unsorted and unlimited.
+  void FindMatches(const DownloadQuery& query, DownloadVector* matches) const;
+
+  // Fills |items| with the items whose start time is within the bounds of
+  // |query|.
+  void FindStartTimes(const DownloadQuery& query, ItemSet* items) const;
+
+  // Fills |items| with the items that may contain the query term |term|.
+  // Returns false if the word index cannot narrow down |term|, which is when
+  // |term| has characters that |folding_| does not fold.
+  bool FindTerm(const string16& term, ItemSet* items) const;
+
+  ScopedVector<AllDownloadItemNotifier> notifiers_;
+
+  // Folds printable ASCII as the collator query terms are searched with
+  // compares it. Empty if that collator's comparisons cannot be folded.
+  const string16 folding_;
+
+  std::map<content::DownloadItem*, Entry> entries_;
+  std::map<content::DownloadItem::DownloadState, ItemSet> by_state_;
+  std::map<content::DownloadDangerType, ItemSet> by_danger_;
+  std::set<StartTimeKey> by_start_time_;
+  // Every suffix of the words of |entries_|, so that the words containing a
+  // query word are found with a range lookup.
+  std::map<string16, ItemSet> by_word_suffix_;
+  // The items with text that |folding_| does not fold, which the word index
+  // cannot rule out for any term.
+  ItemSet unfolded_items_;
+
+  std::map<int, LiveQuery> live_queries_;
+  int next_live_query_id_;
+
+  DISALLOW_COPY_AND_ASSIGN(DownloadQueryIndex);
+};
+
+#endif  // CHROME_BROWSER_DOWNLOAD_DOWNLOAD_QUERY_INDEX_H_
@@ -0,0 +1,250 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/download/download_query_index.h"
+
+#include <string>
+#include <vector>
+
+#include "base/files/file_path.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/stl_util.h"
+#include "base/time/time.h"
+#include "base/values.h"
+#include "content/public/test/mock_download_item.h"
+#include "testing/gmock/include/gmock/gmock.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "url/gurl.h"
+
+using ::testing::NiceMock;
+using ::testing::Return;
+using ::testing::ReturnRef;
+using content::DownloadItem;
+typedef DownloadQuery::DownloadVector DownloadVector;
+
+namespace {
+
+static const int kSomeKnownTime = 1355864160;
+static const char kSomeKnownTime8601[] = "2012-12-18T20:56:0";
+static const char k8601Suffix[] = ".000Z";
+
+// A download and the values its mock returns by reference.
+struct FakeDownload {
+  FakeDownload(uint32 id, const std::string& url_spec, const char* filename,
+               int start_time_offset)
+      : url(url_spec),
+        target_path(base::FilePath::FromUTF8Unsafe(filename)) {
+    ON_CALL(item, GetId()).WillByDefault(Return(id));
+    ON_CALL(item, GetOriginalUrl()).WillByDefault(ReturnRef(this->url));
+    ON_CALL(item, GetTargetFilePath()).WillByDefault(ReturnRef(target_path));
+    ON_CALL(item, GetBrowserContext()).WillByDefault(Return(
+        static_cast<content::BrowserContext*>(NULL)));
+    ON_CALL(item, GetStartTime()).WillByDefault(Return(
+        base::Time::FromTimeT(kSomeKnownTime + start_time_offset)));
+    ON_CALL(item, GetState()).WillByDefault(Return(DownloadItem::COMPLETE));
+    ON_CALL(item, GetDangerType()).WillByDefault(Return(
+        content::DOWNLOAD_DANGER_TYPE_NOT_DANGEROUS));
+  }
+
+  GURL url;
+  base::FilePath target_path;
+  NiceMock<content::MockDownloadItem> item;
+};
+
+}  // namespace
+
+class DownloadQueryIndexTest : public testing::Test {
+ public:
+  DownloadQueryIndexTest() {}
+
+  virtual void TearDown() OVERRIDE {
+    STLDeleteElements(&downloads_);
+  }
+
+  DownloadItem* AddDownload(const std::string& url, const char* filename,
+                            int start_time_offset) {
+    downloads_.push_back(new FakeDownload(downloads_.size(), url, filename,
+                                          start_time_offset));
+    index_.OnDownloadCreated(NULL, &downloads_.back()->item);
+    return &downloads_.back()->item;
+  }
+
+  content::MockDownloadItem& mock(int index) { return downloads_[index]->item; }
+
+  DownloadQueryIndex* index() { return &index_; }
+
+  // Returns the ids of the items |query| finds in the index, which must be the
+  // items it finds among all the downloads.
+  std::string Search(const DownloadQuery& query) {
+    DownloadVector all_items, expected, results;
+    for (size_t i = 0; i < downloads_.size(); ++i)
+      all_items.push_back(&downloads_[i]->item);
+    query.Search(all_items.begin(), all_items.end(), &expected);
+    index_.Search(query, &results);
+    EXPECT_EQ(expected, results);
+    return Ids(results);
+  }
+
+  static std::string Ids(const DownloadVector& items) {
+    std::string ids;
+    for (size_t i = 0; i < items.size(); ++i)
+      ids += static_cast<char>('0' + items[i]->GetId());
+    return ids;
+  }
+
+ private:
+  std::vector<FakeDownload*> downloads_;
+  DownloadQueryIndex index_;
+
+  DISALLOW_COPY_AND_ASSIGN(DownloadQueryIndexTest);
+};
+
+TEST_F(DownloadQueryIndexTest, Search) {
+  AddDownload("http://example.com/report", "Report.pdf", 1);
+  AddDownload("http://example.com/photo", "photo.jpg", 2);
+  AddDownload("http://other.org/setup", "setup.exe", 3);
+  EXPECT_CALL(mock(2), GetState()).WillRepeatedly(Return(
+      DownloadItem::IN_PROGRESS));
+  EXPECT_CALL(mock(2), GetDangerType()).WillRepeatedly(Return(
+      content::DOWNLOAD_DANGER_TYPE_DANGEROUS_FILE));
+  index()->OnDownloadUpdated(NULL, &mock(2));
+
+  {
+    DownloadQuery query;
+    query.AddSorter(DownloadQuery::SORT_START_TIME, DownloadQuery::ASCENDING);
+    EXPECT_EQ("012", Search(query));
+  }
+  {
+    DownloadQuery query;
+    query.AddFilter(DownloadItem::COMPLETE);
+    query.AddSorter(DownloadQuery::SORT_START_TIME, DownloadQuery::DESCENDING);
+    EXPECT_EQ("10", Search(query));
+  }
+  {
+    DownloadQuery query;
+    query.AddFilter(content::DOWNLOAD_DANGER_TYPE_DANGEROUS_FILE);
+    EXPECT_EQ("2", Search(query));
+  }
+  {
+    DownloadQuery query;
+    query.AddFilter(DownloadItem::INTERRUPTED);
+    EXPECT_EQ("", Search(query));
+  }
+  {
+    DownloadQuery query;
+    scoped_ptr<base::Value> value(base::Value::CreateStringValue(
+        std::string(kSomeKnownTime8601) + "1" + k8601Suffix));
+    ASSERT_TRUE(query.AddFilter(DownloadQuery::FILTER_STARTED_AFTER, *value));
+    value.reset(base::Value::CreateStringValue(
+        std::string(kSomeKnownTime8601) + "3" + k8601Suffix));
+    ASSERT_TRUE(query.AddFilter(DownloadQuery::FILTER_STARTED_BEFORE, *value));
+    EXPECT_EQ("1", Search(query));
+  }
+}
+
+TEST_F(DownloadQueryIndexTest, SearchQueryTerms) {
+  AddDownload("http://example.com/report", "Report.pdf", 1);
+  AddDownload("http://example.com/photo", "photo.jpg", 2);
+  AddDownload("http://other.org/setup", "setup.exe", 3);
+
+  const char* kTerms[][2] = {
+    {"REPO", "0"},          // Within a word, ignoring case.
+    {"example", "01"},      // Within a word of the url.
+    {"other.org/se", "2"},  // Across words.
+    {"t.p", "0"},           // Across the end of one word and the next.
+    {"t.px", ""},
+    {"...", ""},            // No words at all, so the index cannot narrow it.
+  };
+  for (size_t i = 0; i < arraysize(kTerms); ++i) {
+    DownloadQuery query;
+    base::ListValue terms;
+    terms.Append(base::Value::CreateStringValue(kTerms[i][0]));
+    ASSERT_TRUE(query.AddFilter(DownloadQuery::FILTER_QUERY, terms));
+    query.AddSorter(DownloadQuery::SORT_START_TIME, DownloadQuery::ASCENDING);
+    EXPECT_EQ(kTerms[i][1], Search(query)) << kTerms[i][0];
+  }
+}
+
+TEST_F(DownloadQueryIndexTest, SearchIgnoresAccents) {
+  AddDownload("http://example.com/cv", "R\xC3\xA9sum\xC3\xA9.pdf", 1);
+  AddDownload("http://example.com/cv2", "resume.pdf", 2);
+
+  const char* kTerms[][2] = {
+    {"resume", "01"},
+    {"SUM\xC3\x89", "01"},
+    {"\xC3\xA9sum\xC3\xA9.p", "01"},
+    {"resumes", ""},
+  };
+  for (size_t i = 0; i < arraysize(kTerms); ++i) {
+    DownloadQuery query;
+    base::ListValue terms;
+    terms.Append(base::Value::CreateStringValue(kTerms[i][0]));
+    ASSERT_TRUE(query.AddFilter(DownloadQuery::FILTER_QUERY, terms));
+    query.AddSorter(DownloadQuery::SORT_START_TIME, DownloadQuery::ASCENDING);
+    EXPECT_EQ(kTerms[i][1], Search(query)) << kTerms[i][0];
+  }
+}
+
+TEST_F(DownloadQueryIndexTest, SearchLettersMatchingSeveral) {
+  // The collator matches these letters with others than their decompositions,
+  // so the index must find what searching every download does.
+  AddDownload("http://example.com/a", "Stra\xC3\x9F" "e.txt", 1);
+  AddDownload("http://example.com/b", "\xC3\x86gis.pdf", 2);
+  AddDownload("http://example.com/c", "S\xC3\xB8ren.jpg", 3);
+  AddDownload("http://example.com/d", "strasse aegis soren.txt", 4);
+
+  const char* kTerms[] = {
+    "strasse", "STRA\xC3\x9F" "E", "ss", "\xC3\x9F", "aegis", "\xC3\xA6",
+    "ae", "soren", "s\xC3\xB8", "o", "example.com/b",
+  };
+  for (size_t i = 0; i < arraysize(kTerms); ++i) {
+    DownloadQuery query;
+    base::ListValue terms;
+    terms.Append(base::Value::CreateStringValue(kTerms[i]));
+    ASSERT_TRUE(query.AddFilter(DownloadQuery::FILTER_QUERY, terms));
+    query.AddSorter(DownloadQuery::SORT_START_TIME, DownloadQuery::ASCENDING);
+    Search(query);
+  }
+
+  // A plain term still finds the download that only matches through ß.
+  DownloadQuery query;
+  base::ListValue terms;
+  terms.Append(base::Value::CreateStringValue("strasse"));
+  ASSERT_TRUE(query.AddFilter(DownloadQuery::FILTER_QUERY, terms));
+  query.AddSorter(DownloadQuery::SORT_START_TIME, DownloadQuery::ASCENDING);
+  EXPECT_EQ("03", Search(query));
+}
+
+TEST_F(DownloadQueryIndexTest, LiveQuery) {
+  AddDownload("http://example.com/report", "report.pdf", 1);
+  DownloadItem* in_progress = AddDownload("http://example.com/photo",
+                                          "photo.jpg", 2);
+  EXPECT_CALL(mock(1), GetState()).WillRepeatedly(Return(
+      DownloadItem::IN_PROGRESS));
+  index()->OnDownloadUpdated(NULL, in_progress);
+
+  scoped_ptr<DownloadQuery> query(new DownloadQuery);
+  query->AddFilter(DownloadItem::COMPLETE);
+  query->AddSorter(DownloadQuery::SORT_START_TIME, DownloadQuery::DESCENDING);
+  int id = index()->AddLiveQuery(query.Pass());
+  DownloadVector results;
+  index()->GetLiveResults(id, &results);
+  EXPECT_EQ("0", Ids(results));
+
+  // Downloads join and leave the results as they change.
+  EXPECT_CALL(mock(1), GetState()).WillRepeatedly(Return(
+      DownloadItem::COMPLETE));
+  index()->OnDownloadUpdated(NULL, in_progress);
+  AddDownload("http://example.com/setup", "setup.exe", 3);
+  index()->GetLiveResults(id, &results);
+  EXPECT_EQ("210", Ids(results));
+
+  index()->OnDownloadRemoved(NULL, in_progress);
+  index()->OnDownloadDestroyed(NULL, &mock(2));
+  index()->GetLiveResults(id, &results);
+  EXPECT_EQ("0", Ids(results));
+  EXPECT_EQ(1u, index()->size());
+
+  index()->RemoveLiveQuery(id);
+}
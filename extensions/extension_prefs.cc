@@ -416,13 +416,28 @@ const DictionaryValue* ExtensionPrefs::GetExtensionPref(
 void ExtensionPrefs::UpdateExtensionPref(const std::string& extension_id,
                                          const std::string& key,
                                          Value* data_value) {
+  scoped_ptr<Value> value(data_value);
   if (!Extension::IdIsValid(extension_id)) {
     NOTREACHED() << "Invalid extension_id " << extension_id;
     return;
   }
+
+  // Any update writes out the whole Preferences file, which holds the
+  // manifests of all the extensions. Skip the update if it doesn't change
+  // anything, like UpdateManifest() does.
+  const DictionaryValue* extension = GetExtensionPref(extension_id);
+  if (extension) {
+    const Value* old_value = NULL;
+    bool has_old_value = extension->Get(key, &old_value);
+    bool unchanged = value.get() ? has_old_value && value->Equals(old_value)
+                                 : !has_old_value;
+    if (unchanged)
+      return;
+  }
+
   ScopedExtensionPrefUpdate update(prefs_, extension_id);
-  if (data_value)
-    update->Set(key, data_value);
+  if (value)
+    update->Set(key, value.release());
   else
     update->Remove(key, NULL);
 }
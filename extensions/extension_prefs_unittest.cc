@@ -19,6 +19,7 @@
 #include "chrome/browser/prefs/scoped_user_pref_update.h"
 #include "chrome/common/chrome_paths.h"
 #include "chrome/common/extensions/permissions/permission_set.h"
+#include "chrome/common/pref_names.h"
 #include "components/user_prefs/pref_registry_syncable.h"
 #include "content/public/browser/notification_details.h"
 #include "content/public/browser/notification_source.h"
@@ -95,6 +96,46 @@ class ExtensionPrefsLastPingDay : public ExtensionPrefsTest {
 };
 TEST_F(ExtensionPrefsLastPingDay, LastPingDay) {}
 
+// Tests that updates which don't change an extension's prefs aren't written.
+class ExtensionPrefsUnchangedUpdate : public ExtensionPrefsTest {
+ public:
+  virtual void Initialize() OVERRIDE {
+    using testing::_;
+    using testing::Mock;
+
+    extension_id_ = prefs_.AddExtensionAndReturnId("unchanged_update");
+    prefs()->SetIsActive(extension_id_, true);
+
+    MockPrefChangeCallback observer(prefs_.pref_service());
+    PrefChangeRegistrar registrar;
+    registrar.Init(prefs_.pref_service());
+    registrar.Add(prefs::kExtensionsPref, observer.GetCallback());
+
+    // Same value.
+    EXPECT_CALL(observer, OnPreferenceChanged(_)).Times(0);
+    prefs()->SetIsActive(extension_id_, true);
+    Mock::VerifyAndClearExpectations(&observer);
+
+    // Removing a value that isn't there.
+    EXPECT_CALL(observer, OnPreferenceChanged(_)).Times(0);
+    prefs()->UpdateExtensionPref(extension_id_, "not_there", NULL);
+    Mock::VerifyAndClearExpectations(&observer);
+
+    // Changed value.
+    EXPECT_CALL(observer, OnPreferenceChanged(_));
+    prefs()->SetIsActive(extension_id_, false);
+    Mock::VerifyAndClearExpectations(&observer);
+  }
+
+  virtual void Verify() OVERRIDE {
+    EXPECT_FALSE(prefs()->IsActive(extension_id_));
+  }
+
+ private:
+  std::string extension_id_;
+};
+TEST_F(ExtensionPrefsUnchangedUpdate, UnchangedUpdate) {}
+
 // Tests the GetToolbarOrder/SetToolbarOrder functions.
 class ExtensionPrefsToolbarOrder : public ExtensionPrefsTest {
  public:
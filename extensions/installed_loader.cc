@@ -151,7 +151,14 @@ void InstalledLoader::Load(const ExtensionInfo& info, bool write_to_prefs) {
   } else {
     error = errors::kManifestUnreadable;
   }
+  AddExtension(info, extension, error, write_to_prefs);
+}
 
+void InstalledLoader::AddExtension(const ExtensionInfo& info,
+                                   scoped_refptr<const Extension> extension,
+                                   const std::string& load_error,
+                                   bool write_to_prefs) {
+  std::string error(load_error);
   // Once installed, non-unpacked extensions cannot change their IDs (e.g., by
   // updating the 'key' field in their manifest).
   // TODO(jstritar): migrate preferences when unpacked extensions change IDs.
@@ -196,6 +203,12 @@ void InstalledLoader::LoadAllExtensions() {
   std::vector<int> reload_reason_counts(NUM_MANIFEST_RELOAD_REASONS, 0);
   bool should_write_prefs = false;
 
+  // The extensions created while reloading their manifests, by index in
+  // |extensions_info|. These are added as they are, rather than created again
+  // from the reloaded manifests.
+  std::vector<scoped_refptr<const Extension> > reloaded_extensions(
+      extensions_info->size());
+
   for (size_t i = 0; i < extensions_info->size(); ++i) {
     ExtensionInfo* info = extensions_info->at(i).get();
 
@@ -232,9 +245,7 @@ void InstalledLoader::LoadAllExtensions() {
         continue;
       }
 
-      extensions_info->at(i)->extension_manifest.reset(
-          static_cast<DictionaryValue*>(
-              extension->manifest()->value()->DeepCopy()));
+      reloaded_extensions[i] = extension;
       should_write_prefs = true;
     }
   }
@@ -242,7 +253,12 @@ void InstalledLoader::LoadAllExtensions() {
   for (size_t i = 0; i < extensions_info->size(); ++i) {
     if (extensions_info->at(i)->extension_location == Manifest::COMMAND_LINE)
       continue;
-    Load(*extensions_info->at(i), should_write_prefs);
+    if (reloaded_extensions[i].get()) {
+      AddExtension(*extensions_info->at(i), reloaded_extensions[i],
+                   std::string(), should_write_prefs);
+    } else {
+      Load(*extensions_info->at(i), should_write_prefs);
+    }
   }
 
   extension_service_->OnLoadedInstalledExtensions();
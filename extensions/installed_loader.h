@@ -5,10 +5,15 @@
 #ifndef CHROME_BROWSER_EXTENSIONS_INSTALLED_LOADER_H_
 #define CHROME_BROWSER_EXTENSIONS_INSTALLED_LOADER_H_
 
+#include <string>
+
+#include "base/memory/ref_counted.h"
+
 class ExtensionService;
 
 namespace extensions {
 
+class Extension;
 class ExtensionPrefs;
 struct ExtensionInfo;
 
@@ -25,6 +30,14 @@ class InstalledLoader {
   void LoadAllExtensions();
 
  private:
+  // Adds the |extension| created from |info| to the ExtensionService, after
+  // checking that it may be loaded. Reports |load_error| if |extension| is
+  // NULL.
+  void AddExtension(const ExtensionInfo& info,
+                    scoped_refptr<const Extension> extension,
+                    const std::string& load_error,
+                    bool write_to_prefs);
+
   // Returns the flags that should be used with Extension::Create() for an
   // extension that is already installed.
   int GetCreationFlags(const ExtensionInfo* info);
@@ -23,6 +23,7 @@
 
 using base::Time;
 using base::TimeDelta;
+using base::TimeTicks;
 
 namespace history {
 
@@ -120,22 +121,47 @@ bool ShouldArchiveVisit(const VisitRow& visit) {
   return false;
 }
 
-// The number of visits we will expire very time we check for old items. This
-// Prevents us from doing too much work any given time.
-const int kNumExpirePerIteration = 32;
+// The bounds on the number of visits we will expire every time we check for
+// old items. Within them, the number is adapted so that an iteration takes
+// about kExpireIterationBudgetMs, which prevents us from doing too much work
+// any given time on a slow disk, and from falling behind on a fast one.
+const int kMinExpirePerIteration = 32;
+const int kMaxExpirePerIteration = 4096;
+const int kExpireIterationBudgetMs = 50;
 
 // The number of seconds between checking for items that should be expired when
-// we think there might be more items to expire. This timeout is used when the
-// last expiration found at least kNumExpirePerIteration and we want to check
-// again "soon."
+// we think there might be more items to expire.
 const int kExpirationDelaySec = 30;
 
+// While there is a backlog, the next check comes this many times the duration
+// of the last iteration later, but no sooner than kMinExpirationDelayMs. This
+// keeps catching up to a small share of the history thread's time.
+const int kExpirationDutyCycleFactor = 20;
+const int kMinExpirationDelayMs = 1000;
+
+// Iterations are put off while the browser wrote to history in the last
+// kForegroundQuietSec, but no more than kMaxDeferredIterations times in a row.
+const int kForegroundQuietSec = 5;
+const int kMaxDeferredIterations = 12;
+
 // The number of minutes between checking, as with kExpirationDelaySec, but
 // when we didn't find enough things to expire last time. If there was no
 // history to expire last iteration, it's likely there is nothing next
 // iteration, so we want to wait longer before checking to avoid wasting CPU.
 const int kExpirationEmptyDelayMin = 5;
 
+// Returns the number of visits the next iteration should expire, given that
+// expiring |visits| took |elapsed|. The number changes by at most a factor of
+// two from one iteration to the next.
+int GetNextIterationSize(int visits, TimeDelta elapsed) {
+  int64 elapsed_us = std::max<int64>(elapsed.InMicroseconds(), 1);
+  int64 next = visits * static_cast<int64>(kExpireIterationBudgetMs) *
+      base::Time::kMicrosecondsPerMillisecond / elapsed_us;
+  next = std::max<int64>(std::min<int64>(next, visits * 2), visits / 2);
+  return static_cast<int>(std::max<int64>(
+      std::min<int64>(next, kMaxExpirePerIteration), kMinExpirePerIteration));
+}
+
 }  // namespace
 
 struct ExpireHistoryBackend::DeleteDependencies {
@@ -172,6 +198,8 @@ ExpireHistoryBackend::ExpireHistoryBackend(
       archived_db_(NULL),
       thumb_db_(NULL),
       weak_factory_(this),
+      visits_per_iteration_(kMinExpirePerIteration),
+      deferred_iterations_(0),
       bookmark_service_(bookmark_service) {
 }
 
@@ -339,7 +367,11 @@ void ExpireHistoryBackend::StartArchivingOldStuff(
 
   // Initialize the queue with all tasks for the first set of iterations.
   InitWorkQueue();
-  ScheduleArchive();
+  ScheduleArchive(TimeDelta::FromSeconds(kExpirationDelaySec));
+}
+
+void ExpireHistoryBackend::NotifyForegroundWork() {
+  last_foreground_work_ = TimeTicks::Now();
 }
 
 void ExpireHistoryBackend::DeleteFaviconsIfPossible(
@@ -386,10 +418,10 @@ void ExpireHistoryBackend::BroadcastDeleteNotifications(
 void ExpireHistoryBackend::DeleteVisitRelatedInfo(
     const VisitVector& visits,
     DeleteDependencies* dependencies) {
-  for (size_t i = 0; i < visits.size(); i++) {
-    // Delete the visit itself.
-    main_db_->DeleteVisit(visits[i]);
+  // Delete the visits themselves.
+  main_db_->DeleteVisits(visits);
 
+  for (size_t i = 0; i < visits.size(); i++) {
     // Add the URL row to the affected URL list.
     std::map<URLID, URLRow>::const_iterator found =
         dependencies->affected_urls.find(visits[i].url_id);
@@ -575,15 +607,12 @@ void ExpireHistoryBackend::ArchiveURLsAndVisits(
   }
 }
 
-void ExpireHistoryBackend::ScheduleArchive() {
-  TimeDelta delay;
+void ExpireHistoryBackend::ScheduleArchive(TimeDelta delay) {
   if (work_queue_.empty()) {
     // If work queue is empty, reset the work queue to contain all tasks and
     // schedule next iteration after a longer delay.
     InitWorkQueue();
     delay = TimeDelta::FromMinutes(kExpirationEmptyDelayMin);
-  } else {
-    delay = TimeDelta::FromSeconds(kExpirationDelaySec);
   }
 
   base::MessageLoop::current()->PostDelayedTask(
@@ -596,9 +625,25 @@ void ExpireHistoryBackend::ScheduleArchive() {
 void ExpireHistoryBackend::DoArchiveIteration() {
   DCHECK(!work_queue_.empty()) << "queue has to be non-empty";
 
+  // Don't compete with the browser for the database while it is busy with
+  // history, unless we have held off for too long already.
+  if (!last_foreground_work_.is_null() &&
+      TimeTicks::Now() - last_foreground_work_ <
+          TimeDelta::FromSeconds(kForegroundQuietSec) &&
+      deferred_iterations_ < kMaxDeferredIterations) {
+    deferred_iterations_++;
+    ScheduleArchive(TimeDelta::FromSeconds(kForegroundQuietSec));
+    return;
+  }
+  deferred_iterations_ = 0;
+
   const ExpiringVisitsReader* reader = work_queue_.front();
-  bool more_to_expire = ArchiveSomeOldHistory(GetCurrentArchiveTime(), reader,
-                                              kNumExpirePerIteration);
+  DeleteDependencies deleted_dependencies;
+  TimeTicks start_time = TimeTicks::Now();
+  bool more_to_expire = ExpireSomeOldVisits(GetCurrentArchiveTime(), reader,
+                                            visits_per_iteration_,
+                                            &deleted_dependencies);
+  TimeDelta elapsed = TimeTicks::Now() - start_time;
 
   work_queue_.pop();
   // If there are more items to expire, add the reader back to the queue, thus
@@ -606,13 +651,46 @@ void ExpireHistoryBackend::DoArchiveIteration() {
   if (more_to_expire)
     work_queue_.push(reader);
 
-  ScheduleArchive();
+  // Send notifications for the stuff that was deleted right away, so that a
+  // URL visited again later is not removed from the visited links after the
+  // fact.
+  BroadcastDeleteNotifications(&deleted_dependencies, DELETION_ARCHIVED);
+
+  TimeDelta delay = TimeDelta::FromSeconds(kExpirationDelaySec);
+  if (more_to_expire) {
+    // The batch was full, so its duration tells how many visits fit the
+    // budget, and we are behind, so check again sooner.
+    visits_per_iteration_ = GetNextIterationSize(visits_per_iteration_,
+                                                 elapsed);
+    delay = std::min(delay, std::max(
+        elapsed * kExpirationDutyCycleFactor,
+        TimeDelta::FromMilliseconds(kMinExpirationDelayMs)));
+  }
+  ScheduleArchive(delay);
 }
 
 bool ExpireHistoryBackend::ArchiveSomeOldHistory(
     base::Time end_time,
     const ExpiringVisitsReader* reader,
     int max_visits) {
+  DeleteDependencies deleted_dependencies;
+  bool more_to_expire = ExpireSomeOldVisits(end_time, reader, max_visits,
+                                            &deleted_dependencies);
+
+  // Send notifications for the stuff that was deleted. These won't normally be
+  // in history views since they were subframes, but they will be in the visited
+  // link system, which needs to be updated now. This function is smart enough
+  // to not do anything if nothing was deleted.
+  BroadcastDeleteNotifications(&deleted_dependencies, DELETION_ARCHIVED);
+
+  return more_to_expire;
+}
+
+bool ExpireHistoryBackend::ExpireSomeOldVisits(
+    base::Time end_time,
+    const ExpiringVisitsReader* reader,
+    int max_visits,
+    DeleteDependencies* deleted_dependencies) {
   if (!main_db_)
     return false;
 
@@ -634,19 +712,25 @@ bool ExpireHistoryBackend::ArchiveSomeOldHistory(
       deleted_visits.push_back(affected_visits[i]);
   }
 
+  // The whole batch goes in one transaction of each database.
+  main_db_->BeginTransaction();
+  if (archived_db_)
+    archived_db_->BeginTransaction();
+  if (thumb_db_)
+    thumb_db_->BeginTransaction();
+
   // Do the actual archiving.
   DeleteDependencies archived_dependencies;
   ArchiveURLsAndVisits(archived_visits, &archived_dependencies);
   DeleteVisitRelatedInfo(archived_visits, &archived_dependencies);
 
-  DeleteDependencies deleted_dependencies;
-  DeleteVisitRelatedInfo(deleted_visits, &deleted_dependencies);
+  DeleteVisitRelatedInfo(deleted_visits, deleted_dependencies);
 
   // This will remove or archive all the affected URLs. Must do the deleting
   // cleanup before archiving so the delete dependencies structure references
   // only those URLs that were actually deleted instead of having some visits
   // archived and then the rest deleted.
-  ExpireURLsForVisits(deleted_visits, &deleted_dependencies);
+  ExpireURLsForVisits(deleted_visits, deleted_dependencies);
   ExpireURLsForVisits(archived_visits, &archived_dependencies);
 
   // Create a union of all affected favicons (we don't store favicons for
@@ -654,18 +738,18 @@ bool ExpireHistoryBackend::ArchiveSomeOldHistory(
   std::set<chrome::FaviconID> affected_favicons(
       archived_dependencies.affected_favicons);
   for (std::set<chrome::FaviconID>::const_iterator i =
-           deleted_dependencies.affected_favicons.begin();
-       i != deleted_dependencies.affected_favicons.end(); ++i) {
+           deleted_dependencies->affected_favicons.begin();
+       i != deleted_dependencies->affected_favicons.end(); ++i) {
     affected_favicons.insert(*i);
   }
   DeleteFaviconsIfPossible(affected_favicons,
-                           &deleted_dependencies.expired_favicons);
+                           &deleted_dependencies->expired_favicons);
 
-  // Send notifications for the stuff that was deleted. These won't normally be
-  // in history views since they were subframes, but they will be in the visited
-  // link system, which needs to be updated now. This function is smart enough
-  // to not do anything if nothing was deleted.
-  BroadcastDeleteNotifications(&deleted_dependencies, DELETION_ARCHIVED);
+  if (thumb_db_)
+    thumb_db_->CommitTransaction();
+  if (archived_db_)
+    archived_db_->CommitTransaction();
+  main_db_->CommitTransaction();
 
   return more_to_expire;
 }
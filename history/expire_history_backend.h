@@ -61,7 +61,9 @@ typedef std::vector<const ExpiringVisitsReader*> ExpiringVisitsReaders;
 // database as it gets old.
 //
 // It will automatically start periodically archiving old history once you call
-// StartArchivingOldStuff().
+// StartArchivingOldStuff(). Each iteration expires a batch of visits sized so
+// that it takes about a fixed time budget, and iterations come sooner while
+// there is a backlog, but hold off while the browser is writing to history.
 class ExpireHistoryBackend {
  public:
   // The delegate pointer must be non-NULL. We will NOT take ownership of it.
@@ -81,6 +83,10 @@ class ExpireHistoryBackend {
   // will continue until the object is deleted.
   void StartArchivingOldStuff(base::TimeDelta expiration_threshold);
 
+  // Tells the expirer that the browser has just written to history, so that
+  // periodic expiration holds off for a while.
+  void NotifyForegroundWork();
+
   // Deletes everything associated with a URL.
   void DeleteURL(const GURL& url);
 
@@ -119,6 +125,7 @@ class ExpireHistoryBackend {
   FRIEND_TEST_ALL_PREFIXES(ExpireHistoryTest, ArchiveSomeOldHistory);
   FRIEND_TEST_ALL_PREFIXES(ExpireHistoryTest, ExpiringVisitsReader);
   FRIEND_TEST_ALL_PREFIXES(ExpireHistoryTest, ArchiveSomeOldHistoryWithSource);
+  FRIEND_TEST_ALL_PREFIXES(ExpireHistoryTest, ArchiveIterations);
   friend class ::TestingProfile;
 
   struct DeleteDependencies;
@@ -214,12 +221,12 @@ class ExpireHistoryBackend {
   void BroadcastDeleteNotifications(DeleteDependencies* dependencies,
                                     DeletionType type);
 
-  // Schedules a call to DoArchiveIteration.
-  void ScheduleArchive();
+  // Schedules a call to DoArchiveIteration after |delay|, or after a longer
+  // delay if the work queue is empty.
+  void ScheduleArchive(base::TimeDelta delay);
 
-  // Calls ArchiveSomeOldHistory to expire some amount of old history, according
-  // to the items in work queue, and schedules another call to happen in the
-  // future.
+  // Expires some amount of old history, according to the items in work queue,
+  // and schedules another call to happen in the future.
   void DoArchiveIteration();
 
   // Tries to expire the oldest |max_visits| visits from history that are older
@@ -230,6 +237,13 @@ class ExpireHistoryBackend {
                              const ExpiringVisitsReader* reader,
                              int max_visits);
 
+  // Does the work of ArchiveSomeOldHistory() in one transaction, filling
+  // |deleted_dependencies| with what was deleted rather than broadcasting it.
+  bool ExpireSomeOldVisits(base::Time end_time,
+                           const ExpiringVisitsReader* reader,
+                           int max_visits,
+                           DeleteDependencies* deleted_dependencies);
+
   // Tries to detect possible bad history or inconsistencies in the database
   // and deletes items. For example, URLs with no visits.
   void ParanoidExpireHistory();
@@ -275,6 +289,15 @@ class ExpireHistoryBackend {
   // iterations.
   std::queue<const ExpiringVisitsReader*> work_queue_;
 
+  // The number of visits the next archive iteration expires, adapted to how
+  // long the previous iterations took.
+  int visits_per_iteration_;
+
+  // When NotifyForegroundWork() was last called, and how many iterations in a
+  // row have been put off since.
+  base::TimeTicks last_foreground_work_;
+  int deferred_iterations_;
+
   // Readers for various types of visits.
   // TODO(dglazkov): If you are adding another one, please consider reorganizing
   // into a map.
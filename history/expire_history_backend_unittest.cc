@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "base/basictypes.h"
 #include "base/compiler_specific.h"
@@ -853,6 +854,53 @@ TEST_F(ExpireHistoryTest, ExpiringVisitsReader) {
   EXPECT_EQ(1U, visits.size());
 }
 
+// Tests that archive iterations hold off while the browser writes to history,
+// and broadcast what they delete once they are done.
+TEST_F(ExpireHistoryTest, ArchiveIterations) {
+  URLID url_ids[3];
+  Time visit_times[4];
+  AddExampleData(url_ids, visit_times);
+  URLRow url_rows[3];
+  for (int i = 0; i < 3; ++i)
+    ASSERT_TRUE(main_db_->GetURLRow(url_ids[i], &url_rows[i]));
+
+  expirer_.StartArchivingOldStuff(TimeDelta());
+
+  // Nothing is expired right after the browser wrote to history.
+  expirer_.NotifyForegroundWork();
+  expirer_.DoArchiveIteration();
+  URLRow temp_row;
+  EXPECT_TRUE(main_db_->GetURLRow(url_ids[0], &temp_row));
+  expirer_.last_foreground_work_ = base::TimeTicks();
+
+  // The first iteration only expires the oldest visit, which deletes the
+  // first URL, and broadcasts that deletion right away.
+  expirer_.visits_per_iteration_ = 1;
+  expirer_.DoArchiveIteration();
+  EXPECT_FALSE(main_db_->GetURLRow(url_ids[0], &temp_row));
+  ASSERT_EQ(1U, notifications_.size());
+  EXPECT_LE(2, expirer_.visits_per_iteration_);
+
+  // Each further iteration broadcasts what it deleted itself.
+  for (int i = 0; i < 10 && main_db_->GetURLRow(url_ids[2], &temp_row); ++i)
+    expirer_.DoArchiveIteration();
+  EXPECT_FALSE(main_db_->GetURLRow(url_ids[2], &temp_row));
+  std::vector<GURL> deleted_urls;
+  for (size_t i = 0; i < notifications_.size(); ++i) {
+    ASSERT_EQ(chrome::NOTIFICATION_HISTORY_URLS_DELETED,
+              notifications_[i].first);
+    URLsDeletedDetails* details =
+        reinterpret_cast<URLsDeletedDetails*>(notifications_[i].second);
+    EXPECT_TRUE(details->archived);
+    EXPECT_FALSE(details->rows.empty());
+    for (size_t j = 0; j < details->rows.size(); ++j)
+      deleted_urls.push_back(details->rows[j].url());
+  }
+  ASSERT_EQ(3U, deleted_urls.size());
+  for (int i = 0; i < 3; ++i)
+    EXPECT_EQ(url_rows[i].url(), deleted_urls[i]);
+}
+
 // Tests how ArchiveSomeOldHistory treats source information.
 TEST_F(ExpireHistoryTest, ArchiveSomeOldHistoryWithSource) {
   const GURL url("www.testsource.com");
@@ -1012,6 +1012,15 @@ bool HistoryBackend::GetMostRecentVisitsForURL(URLID id,
   return false;
 }
 
+bool HistoryBackend::GetMostRecentVisitsForURLs(
+    const std::set<URLID>& ids,
+    int max_visits_per_url,
+    std::map<URLID, VisitVector>* visits) {
+  if (db_)
+    return db_->GetMostRecentVisitsForURLs(ids, max_visits_per_url, visits);
+  return false;
+}
+
 bool HistoryBackend::UpdateURL(URLID id, const history::URLRow& url) {
   if (db_)
     return db_->UpdateURLRow(id, url);
@@ -1497,30 +1506,31 @@ void HistoryBackend::QueryFilteredURLs(
     return;
   }
 
-  VisitVector visits;
-  db_->GetDirectVisitsDuringTimes(filter, 0, &visits);
-
+  // The scores mostly come from the hourly aggregates of the direct visits,
+  // rather than from every visit in the filter's times.
   std::map<URLID, double> score_map;
-  for (size_t i = 0; i < visits.size(); ++i) {
-    score_map[visits[i].url_id] += filter.GetVisitScore(visits[i]);
-  }
+  db_->GetDirectVisitScoresDuringTimes(filter, &score_map);
 
-  // TODO(georgey): experiment with visit_segment database granularity (it is
-  // currently 24 hours) to use it directly instead of using visits database,
-  // which is considerably slower.
-  ScopedVector<PageUsageData> data;
-  data.reserve(score_map.size());
+  // Limit to the top |result_count| results, which are all that get sorted.
+  // The scores are negated so that the highest come first.
+  std::vector<std::pair<double, URLID> > scores;
+  scores.reserve(score_map.size());
   for (std::map<URLID, double>::iterator it = score_map.begin();
        it != score_map.end(); ++it) {
-    PageUsageData* pud = new PageUsageData(it->first);
-    pud->SetScore(it->second);
-    data.push_back(pud);
+    scores.push_back(std::make_pair(-it->second, it->first));
   }
+  size_t top_count = scores.size();
+  if (result_count && implicit_cast<int>(top_count) > result_count)
+    top_count = result_count;
+  std::partial_sort(scores.begin(), scores.begin() + top_count, scores.end());
 
-  // Limit to the top |result_count| results.
-  std::sort(data.begin(), data.end(), PageUsageData::Predicate);
-  if (result_count && implicit_cast<int>(data.size()) > result_count)
-    data.resize(result_count);
+  ScopedVector<PageUsageData> data;
+  data.reserve(top_count);
+  for (size_t i = 0; i < top_count; ++i) {
+    PageUsageData* pud = new PageUsageData(scores[i].second);
+    pud->SetScore(-scores[i].first);
+    data.push_back(pud);
+  }
 
   for (size_t i = 0; i < data.size(); ++i) {
     URLRow info;
@@ -2423,6 +2433,10 @@ void HistoryBackend::Commit() {
 }
 
 void HistoryBackend::ScheduleCommit() {
+  // Every change the browser makes to history schedules a commit, so this is
+  // where expiration learns to hold off.
+  expirer_.NotifyForegroundWork();
+
   if (scheduled_commit_.get())
     return;
   scheduled_commit_ = new CommitLaterTask(this);
@@ -5,6 +5,7 @@
 #ifndef CHROME_BROWSER_HISTORY_HISTORY_BACKEND_H_
 #define CHROME_BROWSER_HISTORY_HISTORY_BACKEND_H_
 
+#include <map>
 #include <set>
 #include <string>
 #include <utility>
@@ -390,6 +391,13 @@ class HistoryBackend : public base::RefCountedThreadSafe<HistoryBackend>,
                                          int max_visits,
                                          VisitVector* visits);
 
+  // Fetches up to |max_visits_per_url| most recent visits for each of the
+  // passed URLs, in as few queries as possible.
+  virtual bool GetMostRecentVisitsForURLs(
+      const std::set<URLID>& ids,
+      int max_visits_per_url,
+      std::map<URLID, VisitVector>* visits);
+
   virtual bool UpdateURL(URLID id, const history::URLRow& url);
 
   // While adding visits in batch, the source needs to be provided.
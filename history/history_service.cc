@@ -317,6 +317,23 @@ history::URLDatabase* HistoryService::InMemoryDatabase() {
   return NULL;
 }
 
+const history::URLPrefixIndex* HistoryService::InMemoryURLPrefixIndex() {
+  DCHECK(thread_checker_.CalledOnValidThread());
+  LoadBackendIfNecessary();
+  if (in_memory_backend_ && in_memory_backend_->db())
+    return in_memory_backend_->db()->url_prefix_index();
+  return NULL;
+}
+
+const history::KeywordSearchTermIndex*
+HistoryService::InMemoryKeywordSearchTermIndex() {
+  DCHECK(thread_checker_.CalledOnValidThread());
+  LoadBackendIfNecessary();
+  if (in_memory_backend_ && in_memory_backend_->db())
+    return in_memory_backend_->db()->keyword_search_term_index();
+  return NULL;
+}
+
 bool HistoryService::GetTypedCountForURL(const GURL& url, int* typed_count) {
   DCHECK(thread_checker_.CalledOnValidThread());
   history::URLRow url_row;
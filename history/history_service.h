@@ -68,7 +68,9 @@ class HistoryQueryTest;
 class InMemoryHistoryBackend;
 class InMemoryURLIndex;
 class InMemoryURLIndexTest;
+class KeywordSearchTermIndex;
 class URLDatabase;
+class URLPrefixIndex;
 class VisitDatabaseObserver;
 class VisitFilter;
 struct DownloadRow;
@@ -146,6 +148,14 @@ class HistoryService : public CancelableRequestProvider,
   // TODO(brettw) this should return the InMemoryHistoryBackend.
   history::URLDatabase* InMemoryDatabase();
 
+  // Returns the index of the typed URLs in the in-memory URL database, under
+  // the same conditions as InMemoryDatabase().
+  const history::URLPrefixIndex* InMemoryURLPrefixIndex();
+
+  // Returns the index of the keyword search terms in the in-memory URL
+  // database, under the same conditions as InMemoryDatabase().
+  const history::KeywordSearchTermIndex* InMemoryKeywordSearchTermIndex();
+
   // Following functions get URL information from in-memory database.
   // They return false if database is not available (e.g. not loaded yet) or the
   // URL does not exist.
@@ -617,6 +617,68 @@ TEST_F(HistoryBackendDBTest, MigrateDownloadValidators) {
   }
 }
 
+TEST_F(HistoryBackendDBTest, MigrateDirectVisitHours) {
+  const int64 kHour = base::Time::kMicrosecondsPerHour;
+  const int64 hour = (base::Time::Now().ToInternalValue() / kHour) * kHour;
+  ASSERT_NO_FATAL_FAILURE(CreateDBVersion(27));
+  {
+    sql::Connection db;
+    ASSERT_TRUE(db.Open(history_dir_.Append(chrome::kHistoryFilename)));
+    // Two typed visits and a link visit to the same URL, in the same hour.
+    const int kTransitions[] = {
+      content::PAGE_TRANSITION_TYPED | content::PAGE_TRANSITION_CHAIN_START,
+      content::PAGE_TRANSITION_TYPED | content::PAGE_TRANSITION_CHAIN_START,
+      content::PAGE_TRANSITION_LINK | content::PAGE_TRANSITION_CHAIN_START,
+    };
+    for (size_t i = 0; i < arraysize(kTransitions); ++i) {
+      sql::Statement s(db.GetUniqueStatement(
+          "INSERT INTO visits (id, url, visit_time, from_visit, transition, "
+          "segment_id, is_indexed, visit_duration) "
+          "VALUES (?, 1, ?, 0, ?, 0, 0, 0)"));
+      s.BindInt64(0, i + 1);
+      s.BindInt64(1, hour + (i + 1) * 10);
+      s.BindInt(2, kTransitions[i]);
+      ASSERT_TRUE(s.Run());
+    }
+    // A stale table, as left behind by a newer build before a downgrade.
+    ASSERT_TRUE(db.Execute(
+        "CREATE TABLE direct_visit_hours(url INTEGER NOT NULL,"
+        "hour INTEGER NOT NULL,visit_count INTEGER NOT NULL,"
+        "offset_sum INTEGER NOT NULL,PRIMARY KEY (hour, url))"));
+    ASSERT_TRUE(db.Execute(
+        "INSERT INTO direct_visit_hours VALUES (2, 0, 5, 0)"));
+  }
+  // Re-open the db using the HistoryDatabase, which should migrate to the
+  // current version, refilling the direct visit hours from the visits.
+  CreateBackendAndDatabase();
+  DeleteBackend();
+  {
+    // Re-open the db for manual manipulation.
+    sql::Connection db;
+    ASSERT_TRUE(db.Open(history_dir_.Append(chrome::kHistoryFilename)));
+    // The version should have been updated.
+    int cur_version = HistoryDatabase::GetCurrentVersion();
+    ASSERT_LE(29, cur_version);
+    {
+      sql::Statement s(db.GetUniqueStatement(
+          "SELECT value FROM meta WHERE key = 'version'"));
+      EXPECT_TRUE(s.Step());
+      EXPECT_EQ(cur_version, s.ColumnInt(0));
+    }
+    {
+      sql::Statement s(db.GetUniqueStatement(
+          "SELECT url, hour, visit_count, offset_sum "
+          "FROM direct_visit_hours"));
+      EXPECT_TRUE(s.Step());
+      EXPECT_EQ(1, s.ColumnInt64(0));
+      EXPECT_EQ(hour, s.ColumnInt64(1));
+      EXPECT_EQ(2, s.ColumnInt(2));
+      EXPECT_EQ(30, s.ColumnInt64(3));
+      EXPECT_FALSE(s.Step());
+    }
+  }
+}
+
 TEST_F(HistoryBackendDBTest, ConfirmDownloadRowCreateAndDelete) {
   // Create the DB.
   CreateBackendAndDatabase();
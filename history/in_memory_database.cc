@@ -141,6 +141,32 @@ bool InMemoryDatabase::InitFromDisk(const base::FilePath& history_name) {
   CreateMainURLIndex();
   CreateKeywordSearchTermsIndices();
 
+  begin_load = base::TimeTicks::Now();
+  URLEnumerator urls;
+  if (InitURLEnumeratorForEverything(&urls)) {
+    URLRows rows;
+    URLRow row;
+    while (urls.GetNextURL(&row))
+      rows.push_back(row);
+    url_prefix_index_.AddAll(rows);
+  }
+  UMA_HISTOGRAM_TIMES("History.InMemoryURLPrefixIndexPopulate",
+                      base::TimeTicks::Now() - begin_load);
+
+  begin_load = base::TimeTicks::Now();
+  sql::Statement terms(db_.GetUniqueStatement(
+      "SELECT kst.keyword_id, kst.url_id, kst.term, u.visit_count, "
+      "u.last_visit_time "
+      "FROM keyword_search_terms kst JOIN urls u ON kst.url_id = u.id"));
+  while (terms.Step()) {
+    keyword_search_term_index_.Add(
+        terms.ColumnInt64(0), terms.ColumnInt64(1), terms.ColumnString16(2),
+        terms.ColumnInt(3),
+        base::Time::FromInternalValue(terms.ColumnInt64(4)));
+  }
+  UMA_HISTOGRAM_TIMES("History.InMemoryKeywordSearchTermIndexPopulate",
+                      base::TimeTicks::Now() - begin_load);
+
   return true;
 }
 
@@ -6,7 +6,9 @@
 #define CHROME_BROWSER_HISTORY_IN_MEMORY_DATABASE_H_
 
 #include "base/basictypes.h"
+#include "chrome/browser/history/keyword_search_term_index.h"
 #include "chrome/browser/history/url_database.h"
+#include "chrome/browser/history/url_prefix_index.h"
 #include "sql/connection.h"
 
 namespace base {
@@ -32,6 +34,17 @@ class InMemoryDatabase : public URLDatabase {
   // much slower.
   bool InitFromDisk(const base::FilePath& history_name);
 
+  // The typed URLs of the database indexed for inline autocomplete. Whoever
+  // changes the URL rows must keep it in sync.
+  URLPrefixIndex* url_prefix_index() { return &url_prefix_index_; }
+
+  // The keyword search terms of the database indexed for the search provider.
+  // Whoever changes the search terms or the visits of their URLs must keep it
+  // in sync.
+  KeywordSearchTermIndex* keyword_search_term_index() {
+    return &keyword_search_term_index_;
+  }
+
  protected:
   // Implemented for URLDatabase.
   virtual sql::Connection& GetDB() OVERRIDE;
@@ -43,6 +56,9 @@ class InMemoryDatabase : public URLDatabase {
 
   sql::Connection db_;
 
+  URLPrefixIndex url_prefix_index_;
+  KeywordSearchTermIndex keyword_search_term_index_;
+
   DISALLOW_COPY_AND_ASSIGN(InMemoryDatabase);
 };
 
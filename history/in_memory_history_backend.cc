@@ -90,10 +90,13 @@ void InMemoryHistoryBackend::Observe(
       OnURLsDeleted(
           *content::Details<history::URLsDeletedDetails>(details).ptr());
       break;
-    case chrome::NOTIFICATION_TEMPLATE_URL_REMOVED:
-      db_->DeleteAllSearchTermsForKeyword(
-          *(content::Details<TemplateURLID>(details).ptr()));
+    case chrome::NOTIFICATION_TEMPLATE_URL_REMOVED: {
+      TemplateURLID keyword_id =
+          *(content::Details<TemplateURLID>(details).ptr());
+      db_->DeleteAllSearchTermsForKeyword(keyword_id);
+      db_->keyword_search_term_index()->RemoveKeyword(keyword_id);
       break;
+    }
     default:
       // For simplicity, the unit tests send us all notifications, even when
       // we haven't registered for them, so don't assert here.
@@ -118,7 +121,13 @@ void InMemoryHistoryBackend::OnTypedURLsModified(
       if (id)
         db_->UpdateURLRow(id, *i);
       else
-        db_->AddURL(*i);
+        id = db_->AddURL(*i);
+      if (id) {
+        URLRow row(*i);
+        row.set_id(id);
+        db_->url_prefix_index()->Add(row);
+        db_->keyword_search_term_index()->UpdateURL(row);
+      }
     }
   }
 }
@@ -141,6 +150,8 @@ void InMemoryHistoryBackend::OnURLsDeleted(const URLsDeletedDetails& details) {
     // We typically won't have most of them since we only have a subset of
     // history, so ignore errors.
     db_->DeleteURLRow(row->id());
+    db_->url_prefix_index()->Remove(row->url());
+    db_->keyword_search_term_index()->RemoveURL(row->id());
   }
 }
 
@@ -155,16 +166,21 @@ void InMemoryHistoryBackend::OnKeywordSearchTermUpdated(
     // Because this row won't have a typed count the title and other stuff
     // doesn't matter. If the user ends up typing the url we'll update the title
     // in OnTypedURLsModified.
-    URLRow new_row(details.url);
-    new_row.set_last_visit(base::Time::Now());
-    url_id = db_->AddURL(new_row);
+    url_row = URLRow(details.url);
+    url_row.set_last_visit(base::Time::Now());
+    url_id = db_->AddURL(url_row);
     if (!url_id)
       return;  // Error adding.
   } else {
     url_id = url_row.id();
   }
 
-  db_->SetKeywordSearchTermsForURL(url_id, details.keyword_id, details.term);
+  if (db_->SetKeywordSearchTermsForURL(url_id, details.keyword_id,
+                                       details.term)) {
+    db_->keyword_search_term_index()->Add(details.keyword_id, url_id,
+                                          details.term, url_row.visit_count(),
+                                          url_row.last_visit());
+  }
 }
 
 bool InMemoryHistoryBackend::HasKeyword(const GURL& url) {
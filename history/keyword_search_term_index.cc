@@ -0,0 +1,174 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/history/keyword_search_term_index.h"
+
+#include <algorithm>
+
+#include "base/i18n/case_conversion.h"
+#include "base/logging.h"
+
+namespace history {
+
+KeywordSearchTermIndex::Term::Term()
+    : visit_count(0) {
+}
+
+KeywordSearchTermIndex::Term::~Term() {
+}
+
+KeywordSearchTermIndex::URLVisits::URLVisits()
+    : visit_count(0) {
+}
+
+KeywordSearchTermIndex::URLVisits::~URLVisits() {
+}
+
+// Orders terms by their most recent visit, then by their visit count, the
+// best first.
+class KeywordSearchTermIndex::MoreRecent {
+ public:
+  bool operator()(const Term* a, const Term* b) const {
+    if (a->last_visit != b->last_visit)
+      return a->last_visit > b->last_visit;
+    return a->visit_count > b->visit_count;
+  }
+};
+
+KeywordSearchTermIndex::KeywordSearchTermIndex() {
+}
+
+KeywordSearchTermIndex::~KeywordSearchTermIndex() {
+}
+
+void KeywordSearchTermIndex::Add(TemplateURLID keyword_id,
+                                 URLID url_id,
+                                 const string16& term,
+                                 int visit_count,
+                                 base::Time last_visit) {
+  DCHECK(url_id && keyword_id && !term.empty());
+  URLVisits& url = urls_[url_id];
+  if (!url.terms.insert(std::make_pair(keyword_id, term)).second)
+    return;  // The URL has a term for this keyword already.
+  url.visit_count = visit_count;
+  url.last_visit = last_visit;
+
+  // NOTE: Keep this ToLower() call in sync with url_database.cc.
+  Terms::iterator it = terms_.insert(std::make_pair(
+      TermKey(keyword_id, base::i18n::ToLower(term)), Term())).first;
+  it->second.url_ids.insert(url_id);
+  UpdateTerm(it);
+}
+
+void KeywordSearchTermIndex::UpdateURL(const URLRow& row) {
+  URLs::iterator url = urls_.find(row.id());
+  if (url == urls_.end())
+    return;
+  url->second.visit_count = row.visit_count();
+  url->second.last_visit = row.last_visit();
+  for (std::map<TemplateURLID, string16>::const_iterator i =
+           url->second.terms.begin();
+       i != url->second.terms.end(); ++i) {
+    Terms::iterator it =
+        terms_.find(TermKey(i->first, base::i18n::ToLower(i->second)));
+    DCHECK(it != terms_.end());
+    UpdateTerm(it);
+  }
+}
+
+void KeywordSearchTermIndex::RemoveURL(URLID url_id) {
+  URLs::iterator url = urls_.find(url_id);
+  if (url == urls_.end())
+    return;
+  std::map<TemplateURLID, string16> terms;
+  terms.swap(url->second.terms);
+  urls_.erase(url);
+  for (std::map<TemplateURLID, string16>::const_iterator i = terms.begin();
+       i != terms.end(); ++i) {
+    Terms::iterator it =
+        terms_.find(TermKey(i->first, base::i18n::ToLower(i->second)));
+    DCHECK(it != terms_.end());
+    it->second.url_ids.erase(url_id);
+    UpdateTerm(it);
+  }
+}
+
+void KeywordSearchTermIndex::RemoveKeyword(TemplateURLID keyword_id) {
+  Terms::iterator it = terms_.lower_bound(TermKey(keyword_id, string16()));
+  while (it != terms_.end() && it->first.first == keyword_id) {
+    for (std::set<URLID>::const_iterator url_id = it->second.url_ids.begin();
+         url_id != it->second.url_ids.end(); ++url_id) {
+      URLs::iterator url = urls_.find(*url_id);
+      DCHECK(url != urls_.end());
+      url->second.terms.erase(keyword_id);
+      if (url->second.terms.empty())
+        urls_.erase(url);
+    }
+    terms_.erase(it++);
+  }
+}
+
+void KeywordSearchTermIndex::Clear() {
+  terms_.clear();
+  urls_.clear();
+}
+
+void KeywordSearchTermIndex::GetMostRecentKeywordSearchTerms(
+    TemplateURLID keyword_id,
+    const string16& prefix,
+    int max_count,
+    std::vector<KeywordSearchTermVisit>* matches) const {
+  // NOTE: the keyword_id can be zero if on first run the user does a query
+  // before the TemplateURLService has finished loading. As the chances of this
+  // occurring are small, we ignore it.
+  if (!keyword_id || max_count <= 0)
+    return;
+
+  DCHECK(!prefix.empty());
+  const string16 lower_prefix = base::i18n::ToLower(prefix);
+  std::vector<const Term*> found;
+  for (Terms::const_iterator it =
+           terms_.lower_bound(TermKey(keyword_id, lower_prefix));
+       it != terms_.end() && it->first.first == keyword_id &&
+           it->first.second.compare(0, lower_prefix.size(), lower_prefix) == 0;
+       ++it) {
+    found.push_back(&it->second);
+  }
+
+  const size_t count = std::min(found.size(), static_cast<size_t>(max_count));
+  std::partial_sort(found.begin(), found.begin() + count, found.end(),
+                    MoreRecent());
+  for (size_t i = 0; i < count; ++i) {
+    KeywordSearchTermVisit visit;
+    visit.term = found[i]->term;
+    visit.visits = found[i]->visit_count;
+    visit.time = found[i]->last_visit;
+    matches->push_back(visit);
+  }
+}
+
+void KeywordSearchTermIndex::UpdateTerm(Terms::iterator it) {
+  Term& term = it->second;
+  if (term.url_ids.empty()) {
+    terms_.erase(it);
+    return;
+  }
+
+  term.visit_count = 0;
+  term.last_visit = base::Time();
+  bool first = true;
+  for (std::set<URLID>::const_iterator url_id = term.url_ids.begin();
+       url_id != term.url_ids.end(); ++url_id) {
+    URLs::const_iterator url = urls_.find(*url_id);
+    DCHECK(url != urls_.end());
+    term.visit_count += url->second.visit_count;
+    if (first || url->second.last_visit > term.last_visit) {
+      term.last_visit = url->second.last_visit;
+      term.term = url->second.terms.find(it->first.first)->second;
+      first = false;
+    }
+  }
+}
+
+}  // namespace history
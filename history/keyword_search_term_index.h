@@ -0,0 +1,106 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_HISTORY_KEYWORD_SEARCH_TERM_INDEX_H_
+#define CHROME_BROWSER_HISTORY_KEYWORD_SEARCH_TERM_INDEX_H_
+
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/strings/string16.h"
+#include "base/time/time.h"
+#include "chrome/browser/history/history_types.h"
+#include "chrome/browser/search_engines/template_url_id.h"
+
+namespace history {
+
+// Answers the queries that the search provider makes of the keyword search
+// terms in the in-memory URL database from memory.
+//
+// The terms are kept sorted by keyword and lowercase term, so the terms of a
+// keyword that start with some text are a range of them. A term searched for
+// from several URLs is listed once, with the most recent visit and the total
+// visit count of those URLs.
+//
+// Kept in sync with the InMemoryDatabase by the InMemoryHistoryBackend. Only
+// accessed on the thread which owns the in-memory database.
+class KeywordSearchTermIndex {
+ public:
+  KeywordSearchTermIndex();
+  ~KeywordSearchTermIndex();
+
+  // Adds |term| as searched for with |keyword_id| from the URL |url_id|,
+  // which has the given visits. Like URLDatabase::SetKeywordSearchTermsForURL()
+  // this does nothing if the URL has a term for |keyword_id| already.
+  void Add(TemplateURLID keyword_id,
+           URLID url_id,
+           const string16& term,
+           int visit_count,
+           base::Time last_visit);
+
+  // Updates the visits of the URL of |row|, if it has search terms.
+  void UpdateURL(const URLRow& row);
+
+  // Removes the search terms of a URL, or of a keyword.
+  void RemoveURL(URLID url_id);
+  void RemoveKeyword(TemplateURLID keyword_id);
+
+  void Clear();
+
+  // Like URLDatabase::GetMostRecentKeywordSearchTerms(), except that each term
+  // is returned once. Terms are ordered by their most recent visit, then by
+  // their visit count.
+  void GetMostRecentKeywordSearchTerms(
+      TemplateURLID keyword_id,
+      const string16& prefix,
+      int max_count,
+      std::vector<KeywordSearchTermVisit>* matches) const;
+
+  size_t size() const { return terms_.size(); }
+
+ private:
+  // A keyword and a lowercase term.
+  typedef std::pair<TemplateURLID, string16> TermKey;
+
+  struct Term {
+    Term();
+    ~Term();
+
+    // The term as searched for from the most recently visited URL.
+    string16 term;
+    int visit_count;
+    base::Time last_visit;
+    std::set<URLID> url_ids;
+  };
+  typedef std::map<TermKey, Term> Terms;
+
+  struct URLVisits {
+    URLVisits();
+    ~URLVisits();
+
+    int visit_count;
+    base::Time last_visit;
+    // The term searched for with each keyword.
+    std::map<TemplateURLID, string16> terms;
+  };
+  typedef std::map<URLID, URLVisits> URLs;
+
+  class MoreRecent;
+
+  // Recomputes the visits of the term at |it| from its URLs, removing it if
+  // it has none left.
+  void UpdateTerm(Terms::iterator it);
+
+  Terms terms_;
+  URLs urls_;
+
+  DISALLOW_COPY_AND_ASSIGN(KeywordSearchTermIndex);
+};
+
+}  // namespace history
+
+#endif  // CHROME_BROWSER_HISTORY_KEYWORD_SEARCH_TERM_INDEX_H_
@@ -0,0 +1,119 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/history/keyword_search_term_index.h"
+
+#include <string>
+#include <vector>
+
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/utf_string_conversions.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "url/gurl.h"
+
+namespace history {
+
+namespace {
+
+const TemplateURLID kKeyword = 1;
+const TemplateURLID kOtherKeyword = 2;
+
+}  // namespace
+
+class KeywordSearchTermIndexTest : public testing::Test {
+ protected:
+  KeywordSearchTermIndexTest() : now_(base::Time::Now()) {}
+
+  // Adds |term| searched for from URL |url_id|, last visited |days_ago|.
+  void Add(TemplateURLID keyword_id, URLID url_id, const char* term,
+           int visit_count, int days_ago) {
+    index_.Add(keyword_id, url_id, ASCIIToUTF16(term), visit_count,
+               now_ - base::TimeDelta::FromDays(days_ago));
+  }
+
+  // Returns the terms found for |prefix|, separated by commas, each followed
+  // by its visit count.
+  std::string Find(TemplateURLID keyword_id, const char* prefix,
+                   int max_count) {
+    std::vector<KeywordSearchTermVisit> matches;
+    index_.GetMostRecentKeywordSearchTerms(keyword_id, ASCIIToUTF16(prefix),
+                                           max_count, &matches);
+    std::string result;
+    for (size_t i = 0; i < matches.size(); ++i) {
+      if (i)
+        result += ",";
+      result += UTF16ToASCII(matches[i].term) + ":" +
+          base::IntToString(matches[i].visits);
+    }
+    return result;
+  }
+
+  base::Time now_;
+  KeywordSearchTermIndex index_;
+};
+
+TEST_F(KeywordSearchTermIndexTest, Find) {
+  Add(kKeyword, 1, "foo", 1, 3);
+  Add(kKeyword, 2, "food", 2, 1);
+  Add(kKeyword, 3, "Football", 5, 2);
+  Add(kKeyword, 4, "bar", 1, 0);
+  Add(kOtherKeyword, 5, "fool", 1, 0);
+
+  // Most recent first, ignoring case, only for the keyword.
+  EXPECT_EQ("food:2,Football:5,foo:1", Find(kKeyword, "FO", 10));
+  EXPECT_EQ("food:2,Football:5", Find(kKeyword, "fo", 2));
+  EXPECT_EQ("food:2", Find(kKeyword, "food", 10));
+  EXPECT_EQ("", Find(kKeyword, "fooz", 10));
+  EXPECT_EQ("fool:1", Find(kOtherKeyword, "f", 10));
+  EXPECT_EQ("", Find(0, "f", 10));
+
+  // A URL has one term per keyword.
+  Add(kKeyword, 1, "fox", 1, 0);
+  EXPECT_EQ("", Find(kKeyword, "fox", 10));
+}
+
+TEST_F(KeywordSearchTermIndexTest, Dedupe) {
+  // The same term searched for from several URLs is listed once, with the
+  // most recent visit and the visits of all of them.
+  Add(kKeyword, 1, "foo", 1, 3);
+  Add(kKeyword, 2, "FOO", 2, 1);
+  Add(kKeyword, 3, "food", 4, 1);
+  EXPECT_EQ(2u, index_.size());
+  // Equally recent, the most visited comes first.
+  EXPECT_EQ("food:4,FOO:3", Find(kKeyword, "f", 10));
+
+  URLRow row(GURL("http://foo/"));
+  row.set_id(1);
+  row.set_visit_count(5);
+  row.set_last_visit(now_);
+  index_.UpdateURL(row);
+  EXPECT_EQ("foo:7,food:4", Find(kKeyword, "f", 10));
+
+  index_.RemoveURL(1);
+  EXPECT_EQ("food:4,FOO:2", Find(kKeyword, "f", 10));
+  index_.RemoveURL(2);
+  EXPECT_EQ("food:4", Find(kKeyword, "f", 10));
+  EXPECT_EQ(1u, index_.size());
+}
+
+TEST_F(KeywordSearchTermIndexTest, RemoveKeyword) {
+  Add(kKeyword, 1, "foo", 1, 0);
+  Add(kOtherKeyword, 1, "foo", 1, 0);
+  Add(kOtherKeyword, 2, "bar", 1, 0);
+  index_.RemoveKeyword(kOtherKeyword);
+  EXPECT_EQ("", Find(kOtherKeyword, "f", 10));
+  EXPECT_EQ("foo:1", Find(kKeyword, "f", 10));
+  EXPECT_EQ(1u, index_.size());
+
+  // The URL may get a term for the removed keyword again.
+  Add(kOtherKeyword, 1, "foo", 1, 0);
+  EXPECT_EQ("foo:1", Find(kOtherKeyword, "f", 10));
+
+  index_.Clear();
+  EXPECT_EQ("", Find(kKeyword, "f", 10));
+  EXPECT_EQ(0u, index_.size());
+}
+
+}  // namespace history
@@ -4,6 +4,7 @@
 
 #include "chrome/browser/history/shortcuts_backend.h"
 
+#include <algorithm>
 #include <map>
 #include <string>
 #include <vector>
@@ -30,6 +31,9 @@ using content::BrowserThread;
 
 namespace {
 
+// How long after a change the pending changes are written to the database.
+const int kWriteDelaySeconds = 2;
+
 // Takes Match classification vector and removes all matched positions,
 // compacting repetitions if necessary.
 ACMatchClassifications StripMatchMarkers(
@@ -128,6 +132,22 @@ ShortcutsBackend::Shortcut::~Shortcut() {
 
 // ShortcutsBackend -----------------------------------------------------------
 
+// Orders index entries by their lowercase text, then by the id of their
+// shortcut, so that every entry has a known position. Also compares them with
+// a text to find where the entries starting with it begin.
+class ShortcutsBackend::EntryLess {
+ public:
+  bool operator()(const IndexEntry& a, const IndexEntry& b) const {
+    int text_order = a.lower_text->compare(*b.lower_text);
+    return (text_order != 0) ? (text_order < 0) :
+        (a.shortcut->id < b.shortcut->id);
+  }
+
+  bool operator()(const IndexEntry& a, const string16& b) const {
+    return *a.lower_text < b;
+  }
+};
+
 ShortcutsBackend::ShortcutsBackend(Profile* profile, bool suppress_db)
     : current_state_(NOT_INITIALIZED),
       no_db_access_(suppress_db) {
@@ -158,17 +178,25 @@ bool ShortcutsBackend::Init() {
       base::Bind(&ShortcutsBackend::InitInternal, this));
 }
 
+ShortcutsBackend::ShortcutRange ShortcutsBackend::FindShortcuts(
+    const string16& lower_text) const {
+  ShortcutIndex::const_iterator begin(
+      std::lower_bound(index_.begin(), index_.end(), lower_text, EntryLess()));
+  ShortcutIndex::const_iterator end(begin);
+  while (end != index_.end() && StartsWith(*end->lower_text, lower_text, true))
+    ++end;
+  return ShortcutRange(begin, end);
+}
+
 bool ShortcutsBackend::AddShortcut(const Shortcut& shortcut) {
   if (!initialized())
     return false;
   DCHECK(guid_map_.find(shortcut.id) == guid_map_.end());
-  guid_map_[shortcut.id] = shortcuts_map_.insert(
-      std::make_pair(base::i18n::ToLower(shortcut.text), shortcut));
+  InsertShortcut(shortcut);
   FOR_EACH_OBSERVER(ShortcutsBackendObserver, observer_list_,
                     OnShortcutsChanged());
-  return no_db_access_ || BrowserThread::PostTask(BrowserThread::DB, FROM_HERE,
-      base::Bind(base::IgnoreResult(&ShortcutsDatabase::AddShortcut),
-                 db_.get(), shortcut));
+  ScheduleWrite(shortcut);
+  return true;
 }
 
 bool ShortcutsBackend::UpdateShortcut(const Shortcut& shortcut) {
@@ -176,14 +204,12 @@ bool ShortcutsBackend::UpdateShortcut(const Shortcut& shortcut) {
     return false;
   GuidMap::iterator it(guid_map_.find(shortcut.id));
   if (it != guid_map_.end())
-    shortcuts_map_.erase(it->second);
-  guid_map_[shortcut.id] = shortcuts_map_.insert(
-      std::make_pair(base::i18n::ToLower(shortcut.text), shortcut));
+    EraseShortcut(it);
+  InsertShortcut(shortcut);
   FOR_EACH_OBSERVER(ShortcutsBackendObserver, observer_list_,
                     OnShortcutsChanged());
-  return no_db_access_ || BrowserThread::PostTask(BrowserThread::DB, FROM_HERE,
-      base::Bind(base::IgnoreResult(&ShortcutsDatabase::UpdateShortcut),
-                 db_.get(), shortcut));
+  ScheduleWrite(shortcut);
+  return true;
 }
 
 bool ShortcutsBackend::DeleteShortcutsWithIds(
@@ -192,16 +218,13 @@ bool ShortcutsBackend::DeleteShortcutsWithIds(
     return false;
   for (size_t i = 0; i < shortcut_ids.size(); ++i) {
     GuidMap::iterator it(guid_map_.find(shortcut_ids[i]));
-    if (it != guid_map_.end()) {
-      shortcuts_map_.erase(it->second);
-      guid_map_.erase(it);
-    }
+    if (it != guid_map_.end())
+      EraseShortcut(it);
+    ScheduleDelete(shortcut_ids[i]);
   }
   FOR_EACH_OBSERVER(ShortcutsBackendObserver, observer_list_,
                     OnShortcutsChanged());
-  return no_db_access_ || BrowserThread::PostTask(BrowserThread::DB, FROM_HERE,
-      base::Bind(base::IgnoreResult(&ShortcutsDatabase::DeleteShortcutsWithIds),
-                 db_.get(), shortcut_ids));
+  return true;
 }
 
 bool ShortcutsBackend::DeleteShortcutsWithUrl(const GURL& shortcut_url) {
@@ -211,10 +234,15 @@ bool ShortcutsBackend::DeleteShortcutsWithUrl(const GURL& shortcut_url) {
 bool ShortcutsBackend::DeleteAllShortcuts() {
   if (!initialized())
     return false;
-  shortcuts_map_.clear();
+  index_.clear();
+  texts_.clear();
   guid_map_.clear();
   FOR_EACH_OBSERVER(ShortcutsBackendObserver, observer_list_,
                     OnShortcutsChanged());
+  // Nothing queued needs writing any more.
+  pending_writes_.clear();
+  pending_deletes_.clear();
+  write_timer_.Stop();
   return no_db_access_ || BrowserThread::PostTask(BrowserThread::DB, FROM_HERE,
       base::Bind(base::IgnoreResult(&ShortcutsDatabase::DeleteAllShortcuts),
                  db_.get()));
@@ -235,6 +263,8 @@ void ShortcutsBackend::ShutdownOnUIThread() {
   DCHECK(!BrowserThread::IsThreadInitialized(BrowserThread::UI) ||
          BrowserThread::CurrentlyOn(BrowserThread::UI));
   notification_registrar_.RemoveAll();
+  write_timer_.Stop();
+  WritePendingChanges();
 }
 
 void ShortcutsBackend::Observe(int type,
@@ -263,7 +293,7 @@ void ShortcutsBackend::Observe(int type,
     for (GuidMap::iterator it(guid_map_.begin()); it != guid_map_.end(); ++it) {
       if (std::find_if(
           rows.begin(), rows.end(), URLRow::URLRowHasURL(
-              it->second->second.match_core.destination_url)) != rows.end())
+              it->second.match_core.destination_url)) != rows.end())
         shortcut_ids.push_back(it->first);
     }
     DeleteShortcutsWithIds(shortcut_ids);
@@ -276,13 +306,14 @@ void ShortcutsBackend::Observe(int type,
   string16 text_lowercase(base::i18n::ToLower(log->text));
 
   const AutocompleteMatch& match(log->result.match_at(log->selected_index));
-  for (ShortcutMap::iterator it = shortcuts_map_.lower_bound(text_lowercase);
-       it != shortcuts_map_.end() &&
-           StartsWith(it->first, text_lowercase, true); ++it) {
-    if (match.destination_url == it->second.match_core.destination_url) {
-      UpdateShortcut(Shortcut(it->second.id, log->text,
+  ShortcutRange range(FindShortcuts(text_lowercase));
+  for (ShortcutIndex::const_iterator it = range.first; it != range.second;
+       ++it) {
+    const Shortcut& shortcut = *it->shortcut;
+    if (match.destination_url == shortcut.match_core.destination_url) {
+      UpdateShortcut(Shortcut(shortcut.id, log->text,
                               Shortcut::MatchCore(match), base::Time::Now(),
-                              it->second.number_of_hits + 1));
+                              shortcut.number_of_hits + 1));
       return;
     }
   }
@@ -293,24 +324,24 @@ void ShortcutsBackend::Observe(int type,
 void ShortcutsBackend::InitInternal() {
   DCHECK(current_state_ == INITIALIZING);
   db_->Init();
-  ShortcutsDatabase::GuidToShortcutMap shortcuts;
-  db_->LoadShortcuts(&shortcuts);
-  temp_shortcuts_map_.reset(new ShortcutMap);
   temp_guid_map_.reset(new GuidMap);
-  for (ShortcutsDatabase::GuidToShortcutMap::iterator it = shortcuts.begin();
-       it != shortcuts.end(); ++it) {
-    (*temp_guid_map_)[it->first] = temp_shortcuts_map_->insert(
-        std::make_pair(base::i18n::ToLower(it->second.text), it->second));
-  }
+  db_->LoadShortcuts(temp_guid_map_.get());
+  temp_texts_.reset(new TextMap);
+  temp_index_.reset(new ShortcutIndex);
+  BuildIndex(*temp_guid_map_, temp_texts_.get(), temp_index_.get());
   BrowserThread::PostTask(BrowserThread::UI, FROM_HERE,
       base::Bind(&ShortcutsBackend::InitCompleted, this));
 }
 
 void ShortcutsBackend::InitCompleted() {
+  // Swapping the maps keeps the addresses of their elements, which the index
+  // points to.
   temp_guid_map_->swap(guid_map_);
-  temp_shortcuts_map_->swap(shortcuts_map_);
-  temp_shortcuts_map_.reset(NULL);
+  temp_texts_->swap(texts_);
+  temp_index_->swap(index_);
   temp_guid_map_.reset(NULL);
+  temp_texts_.reset(NULL);
+  temp_index_.reset(NULL);
   current_state_ = INITIALIZED;
   FOR_EACH_OBSERVER(ShortcutsBackendObserver, observer_list_,
                     OnShortcutsLoaded());
@@ -319,27 +350,104 @@ void ShortcutsBackend::InitCompleted() {
 bool ShortcutsBackend::DeleteShortcutsWithUrl(const GURL& url,
                                               bool exact_match) {
   const std::string& url_spec = url.spec();
-  std::vector<std::string> shortcut_ids;
   for (GuidMap::iterator it(guid_map_.begin()); it != guid_map_.end(); ) {
     if (exact_match ?
-        (it->second->second.match_core.destination_url == url) :
-        StartsWithASCII(it->second->second.match_core.destination_url.spec(),
+        (it->second.match_core.destination_url == url) :
+        StartsWithASCII(it->second.match_core.destination_url.spec(),
                         url_spec, true)) {
-      shortcut_ids.push_back(it->first);
-      shortcuts_map_.erase(it->second);
-      guid_map_.erase(it++);
+      ScheduleDelete(it->first);
+      EraseShortcut(it++);
     } else {
       ++it;
     }
   }
   FOR_EACH_OBSERVER(ShortcutsBackendObserver, observer_list_,
                     OnShortcutsChanged());
-  return no_db_access_ ||
-      BrowserThread::PostTask(
-          BrowserThread::DB, FROM_HERE,
-          base::Bind(
-              base::IgnoreResult(&ShortcutsDatabase::DeleteShortcutsWithUrl),
-              db_.get(), url_spec));
+  return true;
+}
+
+// static
+void ShortcutsBackend::BuildIndex(const GuidMap& guid_map,
+                                  TextMap* texts,
+                                  ShortcutIndex* index) {
+  index->reserve(guid_map.size());
+  for (GuidMap::const_iterator it(guid_map.begin()); it != guid_map.end();
+       ++it) {
+    TextMap::iterator text = texts->insert(std::make_pair(
+        base::i18n::ToLower(it->second.text), 0)).first;
+    ++text->second;
+    IndexEntry entry = { &text->first, &it->second };
+    index->push_back(entry);
+  }
+  std::sort(index->begin(), index->end(), EntryLess());
+}
+
+void ShortcutsBackend::InsertShortcut(const Shortcut& shortcut) {
+  GuidMap::iterator it =
+      guid_map_.insert(std::make_pair(shortcut.id, shortcut)).first;
+  TextMap::iterator text = texts_.insert(std::make_pair(
+      base::i18n::ToLower(shortcut.text), 0)).first;
+  ++text->second;
+  IndexEntry entry = { &text->first, &it->second };
+  index_.insert(std::upper_bound(index_.begin(), index_.end(), entry,
+                                 EntryLess()),
+                entry);
+}
+
+void ShortcutsBackend::EraseShortcut(GuidMap::iterator it) {
+  TextMap::iterator text = texts_.find(base::i18n::ToLower(it->second.text));
+  DCHECK(text != texts_.end());
+  IndexEntry entry = { &text->first, &it->second };
+  ShortcutIndex::iterator position(
+      std::lower_bound(index_.begin(), index_.end(), entry, EntryLess()));
+  DCHECK(position != index_.end() && position->shortcut == &it->second);
+  index_.erase(position);
+  if (--text->second == 0)
+    texts_.erase(text);
+  guid_map_.erase(it);
+}
+
+void ShortcutsBackend::ScheduleWrite(const Shortcut& shortcut) {
+  if (no_db_access_)
+    return;
+  pending_deletes_.erase(shortcut.id);
+  pending_writes_.erase(shortcut.id);
+  pending_writes_.insert(std::make_pair(shortcut.id, shortcut));
+  if (!write_timer_.IsRunning()) {
+    write_timer_.Start(FROM_HERE,
+                       base::TimeDelta::FromSeconds(kWriteDelaySeconds), this,
+                       &ShortcutsBackend::WritePendingChanges);
+  }
+}
+
+void ShortcutsBackend::ScheduleDelete(const std::string& id) {
+  if (no_db_access_)
+    return;
+  pending_writes_.erase(id);
+  pending_deletes_.insert(id);
+  if (!write_timer_.IsRunning()) {
+    write_timer_.Start(FROM_HERE,
+                       base::TimeDelta::FromSeconds(kWriteDelaySeconds), this,
+                       &ShortcutsBackend::WritePendingChanges);
+  }
+}
+
+void ShortcutsBackend::WritePendingChanges() {
+  if (no_db_access_ || (pending_writes_.empty() && pending_deletes_.empty()))
+    return;
+  std::vector<Shortcut> shortcuts;
+  shortcuts.reserve(pending_writes_.size());
+  for (std::map<std::string, Shortcut>::const_iterator it(
+           pending_writes_.begin());
+       it != pending_writes_.end(); ++it)
+    shortcuts.push_back(it->second);
+  std::vector<std::string> deleted_ids(pending_deletes_.begin(),
+                                       pending_deletes_.end());
+  pending_writes_.clear();
+  pending_deletes_.clear();
+  BrowserThread::PostTask(BrowserThread::DB, FROM_HERE,
+      base::Bind(base::IgnoreResult(&ShortcutsDatabase::WriteShortcuts),
+                 db_.get(), shortcuts, deleted_ids));
 }
 
 }  // namespace history
@@ -6,7 +6,9 @@
 #define CHROME_BROWSER_HISTORY_SHORTCUTS_BACKEND_H_
 
 #include <map>
+#include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/files/file_path.h"
@@ -17,6 +19,7 @@
 #include "base/strings/string16.h"
 #include "base/synchronization/lock.h"
 #include "base/time/time.h"
+#include "base/timer/timer.h"
 #include "chrome/browser/autocomplete/autocomplete_match.h"
 #include "components/browser_context_keyed_service/refcounted_browser_context_keyed_service.h"
 #include "content/public/browser/notification_observer.h"
@@ -82,7 +85,19 @@ class ShortcutsBackend : public RefcountedBrowserContextKeyedService,
     int number_of_hits;           // How many times shortcut was selected.
   };
 
-  typedef std::multimap<string16, ShortcutsBackend::Shortcut> ShortcutMap;
+  // An entry of the shortcut index: a shortcut and its text, lowercased. The
+  // lowercase texts are interned, so the shortcuts selected with the same text
+  // share it, and the index is a compact array sorted by the text, which is
+  // cheap to search and to update. The rest of each shortcut, including its
+  // classifications, is kept aside and only looked at for the shortcuts that
+  // are found.
+  struct IndexEntry {
+    const string16* lower_text;
+    const Shortcut* shortcut;
+  };
+  typedef std::vector<IndexEntry> ShortcutIndex;
+  typedef std::pair<ShortcutIndex::const_iterator,
+                    ShortcutIndex::const_iterator> ShortcutRange;
 
   // |profile| is necessary for profile notifications only and can be NULL in
   // unit-tests. For unit testing, set |suppress_db| to true to prevent creation
@@ -109,7 +124,11 @@ class ShortcutsBackend : public RefcountedBrowserContextKeyedService,
   // All of the public functions *must* be called on UI thread only!
 
   bool initialized() const { return current_state_ == INITIALIZED; }
-  const ShortcutMap& shortcuts_map() const { return shortcuts_map_; }
+  const ShortcutIndex& shortcut_index() const { return index_; }
+
+  // Returns the entries of the index whose lowercase text starts with
+  // |lower_text|.
+  ShortcutRange FindShortcuts(const string16& lower_text) const;
 
   // Adds the Shortcut to the database.
   bool AddShortcut(const ShortcutsBackend::Shortcut& shortcut);
@@ -139,7 +158,12 @@ class ShortcutsBackend : public RefcountedBrowserContextKeyedService,
                       // called.
   };
 
-  typedef std::map<std::string, ShortcutMap::iterator> GuidMap;
+  // The shortcuts by id, and the interned lowercase texts with the number of
+  // shortcuts sharing each.
+  typedef std::map<std::string, Shortcut> GuidMap;
+  typedef std::map<string16, int> TextMap;
+
+  class EntryLess;
 
   virtual ~ShortcutsBackend();
 
@@ -162,19 +186,47 @@ class ShortcutsBackend : public RefcountedBrowserContextKeyedService,
   // true, only shortcuts from exactly |url| are deleted.
   bool DeleteShortcutsWithUrl(const GURL& url, bool exact_match);
 
+  // Builds |index| and |texts| for the shortcuts of |guid_map|.
+  static void BuildIndex(const GuidMap& guid_map,
+                         TextMap* texts,
+                         ShortcutIndex* index);
+
+  // Adds |shortcut| to the shortcuts and the index, or removes the shortcut at
+  // |it| from them.
+  void InsertShortcut(const Shortcut& shortcut);
+  void EraseShortcut(GuidMap::iterator it);
+
+  // Queues the writing of |shortcut|, or the deletion of the shortcut with
+  // |id|, to the database.
+  void ScheduleWrite(const Shortcut& shortcut);
+  void ScheduleDelete(const std::string& id);
+
+  // Writes the queued changes to the database in one transaction on the DB
+  // thread.
+  void WritePendingChanges();
+
   CurrentState current_state_;
   ObserverList<ShortcutsBackendObserver> observer_list_;
   scoped_refptr<ShortcutsDatabase> db_;
 
-  // The |temp_shortcuts_map_| and |temp_guid_map_| used for temporary storage
-  // between InitInternal() and InitComplete() to avoid doing a potentially huge
-  // copy.
-  scoped_ptr<ShortcutMap> temp_shortcuts_map_;
+  // The |temp_guid_map_|, |temp_texts_| and |temp_index_| used for temporary
+  // storage between InitInternal() and InitComplete() to avoid doing a
+  // potentially huge copy.
   scoped_ptr<GuidMap> temp_guid_map_;
+  scoped_ptr<TextMap> temp_texts_;
+  scoped_ptr<ShortcutIndex> temp_index_;
 
-  ShortcutMap shortcuts_map_;
-  // This is a helper map for quick access to a shortcut by guid.
   GuidMap guid_map_;
+  TextMap texts_;
+  ShortcutIndex index_;
+
+  // Changes not yet written to the database: the shortcuts added or updated,
+  // and the ids of the shortcuts deleted, since the last write. They are
+  // written together a little after the first of them, so that a burst of
+  // changes costs one transaction.
+  std::map<std::string, Shortcut> pending_writes_;
+  std::set<std::string> pending_deletes_;
+  base::OneShotTimer<ShortcutsBackend> write_timer_;
 
   content::NotificationRegistrar notification_registrar_;
 
@@ -53,6 +53,9 @@ class ShortcutsBackendTest : public testing::Test,
 
   void InitBackend();
 
+  // Returns the shortcut selected with exactly |text|, or NULL.
+  const ShortcutsBackend::Shortcut* FindShortcut(const string16& text) const;
+
   TestingProfile profile_;
   scoped_refptr<ShortcutsBackend> backend_;
   base::MessageLoopForUI ui_message_loop_;
@@ -97,6 +100,17 @@ void ShortcutsBackendTest::InitBackend() {
   EXPECT_TRUE(backend_->initialized());
 }
 
+const ShortcutsBackend::Shortcut* ShortcutsBackendTest::FindShortcut(
+    const string16& text) const {
+  ShortcutsBackend::ShortcutRange range(backend_->FindShortcuts(text));
+  for (ShortcutsBackend::ShortcutIndex::const_iterator it = range.first;
+       it != range.second; ++it) {
+    if (*it->lower_text == text)
+      return it->shortcut;
+  }
+  return NULL;
+}
+
 
 // Actual tests ---------------------------------------------------------------
 
@@ -110,17 +124,60 @@ TEST_F(ShortcutsBackendTest, AddAndUpdateShortcut) {
   EXPECT_TRUE(changed_notified_);
   changed_notified_ = false;
 
-  const ShortcutsBackend::ShortcutMap& shortcuts = backend_->shortcuts_map();
-  ASSERT_TRUE(shortcuts.end() != shortcuts.find(shortcut.text));
-  EXPECT_EQ(shortcut.id, shortcuts.find(shortcut.text)->second.id);
+  ASSERT_TRUE(FindShortcut(shortcut.text));
+  EXPECT_EQ(shortcut.id, FindShortcut(shortcut.text)->id);
   EXPECT_EQ(shortcut.match_core.contents,
-            shortcuts.find(shortcut.text)->second.match_core.contents);
+            FindShortcut(shortcut.text)->match_core.contents);
   shortcut.match_core.contents = ASCIIToUTF16("Google Web Search");
   EXPECT_TRUE(backend_->UpdateShortcut(shortcut));
   EXPECT_TRUE(changed_notified_);
-  EXPECT_EQ(shortcut.id, shortcuts.find(shortcut.text)->second.id);
+  ASSERT_TRUE(FindShortcut(shortcut.text));
+  EXPECT_EQ(shortcut.id, FindShortcut(shortcut.text)->id);
   EXPECT_EQ(shortcut.match_core.contents,
-            shortcuts.find(shortcut.text)->second.match_core.contents);
+            FindShortcut(shortcut.text)->match_core.contents);
+  EXPECT_EQ(1U, backend_->shortcut_index().size());
+}
+
+TEST_F(ShortcutsBackendTest, FindShortcuts) {
+  InitBackend();
+  ShortcutsBackend::Shortcut shortcut1(
+      "BD85DBA2-8C29-49F9-84AE-48E1E90880DF", ASCIIToUTF16("goog"),
+      MatchCoreForTesting("http://www.google.com"), base::Time::Now(), 100);
+  EXPECT_TRUE(backend_->AddShortcut(shortcut1));
+  ShortcutsBackend::Shortcut shortcut2(
+      "BD85DBA2-8C29-49F9-84AE-48E1E90880E0", ASCIIToUTF16("Goog"),
+      MatchCoreForTesting("http://www.google.org"), base::Time::Now(), 10);
+  EXPECT_TRUE(backend_->AddShortcut(shortcut2));
+  ShortcutsBackend::Shortcut shortcut3(
+      "BD85DBA2-8C29-49F9-84AE-48E1E90880E1", ASCIIToUTF16("google maps"),
+      MatchCoreForTesting("http://maps.google.com"), base::Time::Now(), 10);
+  EXPECT_TRUE(backend_->AddShortcut(shortcut3));
+  ShortcutsBackend::Shortcut shortcut4(
+      "BD85DBA2-8C29-49F9-84AE-48E1E90880E2", ASCIIToUTF16("gmail"),
+      MatchCoreForTesting("http://mail.google.com"), base::Time::Now(), 10);
+  EXPECT_TRUE(backend_->AddShortcut(shortcut4));
+
+  // The shortcuts selected with the same text, ignoring case, share it.
+  ShortcutsBackend::ShortcutRange range(
+      backend_->FindShortcuts(ASCIIToUTF16("goog")));
+  ASSERT_EQ(3, range.second - range.first);
+  EXPECT_EQ(range.first[0].lower_text, range.first[1].lower_text);
+  EXPECT_EQ(shortcut1.id, range.first[0].shortcut->id);
+  EXPECT_EQ(shortcut2.id, range.first[1].shortcut->id);
+  EXPECT_EQ(shortcut3.id, range.first[2].shortcut->id);
+
+  range = backend_->FindShortcuts(ASCIIToUTF16("g"));
+  EXPECT_EQ(4, range.second - range.first);
+  range = backend_->FindShortcuts(ASCIIToUTF16("googlf"));
+  EXPECT_TRUE(range.first == range.second);
+
+  std::vector<std::string> deleted_ids;
+  deleted_ids.push_back(shortcut1.id);
+  EXPECT_TRUE(backend_->DeleteShortcutsWithIds(deleted_ids));
+  range = backend_->FindShortcuts(ASCIIToUTF16("goog"));
+  ASSERT_EQ(2, range.second - range.first);
+  EXPECT_EQ(shortcut2.id, range.first[0].shortcut->id);
+  EXPECT_EQ(shortcut3.id, range.first[1].shortcut->id);
 }
 
 TEST_F(ShortcutsBackendTest, DeleteShortcuts) {
@@ -145,24 +202,25 @@ TEST_F(ShortcutsBackendTest, DeleteShortcuts) {
       MatchCoreForTesting("http://www.film.com"), base::Time::Now(), 10);
   EXPECT_TRUE(backend_->AddShortcut(shortcut4));
 
-  const ShortcutsBackend::ShortcutMap& shortcuts = backend_->shortcuts_map();
+  const ShortcutsBackend::ShortcutIndex& shortcuts =
+      backend_->shortcut_index();
 
   ASSERT_EQ(4U, shortcuts.size());
-  EXPECT_EQ(shortcut1.id, shortcuts.find(shortcut1.text)->second.id);
-  EXPECT_EQ(shortcut2.id, shortcuts.find(shortcut2.text)->second.id);
-  EXPECT_EQ(shortcut3.id, shortcuts.find(shortcut3.text)->second.id);
-  EXPECT_EQ(shortcut4.id, shortcuts.find(shortcut4.text)->second.id);
+  EXPECT_EQ(shortcut1.id, FindShortcut(shortcut1.text)->id);
+  EXPECT_EQ(shortcut2.id, FindShortcut(shortcut2.text)->id);
+  EXPECT_EQ(shortcut3.id, FindShortcut(shortcut3.text)->id);
+  EXPECT_EQ(shortcut4.id, FindShortcut(shortcut4.text)->id);
 
   EXPECT_TRUE(backend_->DeleteShortcutsWithUrl(
       shortcut1.match_core.destination_url));
 
   ASSERT_EQ(2U, shortcuts.size());
-  EXPECT_TRUE(shortcuts.end() == shortcuts.find(shortcut1.text));
-  EXPECT_TRUE(shortcuts.end() == shortcuts.find(shortcut2.text));
-  ASSERT_TRUE(shortcuts.end() != shortcuts.find(shortcut3.text));
-  ASSERT_TRUE(shortcuts.end() != shortcuts.find(shortcut4.text));
-  EXPECT_EQ(shortcut3.id, shortcuts.find(shortcut3.text)->second.id);
-  EXPECT_EQ(shortcut4.id, shortcuts.find(shortcut4.text)->second.id);
+  EXPECT_TRUE(FindShortcut(shortcut1.text) == NULL);
+  EXPECT_TRUE(FindShortcut(shortcut2.text) == NULL);
+  ASSERT_TRUE(FindShortcut(shortcut3.text));
+  ASSERT_TRUE(FindShortcut(shortcut4.text));
+  EXPECT_EQ(shortcut3.id, FindShortcut(shortcut3.text)->id);
+  EXPECT_EQ(shortcut4.id, FindShortcut(shortcut4.text)->id);
 
   std::vector<std::string> deleted_ids;
   deleted_ids.push_back(shortcut3.id);
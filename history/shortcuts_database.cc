@@ -122,6 +122,31 @@ bool ShortcutsDatabase::DeleteShortcutsWithIds(
   return success;
 }
 
+bool ShortcutsDatabase::WriteShortcuts(
+    const std::vector<ShortcutsBackend::Shortcut>& shortcuts,
+    const std::vector<std::string>& deleted_ids) {
+  bool success = true;
+  db_.BeginTransaction();
+  for (std::vector<ShortcutsBackend::Shortcut>::const_iterator it =
+           shortcuts.begin(); it != shortcuts.end(); ++it) {
+    sql::Statement s(db_.GetCachedStatement(SQL_FROM_HERE,
+        base::StringPrintf("INSERT OR REPLACE INTO %s (id, text, url, "
+            "contents, contents_class, description, description_class, "
+            "last_access_time, number_of_hits) VALUES (?,?,?,?,?,?,?,?,?)",
+            kShortcutsTableName).c_str()));
+    BindShortcutToStatement(*it, &s);
+    if (!s.Run())
+      success = false;
+  }
+  for (std::vector<std::string>::const_iterator it = deleted_ids.begin();
+       it != deleted_ids.end(); ++it) {
+    if (!DeleteShortcut("id", *it, db_))
+      success = false;
+  }
+  db_.CommitTransaction();
+  return success;
+}
+
 bool ShortcutsDatabase::DeleteShortcutsWithUrl(
     const std::string& shortcut_url_spec) {
   return DeleteShortcut("url", shortcut_url_spec, db_);
@@ -56,6 +56,11 @@ class ShortcutsDatabase : public base::RefCountedThreadSafe<ShortcutsDatabase> {
   // Deletes the ShortcutsProvider::Shortcuts with the id.
   bool DeleteShortcutsWithIds(const std::vector<std::string>& shortcut_ids);
 
+  // Adds or updates |shortcuts| and deletes the shortcuts with |deleted_ids|,
+  // in one transaction.
+  bool WriteShortcuts(const std::vector<ShortcutsBackend::Shortcut>& shortcuts,
+                      const std::vector<std::string>& deleted_ids);
+
   // Deletes the ShortcutsProvider::Shortcuts with the url.
   bool DeleteShortcutsWithUrl(const std::string& shortcut_url_spec);
 
@@ -72,6 +77,7 @@ class ShortcutsDatabase : public base::RefCountedThreadSafe<ShortcutsDatabase> {
   FRIEND_TEST_ALL_PREFIXES(ShortcutsDatabaseTest, UpdateShortcut);
   FRIEND_TEST_ALL_PREFIXES(ShortcutsDatabaseTest, DeleteShortcutsWithIds);
   FRIEND_TEST_ALL_PREFIXES(ShortcutsDatabaseTest, DeleteShortcutsWithUrl);
+  FRIEND_TEST_ALL_PREFIXES(ShortcutsDatabaseTest, WriteShortcuts);
   FRIEND_TEST_ALL_PREFIXES(ShortcutsDatabaseTest, LoadShortcuts);
 
   virtual ~ShortcutsDatabase();
@@ -172,6 +172,31 @@ TEST_F(ShortcutsDatabaseTest, DeleteShortcutsWithUrl) {
   EXPECT_TRUE(it == shortcuts.end());
 }
 
+TEST_F(ShortcutsDatabaseTest, WriteShortcuts) {
+  AddAll();
+  ShortcutsBackend::Shortcut updated(
+      ShortcutFromTestInfo(shortcut_test_db[1]));
+  updated.match_core.contents = ASCIIToUTF16("gro.todhsals");
+  ShortcutsBackend::Shortcut added(ShortcutFromTestInfo(shortcut_test_db[0]));
+  added.id = "BD85DBA2-8C29-49F9-84AE-48E1E90880E2";
+  std::vector<ShortcutsBackend::Shortcut> shortcuts_to_write;
+  shortcuts_to_write.push_back(updated);
+  shortcuts_to_write.push_back(added);
+  std::vector<std::string> deleted_ids;
+  deleted_ids.push_back(shortcut_test_db[2].guid);
+  EXPECT_TRUE(db_->WriteShortcuts(shortcuts_to_write, deleted_ids));
+  EXPECT_EQ(arraysize(shortcut_test_db), CountRecords());
+
+  ShortcutsDatabase::GuidToShortcutMap shortcuts;
+  EXPECT_TRUE(db_->LoadShortcuts(&shortcuts));
+  ShortcutsDatabase::GuidToShortcutMap::iterator it =
+      shortcuts.find(updated.id);
+  ASSERT_TRUE(it != shortcuts.end());
+  EXPECT_TRUE(it->second.match_core.contents == updated.match_core.contents);
+  EXPECT_TRUE(shortcuts.find(added.id) != shortcuts.end());
+  EXPECT_TRUE(shortcuts.find(shortcut_test_db[2].guid) == shortcuts.end());
+}
+
 TEST_F(ShortcutsDatabaseTest, LoadShortcuts) {
   AddAll();
   ShortcutsDatabase::GuidToShortcutMap shortcuts;
@@ -16,6 +16,13 @@ using content::BrowserThread;
 
 namespace history {
 
+TopSitesBackend::PageThumbnail::PageThumbnail()
+    : url_rank(0) {
+}
+
+TopSitesBackend::PageThumbnail::~PageThumbnail() {
+}
+
 TopSitesBackend::TopSitesBackend()
     : db_(new TopSitesDatabase()) {
 }
@@ -62,6 +69,13 @@ void TopSitesBackend::SetPageThumbnail(const MostVisitedURL& url,
                  url_rank, thumbnail));
 }
 
+void TopSitesBackend::SetPageThumbnails(const PageThumbnails& thumbnails) {
+  BrowserThread::PostTask(
+      BrowserThread::DB, FROM_HERE,
+      base::Bind(&TopSitesBackend::SetPageThumbnailsOnDBThread, this,
+                 thumbnails));
+}
+
 void TopSitesBackend::ResetDatabase() {
   BrowserThread::PostTask(
       BrowserThread::DB, FROM_HERE,
@@ -128,6 +142,19 @@ void TopSitesBackend::SetPageThumbnailOnDBThread(const MostVisitedURL& url,
   db_->SetPageThumbnail(url, url_rank, thumbnail);
 }
 
+void TopSitesBackend::SetPageThumbnailsOnDBThread(
+    const PageThumbnails& thumbnails) {
+  if (!db_)
+    return;
+
+  db_->BeginTransaction();
+  for (size_t i = 0; i < thumbnails.size(); ++i) {
+    db_->SetPageThumbnail(thumbnails[i].url, thumbnails[i].url_rank,
+                          thumbnails[i].thumbnail);
+  }
+  db_->CommitTransaction();
+}
+
 void TopSitesBackend::ResetDatabaseOnDBThread(const base::FilePath& file_path) {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::DB));
   db_.reset(NULL);
@@ -5,6 +5,8 @@
 #ifndef CHROME_BROWSER_HISTORY_TOP_SITES_BACKEND_H_
 #define CHROME_BROWSER_HISTORY_TOP_SITES_BACKEND_H_
 
+#include <vector>
+
 #include "base/callback.h"
 #include "base/files/file_path.h"
 #include "base/memory/ref_counted.h"
@@ -31,6 +33,17 @@ class TopSitesBackend : public base::RefCountedThreadSafe<TopSitesBackend> {
   typedef base::Callback<void(const scoped_refptr<MostVisitedThumbnails>&)>
       GetMostVisitedThumbnailsCallback;
 
+  // A thumbnail to write to the db, along with the page it belongs to.
+  struct PageThumbnail {
+    PageThumbnail();
+    ~PageThumbnail();
+
+    MostVisitedURL url;
+    int url_rank;
+    Images thumbnail;
+  };
+  typedef std::vector<PageThumbnail> PageThumbnails;
+
   TopSitesBackend();
 
   void Init(const base::FilePath& path);
@@ -51,6 +64,9 @@ class TopSitesBackend : public base::RefCountedThreadSafe<TopSitesBackend> {
                         int url_rank,
                         const Images& thumbnail);
 
+  // Sets several thumbnails in one transaction.
+  void SetPageThumbnails(const PageThumbnails& thumbnails);
+
   // Deletes the database and recreates it.
   void ResetDatabase();
 
@@ -83,6 +99,9 @@ class TopSitesBackend : public base::RefCountedThreadSafe<TopSitesBackend> {
                                   int url_rank,
                                   const Images& thumbnail);
 
+  // Sets the thumbnails.
+  void SetPageThumbnailsOnDBThread(const PageThumbnails& thumbnails);
+
   // Resets the database.
   void ResetDatabaseOnDBThread(const base::FilePath& file_path);
 
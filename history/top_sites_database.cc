@@ -80,6 +80,14 @@ bool TopSitesDatabase::Init(const base::FilePath& db_name) {
   return true;
 }
 
+void TopSitesDatabase::BeginTransaction() {
+  db_->BeginTransaction();
+}
+
+void TopSitesDatabase::CommitTransaction() {
+  db_->CommitTransaction();
+}
+
 bool TopSitesDatabase::InitThumbnailTable() {
   if (!db_->DoesTableExist("thumbnails")) {
     if (!db_->Execute("CREATE TABLE thumbnails ("
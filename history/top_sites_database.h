@@ -32,6 +32,11 @@ class TopSitesDatabase {
   // Returns true on success. If false, no other functions should be called.
   bool Init(const base::FilePath& db_name);
 
+  // Groups the changes made until CommitTransaction() into one transaction.
+  // Transactions may be nested.
+  void BeginTransaction();
+  void CommitTransaction();
+
   // Thumbnails ----------------------------------------------------------------
 
   // Returns a list of all URLs currently in the table.
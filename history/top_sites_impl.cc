@@ -18,6 +18,7 @@
 #include "base/strings/string_util.h"
 #include "base/strings/utf_string_conversions.h"
 #include "base/task_runner.h"
+#include "base/threading/sequenced_worker_pool.h"
 #include "base/values.h"
 #include "chrome/browser/chrome_notification_types.h"
 #include "chrome/browser/history/history_backend.h"
@@ -42,7 +43,7 @@
 #include "ui/base/l10n/l10n_util.h"
 #include "ui/base/layout.h"
 #include "ui/base/resource/resource_bundle.h"
-#include "ui/gfx/image/image_util.h"
+#include "ui/gfx/codec/jpeg_codec.h"
 
 using base::DictionaryValue;
 using content::BrowserThread;
@@ -82,12 +83,33 @@ static const int64 kMaxUpdateIntervalMinutes = 60;
 // artifacts for these small sized, highly detailed images.
 static const int kTopSitesImageQuality = 100;
 
+// Max number of thumbnails encoded, and then written to the db, in one batch.
+static const size_t kMaxThumbnailsPerBatch = 8;
+
+// Max size of the bitmaps waiting to be encoded. Past it the oldest are
+// dropped.
+static const size_t kMaxPendingThumbnailBytes = 4 * 1024 * 1024;
+
+TopSitesImpl::PendingThumbnail::PendingThumbnail() {
+}
+
+TopSitesImpl::PendingThumbnail::~PendingThumbnail() {
+}
+
+TopSitesImpl::EncodedThumbnail::EncodedThumbnail() {
+}
+
+TopSitesImpl::EncodedThumbnail::~EncodedThumbnail() {
+}
+
 TopSitesImpl::TopSitesImpl(Profile* profile)
     : backend_(NULL),
       cache_(new TopSitesCache()),
       thread_safe_cache_(new TopSitesCache()),
       profile_(profile),
       last_num_urls_changed_(0),
+      pending_thumbnail_bytes_(0),
+      encoding_thumbnails_(false),
       loaded_(false) {
   if (!profile_)
     return;
@@ -141,19 +163,38 @@ bool TopSitesImpl::SetPageThumbnail(const GURL& url,
   if (!HistoryService::CanAddURL(url))
     return false;  // It's not a real webpage.
 
-  scoped_refptr<base::RefCountedBytes> thumbnail_data;
-  if (!EncodeBitmap(thumbnail, &thumbnail_data))
+  if (thumbnail.IsEmpty())
     return false;
 
+  PendingThumbnail pending;
+  pending.url = url;
+  pending.bitmap = *thumbnail.ToSkBitmap();
+  pending.score = score;
+  pending.score_with_redirects = score;
   if (add_temp_thumbnail) {
-    // Always remove the existing entry and then add it back. That way if we end
-    // up with too many temp thumbnails we'll prune the oldest first.
-    RemoveTemporaryThumbnailByURL(url);
-    AddTemporaryThumbnail(url, thumbnail_data.get(), score);
-    return true;
+    // Temporary thumbnails always replace the existing one.
+    pending.key = url;
+  } else {
+    pending.key = cache_->GetCanonicalURL(url);
+    pending.score_with_redirects.redirect_hops_from_dest =
+        GetRedirectDistanceForURL(
+            cache_->top_sites()[cache_->GetURLIndex(url)], url);
+    if (!IsBetterThanQueuedThumbnail(pending.key,
+                                     pending.score_with_redirects))
+      return false;  // The one waiting to be encoded is better.
+
+    Images* image = cache_->GetImage(url);
+    if (!ShouldReplaceThumbnailWith(image->thumbnail_score,
+                                    pending.score_with_redirects) &&
+        image->thumbnail.get())
+      return false;  // The one we already have is better.
   }
 
-  return SetPageThumbnailEncoded(url, thumbnail_data.get(), score);
+  // The thumbnail is applied once it is encoded, which is when it is checked
+  // again against the page's thumbnail at that time.
+  QueueThumbnail(pending);
+  StartEncodingThumbnails();
+  return true;
 }
 
 bool TopSitesImpl::SetPageThumbnailToJPEGBytes(
@@ -258,6 +299,15 @@ bool TopSitesImpl::GetPageThumbnailScore(const GURL& url,
 
 bool TopSitesImpl::GetTemporaryPageThumbnailScore(const GURL& url,
                                                   ThumbnailScore* score) {
+  // A temporary thumbnail waiting to be encoded is newer than any in
+  // |temp_images_|.
+  PendingThumbnailMap::const_iterator pending =
+      pending_thumbnail_map_.find(url);
+  if (pending != pending_thumbnail_map_.end() && !IsKnownURL(url)) {
+    *score = pending->second->score;
+    return true;
+  }
+
   for (TempImages::iterator i = temp_images_.begin(); i != temp_images_.end();
        ++i) {
     if (i->first == url) {
@@ -349,6 +399,7 @@ void TopSitesImpl::Shutdown() {
   // invoked Shutdown (this could happen if we have a pending request and
   // Shutdown is invoked).
   history_consumer_.CancelAllRequests();
+  CancelThumbnailEncoding();
   backend_->Shutdown();
 }
 
@@ -478,13 +529,21 @@ bool TopSitesImpl::SetPageThumbnailEncoded(
 }
 
 // static
-bool TopSitesImpl::EncodeBitmap(const gfx::Image& bitmap,
+bool TopSitesImpl::EncodeBitmap(const SkBitmap& bitmap,
                                 scoped_refptr<base::RefCountedBytes>* bytes) {
-  if (bitmap.IsEmpty())
+  SkAutoLockPixels bitmap_lock(bitmap);
+  if (!bitmap.readyToDraw())
     return false;
   *bytes = new base::RefCountedBytes();
   std::vector<unsigned char> data;
-  if (!gfx::JPEG1xEncodedDataFromImage(bitmap, kTopSitesImageQuality, &data))
+  if (!gfx::JPEGCodec::Encode(
+          reinterpret_cast<unsigned char*>(bitmap.getAddr32(0, 0)),
+          gfx::JPEGCodec::FORMAT_SkBitmap,
+          bitmap.width(),
+          bitmap.height(),
+          static_cast<int>(bitmap.rowBytes()),
+          kTopSitesImageQuality,
+          &data))
     return false;
 
   // As we're going to cache this data, make sure the vector is only as big as
@@ -494,6 +553,128 @@ bool TopSitesImpl::EncodeBitmap(const gfx::Image& bitmap,
   return true;
 }
 
+// static
+void TopSitesImpl::EncodeThumbnails(const std::vector<PendingThumbnail>& batch,
+                                    EncodedThumbnails* results) {
+  results->resize(batch.size());
+  for (size_t i = 0; i < batch.size(); ++i) {
+    EncodedThumbnail& result = (*results)[i];
+    result.url = batch[i].url;
+    result.score = batch[i].score;
+    if (!EncodeBitmap(batch[i].bitmap, &result.data))
+      result.data = NULL;
+  }
+}
+
+bool TopSitesImpl::IsBetterThanQueuedThumbnail(
+    const GURL& key,
+    const ThumbnailScore& score_with_redirects) {
+  PendingThumbnailMap::const_iterator pending =
+      pending_thumbnail_map_.find(key);
+  if (pending != pending_thumbnail_map_.end() &&
+      !ShouldReplaceThumbnailWith(pending->second->score_with_redirects,
+                                  score_with_redirects))
+    return false;
+
+  std::map<GURL, ThumbnailScore>::const_iterator encoding =
+      encoding_thumbnail_scores_.find(key);
+  return encoding == encoding_thumbnail_scores_.end() ||
+      ShouldReplaceThumbnailWith(encoding->second, score_with_redirects);
+}
+
+void TopSitesImpl::QueueThumbnail(const PendingThumbnail& thumbnail) {
+  RemovePendingThumbnail(thumbnail.key);
+
+  pending_thumbnail_bytes_ += thumbnail.bitmap.getSize();
+  pending_thumbnail_map_[thumbnail.key] =
+      pending_thumbnails_.insert(pending_thumbnails_.end(), thumbnail);
+
+  while (pending_thumbnail_bytes_ > kMaxPendingThumbnailBytes &&
+         pending_thumbnails_.size() > 1) {
+    RemovePendingThumbnail(pending_thumbnails_.front().key);
+  }
+}
+
+void TopSitesImpl::RemovePendingThumbnail(const GURL& key) {
+  PendingThumbnailMap::iterator pending = pending_thumbnail_map_.find(key);
+  if (pending == pending_thumbnail_map_.end())
+    return;
+
+  pending_thumbnail_bytes_ -= pending->second->bitmap.getSize();
+  pending_thumbnails_.erase(pending->second);
+  pending_thumbnail_map_.erase(pending);
+}
+
+void TopSitesImpl::StartEncodingThumbnails() {
+  if (encoding_thumbnails_ || pending_thumbnails_.empty())
+    return;
+
+  std::vector<PendingThumbnail> batch;
+  while (!pending_thumbnails_.empty() &&
+         batch.size() < kMaxThumbnailsPerBatch) {
+    batch.push_back(pending_thumbnails_.front());
+    encoding_thumbnail_scores_[batch.back().key] =
+        batch.back().score_with_redirects;
+    RemovePendingThumbnail(batch.back().key);
+  }
+
+  encoding_thumbnails_ = true;
+  EncodedThumbnails* results = new EncodedThumbnails;
+  thumbnail_encode_tracker_.PostTaskAndReply(
+      BrowserThread::GetBlockingPool()->GetTaskRunnerWithShutdownBehavior(
+          base::SequencedWorkerPool::SKIP_ON_SHUTDOWN).get(),
+      FROM_HERE,
+      base::Bind(&TopSitesImpl::EncodeThumbnails, batch, results),
+      base::Bind(&TopSitesImpl::OnThumbnailsEncoded, base::Unretained(this),
+                 base::Owned(results)));
+}
+
+void TopSitesImpl::OnThumbnailsEncoded(const EncodedThumbnails* thumbnails) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
+  encoding_thumbnails_ = false;
+  encoding_thumbnail_scores_.clear();
+
+  // The top sites may have changed while the batch was encoded, so each
+  // thumbnail is applied as if it had only just been handed over.
+  TopSitesBackend::PageThumbnails updates;
+  for (size_t i = 0; i < thumbnails->size(); ++i) {
+    const EncodedThumbnail& thumbnail = (*thumbnails)[i];
+    if (!thumbnail.data.get())
+      continue;
+
+    if (cache_->IsKnownURL(thumbnail.url)) {
+      if (!SetPageThumbnailNoDB(thumbnail.url, thumbnail.data.get(),
+                                thumbnail.score))
+        continue;
+      size_t index = cache_->GetURLIndex(thumbnail.url);
+      TopSitesBackend::PageThumbnail update;
+      update.url = cache_->top_sites()[index];
+      update.url_rank = index;
+      update.thumbnail = *(cache_->GetImage(update.url.url));
+      updates.push_back(update);
+    } else if (!IsFull()) {
+      // Always remove the existing entry and then add it back. That way if we
+      // end up with too many temp thumbnails we'll prune the oldest first.
+      RemoveTemporaryThumbnailByURL(thumbnail.url);
+      AddTemporaryThumbnail(thumbnail.url, thumbnail.data.get(),
+                            thumbnail.score);
+    }
+  }
+  if (!updates.empty())
+    backend_->SetPageThumbnails(updates);
+
+  StartEncodingThumbnails();
+}
+
+void TopSitesImpl::CancelThumbnailEncoding() {
+  thumbnail_encode_tracker_.TryCancelAll();
+  encoding_thumbnails_ = false;
+  encoding_thumbnail_scores_.clear();
+  pending_thumbnails_.clear();
+  pending_thumbnail_map_.clear();
+  pending_thumbnail_bytes_ = 0;
+}
+
 void TopSitesImpl::RemoveTemporaryThumbnailByURL(const GURL& url) {
   for (TempImages::iterator i = temp_images_.begin(); i != temp_images_.end();
        ++i) {
@@ -602,6 +783,7 @@ void TopSitesImpl::Observe(int type,
   if (type == chrome::NOTIFICATION_HISTORY_URLS_DELETED) {
     content::Details<history::URLsDeletedDetails> deleted_details(details);
     if (deleted_details->all_history) {
+      CancelThumbnailEncoding();
       SetTopSites(MostVisitedURLList());
       backend_->ResetDatabase();
     } else {
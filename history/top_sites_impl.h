@@ -6,6 +6,7 @@
 #define CHROME_BROWSER_HISTORY_TOP_SITES_IMPL_H_
 
 #include <list>
+#include <map>
 #include <set>
 #include <string>
 #include <utility>
@@ -26,6 +27,7 @@
 #include "chrome/browser/history/top_sites_backend.h"
 #include "chrome/common/cancelable_task_tracker.h"
 #include "chrome/common/thumbnail_score.h"
+#include "third_party/skia/include/core/SkBitmap.h"
 #include "third_party/skia/include/core/SkColor.h"
 #include "ui/gfx/image/image.h"
 #include "url/gurl.h"
@@ -47,6 +49,10 @@ class TopSitesImplTest;
 // thread. All other methods must be invoked on the UI thread. All mutations
 // to internal state happen on the UI thread and are scheduled to update the
 // db using TopSitesBackend.
+//
+// Thumbnails handed to SetPageThumbnail() are JPEG encoded on the blocking
+// pool, a batch at a time. Until then they wait in a bounded queue, where a
+// newer capture of a page replaces the one already waiting.
 class TopSitesImpl : public TopSites {
  public:
   explicit TopSitesImpl(Profile* profile);
@@ -96,6 +102,36 @@ class TopSitesImpl : public TopSites {
   typedef std::pair<GURL, Images> TempImage;
   typedef std::list<TempImage> TempImages;
 
+  // A thumbnail handed to SetPageThumbnail(), waiting to be encoded.
+  struct PendingThumbnail {
+    PendingThumbnail();
+    ~PendingThumbnail();
+
+    GURL url;
+    // The key of the thumbnail in |pending_thumbnail_map_|: the canonical URL
+    // if |url| is known, else |url| itself.
+    GURL key;
+    SkBitmap bitmap;
+    ThumbnailScore score;
+    // |score| with the redirect hops filled in, which later captures of the
+    // same page are compared against.
+    ThumbnailScore score_with_redirects;
+  };
+  typedef std::list<PendingThumbnail> PendingThumbnails;
+  typedef std::map<GURL, PendingThumbnails::iterator> PendingThumbnailMap;
+
+  // The result of encoding a PendingThumbnail.
+  struct EncodedThumbnail {
+    EncodedThumbnail();
+    ~EncodedThumbnail();
+
+    GURL url;
+    // NULL if the bitmap could not be encoded.
+    scoped_refptr<base::RefCountedBytes> data;
+    ThumbnailScore score;
+  };
+  typedef std::vector<EncodedThumbnail> EncodedThumbnails;
+
   // Generates the diff of things that happened between "old" and "new."
   //
   // The URLs that are in "new" but not "old" will be have their index into
@@ -122,10 +158,39 @@ class TopSitesImpl : public TopSites {
                                const ThumbnailScore& score);
 
   // Encodes the bitmap to bytes for storage to the db. Returns true if the
-  // bitmap was successfully encoded.
-  static bool EncodeBitmap(const gfx::Image& bitmap,
+  // bitmap was successfully encoded. May be invoked on any thread.
+  static bool EncodeBitmap(const SkBitmap& bitmap,
                            scoped_refptr<base::RefCountedBytes>* bytes);
 
+  // Encodes the thumbnails of |batch| into |results|. Runs on the blocking
+  // pool.
+  static void EncodeThumbnails(const std::vector<PendingThumbnail>& batch,
+                               EncodedThumbnails* results);
+
+  // Returns true if a thumbnail of |key| with |score_with_redirects| would
+  // replace the one waiting for, or being, encoded. Also true if there is
+  // none.
+  bool IsBetterThanQueuedThumbnail(const GURL& key,
+                                   const ThumbnailScore& score_with_redirects);
+
+  // Queues |thumbnail| for encoding, replacing any thumbnail of the same page
+  // still waiting, and dropping the oldest ones if the queue grows too large.
+  void QueueThumbnail(const PendingThumbnail& thumbnail);
+
+  // Removes the thumbnail of |key| waiting to be encoded, if any.
+  void RemovePendingThumbnail(const GURL& key);
+
+  // Sends the next batch of queued thumbnails to be encoded, unless a batch
+  // is already being encoded.
+  void StartEncodingThumbnails();
+
+  // Applies the encoded |thumbnails| of a batch, and writes those of the top
+  // sites to the db in one go.
+  void OnThumbnailsEncoded(const EncodedThumbnails* thumbnails);
+
+  // Drops the queued thumbnails, and ignores the batch being encoded.
+  void CancelThumbnailEncoding();
+
   // Removes the cached thumbnail for url. Does nothing if |url| if not cached
   // in |temp_images_|.
   void RemoveTemporaryThumbnailByURL(const GURL& url);
@@ -237,6 +302,18 @@ class TopSitesImpl : public TopSites {
   // SetTopSites call.
   TempImages temp_images_;
 
+  // Thumbnails waiting to be encoded, oldest first, and indexed by their
+  // keys. |pending_thumbnail_bytes_| is the size of their bitmaps.
+  PendingThumbnails pending_thumbnails_;
+  PendingThumbnailMap pending_thumbnail_map_;
+  size_t pending_thumbnail_bytes_;
+
+  // True while a batch of thumbnails is being encoded, the scores of which
+  // are kept by key so that worse captures can be turned down meanwhile.
+  bool encoding_thumbnails_;
+  std::map<GURL, ThumbnailScore> encoding_thumbnail_scores_;
+  CancelableTaskTracker thumbnail_encode_tracker_;
+
   // URL List of prepopulated page.
   std::vector<GURL> prepopulated_page_urls_;
 
@@ -6,7 +6,9 @@
 #include "base/memory/weak_ptr.h"
 #include "base/message_loop/message_loop.h"
 #include "base/path_service.h"
+#include "base/run_loop.h"
 #include "base/strings/utf_string_conversions.h"
+#include "base/threading/sequenced_worker_pool.h"
 #include "chrome/browser/history/history_db_task.h"
 #include "chrome/browser/history/history_service_factory.h"
 #include "chrome/browser/history/history_types.h"
@@ -186,6 +188,20 @@ class TopSitesImplTest : public HistoryUnitTestBase {
     base::MessageLoop::current()->Run();
   }
 
+  // Waits for top sites to encode the thumbnails passed to SetPageThumbnail,
+  // and to apply them.
+  void WaitForThumbnailEncodes() {
+    while (top_sites()->encoding_thumbnails_ ||
+           !top_sites()->pending_thumbnails_.empty()) {
+      BrowserThread::GetBlockingPool()->FlushForTesting();
+      base::RunLoop().RunUntilIdle();
+    }
+  }
+
+  size_t pending_thumbnail_count() {
+    return top_sites()->pending_thumbnails_.size();
+  }
+
   TopSitesImpl* top_sites() {
     return static_cast<TopSitesImpl*>(profile_->GetTopSites());
   }
@@ -265,7 +281,7 @@ class TopSitesImplTest : public HistoryUnitTestBase {
   bool ThumbnailEqualsBytes(const gfx::Image& image,
                             base::RefCountedMemory* bytes) {
     scoped_refptr<base::RefCountedBytes> encoded_image;
-    TopSitesImpl::EncodeBitmap(image, &encoded_image);
+    TopSitesImpl::EncodeBitmap(*image.ToSkBitmap(), &encoded_image);
     return ThumbnailsAreEqual(encoded_image.get(), bytes);
   }
 
@@ -456,6 +472,52 @@ TEST_F(TopSitesImplTest, SetPageThumbnail) {
   EXPECT_FALSE(top_sites()->SetPageThumbnail(url1a, thumbnail, medium_score));
 }
 
+// Makes sure repeated captures of a page waiting to be encoded are coalesced.
+TEST_F(TopSitesImplTest, CoalesceThumbnailEncodes) {
+  GURL url("http://google.com/");
+
+  MostVisitedURLList list;
+  AppendMostVisitedURL(&list, url);
+  SetTopSites(list);
+
+  gfx::Image red_thumbnail(CreateBitmap(SK_ColorRED));
+  gfx::Image green_thumbnail(CreateBitmap(SK_ColorGREEN));
+  gfx::Image blue_thumbnail(CreateBitmap(SK_ColorBLUE));
+
+  base::Time now = base::Time::Now();
+  ThumbnailScore worst_score(1.0, true, true, now);
+  ThumbnailScore low_score(0.75, true, true, now);
+  ThumbnailScore medium_score(0.5, true, true, now);
+  ThumbnailScore high_score(0.25, true, true, now);
+  ThumbnailScore best_score(0.0, true, true, now);
+
+  // The first capture is sent to be encoded right away, and later ones wait
+  // unless they are worse.
+  EXPECT_TRUE(top_sites()->SetPageThumbnail(url, red_thumbnail, low_score));
+  EXPECT_EQ(0u, pending_thumbnail_count());
+  EXPECT_FALSE(top_sites()->SetPageThumbnail(url, green_thumbnail,
+                                             worst_score));
+  EXPECT_TRUE(top_sites()->SetPageThumbnail(url, green_thumbnail,
+                                            medium_score));
+  EXPECT_EQ(1u, pending_thumbnail_count());
+
+  // A better capture replaces the waiting one, a worse one is turned down.
+  EXPECT_TRUE(top_sites()->SetPageThumbnail(url, blue_thumbnail, best_score));
+  EXPECT_EQ(1u, pending_thumbnail_count());
+  EXPECT_FALSE(top_sites()->SetPageThumbnail(url, green_thumbnail,
+                                             high_score));
+
+  WaitForThumbnailEncodes();
+  scoped_refptr<base::RefCountedMemory> result;
+  EXPECT_TRUE(top_sites()->GetPageThumbnail(url, false, &result));
+  EXPECT_TRUE(ThumbnailEqualsBytes(blue_thumbnail, result.get()));
+
+  // The best capture made it to the db.
+  RecreateTopSitesAndBlock();
+  EXPECT_TRUE(top_sites()->GetPageThumbnail(url, false, &result));
+  EXPECT_TRUE(ThumbnailEqualsBytes(blue_thumbnail, result.get()));
+}
+
 // Makes sure a thumbnail is correctly removed when the page is removed.
 TEST_F(TopSitesImplTest, ThumbnailRemoved) {
   GURL url("http://google.com/");
@@ -475,6 +537,7 @@ TEST_F(TopSitesImplTest, ThumbnailRemoved) {
 
   // Set the thumbnail.
   EXPECT_TRUE(top_sites()->SetPageThumbnail(url, thumbnail, medium_score));
+  WaitForThumbnailEncodes();
 
   // Make sure the thumbnail was actually set.
   scoped_refptr<base::RefCountedMemory> result;
@@ -509,10 +572,12 @@ TEST_F(TopSitesImplTest, GetPageThumbnail) {
 
   scoped_refptr<base::RefCountedMemory> result;
   EXPECT_TRUE(top_sites()->SetPageThumbnail(url1.url, thumbnail, score));
+  WaitForThumbnailEncodes();
   EXPECT_TRUE(top_sites()->GetPageThumbnail(url1.url, false, &result));
 
   EXPECT_TRUE(top_sites()->SetPageThumbnail(GURL("http://gmail.com"),
                                            thumbnail, score));
+  WaitForThumbnailEncodes();
   EXPECT_TRUE(top_sites()->GetPageThumbnail(GURL("http://gmail.com"),
                                             false,
                                             &result));
@@ -523,6 +588,7 @@ TEST_F(TopSitesImplTest, GetPageThumbnail) {
 
   EXPECT_TRUE(top_sites()->SetPageThumbnail(GURL("http://mail.google.com"),
                                            thumbnail, score));
+  WaitForThumbnailEncodes();
   EXPECT_TRUE(top_sites()->GetPageThumbnail(url2.url, false, &result));
 
   EXPECT_TRUE(ThumbnailEqualsBytes(thumbnail, result.get()));
@@ -572,6 +638,7 @@ TEST_F(TopSitesImplTest, SaveToDB) {
   gfx::Image tmp_bitmap(CreateBitmap(SK_ColorBLUE));
   ASSERT_TRUE(top_sites()->SetPageThumbnail(asdf_url, tmp_bitmap,
                                             ThumbnailScore()));
+  WaitForThumbnailEncodes();
 
   RecreateTopSitesAndBlock();
 
@@ -599,6 +666,7 @@ TEST_F(TopSitesImplTest, SaveToDB) {
   ASSERT_TRUE(top_sites()->SetPageThumbnail(google_url,
                                             tmp_bitmap,
                                             ThumbnailScore()));
+  WaitForThumbnailEncodes();
 
   // Make TopSites reread from the db.
   RefreshTopSitesAndRecreate();
@@ -633,6 +701,7 @@ TEST_F(TopSitesImplTest, RealDatabase) {
   gfx::Image asdf_thumbnail(CreateBitmap(SK_ColorRED));
   ASSERT_TRUE(top_sites()->SetPageThumbnail(
                   asdf_url, asdf_thumbnail, ThumbnailScore()));
+  WaitForThumbnailEncodes();
 
   base::Time add_time(base::Time::Now());
   AddPageToHistory(url.url, url.title, url.redirects, add_time);
@@ -669,6 +738,7 @@ TEST_F(TopSitesImplTest, RealDatabase) {
   gfx::Image google_thumbnail(CreateBitmap(SK_ColorBLUE));
   ASSERT_TRUE(top_sites()->SetPageThumbnail(
                   url2.url, google_thumbnail, ThumbnailScore()));
+  WaitForThumbnailEncodes();
 
   RefreshTopSitesAndRecreate();
 
@@ -700,6 +770,7 @@ TEST_F(TopSitesImplTest, RealDatabase) {
   EXPECT_TRUE(top_sites()->SetPageThumbnail(google3_url,
                                             weewar_bitmap,
                                             medium_score));
+  WaitForThumbnailEncodes();
   RefreshTopSitesAndRecreate();
   {
     scoped_refptr<base::RefCountedMemory> read_data;
@@ -718,6 +789,7 @@ TEST_F(TopSitesImplTest, RealDatabase) {
   EXPECT_TRUE(top_sites()->SetPageThumbnail(google1_url,
                                             green_bitmap,
                                             high_score));
+  WaitForThumbnailEncodes();
 
   // Check that the thumbnail was updated.
   RefreshTopSitesAndRecreate();
@@ -963,6 +1035,7 @@ TEST_F(TopSitesImplTest, AddTemporaryThumbnail) {
   EXPECT_TRUE(top_sites()->SetPageThumbnail(unknown_url,
                                             thumbnail,
                                             medium_score));
+  WaitForThumbnailEncodes();
 
   // We shouldn't get the thumnail back though (the url isn't in to sites yet).
   scoped_refptr<base::RefCountedMemory> out;
@@ -0,0 +1,350 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/history/url_prefix_index.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "base/logging.h"
+#include "base/strings/utf_string_conversions.h"
+#include "chrome/browser/autocomplete/url_prefix.h"
+#include "chrome/browser/history/url_database.h"
+
+namespace history {
+
+namespace {
+
+// The prefixes of URLPrefix::GetURLPrefixes(), as urls are stored.
+const std::vector<std::string>& GetPrefixes() {
+  CR_DEFINE_STATIC_LOCAL(std::vector<std::string>, prefixes, ());
+  if (prefixes.empty()) {
+    const URLPrefixes& url_prefixes = URLPrefix::GetURLPrefixes();
+    for (URLPrefixes::const_iterator i = url_prefixes.begin();
+         i != url_prefixes.end(); ++i)
+      prefixes.push_back(UTF16ToUTF8(i->prefix));
+  }
+  return prefixes;
+}
+
+bool StartsWith(const std::string& text, const std::string& prefix) {
+  return text.compare(0, prefix.size(), prefix) == 0;
+}
+
+// Returns true if |a| comes before |b| in the order that
+// URLDatabase::AutocompleteForPrefix() returns rows in.
+bool IsBetter(const URLRow& a, const URLRow& b) {
+  if (a.typed_count() != b.typed_count())
+    return a.typed_count() > b.typed_count();
+  if (a.visit_count() != b.visit_count())
+    return a.visit_count() > b.visit_count();
+  return a.last_visit() > b.last_visit();
+}
+
+// A range of entries, and the position of the best-scoring entry in it.
+struct Span {
+  size_t begin;
+  size_t end;
+  size_t best;
+};
+
+}  // namespace
+
+URLPrefixMatch::URLPrefixMatch()
+    : prefix_index(0),
+      best_prefix_components(0) {
+}
+
+URLPrefixMatch::URLPrefixMatch(const URLRow& row,
+                               size_t prefix_index,
+                               size_t best_prefix_components)
+    : row(row),
+      prefix_index(prefix_index),
+      best_prefix_components(best_prefix_components) {
+}
+
+URLPrefixMatch::~URLPrefixMatch() {
+}
+
+URLPrefixIndex::Tree::Tree()
+    : valid(false) {
+}
+
+URLPrefixIndex::Tree::~Tree() {
+}
+
+// Orders entries by prefix, then by the rest of the url. Also compares them
+// with a prefix and text to find the range of entries that start with both.
+class URLPrefixIndex::EntryLess {
+ public:
+  bool operator()(const Entry& a, const Entry& b) const {
+    if (a.prefix_index != b.prefix_index)
+      return a.prefix_index < b.prefix_index;
+    return a.row->first.compare(a.prefix_length, std::string::npos,
+                                b.row->first, b.prefix_length,
+                                std::string::npos) < 0;
+  }
+
+  bool operator()(const Entry& a,
+                  const std::pair<size_t, std::string>& b) const {
+    if (a.prefix_index != b.first)
+      return a.prefix_index < b.first;
+    return a.row->first.compare(a.prefix_length, std::string::npos,
+                                b.second) < 0;
+  }
+};
+
+// Orders spans with the best-scoring one last, for a max-heap.
+class URLPrefixIndex::SpanLess {
+ public:
+  explicit SpanLess(const Entries& entries) : entries_(&entries) {}
+
+  bool operator()(const Span& a, const Span& b) const {
+    return IsBetter((*entries_)[b.best].row->second.row,
+                    (*entries_)[a.best].row->second.row);
+  }
+
+ private:
+  const Entries* entries_;
+};
+
+URLPrefixIndex::URLPrefixIndex()
+    : trees_(GetPrefixes().size()) {
+}
+
+URLPrefixIndex::~URLPrefixIndex() {
+}
+
+void URLPrefixIndex::Add(const URLRow& row) {
+  if (!row.url().is_valid() || row.typed_count() <= 0 || row.hidden()) {
+    Remove(row.url());
+    return;
+  }
+
+  std::string url = URLDatabase::GURLToDatabaseURL(row.url());
+  RowMap::iterator existing = rows_.find(url);
+  if (existing != rows_.end()) {
+    // The url is listed already; only its scores change.
+    existing->second.row = row;
+    UpdateScores(*existing);
+    return;
+  }
+
+  size_t sorted_size = entries_.size();
+  AppendRow(url, row);
+  std::sort(entries_.begin() + sorted_size, entries_.end(), EntryLess());
+  std::inplace_merge(entries_.begin(), entries_.begin() + sorted_size,
+                     entries_.end(), EntryLess());
+  InvalidateTrees(url);
+}
+
+void URLPrefixIndex::AddAll(const URLRows& rows) {
+  // Remove first, while the entries are still sorted.
+  for (URLRows::const_iterator i = rows.begin(); i != rows.end(); ++i) {
+    if (!i->url().is_valid() || i->typed_count() <= 0 || i->hidden())
+      Remove(i->url());
+  }
+
+  size_t sorted_size = entries_.size();
+  for (URLRows::const_iterator i = rows.begin(); i != rows.end(); ++i) {
+    if (!i->url().is_valid() || i->typed_count() <= 0 || i->hidden())
+      continue;
+    std::string url = URLDatabase::GURLToDatabaseURL(i->url());
+    RowMap::iterator existing = rows_.find(url);
+    if (existing != rows_.end())
+      existing->second.row = *i;
+    else
+      AppendRow(url, *i);
+  }
+  std::sort(entries_.begin() + sorted_size, entries_.end(), EntryLess());
+  std::inplace_merge(entries_.begin(), entries_.begin() + sorted_size,
+                     entries_.end(), EntryLess());
+
+  for (size_t i = 0; i < trees_.size(); ++i)
+    trees_[i].valid = false;
+}
+
+void URLPrefixIndex::Remove(const GURL& url) {
+  RowMap::iterator row = rows_.find(URLDatabase::GURLToDatabaseURL(url));
+  if (row == rows_.end())
+    return;
+  InvalidateTrees(row->first);
+
+  const std::vector<std::string>& prefixes = GetPrefixes();
+  for (size_t i = 0; i < prefixes.size(); ++i) {
+    if (StartsWith(row->first, prefixes[i]))
+      entries_.erase(entries_.begin() + FindEntry(i, *row));
+  }
+  rows_.erase(row);
+}
+
+void URLPrefixIndex::Clear() {
+  rows_.clear();
+  entries_.clear();
+  for (size_t i = 0; i < trees_.size(); ++i) {
+    trees_[i].valid = false;
+    trees_[i].best.clear();
+  }
+}
+
+void URLPrefixIndex::Find(const std::string& text,
+                          size_t max_results_per_prefix,
+                          URLPrefixMatches* matches) const {
+  // Like the database query, find the urls between prefix + |text| and
+  // prefix + |text| followed by the largest byte.
+  std::string end_text(text);
+  end_text.push_back(std::numeric_limits<unsigned char>::max());
+
+  SpanLess span_less(entries_);
+  std::vector<Span> spans;
+  const std::vector<std::string>& prefixes = GetPrefixes();
+  for (size_t i = 0; i < prefixes.size(); ++i) {
+    Span span;
+    span.begin = std::lower_bound(entries_.begin(), entries_.end(),
+                                  std::make_pair(i, text), EntryLess()) -
+        entries_.begin();
+    span.end = std::lower_bound(entries_.begin() + span.begin, entries_.end(),
+                                std::make_pair(i, end_text), EntryLess()) -
+        entries_.begin();
+    if (span.begin == span.end)
+      continue;
+
+    size_t block_begin = BlockBegin(i);
+    UpdateTree(i, block_begin);
+
+    // Take the best entry of the range, then look for the next best on
+    // either side of it, and so on.
+    span.best = BestInRange(i, block_begin, span.begin, span.end);
+    spans.clear();
+    spans.push_back(span);
+    for (size_t found = 0;
+         found < max_results_per_prefix && !spans.empty(); ++found) {
+      std::pop_heap(spans.begin(), spans.end(), span_less);
+      Span best = spans.back();
+      spans.pop_back();
+      const IndexedRow& row = entries_[best.best].row->second;
+      matches->push_back(
+          URLPrefixMatch(row.row, i, row.best_prefix_components));
+
+      Span left = { best.begin, best.best, 0 };
+      Span right = { best.best + 1, best.end, 0 };
+      if (left.begin < left.end) {
+        left.best = BestInRange(i, block_begin, left.begin, left.end);
+        spans.push_back(left);
+        std::push_heap(spans.begin(), spans.end(), span_less);
+      }
+      if (right.begin < right.end) {
+        right.best = BestInRange(i, block_begin, right.begin, right.end);
+        spans.push_back(right);
+        std::push_heap(spans.begin(), spans.end(), span_less);
+      }
+    }
+  }
+}
+
+void URLPrefixIndex::AppendRow(const std::string& url, const URLRow& row) {
+  RowMap::iterator inserted =
+      rows_.insert(std::make_pair(url, IndexedRow())).first;
+  inserted->second.row = row;
+  const URLPrefix* best_prefix = URLPrefix::BestURLPrefix(
+      UTF8ToUTF16(row.url().spec()), string16());
+  DCHECK(best_prefix);
+  inserted->second.best_prefix_components = best_prefix->num_components;
+
+  const std::vector<std::string>& prefixes = GetPrefixes();
+  for (size_t i = 0; i < prefixes.size(); ++i) {
+    if (!StartsWith(url, prefixes[i]))
+      continue;
+    Entry entry;
+    entry.prefix_index = i;
+    entry.prefix_length = prefixes[i].size();
+    entry.row = &*inserted;
+    entries_.push_back(entry);
+  }
+}
+
+size_t URLPrefixIndex::FindEntry(size_t prefix_index,
+                                 const RowMap::value_type& row) const {
+  Entry entry;
+  entry.prefix_index = prefix_index;
+  entry.prefix_length = GetPrefixes()[prefix_index].size();
+  entry.row = &row;
+  Entries::const_iterator found = std::lower_bound(entries_.begin(),
+                                                   entries_.end(), entry,
+                                                   EntryLess());
+  DCHECK(found != entries_.end() && found->row == entry.row);
+  return found - entries_.begin();
+}
+
+size_t URLPrefixIndex::BlockBegin(size_t prefix_index) const {
+  return std::lower_bound(entries_.begin(), entries_.end(),
+                          std::make_pair(prefix_index, std::string()),
+                          EntryLess()) - entries_.begin();
+}
+
+size_t URLPrefixIndex::Better(size_t block_begin, size_t a, size_t b) const {
+  return IsBetter(entries_[block_begin + b].row->second.row,
+                  entries_[block_begin + a].row->second.row) ? b : a;
+}
+
+size_t URLPrefixIndex::BestInRange(size_t prefix_index,
+                                   size_t block_begin,
+                                   size_t begin,
+                                   size_t end) const {
+  DCHECK_LT(begin, end);
+  const Tree& tree = trees_[prefix_index];
+  DCHECK(tree.valid);
+  size_t size = tree.best.size() / 2;
+  size_t best = begin - block_begin;
+  for (size_t left = best + size, right = end - block_begin + size;
+       left < right; left /= 2, right /= 2) {
+    if (left & 1)
+      best = Better(block_begin, best, tree.best[left++]);
+    if (right & 1)
+      best = Better(block_begin, best, tree.best[--right]);
+  }
+  return block_begin + best;
+}
+
+void URLPrefixIndex::UpdateTree(size_t prefix_index,
+                                size_t block_begin) const {
+  Tree& tree = trees_[prefix_index];
+  if (tree.valid)
+    return;
+  tree.valid = true;
+
+  size_t size = BlockBegin(prefix_index + 1) - block_begin;
+  tree.best.assign(2 * size, 0);
+  for (size_t j = 0; j < size; ++j)
+    tree.best[size + j] = j;
+  for (size_t k = size - 1; k > 0; --k)
+    tree.best[k] = Better(block_begin, tree.best[2 * k], tree.best[2 * k + 1]);
+}
+
+void URLPrefixIndex::UpdateScores(const RowMap::value_type& row) {
+  const std::vector<std::string>& prefixes = GetPrefixes();
+  for (size_t i = 0; i < prefixes.size(); ++i) {
+    Tree& tree = trees_[i];
+    if (!tree.valid || !StartsWith(row.first, prefixes[i]))
+      continue;
+    size_t block_begin = BlockBegin(i);
+    size_t size = tree.best.size() / 2;
+    for (size_t k = (FindEntry(i, row) - block_begin + size) / 2; k > 0;
+         k /= 2) {
+      tree.best[k] =
+          Better(block_begin, tree.best[2 * k], tree.best[2 * k + 1]);
+    }
+  }
+}
+
+void URLPrefixIndex::InvalidateTrees(const std::string& url) {
+  const std::vector<std::string>& prefixes = GetPrefixes();
+  for (size_t i = 0; i < prefixes.size(); ++i) {
+    if (StartsWith(url, prefixes[i]))
+      trees_[i].valid = false;
+  }
+}
+
+}  // namespace history
@@ -0,0 +1,149 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_HISTORY_URL_PREFIX_INDEX_H_
+#define CHROME_BROWSER_HISTORY_URL_PREFIX_INDEX_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "chrome/browser/history/history_types.h"
+
+class GURL;
+
+namespace history {
+
+// A match found by URLPrefixIndex::Find().
+struct URLPrefixMatch {
+  URLPrefixMatch();
+  URLPrefixMatch(const URLRow& row, size_t prefix_index,
+                 size_t best_prefix_components);
+  ~URLPrefixMatch();
+
+  URLRow row;
+  // The index in URLPrefix::GetURLPrefixes() of the prefix the input was
+  // matched after.
+  size_t prefix_index;
+  // The number of components of URLPrefix::BestURLPrefix() of the url.
+  size_t best_prefix_components;
+};
+typedef std::vector<URLPrefixMatch> URLPrefixMatches;
+
+// Answers the queries that inline autocomplete makes of the in-memory URL
+// database, one URLDatabase::AutocompleteForPrefix() call per URLPrefix, from
+// memory in a single lookup.
+//
+// Each typed, visible url is listed once after every URLPrefix that it starts
+// with, keyed by the prefix and the rest of the url. The list is sorted, so
+// the urls that start with a given prefix and text are a range of it. A
+// segment tree over the urls listed after each prefix gives the best-scoring
+// url of any range in logarithmic time, from which the best few of a range are
+// found without looking at the rest. A change of scores updates the trees in
+// place; a url added or removed invalidates the trees of its prefixes only,
+// which are rebuilt on the next lookup that needs them.
+//
+// Kept in sync with the InMemoryDatabase by the InMemoryHistoryBackend. Only
+// accessed on the thread which owns the in-memory database.
+class URLPrefixIndex {
+ public:
+  URLPrefixIndex();
+  ~URLPrefixIndex();
+
+  // Adds |row| or updates its scores. Rows which AutocompleteForPrefix()
+  // would not return for typed urls only are removed instead.
+  void Add(const URLRow& row);
+  // Like calling Add() for each of |rows|, which are for distinct urls, but
+  // sorts the index once rather than once per row.
+  void AddAll(const URLRows& rows);
+  void Remove(const GURL& url);
+  void Clear();
+
+  // Like calling URLDatabase::AutocompleteForPrefix(prefix + |text|,
+  // |max_results_per_prefix|, true, ...) for each URLPrefix in turn. The
+  // matches are appended to |matches| in the order of the prefixes, and best
+  // first for each prefix.
+  void Find(const std::string& text,
+            size_t max_results_per_prefix,
+            URLPrefixMatches* matches) const;
+
+  size_t size() const { return rows_.size(); }
+
+ private:
+  struct IndexedRow {
+    URLRow row;
+    size_t best_prefix_components;
+  };
+  typedef std::map<std::string, IndexedRow> RowMap;
+
+  // A url listed after one of the prefixes it starts with.
+  struct Entry {
+    size_t prefix_index;
+    // The url is |row->first|; the prefix is its first |prefix_length| bytes.
+    size_t prefix_length;
+    const RowMap::value_type* row;
+  };
+  typedef std::vector<Entry> Entries;
+
+  // A segment tree over the entries listed after one prefix, which start at
+  // the block's position in |entries_|. Positions in it are relative to the
+  // start of the block, so that changes to other blocks leave it valid. For a
+  // block of n entries, |best[n + j]| is j, and |best[k]| is the best-scoring
+  // of |best[2k]| and |best[2k + 1]|.
+  struct Tree {
+    Tree();
+    ~Tree();
+
+    bool valid;
+    std::vector<size_t> best;
+  };
+
+  class EntryLess;
+  class SpanLess;
+
+  // Adds |row| to |rows_| and appends its entries to |entries_|, unsorted.
+  void AppendRow(const std::string& url, const URLRow& row);
+
+  // Returns the position in |entries_| of the entry of |row| listed after
+  // prefix |prefix_index|, which must be one that its url starts with.
+  size_t FindEntry(size_t prefix_index, const RowMap::value_type& row) const;
+
+  // Returns the position of the first entry listed after prefix
+  // |prefix_index|.
+  size_t BlockBegin(size_t prefix_index) const;
+
+  // Returns whichever of the entries at |block_begin| + |a| and
+  // |block_begin| + |b| scores better, as a position relative to
+  // |block_begin|.
+  size_t Better(size_t block_begin, size_t a, size_t b) const;
+
+  // Returns the position of the best-scoring entry in [begin, end), which
+  // lies in the block of prefix |prefix_index| starting at |block_begin|.
+  size_t BestInRange(size_t prefix_index,
+                     size_t block_begin,
+                     size_t begin,
+                     size_t end) const;
+
+  // Rebuilds the tree of prefix |prefix_index| if its entries have changed.
+  void UpdateTree(size_t prefix_index, size_t block_begin) const;
+
+  // Updates the valid trees of the entries of |row| after its scores change.
+  void UpdateScores(const RowMap::value_type& row);
+
+  // Marks the trees of the prefixes that |url| starts with as invalid.
+  void InvalidateTrees(const std::string& url);
+
+  RowMap rows_;
+  Entries entries_;
+
+  // One per URLPrefix.
+  mutable std::vector<Tree> trees_;
+
+  DISALLOW_COPY_AND_ASSIGN(URLPrefixIndex);
+};
+
+}  // namespace history
+
+#endif  // CHROME_BROWSER_HISTORY_URL_PREFIX_INDEX_H_
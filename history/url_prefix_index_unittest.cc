@@ -0,0 +1,151 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/history/url_prefix_index.h"
+
+#include <string>
+
+#include "base/strings/utf_string_conversions.h"
+#include "base/time/time.h"
+#include "chrome/browser/autocomplete/url_prefix.h"
+#include "chrome/browser/history/in_memory_database.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "url/gurl.h"
+
+namespace history {
+
+namespace {
+
+struct TestURL {
+  const char* url;
+  int visit_count;
+  int typed_count;
+};
+
+// Every row scores differently, so that the order of the results is defined.
+const TestURL kTestURLs[] = {
+  {"http://www.google.com/", 100, 30},
+  {"http://www.google.com/search?q=foo", 20, 2},
+  {"https://www.google.com/calendar", 50, 10},
+  {"http://google.org/", 5, 1},
+  {"http://goodnews.com/", 8, 1},
+  {"https://mail.google.com/", 90, 25},
+  {"ftp://ftp.gnu.org/", 3, 1},
+  {"http://www.example.com/", 40, 0},  // Not typed.
+  {"http://wwwhat.com/", 12, 3},
+};
+
+}  // namespace
+
+class URLPrefixIndexTest : public testing::Test {
+ protected:
+  virtual void SetUp() OVERRIDE {
+    ASSERT_TRUE(db_.InitFromScratch());
+    for (size_t i = 0; i < arraysize(kTestURLs); ++i) {
+      URLRow row(GURL(kTestURLs[i].url));
+      row.set_visit_count(kTestURLs[i].visit_count);
+      row.set_typed_count(kTestURLs[i].typed_count);
+      row.set_last_visit(base::Time::Now() - base::TimeDelta::FromDays(i));
+      row.set_id(db_.AddURL(row));
+      ASSERT_TRUE(row.id());
+      index_.Add(row);
+    }
+  }
+
+  // Expects the index to find what the database finds for |text|.
+  void ExpectSameAsDatabase(const std::string& text) {
+    URLPrefixMatches matches;
+    index_.Find(text, 3, &matches);
+    URLPrefixMatches::const_iterator match = matches.begin();
+
+    const URLPrefixes& prefixes = URLPrefix::GetURLPrefixes();
+    for (size_t i = 0; i < prefixes.size(); ++i) {
+      URLRows rows;
+      db_.AutocompleteForPrefix(UTF16ToUTF8(prefixes[i].prefix) + text, 3,
+                                true, &rows);
+      for (URLRows::const_iterator row = rows.begin(); row != rows.end();
+           ++row, ++match) {
+        ASSERT_TRUE(match != matches.end()) << text;
+        EXPECT_EQ(i, match->prefix_index) << text;
+        EXPECT_EQ(row->url(), match->row.url()) << text;
+        EXPECT_EQ(row->id(), match->row.id()) << text;
+        EXPECT_EQ(URLPrefix::BestURLPrefix(UTF8ToUTF16(row->url().spec()),
+                                           string16())->num_components,
+                  match->best_prefix_components) << text;
+      }
+    }
+    EXPECT_TRUE(match == matches.end()) << text;
+  }
+
+  InMemoryDatabase db_;
+  URLPrefixIndex index_;
+};
+
+TEST_F(URLPrefixIndexTest, Find) {
+  const char* kTexts[] = {
+    "", "g", "goo", "google.com", "www.g", "www", "http", "http://www.g",
+    "mail", "ftp.", "gnu", "wwwh", "example", "nothing",
+  };
+  for (size_t i = 0; i < arraysize(kTexts); ++i)
+    ExpectSameAsDatabase(kTexts[i]);
+}
+
+TEST_F(URLPrefixIndexTest, Update) {
+  // Scores change the order, of urls looked up already too.
+  ExpectSameAsDatabase("goo");
+  URLRow row;
+  ASSERT_TRUE(db_.GetRowForURL(GURL("http://google.org/"), &row));
+  row.set_typed_count(100);
+  ASSERT_TRUE(db_.UpdateURLRow(row.id(), row));
+  index_.Add(row);
+  ExpectSameAsDatabase("goo");
+
+  // No longer typed.
+  ASSERT_TRUE(db_.GetRowForURL(GURL("https://mail.google.com/"), &row));
+  row.set_typed_count(0);
+  ASSERT_TRUE(db_.UpdateURLRow(row.id(), row));
+  index_.Add(row);
+  ExpectSameAsDatabase("mail");
+
+  ASSERT_TRUE(db_.GetRowForURL(GURL("http://www.google.com/"), &row));
+  ASSERT_TRUE(db_.DeleteURLRow(row.id()));
+  index_.Remove(row.url());
+  ExpectSameAsDatabase("goo");
+  EXPECT_EQ(6u, index_.size());
+
+  index_.Clear();
+  URLPrefixMatches matches;
+  index_.Find("g", 3, &matches);
+  EXPECT_TRUE(matches.empty());
+}
+
+TEST_F(URLPrefixIndexTest, AddAll) {
+  URLRows rows;
+  URLDatabase::URLEnumerator urls;
+  ASSERT_TRUE(db_.InitURLEnumeratorForEverything(&urls));
+  URLRow row;
+  while (urls.GetNextURL(&row))
+    rows.push_back(row);
+
+  index_.Clear();
+  index_.AddAll(rows);
+  EXPECT_EQ(8u, index_.size());
+  ExpectSameAsDatabase("goo");
+  ExpectSameAsDatabase("www");
+
+  // Rows are added to a non-empty index, and updated, in bulk as well.
+  index_.Clear();
+  index_.AddAll(URLRows(rows.begin(), rows.begin() + 3));
+  ExpectSameAsDatabase("");
+  for (URLRows::iterator i = rows.begin(); i != rows.end(); ++i) {
+    i->set_typed_count(i->typed_count() ? 40 - i->typed_count() : 0);
+    ASSERT_TRUE(db_.UpdateURLRow(i->id(), *i));
+  }
+  index_.AddAll(rows);
+  EXPECT_EQ(8u, index_.size());
+  ExpectSameAsDatabase("goo");
+  ExpectSameAsDatabase("");
+}
+
+}  // namespace history
@@ -8,6 +8,7 @@
 #include <limits>
 #include <map>
 #include <set>
+#include <string>
 
 #include "base/logging.h"
 #include "base/strings/string_number_conversions.h"
@@ -19,6 +20,33 @@
 
 namespace history {
 
+namespace {
+
+const int64 kMicrosecondsPerHour = base::Time::kMicrosecondsPerHour;
+
+// The number of URLs whose visits GetMostRecentVisitsForURLs() reads with
+// each query.
+const int kURLsPerVisitsQuery = 100;
+
+// Returns whether |transition| is that of a visit made directly by the user,
+// as GetDirectVisitsDuringTimes() returns.
+bool IsDirectVisit(content::PageTransition transition) {
+  if (!(transition & content::PAGE_TRANSITION_CHAIN_START))
+    return false;
+  content::PageTransition core =
+      content::PageTransitionStripQualifier(transition);
+  return core == content::PAGE_TRANSITION_TYPED ||
+         core == content::PAGE_TRANSITION_AUTO_BOOKMARK;
+}
+
+// Returns the start of the hour |time| falls in, as an internal time value.
+int64 HourContaining(base::Time time) {
+  int64 value = time.ToInternalValue();
+  return value - value % kMicrosecondsPerHour;
+}
+
+}  // namespace
+
 VisitDatabase::VisitDatabase() {
 }
 
@@ -70,16 +98,94 @@ bool VisitDatabase::InitVisitTable() {
           "visits (visit_time)"))
     return false;
 
-  return true;
+  // The direct visit hours are derived from the visits, so they are created
+  // and dropped along with them.
+  return CreateDirectVisitHoursTable();
 }
 
 bool VisitDatabase::DropVisitTable() {
   // This will also drop the indices over the table.
   return
       GetDB().Execute("DROP TABLE IF EXISTS visit_source") &&
+      GetDB().Execute("DROP TABLE IF EXISTS direct_visit_hours") &&
       GetDB().Execute("DROP TABLE visits");
 }
 
+bool VisitDatabase::CreateDirectVisitHoursTable() {
+  // One row per URL and hour with direct visits. |offset_sum| is the sum of
+  // the visits' offsets from the start of the hour, from which their mean
+  // time is had.
+  return GetDB().Execute("CREATE TABLE IF NOT EXISTS direct_visit_hours("
+                         "url INTEGER NOT NULL,"
+                         "hour INTEGER NOT NULL,"
+                         "visit_count INTEGER NOT NULL,"
+                         "offset_sum INTEGER NOT NULL,"
+                         "PRIMARY KEY (hour, url))");
+}
+
+bool VisitDatabase::MigrateDirectVisitHours() {
+  if (!CreateDirectVisitHoursTable() ||
+      !GetDB().Execute("DELETE FROM direct_visit_hours"))
+    return false;
+
+  // Fill it from the visits already in the database.
+  sql::Statement statement(GetDB().GetUniqueStatement(
+      "INSERT INTO direct_visit_hours (url, hour, visit_count, offset_sum) "
+      "SELECT url, visit_time - visit_time % ?, COUNT(*), "
+      "SUM(visit_time % ?) FROM visits "
+      "WHERE (transition & ?) != 0 "  // CHAIN_START
+      "AND (transition & ?) IN (?, ?) "  // TYPED or AUTO_BOOKMARK only
+      "GROUP BY url, visit_time - visit_time % ?"));
+  statement.BindInt64(0, kMicrosecondsPerHour);
+  statement.BindInt64(1, kMicrosecondsPerHour);
+  statement.BindInt(2, content::PAGE_TRANSITION_CHAIN_START);
+  statement.BindInt(3, content::PAGE_TRANSITION_CORE_MASK);
+  statement.BindInt(4, content::PAGE_TRANSITION_TYPED);
+  statement.BindInt(5, content::PAGE_TRANSITION_AUTO_BOOKMARK);
+  statement.BindInt64(6, kMicrosecondsPerHour);
+  return statement.Run();
+}
+
+bool VisitDatabase::UpdateDirectVisitHours(const VisitRow& visit, int delta) {
+  if (!IsDirectVisit(visit.transition))
+    return true;
+
+  int64 hour = HourContaining(visit.visit_time);
+  int64 offset = visit.visit_time.ToInternalValue() - hour;
+  sql::Statement update(GetDB().GetCachedStatement(SQL_FROM_HERE,
+      "UPDATE direct_visit_hours SET visit_count = visit_count + ?, "
+      "offset_sum = offset_sum + ? WHERE hour = ? AND url = ?"));
+  update.BindInt(0, delta);
+  update.BindInt64(1, delta * offset);
+  update.BindInt64(2, hour);
+  update.BindInt64(3, visit.url_id);
+  if (!update.Run())
+    return false;
+
+  if (GetDB().GetLastChangeCount() == 0) {
+    // Removing a visit the hours do not know of leaves them as they are.
+    if (delta < 0)
+      return true;
+    sql::Statement insert(GetDB().GetCachedStatement(SQL_FROM_HERE,
+        "INSERT INTO direct_visit_hours (url, hour, visit_count, offset_sum) "
+        "VALUES (?,?,?,?)"));
+    insert.BindInt64(0, visit.url_id);
+    insert.BindInt64(1, hour);
+    insert.BindInt(2, delta);
+    insert.BindInt64(3, delta * offset);
+    return insert.Run();
+  }
+
+  if (delta > 0)
+    return true;
+  sql::Statement del(GetDB().GetCachedStatement(SQL_FROM_HERE,
+      "DELETE FROM direct_visit_hours "
+      "WHERE hour = ? AND url = ? AND visit_count <= 0"));
+  del.BindInt64(0, hour);
+  del.BindInt64(1, visit.url_id);
+  return del.Run();
+}
+
 // Must be in sync with HISTORY_VISIT_ROW_FIELDS.
 // static
 void VisitDatabase::FillVisitRow(sql::Statement& statement, VisitRow* visit) {
@@ -160,6 +266,7 @@ VisitID VisitDatabase::AddVisit(VisitRow* visit, VisitSource source) {
   }
 
   visit->visit_id = GetDB().GetLastInsertRowId();
+  UpdateDirectVisitHours(*visit, 1);
 
   if (source != SOURCE_BROWSED) {
     // Record the source of this visit when it is not browsed.
@@ -194,6 +301,8 @@ void VisitDatabase::DeleteVisit(const VisitRow& visit) {
   del.BindInt64(0, visit.visit_id);
   if (!del.Run())
     return;
+  if (GetDB().GetLastChangeCount())
+    UpdateDirectVisitHours(visit, -1);
 
   // Try to delete the entry in visit_source table as well.
   // If the visit was browsed, there is no corresponding entry in visit_source
@@ -204,6 +313,57 @@ void VisitDatabase::DeleteVisit(const VisitRow& visit) {
   del.Run();
 }
 
+void VisitDatabase::DeleteVisits(const VisitVector& visits) {
+  std::map<VisitID, VisitID> referrers;
+  for (size_t i = 0; i < visits.size(); ++i)
+    referrers[visits[i].visit_id] = visits[i].referring_visit;
+
+  // Patch around the visits, skipping over the referrers which are deleted as
+  // well. The number of hops is bounded in case the chain loops.
+  sql::Statement update_chain(GetDB().GetCachedStatement(SQL_FROM_HERE,
+      "UPDATE visits SET from_visit=? WHERE from_visit=?"));
+  for (size_t i = 0; i < visits.size(); ++i) {
+    VisitID referrer = visits[i].referring_visit;
+    for (size_t hops = 0; hops < visits.size(); ++hops) {
+      std::map<VisitID, VisitID>::const_iterator found =
+          referrers.find(referrer);
+      if (found == referrers.end())
+        break;
+      referrer = found->second;
+    }
+    update_chain.Reset(true);
+    update_chain.BindInt64(0, referrer);
+    update_chain.BindInt64(1, visits[i].visit_id);
+    if (!update_chain.Run())
+      return;
+  }
+
+  // Delete the visits and their sources in batches of ids.
+  const size_t batch_size = 500;
+  for (size_t start_index = 0; start_index < visits.size();
+       start_index += batch_size) {
+    size_t end_index = std::min(start_index + batch_size, visits.size());
+    std::string ids;
+    for (size_t j = start_index; j < end_index; j++) {
+      if (j != start_index)
+        ids.push_back(',');
+      ids.append(base::Int64ToString(visits[j].visit_id));
+    }
+
+    sql::Statement del(GetDB().GetUniqueStatement(
+        ("DELETE FROM visits WHERE id IN (" + ids + ")").c_str()));
+    if (!del.Run())
+      return;
+    for (size_t j = start_index; j < end_index; j++)
+      UpdateDirectVisitHours(visits[j], -1);
+
+    // Browsed visits have no entry in the visit_source table.
+    del.Assign(GetDB().GetUniqueStatement(
+        ("DELETE FROM visit_source WHERE id IN (" + ids + ")").c_str()));
+    del.Run();
+  }
+}
+
 bool VisitDatabase::GetRowForVisit(VisitID visit_id, VisitRow* out_visit) {
   sql::Statement statement(GetDB().GetCachedStatement(SQL_FROM_HERE,
       "SELECT" HISTORY_VISIT_ROW_FIELDS "FROM visits WHERE id=?"));
@@ -228,6 +388,10 @@ bool VisitDatabase::UpdateVisitRow(const VisitRow& visit) {
   if (visit.visit_id == visit.referring_visit)
     return false;
 
+  // The update may move the visit to another hour, or make it direct or not.
+  VisitRow old_visit;
+  bool found_old_visit = GetRowForVisit(visit.visit_id, &old_visit);
+
   sql::Statement statement(GetDB().GetCachedStatement(SQL_FROM_HERE,
       "UPDATE visits SET "
       "url=?,visit_time=?,from_visit=?,transition=?,segment_id=?,"
@@ -240,7 +404,16 @@ bool VisitDatabase::UpdateVisitRow(const VisitRow& visit) {
   statement.BindInt64(5, visit.visit_duration.ToInternalValue());
   statement.BindInt64(6, visit.visit_id);
 
-  return statement.Run();
+  if (!statement.Run())
+    return false;
+  if (found_old_visit &&
+      (old_visit.url_id != visit.url_id ||
+       old_visit.visit_time != visit.visit_time ||
+       old_visit.transition != visit.transition)) {
+    UpdateDirectVisitHours(old_visit, -1);
+    UpdateDirectVisitHours(visit, 1);
+  }
+  return true;
 }
 
 bool VisitDatabase::GetVisitsForURL(URLID url_id, VisitVector* visits) {
@@ -404,6 +577,68 @@ void VisitDatabase::GetDirectVisitsDuringTimes(const VisitFilter& time_filter,
   }
 }
 
+void VisitDatabase::GetDirectVisitScoresDuringTimes(
+    const VisitFilter& filter,
+    std::map<URLID, double>* scores) {
+  for (VisitFilter::TimeVector::const_iterator it = filter.times().begin();
+       it != filter.times().end(); ++it) {
+    int64 begin = it->first.ToInternalValue();
+    int64 end = it->second.ToInternalValue();
+    int64 first_hour = HourContaining(it->first);
+    if (first_hour < begin)
+      first_hour += kMicrosecondsPerHour;
+    int64 end_hour = HourContaining(it->second);
+    if (first_hour >= end_hour) {
+      AddDirectVisitScores(begin, end, filter, scores);
+      continue;
+    }
+
+    AddDirectVisitScores(begin, first_hour, filter, scores);
+    AddDirectVisitScores(end_hour, end, filter, scores);
+
+    sql::Statement statement(GetDB().GetCachedStatement(SQL_FROM_HERE,
+        "SELECT url, hour, visit_count, offset_sum FROM direct_visit_hours "
+        "WHERE hour >= ? AND hour < ?"));
+    statement.BindInt64(0, first_hour);
+    statement.BindInt64(1, end_hour);
+    while (statement.Step()) {
+      int visit_count = statement.ColumnInt(2);
+      if (visit_count <= 0)
+        continue;
+      // The visits of the hour are scored as if all made at their mean time.
+      VisitRow visit;
+      visit.url_id = statement.ColumnInt64(0);
+      visit.visit_time = base::Time::FromInternalValue(
+          statement.ColumnInt64(1) + statement.ColumnInt64(3) / visit_count);
+      (*scores)[visit.url_id] += visit_count * filter.GetVisitScore(visit);
+    }
+  }
+}
+
+void VisitDatabase::AddDirectVisitScores(int64 begin_time,
+                                         int64 end_time,
+                                         const VisitFilter& filter,
+                                         std::map<URLID, double>* scores) {
+  if (begin_time >= end_time)
+    return;
+  sql::Statement statement(GetDB().GetCachedStatement(SQL_FROM_HERE,
+      "SELECT" HISTORY_VISIT_ROW_FIELDS "FROM visits "
+      "WHERE visit_time >= ? AND visit_time < ? "
+      "AND (transition & ?) != 0 "  // CHAIN_START
+      "AND (transition & ?) IN (?, ?)"));  // TYPED or AUTO_BOOKMARK only
+  statement.BindInt64(0, begin_time);
+  statement.BindInt64(1, end_time);
+  statement.BindInt(2, content::PAGE_TRANSITION_CHAIN_START);
+  statement.BindInt(3, content::PAGE_TRANSITION_CORE_MASK);
+  statement.BindInt(4, content::PAGE_TRANSITION_TYPED);
+  statement.BindInt(5, content::PAGE_TRANSITION_AUTO_BOOKMARK);
+  while (statement.Step()) {
+    VisitRow visit;
+    FillVisitRow(statement, &visit);
+    (*scores)[visit.url_id] += filter.GetVisitScore(visit);
+  }
+}
+
 VisitID VisitDatabase::GetMostRecentVisitForURL(URLID url_id,
                                                 VisitRow* visit_row) {
   // The visit_time values can be duplicated in a redirect chain, so we sort
@@ -443,6 +678,94 @@ bool VisitDatabase::GetMostRecentVisitsForURL(URLID url_id,
   return FillVisitVector(statement, visits);
 }
 
+bool VisitDatabase::GetMostRecentVisitsForURLs(
+    const std::set<URLID>& url_ids,
+    int max_results_per_url,
+    std::map<URLID, VisitVector>* visits) {
+  visits->clear();
+  if (url_ids.empty())
+    return true;
+
+  // The statements always have the same number of URL parameters so that
+  // they can be cached. The ones left unbound are NULL, which matches no URL.
+  std::string in_list("IN (");
+  for (int i = 0; i < kURLsPerVisitsQuery; ++i)
+    in_list.append(i ? ",?" : "?");
+  in_list.append(")");
+
+  // URLs with more visits than are wanted are read one at a time with
+  // GetMostRecentVisitsForURL(), whose LIMIT bounds the scan, so that a URL
+  // visited thousands of times does not cost thousands of rows.
+  std::string heavy_sql("SELECT id FROM urls WHERE visit_count > ? AND id ");
+  heavy_sql.append(in_list);
+  sql::Statement heavy_statement(GetDB().GetCachedStatement(
+      SQL_FROM_HERE, heavy_sql.c_str()));
+
+  // The rest are read together, in the same order as
+  // GetMostRecentVisitsForURL() for each URL.
+  std::string sql("SELECT" HISTORY_VISIT_ROW_FIELDS "FROM visits WHERE url ");
+  sql.append(in_list);
+  sql.append(" ORDER BY url, visit_time DESC, id DESC");
+  sql::Statement statement(GetDB().GetCachedStatement(SQL_FROM_HERE,
+                                                      sql.c_str()));
+  if (!heavy_statement.is_valid() || !statement.is_valid())
+    return false;
+
+  std::set<URLID>::const_iterator url_id = url_ids.begin();
+  while (url_id != url_ids.end()) {
+    std::vector<URLID> batch;
+    heavy_statement.Reset(true);
+    heavy_statement.BindInt(0, max_results_per_url);
+    for (; static_cast<int>(batch.size()) < kURLsPerVisitsQuery &&
+           url_id != url_ids.end(); ++url_id) {
+      heavy_statement.BindInt64(static_cast<int>(batch.size()) + 1, *url_id);
+      batch.push_back(*url_id);
+    }
+    std::set<URLID> heavy_url_ids;
+    while (heavy_statement.Step())
+      heavy_url_ids.insert(heavy_statement.ColumnInt64(0));
+    if (!heavy_statement.Succeeded())
+      return false;
+
+    statement.Reset(true);
+    int bound = 0;
+    for (size_t i = 0; i < batch.size(); ++i) {
+      if (heavy_url_ids.find(batch[i]) == heavy_url_ids.end()) {
+        statement.BindInt64(bound++, batch[i]);
+        continue;
+      }
+      VisitVector url_visits;
+      if (!GetMostRecentVisitsForURL(batch[i], max_results_per_url,
+                                     &url_visits))
+        return false;
+      if (!url_visits.empty())
+        (*visits)[batch[i]].swap(url_visits);
+    }
+    if (!bound)
+      continue;
+
+    // The visit count of a URL need not match its visits, so the cap is
+    // still checked, before the rest of the row is read.
+    URLID current_url_id = 0;
+    VisitVector* url_visits = NULL;
+    while (statement.Step()) {
+      URLID visit_url_id = statement.ColumnInt64(1);
+      if (!url_visits || visit_url_id != current_url_id) {
+        current_url_id = visit_url_id;
+        url_visits = &(*visits)[current_url_id];
+      }
+      if (url_visits->size() >= static_cast<size_t>(max_results_per_url))
+        continue;
+      VisitRow visit;
+      FillVisitRow(statement, &visit);
+      url_visits->push_back(visit);
+    }
+    if (!statement.Succeeded())
+      return false;
+  }
+  return true;
+}
+
 bool VisitDatabase::GetRedirectFromVisit(VisitID from_visit,
                                          VisitID* to_visit,
                                          GURL* to_url) {
@@ -5,6 +5,8 @@
 #ifndef CHROME_BROWSER_HISTORY_VISIT_DATABASE_H_
 #define CHROME_BROWSER_HISTORY_VISIT_DATABASE_H_
 
+#include <map>
+#include <set>
 #include <vector>
 
 #include "chrome/browser/history/history_types.h"
@@ -45,6 +47,12 @@ class VisitDatabase {
   // doesn't exist, it will not do anything.
   void DeleteVisit(const VisitRow& visit);
 
+  // Deletes the given visits, which must be in the database, with a few
+  // statements for the whole set rather than a few for each visit. Visits
+  // referred to by a chain of deleted visits are patched to refer to the first
+  // visit left in the chain.
+  void DeleteVisits(const VisitVector& visits);
+
   // Query a VisitInfo giving an visit id, filling the given VisitRow.
   // Returns true on success.
   bool GetRowForVisit(VisitID visit_id, VisitRow* out_visit);
@@ -130,6 +138,14 @@ class VisitDatabase {
                                    int max_count,
                                    VisitVector* visits);
 
+  // Adds the scores |filter| gives the direct visits during its times, as
+  // returned by GetDirectVisitsDuringTimes(), to |scores|, summed per URL.
+  // The hours wholly within the times are read from the hourly aggregates of
+  // the direct visits, whose visits are scored as if made at their mean time;
+  // only the partial hours at the ends of the times are read visit by visit.
+  void GetDirectVisitScoresDuringTimes(const VisitFilter& filter,
+                                       std::map<URLID, double>* scores);
+
   // Returns the visit ID for the most recent visit of the given URL ID, or 0
   // if there is no visit for the URL.
   //
@@ -147,6 +163,16 @@ class VisitDatabase {
                                  int max_results,
                                  VisitVector* visits);
 
+  // Like GetMostRecentVisitsForURL() for each URL of |url_ids|, filling
+  // |visits| with the visits of each URL that has any. The visits are read
+  // with one query per batch of URLs rather than one per URL, except for URLs
+  // with more than |max_results_per_url| visits, which are read on their own.
+  //
+  // Returns false if a query fails.
+  bool GetMostRecentVisitsForURLs(const std::set<URLID>& url_ids,
+                                  int max_results_per_url,
+                                  std::map<URLID, VisitVector>* visits);
+
   // Finds a redirect coming from the given |from_visit|. If a redirect is
   // found, it fills the visit ID and URL into the out variables and returns
   // true. If there is no redirect from the given visit, returns false.
@@ -218,7 +244,25 @@ class VisitDatabase {
   // don't have visit_duration column yet.
   bool MigrateVisitsWithoutDuration();
 
+  // Called by the derived classes to fill the hourly aggregates of the direct
+  // visits from the visits, when migrating a database which had none.
+  bool MigrateDirectVisitHours();
+
  private:
+  // Creates the table of the hourly aggregates of the direct visits, empty,
+  // if it does not exist yet.
+  bool CreateDirectVisitHoursTable();
+
+  // Accounts for |delta| visits like |visit| in the hourly aggregates, if it
+  // is a direct visit.
+  bool UpdateDirectVisitHours(const VisitRow& visit, int delta);
+
+  // Adds the scores of the direct visits in [begin_time, end_time), given as
+  // internal time values, to |scores| visit by visit.
+  void AddDirectVisitScores(int64 begin_time,
+                            int64 end_time,
+                            const VisitFilter& filter,
+                            std::map<URLID, double>* scores);
 
   DISALLOW_COPY_AND_ASSIGN(VisitDatabase);
 };
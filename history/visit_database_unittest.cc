@@ -2,19 +2,23 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <map>
 #include <set>
 #include <vector>
 
 #include "base/files/file_path.h"
 #include "base/files/scoped_temp_dir.h"
 #include "base/path_service.h"
+#include "base/strings/string_number_conversions.h"
 #include "base/strings/string_util.h"
 #include "base/time/time.h"
 #include "chrome/browser/history/url_database.h"
 #include "chrome/browser/history/visit_database.h"
+#include "chrome/browser/history/visit_filter.h"
 #include "sql/connection.h"
 #include "testing/gtest/include/gtest/gtest.h"
 #include "testing/platform_test.h"
+#include "url/gurl.h"
 
 using base::Time;
 using base::TimeDelta;
@@ -136,6 +140,36 @@ TEST_F(VisitDatabaseTest, Delete) {
               IsVisitInfoEqual(matches[1], visit_info3));
 }
 
+TEST_F(VisitDatabaseTest, DeleteVisits) {
+  // Add a chain of four visits, one with a source, and delete the middle two
+  // at once. The chain should link the outer two.
+  VisitRow visits[4];
+  for (int i = 0; i < 4; ++i) {
+    visits[i] = VisitRow(1, Time::FromInternalValue(1000 + i),
+                         i ? visits[i - 1].visit_id : 0,
+                         content::PAGE_TRANSITION_LINK, 0);
+    EXPECT_TRUE(AddVisit(&visits[i],
+                         i == 2 ? SOURCE_EXTENSION : SOURCE_BROWSED));
+  }
+
+  // Deleted in chain order, the last visit still ends up linked to the first.
+  VisitVector deleted;
+  deleted.push_back(visits[1]);
+  deleted.push_back(visits[2]);
+  DeleteVisits(deleted);
+
+  visits[3].referring_visit = visits[0].visit_id;
+  std::vector<VisitRow> matches;
+  EXPECT_TRUE(GetVisitsForURL(1, &matches));
+  ASSERT_EQ(2U, matches.size());
+  EXPECT_TRUE(IsVisitInfoEqual(matches[0], visits[0]));
+  EXPECT_TRUE(IsVisitInfoEqual(matches[1], visits[3]));
+
+  VisitSourceMap sources;
+  GetVisitsSource(deleted, &sources);
+  EXPECT_TRUE(sources.empty());
+}
+
 TEST_F(VisitDatabaseTest, Update) {
   // Make something in the database.
   VisitRow original(1, Time::Now(), 23, content::PageTransitionFromInt(0), 19);
@@ -263,6 +297,75 @@ TEST_F(VisitDatabaseTest, GetVisitsForTimes) {
   }
 }
 
+TEST_F(VisitDatabaseTest, GetMostRecentVisitsForURLs) {
+  // Enough URLs for several queries, each with a few visits, some of them at
+  // the same time.
+  Time base_time = Time::Now();
+  for (URLID url_id = 1; url_id <= 250; ++url_id) {
+    for (int i = 0; i < static_cast<int>(url_id % 5); ++i) {
+      VisitRow visit(url_id, base_time + TimeDelta::FromMinutes(i / 2), 0,
+                     content::PAGE_TRANSITION_TYPED, 0);
+      EXPECT_TRUE(AddVisit(&visit, SOURCE_BROWSED));
+    }
+  }
+
+  std::set<URLID> url_ids;
+  for (URLID url_id = 2; url_id <= 250; url_id += 2)
+    url_ids.insert(url_id);
+  url_ids.insert(1000);  // No visits.
+  std::map<URLID, VisitVector> visits;
+  ASSERT_TRUE(GetMostRecentVisitsForURLs(url_ids, 3, &visits));
+
+  for (URLID url_id = 1; url_id <= 250; ++url_id) {
+    std::map<URLID, VisitVector>::const_iterator found = visits.find(url_id);
+    if (url_id % 2 || url_id % 5 == 0) {
+      EXPECT_TRUE(found == visits.end()) << url_id;
+      continue;
+    }
+    ASSERT_TRUE(found != visits.end()) << url_id;
+    VisitVector expected;
+    ASSERT_TRUE(GetMostRecentVisitsForURL(url_id, 3, &expected));
+    ASSERT_EQ(expected.size(), found->second.size()) << url_id;
+    for (size_t i = 0; i < expected.size(); ++i)
+      EXPECT_TRUE(IsVisitInfoEqual(expected[i], found->second[i])) << url_id;
+  }
+  EXPECT_TRUE(visits.find(1000) == visits.end());
+}
+
+TEST_F(VisitDatabaseTest, GetMostRecentVisitsForURLsWithManyVisits) {
+  // URLs with more visits than are wanted, one of them with a visit count
+  // lower than its number of visits, and one with few visits.
+  const int kVisitCounts[] = { 20, 1, 2 };
+  const int kNumVisits[] = { 20, 6, 2 };
+  Time base_time = Time::Now();
+  std::set<URLID> url_ids;
+  for (int i = 0; i < static_cast<int>(arraysize(kVisitCounts)); ++i) {
+    URLRow row(GURL("http://www.google.com/" + base::IntToString(i)));
+    row.set_visit_count(kVisitCounts[i]);
+    URLID url_id = AddURL(row);
+    ASSERT_TRUE(url_id);
+    url_ids.insert(url_id);
+    for (int j = 0; j < kNumVisits[i]; ++j) {
+      VisitRow visit(url_id, base_time + TimeDelta::FromMinutes(j), 0,
+                     content::PAGE_TRANSITION_TYPED, 0);
+      EXPECT_TRUE(AddVisit(&visit, SOURCE_BROWSED));
+    }
+  }
+
+  std::map<URLID, VisitVector> visits;
+  ASSERT_TRUE(GetMostRecentVisitsForURLs(url_ids, 3, &visits));
+  ASSERT_EQ(url_ids.size(), visits.size());
+  for (std::set<URLID>::const_iterator url_id = url_ids.begin();
+       url_id != url_ids.end(); ++url_id) {
+    VisitVector expected;
+    ASSERT_TRUE(GetMostRecentVisitsForURL(*url_id, 3, &expected));
+    const VisitVector& found = visits[*url_id];
+    ASSERT_EQ(expected.size(), found.size()) << *url_id;
+    for (size_t i = 0; i < expected.size(); ++i)
+      EXPECT_TRUE(IsVisitInfoEqual(expected[i], found[i])) << *url_id;
+  }
+}
+
 TEST_F(VisitDatabaseTest, GetAllVisitsInRange) {
   std::vector<VisitRow> test_visit_rows = GetTestVisitRows();
 
@@ -385,4 +488,70 @@ TEST_F(VisitDatabaseTest, VisitSource) {
   EXPECT_EQ(SOURCE_EXTENSION, sources[matches[0].visit_id]);
 }
 
+TEST_F(VisitDatabaseTest, DirectVisitScores) {
+  Time now = Time::Now();
+  content::PageTransition typed = static_cast<content::PageTransition>(
+      content::PAGE_TRANSITION_TYPED |
+      content::PAGE_TRANSITION_CHAIN_START |
+      content::PAGE_TRANSITION_CHAIN_END);
+  content::PageTransition bookmark = static_cast<content::PageTransition>(
+      content::PAGE_TRANSITION_AUTO_BOOKMARK |
+      content::PAGE_TRANSITION_CHAIN_START |
+      content::PAGE_TRANSITION_CHAIN_END);
+  content::PageTransition link = static_cast<content::PageTransition>(
+      content::PAGE_TRANSITION_LINK |
+      content::PAGE_TRANSITION_CHAIN_START |
+      content::PAGE_TRANSITION_CHAIN_END);
+
+  // Typed visits spread over several hours, some sharing an hour.
+  std::vector<VisitRow> typed_visits;
+  for (int i = 0; i < 10; ++i) {
+    VisitRow visit(1, now - TimeDelta::FromMinutes(37 * i), 0, typed, 0);
+    EXPECT_TRUE(AddVisit(&visit, SOURCE_BROWSED));
+    typed_visits.push_back(visit);
+  }
+  VisitRow bookmark_visit(2, now - TimeDelta::FromHours(2), 0, bookmark, 0);
+  EXPECT_TRUE(AddVisit(&bookmark_visit, SOURCE_BROWSED));
+  // Not a direct visit.
+  VisitRow link_visit(3, now - TimeDelta::FromHours(1), 0, link, 0);
+  EXPECT_TRUE(AddVisit(&link_visit, SOURCE_BROWSED));
+
+  VisitFilter filter;
+  filter.SetFilterTime(now);
+  filter.SetFilterWidth(TimeDelta::FromHours(12));
+  filter.set_sorting_order(VisitFilter::ORDER_BY_VISIT_COUNT);
+  std::map<URLID, double> scores;
+  GetDirectVisitScoresDuringTimes(filter, &scores);
+  EXPECT_EQ(2U, scores.size());
+  EXPECT_DOUBLE_EQ(10.0, scores[1]);
+  EXPECT_DOUBLE_EQ(1.0, scores[2]);
+
+  // Scores which decay with time are close to those of the visits.
+  filter.set_sorting_order(VisitFilter::ORDER_BY_RECENCY);
+  scores.clear();
+  GetDirectVisitScoresDuringTimes(filter, &scores);
+  VisitVector visits;
+  GetDirectVisitsDuringTimes(filter, 0, &visits);
+  ASSERT_EQ(11U, visits.size());
+  double visit_score = 0;
+  for (size_t i = 0; i < visits.size(); ++i) {
+    if (visits[i].url_id == 1)
+      visit_score += filter.GetVisitScore(visits[i]);
+  }
+  EXPECT_NEAR(visit_score, scores[1], visit_score * 0.01);
+
+  // Deleting and updating visits keep the aggregates in step.
+  filter.set_sorting_order(VisitFilter::ORDER_BY_VISIT_COUNT);
+  DeleteVisit(typed_visits[0]);
+  bookmark_visit.transition = link;
+  EXPECT_TRUE(UpdateVisitRow(bookmark_visit));
+  link_visit.transition = typed;
+  EXPECT_TRUE(UpdateVisitRow(link_visit));
+  scores.clear();
+  GetDirectVisitScoresDuringTimes(filter, &scores);
+  EXPECT_EQ(2U, scores.size());
+  EXPECT_DOUBLE_EQ(9.0, scores[1]);
+  EXPECT_DOUBLE_EQ(1.0, scores[3]);
+}
+
 }  // namespace history
@@ -169,6 +169,15 @@ class MemoryDetails : public base::RefCountedThreadSafe<MemoryDetails> {
       const ProcessInfoSnapshot& process_info);
 #endif
 
+#if defined(OS_LINUX)
+  // Called on the file thread with the working sets read by a blocking pool
+  // task for process_data_[|browser|].processes, from |offset| on. Once the
+  // last task is in, goes on to CollectChildInfoOnUIThread().
+  void OnWorkingSetsRead(size_t browser,
+                         size_t offset,
+                         const ProcessMemoryInformationList* processes);
+#endif
+
   // Collect child process information on the UI thread.  Information about
   // renderer processes is only available there.
   void CollectChildInfoOnUIThread();
@@ -191,7 +200,20 @@ class MemoryDetails : public base::RefCountedThreadSafe<MemoryDetails> {
   base::SwapInfo swap_info_;
 #endif
 
+#if defined(OS_LINUX)
+  // The number of blocking pool tasks still reading working sets.
+  int pending_working_set_reads_;
+#endif
+
   DISALLOW_COPY_AND_ASSIGN(MemoryDetails);
 };
 
+#if defined(OS_LINUX)
+// Fills |working_set| from the contents of /proc/<pid>/smaps_rollup the way
+// base::ProcessMetrics::GetWorkingSetKBytes() does from smaps. Returns false
+// if |rollup| has no Pss line. Exposed for testing.
+bool ParseSmapsRollup(const std::string& rollup,
+                      base::WorkingSetKBytes* working_set);
+#endif
+
 #endif  // CHROME_BROWSER_MEMORY_DETAILS_H_
@@ -7,14 +7,18 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <map>
 #include <set>
 
 #include "base/bind.h"
 #include "base/file_util.h"
+#include "base/files/file_path.h"
+#include "base/memory/scoped_ptr.h"
 #include "base/process/process_iterator.h"
 #include "base/process/process_metrics.h"
 #include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
 #include "base/strings/string_util.h"
 #include "base/strings/utf_string_conversions.h"
 #include "chrome/common/chrome_constants.h"
@@ -68,8 +72,12 @@ static const struct {
   { "", MAX_BROWSERS },
 };
 
+// The number of processes whose memory one blocking pool task reads.
+static const size_t kProcessesPerTask = 8;
+
 MemoryDetails::MemoryDetails()
-    : user_metrics_mode_(UPDATE_USER_METRICS) {
+    : user_metrics_mode_(UPDATE_USER_METRICS),
+      pending_working_set_reads_(0) {
 }
 
 ProcessData* MemoryDetails::ChromeBrowser() {
@@ -110,9 +118,9 @@ static BrowserType GetBrowserType(const std::string& process_name) {
   return MAX_BROWSERS;
 }
 
-// For each of a list of pids, collect memory information about that process.
-static ProcessData GetProcessDataMemoryInformation(
-    const std::vector<pid_t>& pids) {
+// For each of a list of pids, create the memory information about that
+// process. The working sets are read later, by ReadWorkingSets().
+static ProcessData CreateProcessData(const std::vector<pid_t>& pids) {
   ProcessData process_data;
   for (std::vector<pid_t>::const_iterator iter = pids.begin();
        iter != pids.end();
@@ -127,16 +135,79 @@ static ProcessData GetProcessDataMemoryInformation(
     else
       pmi.process_type = content::PROCESS_TYPE_UNKNOWN;
 
-    base::ProcessMetrics* metrics =
-        base::ProcessMetrics::CreateProcessMetrics(*iter);
-    metrics->GetWorkingSetKBytes(&pmi.working_set);
-    delete metrics;
-
     process_data.processes.push_back(pmi);
   }
   return process_data;
 }
 
+static bool ReadProcFile(pid_t pid,
+                         const char* name,
+                         std::string* contents) {
+  base::FilePath path = base::FilePath("/proc")
+      .Append(base::IntToString(pid))
+      .Append(name);
+  return file_util::ReadFileToString(path, contents);
+}
+
+bool ParseSmapsRollup(const std::string& rollup,
+                      base::WorkingSetKBytes* working_set) {
+  std::vector<std::string> lines;
+  base::SplitString(rollup, '\n', &lines);
+  bool has_pss = false;
+  size_t private_kb = 0;
+  size_t pss_kb = 0;
+  size_t swap_kb = 0;
+  for (size_t i = 0; i < lines.size(); ++i) {
+    std::vector<std::string> fields;
+    base::SplitStringAlongWhitespace(lines[i], &fields);
+    int value = 0;
+    if (fields.size() < 2 || !base::StringToInt(fields[1], &value))
+      continue;
+    if (fields[0] == "Private_Clean:" || fields[0] == "Private_Dirty:") {
+      private_kb += value;
+    } else if (fields[0] == "Pss:") {
+      pss_kb += value;
+      has_pss = true;
+    } else if (fields[0] == "Swap:") {
+      swap_kb += value;
+    }
+  }
+  if (!has_pss)
+    return false;
+  working_set->priv = private_kb;
+  working_set->shared = pss_kb;
+  working_set->shareable = 0;
+#if defined(OS_CHROMEOS)
+  working_set->swapped = swap_kb;
+#endif
+  return true;
+}
+
+// Reads the working set from /proc/<pid>/smaps_rollup, which sums up smaps
+// without the cost of printing every mapping. Only newer kernels have it.
+static bool ReadWorkingSetFromSmapsRollup(
+    pid_t pid,
+    base::WorkingSetKBytes* working_set) {
+  std::string rollup;
+  return ReadProcFile(pid, "smaps_rollup", &rollup) &&
+         ParseSmapsRollup(rollup, working_set);
+}
+
+// Reads the working sets of |processes|. Runs in the blocking pool. Every
+// browser's processes are read the same way, so that they compare: from the
+// smaps rollup if there is one, and walking smaps through
+// base::ProcessMetrics otherwise.
+static void ReadWorkingSets(ProcessMemoryInformationList* processes) {
+  for (ProcessMemoryInformationList::iterator iter = processes->begin();
+       iter != processes->end(); ++iter) {
+    if (!ReadWorkingSetFromSmapsRollup(iter->pid, &iter->working_set)) {
+      scoped_ptr<base::ProcessMetrics> metrics(
+          base::ProcessMetrics::CreateProcessMetrics(iter->pid));
+      metrics->GetWorkingSetKBytes(&iter->working_set);
+    }
+  }
+}
+
 // Find all children of the given process with pid |root|.
 static std::vector<pid_t> GetAllChildren(const ProcessMap& processes,
                                          const pid_t root) {
@@ -196,7 +267,7 @@ void MemoryDetails::CollectProcessData(
   }
 
   ProcessData current_browser =
-      GetProcessDataMemoryInformation(GetAllChildren(process_map, getpid()));
+      CreateProcessData(GetAllChildren(process_map, getpid()));
   current_browser.name = l10n_util::GetStringUTF16(IDS_SHORT_PRODUCT_NAME);
   current_browser.process_name = ASCIIToUTF16("chrome");
 
@@ -222,7 +293,7 @@ void MemoryDetails::CollectProcessData(
        iter != browsers_found.end();
        ++iter) {
     std::vector<pid_t> browser_processes = GetAllChildren(process_map, *iter);
-    ProcessData browser = GetProcessDataMemoryInformation(browser_processes);
+    ProcessData browser = CreateProcessData(browser_processes);
 
     ProcessMap::const_iterator process_iter = process_map.find(*iter);
     if (process_iter == process_map.end())
@@ -233,6 +304,49 @@ void MemoryDetails::CollectProcessData(
     process_data_.push_back(browser);
   }
 
+  // Read the working sets in parallel, in the blocking pool. Reading /proc
+  // serially takes seconds with hundreds of processes.
+  DCHECK_EQ(0, pending_working_set_reads_);
+  for (size_t browser = 0; browser < process_data_.size(); ++browser) {
+    const ProcessMemoryInformationList& processes =
+        process_data_[browser].processes;
+    for (size_t offset = 0; offset < processes.size();
+         offset += kProcessesPerTask) {
+      ProcessMemoryInformationList* chunk = new ProcessMemoryInformationList(
+          processes.begin() + offset,
+          processes.begin() + std::min(offset + kProcessesPerTask,
+                                       processes.size()));
+      if (BrowserThread::PostBlockingPoolTaskAndReply(
+              FROM_HERE,
+              base::Bind(&ReadWorkingSets, base::Unretained(chunk)),
+              base::Bind(&MemoryDetails::OnWorkingSetsRead, this, browser,
+                         offset, base::Owned(chunk)))) {
+        ++pending_working_set_reads_;
+      } else {
+        delete chunk;
+      }
+    }
+  }
+  if (!pending_working_set_reads_)
+    OnWorkingSetsRead(0, 0, NULL);
+}
+
+void MemoryDetails::OnWorkingSetsRead(
+    size_t browser,
+    size_t offset,
+    const ProcessMemoryInformationList* processes) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::FILE));
+  if (processes) {
+    ProcessMemoryInformationList& browser_processes =
+        process_data_[browser].processes;
+    for (size_t i = 0; i < processes->size(); ++i) {
+      DCHECK_EQ(browser_processes[offset + i].pid, (*processes)[i].pid);
+      browser_processes[offset + i].working_set = (*processes)[i].working_set;
+    }
+    if (--pending_working_set_reads_ > 0)
+      return;
+  }
+
 #if defined(OS_CHROMEOS)
   base::GetSwapInfo(&swap_info_);
 #endif
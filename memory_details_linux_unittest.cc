@@ -0,0 +1,50 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/memory_details.h"
+
+#include <string>
+
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace {
+
+const char kSmapsRollup[] =
+    "00400000-7ffc5a9b6000 ---p 00000000 00:00 0                  [rollup]\n"
+    "Rss:              884540 kB\n"
+    "Pss:              415234 kB\n"
+    "Pss_Anon:         350112 kB\n"
+    "Pss_File:          65122 kB\n"
+    "Pss_Shmem:             0 kB\n"
+    "Shared_Clean:     470320 kB\n"
+    "Shared_Dirty:       5124 kB\n"
+    "Private_Clean:     12800 kB\n"
+    "Private_Dirty:    396296 kB\n"
+    "Referenced:       870000 kB\n"
+    "Anonymous:        400000 kB\n"
+    "Swap:               2048 kB\n"
+    "SwapPss:            1024 kB\n"
+    "Locked:                0 kB\n";
+
+}  // namespace
+
+TEST(MemoryDetailsLinuxTest, ParseSmapsRollup) {
+  base::WorkingSetKBytes working_set;
+  ASSERT_TRUE(ParseSmapsRollup(kSmapsRollup, &working_set));
+  EXPECT_EQ(12800u + 396296u, working_set.priv);
+  // The per-type Pss lines are not counted again.
+  EXPECT_EQ(415234u, working_set.shared);
+  EXPECT_EQ(0u, working_set.shareable);
+#if defined(OS_CHROMEOS)
+  EXPECT_EQ(2048u, working_set.swapped);
+#endif
+}
+
+TEST(MemoryDetailsLinuxTest, ParseSmapsRollupWithoutPss) {
+  base::WorkingSetKBytes working_set;
+  EXPECT_FALSE(ParseSmapsRollup(std::string(), &working_set));
+  EXPECT_FALSE(ParseSmapsRollup("Rss:  884540 kB\n"
+                                "Private_Dirty:  396296 kB\n",
+                                &working_set));
+}
@@ -4,16 +4,13 @@
 
 #include "chrome/browser/metrics/compression_utils.h"
 
-#include <vector>
+#include <string.h>
 
-#include "base/basictypes.h"
+#include "base/logging.h"
 #include "third_party/zlib/zlib.h"
 
 namespace {
 
-// The difference in bytes between a zlib header and a gzip header.
-const size_t kGzipZlibHeaderDifferenceBytes = 16;
-
 // Pass an integer greater than the following get a gzip header instead of a
 // zlib header when calling deflateInit2_.
 const int kWindowBitsToGetGzipHeader = 16;
@@ -23,70 +20,133 @@ const int kWindowBitsToGetGzipHeader = 16;
 // http://www.zlib.net/manual.html (search for memLevel).
 const int kZlibMemoryLevel = 8;
 
-// This code is taken almost verbatim from third_party/zlib/compress.c. The only
-// difference is deflateInit2_ is called which sets the window bits to be > 16.
-// That causes a gzip header to be emitted rather than a zlib header.
-int GzipCompressHelper(Bytef* dest,
-                       uLongf* dest_length,
-                       const Bytef* source,
-                       uLong source_length) {
-    z_stream stream;
-
-    stream.next_in = bit_cast<Bytef*>(source);
-    stream.avail_in = static_cast<uInt>(source_length);
-    stream.next_out = dest;
-    stream.avail_out = static_cast<uInt>(*dest_length);
-    if (static_cast<uLong>(stream.avail_out) != *dest_length)
-      return Z_BUF_ERROR;
-
-    stream.zalloc = static_cast<alloc_func>(0);
-    stream.zfree = static_cast<free_func>(0);
-    stream.opaque = static_cast<voidpf>(0);
-
-    gz_header gzip_header;
-    memset(&gzip_header, 0, sizeof(gzip_header));
-    int err = deflateInit2_(&stream,
-                            Z_DEFAULT_COMPRESSION,
-                            Z_DEFLATED,
-                            MAX_WBITS + kWindowBitsToGetGzipHeader,
-                            kZlibMemoryLevel,
-                            Z_DEFAULT_STRATEGY,
-                            ZLIB_VERSION,
-                            sizeof(z_stream));
-    if (err != Z_OK)
-      return err;
-
-    err = deflateSetHeader(&stream, &gzip_header);
-    if (err != Z_OK)
-      return err;
-
-    err = deflate(&stream, Z_FINISH);
-    if (err != Z_STREAM_END) {
-        deflateEnd(&stream);
-        return err == Z_OK ? Z_BUF_ERROR : err;
-    }
-    *dest_length = stream.total_out;
+// The size of the buffer zlib writes its output to, in bytes.
+const size_t kOutputBufferSize = 16 * 1024;
 
-    err = deflateEnd(&stream);
-    return err;
-}
 }  // namespace
 
 namespace chrome {
 
 bool GzipCompress(const std::string& input, std::string* output) {
-  std::vector<Bytef> compressed_data(kGzipZlibHeaderDifferenceBytes +
-                                     compressBound(input.size()));
-
-  uLongf compressed_size = compressed_data.size();
-  if (GzipCompressHelper(&compressed_data.front(),
-                         &compressed_size,
-                         bit_cast<const Bytef*>(input.data()),
-                         input.size()) != Z_OK)
+  GzipCompressor compressor;
+  std::string compressed_data;
+  if (!compressor.Write(input.data(), input.size(), &compressed_data) ||
+      !compressor.Finish(&compressed_data)) {
+    return false;
+  }
+  output->swap(compressed_data);
+  return true;
+}
+
+bool GzipUncompress(const std::string& input, std::string* output) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (inflateInit2(&stream, MAX_WBITS + kWindowBitsToGetGzipHeader) != Z_OK)
+    return false;
+
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+  stream.avail_in = static_cast<uInt>(input.size());
+  std::string uncompressed_data;
+  char buffer[kOutputBufferSize];
+  int err;
+  do {
+    stream.next_out = reinterpret_cast<Bytef*>(buffer);
+    stream.avail_out = sizeof(buffer);
+    err = inflate(&stream, Z_NO_FLUSH);
+    uncompressed_data.append(buffer, sizeof(buffer) - stream.avail_out);
+  } while (err == Z_OK);
+  inflateEnd(&stream);
+
+  // A truncated stream ends with Z_BUF_ERROR, once inflate() has run out of
+  // input.
+  if (err != Z_STREAM_END)
+    return false;
+  output->swap(uncompressed_data);
+  return true;
+}
+
+GzipCompressor::GzipCompressor()
+    : stream_(new z_stream),
+      failed_(false),
+      finished_(false) {
+  memset(stream_.get(), 0, sizeof(z_stream));
+  int err = deflateInit2_(stream_.get(),
+                          Z_DEFAULT_COMPRESSION,
+                          Z_DEFLATED,
+                          MAX_WBITS + kWindowBitsToGetGzipHeader,
+                          kZlibMemoryLevel,
+                          Z_DEFAULT_STRATEGY,
+                          ZLIB_VERSION,
+                          sizeof(z_stream));
+  if (err != Z_OK) {
+    failed_ = true;
+    finished_ = true;
+    return;
+  }
+
+  // zlib keeps a pointer to the header until it is written out, so it lives
+  // in static storage. Its fields are all zero, so the OS byte is too.
+  static gz_header gzip_header;
+  if (deflateSetHeader(stream_.get(), &gzip_header) != Z_OK)
+    failed_ = true;
+}
+
+GzipCompressor::~GzipCompressor() {
+  if (!finished_)
+    deflateEnd(stream_.get());
+}
+
+bool GzipCompressor::Write(const char* data,
+                           size_t size,
+                           std::string* output) {
+  DCHECK(!finished_ || failed_);
+  if (failed_)
+    return false;
+  stream_->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+  stream_->avail_in = static_cast<uInt>(size);
+  if (static_cast<size_t>(stream_->avail_in) != size) {
+    failed_ = true;
+    return false;
+  }
+  if (!Deflate(Z_NO_FLUSH, output))
+    return false;
+  DCHECK_EQ(0u, stream_->avail_in);
+  return true;
+}
+
+bool GzipCompressor::Finish(std::string* output) {
+  DCHECK(!finished_ || failed_);
+  if (failed_)
     return false;
+  stream_->next_in = NULL;
+  stream_->avail_in = 0;
+  bool result = Deflate(Z_FINISH, output);
+  finished_ = true;
+  if (deflateEnd(stream_.get()) != Z_OK)
+    result = false;
+  failed_ = !result;
+  return result;
+}
 
-  compressed_data.resize(compressed_size);
-  output->assign(compressed_data.begin(), compressed_data.end());
+bool GzipCompressor::Deflate(int flush, std::string* output) {
+  char buffer[kOutputBufferSize];
+  int err;
+  do {
+    stream_->next_out = reinterpret_cast<Bytef*>(buffer);
+    stream_->avail_out = sizeof(buffer);
+    err = deflate(stream_.get(), flush);
+    if (err == Z_STREAM_ERROR) {
+      failed_ = true;
+      return false;
+    }
+    output->append(buffer, sizeof(buffer) - stream_->avail_out);
+  } while (stream_->avail_out == 0);
+
+  if (flush == Z_FINISH && err != Z_STREAM_END) {
+    failed_ = true;
+    return false;
+  }
   return true;
 }
+
 }  // namespace chrome
@@ -7,11 +7,47 @@
 
 #include <string>
 
+#include "base/basictypes.h"
+#include "base/memory/scoped_ptr.h"
+
+struct z_stream_s;
+
 namespace chrome {
 
 // Compresses the text in |input| using gzip storing the result in |output|.
 bool GzipCompress(const std::string& input, std::string* output);
 
+// Uncompresses the gzip data in |input|, storing the result in |output|.
+// Returns false if |input| is not a complete gzip stream.
+bool GzipUncompress(const std::string& input, std::string* output);
+
+// Compresses data using gzip as it is handed in, so that a large input can be
+// compressed piecewise and its output written out as it is produced, instead
+// of holding the whole input and a worst-case sized output buffer at once.
+class GzipCompressor {
+ public:
+  GzipCompressor();
+  ~GzipCompressor();
+
+  // Compresses |size| bytes at |data|, appending the output that is ready to
+  // |output|. Returns false on error, after which the compressor is unusable.
+  bool Write(const char* data, size_t size, std::string* output);
+
+  // Appends the rest of the output, including the gzip trailer, to |output|.
+  // Nothing may be written afterwards.
+  bool Finish(std::string* output);
+
+ private:
+  // Runs deflate() with |flush| until it stops producing output.
+  bool Deflate(int flush, std::string* output);
+
+  scoped_ptr<z_stream_s> stream_;
+  bool failed_;
+  bool finished_;
+
+  DISALLOW_COPY_AND_ASSIGN(GzipCompressor);
+};
+
 }  // namespace chrome
 
 #endif  // CHROME_BROWSER_METRICS_COMPRESSION_UTILS_H_
@@ -2,12 +2,14 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <algorithm>
 #include <string>
 
 #include "base/base_paths.h"
 #include "base/basictypes.h"
 #include "base/file_util.h"
 #include "base/path_service.h"
+#include "base/strings/string_number_conversions.h"
 #include "chrome/browser/metrics/compression_utils.h"
 #include "chrome/common/chrome_paths.h"
 #include "testing/gtest/include/gtest/gtest.h"
@@ -45,4 +47,54 @@ TEST(CompressionUtilsTest, GzipCompression) {
   EXPECT_EQ(golden_compressed_data, compressed_data);
 }
 
+TEST(CompressionUtilsTest, GzipUncompression) {
+  std::string compressed_data(reinterpret_cast<const char*>(kCompressedData),
+                              arraysize(kCompressedData));
+  std::string uncompressed_data;
+  EXPECT_TRUE(chrome::GzipUncompress(compressed_data, &uncompressed_data));
+  std::string golden_data(reinterpret_cast<const char*>(kData),
+                          arraysize(kData));
+  EXPECT_EQ(golden_data, uncompressed_data);
+
+  // A truncated stream is rejected.
+  compressed_data.resize(compressed_data.size() - 1);
+  EXPECT_FALSE(chrome::GzipUncompress(compressed_data, &uncompressed_data));
+  EXPECT_EQ(golden_data, uncompressed_data);
+}
+
+TEST(CompressionUtilsTest, StreamingCompression) {
+  // Writing in chunks produces the same stream as compressing in one go.
+  std::string data(reinterpret_cast<const char*>(kData), arraysize(kData));
+  chrome::GzipCompressor compressor;
+  std::string compressed_data;
+  for (size_t i = 0; i < data.size(); ++i)
+    EXPECT_TRUE(compressor.Write(&data[i], 1, &compressed_data));
+  EXPECT_TRUE(compressor.Finish(&compressed_data));
+  std::string golden_compressed_data(
+      reinterpret_cast<const char*>(kCompressedData),
+      arraysize(kCompressedData));
+  EXPECT_EQ(golden_compressed_data, compressed_data);
+}
+
+TEST(CompressionUtilsTest, LargeStreamingCompression) {
+  // More output than fits in the compressor's buffer at once.
+  std::string data;
+  for (int i = 0; data.size() < 1024 * 1024; ++i)
+    data.append(base::IntToString(i * i));
+  chrome::GzipCompressor compressor;
+  std::string compressed_data;
+  const size_t kChunkSize = 10000;
+  for (size_t offset = 0; offset < data.size(); offset += kChunkSize) {
+    EXPECT_TRUE(compressor.Write(
+        data.data() + offset, std::min(kChunkSize, data.size() - offset),
+        &compressed_data));
+  }
+  EXPECT_TRUE(compressor.Finish(&compressed_data));
+  EXPECT_GT(data.size(), compressed_data.size());
+
+  std::string uncompressed_data;
+  EXPECT_TRUE(chrome::GzipUncompress(compressed_data, &uncompressed_data));
+  EXPECT_TRUE(data == uncompressed_data);
+}
+
 }  // namespace
@@ -5,15 +5,37 @@
 #include "chrome/browser/metrics/metrics_log_serializer.h"
 
 #include "base/base64.h"
+#include "base/bind.h"
+#include "base/file_util.h"
+#include "base/files/file_path.h"
 #include "base/md5.h"
 #include "base/metrics/histogram.h"
+#include "base/path_service.h"
 #include "base/prefs/pref_service.h"
+#include "base/threading/sequenced_worker_pool.h"
 #include "chrome/browser/browser_process.h"
-#include "chrome/browser/prefs/scoped_user_pref_update.h"
+#include "chrome/browser/metrics/metrics_log_store.h"
+#include "chrome/common/chrome_paths.h"
 #include "chrome/common/pref_names.h"
+#include "content/public/browser/browser_thread.h"
+
+using content::BrowserThread;
 
 namespace {
 
+// The directory in the user data directory holding the stored logs, in a
+// subdirectory for each log type.
+const base::FilePath::CharType kLogStoreDirname[] =
+    FILE_PATH_LITERAL("Metrics Logs");
+const base::FilePath::CharType kInitialLogStoreDirname[] =
+    FILE_PATH_LITERAL("Initial");
+const base::FilePath::CharType kOngoingLogStoreDirname[] =
+    FILE_PATH_LITERAL("Ongoing");
+
+// All the log stores share this sequence, so that a discard is ordered with
+// the reads and writes around it.
+const char kLogStoreSequenceName[] = "MetricsLogStore";
+
 // The number of "initial" logs to save, and hope to send during a future Chrome
 // session.  Initial logs contain crash stats, and are pretty small.
 const size_t kInitialLogsPersistLimit = 20;
@@ -31,9 +53,14 @@ const size_t kOngoingLogsPersistLimit = 8;
 
 // The number of bytes each of initial and ongoing logs that must be stored.
 // This ensures that a reasonable amount of history will be stored even if there
-// is a long series of very small logs.
+// is a long series of very small logs. The logs are stored compressed, and
+// this counts their compressed size.
 const size_t kStorageByteLimitPerLogType = 300000;
 
+// The most bytes each of initial and ongoing logs may take on disk, however few
+// logs that is.
+const size_t kMaxStorageBytesPerLogType = 1000000;
+
 // We append (2) more elements to persisted lists: the size of the list and a
 // checksum of the elements.
 const size_t kChecksumEntryCount = 2;
@@ -45,10 +72,49 @@ MetricsLogSerializer::LogReadStatus MakeRecallStatusHistogram(
   return status;
 }
 
+base::FilePath GetLogStoreDirectory() {
+  base::FilePath user_data_dir;
+  bool result = PathService::Get(chrome::DIR_USER_DATA, &user_data_dir);
+  DCHECK(result);
+  return user_data_dir.Append(kLogStoreDirname);
+}
+
+scoped_refptr<base::SequencedTaskRunner> GetLogStoreTaskRunner() {
+  base::SequencedWorkerPool* pool = BrowserThread::GetBlockingPool();
+  // The logs persisted at shutdown are those of the session ending, so the
+  // writes are let finish.
+  return pool->GetSequencedTaskRunnerWithShutdownBehavior(
+      pool->GetNamedSequenceToken(kLogStoreSequenceName),
+      base::SequencedWorkerPool::BLOCK_SHUTDOWN);
+}
+
+void DeleteLogStoreDirectory(const base::FilePath& directory) {
+  base::DeleteFile(directory, true);
+}
+
 }  // namespace
 
 
-MetricsLogSerializer::MetricsLogSerializer() {}
+MetricsLogSerializer::MetricsLogSerializer()
+    : pending_loads_(2),
+      weak_ptr_factory_(this) {
+  base::FilePath directory = GetLogStoreDirectory();
+  scoped_refptr<base::SequencedTaskRunner> task_runner =
+      GetLogStoreTaskRunner();
+  initial_log_store_ = new MetricsLogStore(
+      directory.Append(kInitialLogStoreDirname), kInitialLogsPersistLimit,
+      kStorageByteLimitPerLogType, kMaxStorageBytesPerLogType, task_runner);
+  ongoing_log_store_ = new MetricsLogStore(
+      directory.Append(kOngoingLogStoreDirname), kOngoingLogsPersistLimit,
+      kStorageByteLimitPerLogType, kMaxStorageBytesPerLogType, task_runner);
+
+  // The logs are asked for once the initial log is ready, so read them ahead.
+  base::Closure loaded_callback =
+      base::Bind(&MetricsLogSerializer::OnLogStoreLoaded,
+                 weak_ptr_factory_.GetWeakPtr());
+  initial_log_store_->StartLoading(loaded_callback);
+  ongoing_log_store_->StartLoading(loaded_callback);
+}
 
 MetricsLogSerializer::~MetricsLogSerializer() {}
 
@@ -57,24 +123,21 @@ void MetricsLogSerializer::SerializeLogs(const std::vector<std::string>& logs,
   PrefService* local_state = g_browser_process->local_state();
   DCHECK(local_state);
   const char* pref = NULL;
-  size_t store_length_limit = 0;
   switch (log_type) {
     case MetricsLogManager::INITIAL_LOG:
       pref = prefs::kMetricsInitialLogs;
-      store_length_limit = kInitialLogsPersistLimit;
       break;
     case MetricsLogManager::ONGOING_LOG:
       pref = prefs::kMetricsOngoingLogs;
-      store_length_limit = kOngoingLogsPersistLimit;
       break;
     case MetricsLogManager::NO_LOG:
       NOTREACHED();
       return;
   };
 
-  ListPrefUpdate update(local_state, pref);
-  WriteLogsToPrefList(logs, store_length_limit, kStorageByteLimitPerLogType,
-                      update.Get());
+  GetLogStore(log_type)->StoreLogs(logs);
+  // Any logs recalled from the prefs are among |logs|, and now in the store.
+  local_state->ClearPref(pref);
 }
 
 void MetricsLogSerializer::DeserializeLogs(MetricsLogManager::LogType log_type,
@@ -89,8 +152,44 @@ void MetricsLogSerializer::DeserializeLogs(MetricsLogManager::LogType log_type,
   else
     pref = prefs::kMetricsOngoingLogs;
 
+  // Logs left in the prefs by an earlier version are older than any stored.
   const ListValue* unsent_logs = local_state->GetList(pref);
   ReadLogsFromPrefList(*unsent_logs, logs);
+  GetLogStore(log_type)->TakeLoadedLogs(logs);
+}
+
+void MetricsLogSerializer::WaitForPersistedLogs(
+    const base::Closure& callback) {
+  DCHECK(loaded_callback_.is_null());
+  if (pending_loads_ == 0) {
+    callback.Run();
+    return;
+  }
+  loaded_callback_ = callback;
+}
+
+// static
+void MetricsLogSerializer::DiscardPersistedLogs() {
+  GetLogStoreTaskRunner()->PostTask(
+      FROM_HERE,
+      base::Bind(&DeleteLogStoreDirectory, GetLogStoreDirectory()));
+}
+
+MetricsLogStore* MetricsLogSerializer::GetLogStore(
+    MetricsLogManager::LogType log_type) {
+  DCHECK_NE(MetricsLogManager::NO_LOG, log_type);
+  if (log_type == MetricsLogManager::INITIAL_LOG)
+    return initial_log_store_.get();
+  return ongoing_log_store_.get();
+}
+
+void MetricsLogSerializer::OnLogStoreLoaded() {
+  DCHECK_GT(pending_loads_, 0);
+  if (--pending_loads_ > 0 || loaded_callback_.is_null())
+    return;
+  base::Closure callback = loaded_callback_;
+  loaded_callback_.Reset();
+  callback.Run();
 }
 
 // static
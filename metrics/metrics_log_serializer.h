@@ -6,14 +6,22 @@
 #define CHROME_BROWSER_METRICS_METRICS_LOG_SERIALIZER_H_
 
 #include "base/basictypes.h"
+#include "base/callback.h"
 #include "base/gtest_prod_util.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/weak_ptr.h"
 #include "chrome/common/metrics/metrics_log_manager.h"
 
+class MetricsLogStore;
+
 namespace base {
 class ListValue;
 }
 
-// Serializer for persisting metrics logs to prefs.
+// Serializer for persisting metrics logs. The logs are kept compressed in a
+// MetricsLogStore of each log type, in the user data directory. Earlier
+// versions kept them in Local State prefs; logs found there are read back
+// once, and the prefs cleared on the next write.
 class MetricsLogSerializer : public MetricsLogManager::LogSerializer {
  public:
   // Used to produce a histogram that keeps track of the status of recalling
@@ -43,12 +51,28 @@ class MetricsLogSerializer : public MetricsLogManager::LogSerializer {
   virtual void DeserializeLogs(MetricsLogManager::LogType log_type,
                                std::vector<std::string>* logs) OVERRIDE;
 
+  // Runs |callback| once the logs persisted by earlier sessions have been
+  // read, or right away if they have. DeserializeLogs() must not be called
+  // before then.
+  void WaitForPersistedLogs(const base::Closure& callback);
+
+  // Deletes the logs persisted by earlier sessions, before any serializer
+  // created afterwards reads them.
+  static void DiscardPersistedLogs();
+
  private:
+  MetricsLogStore* GetLogStore(MetricsLogManager::LogType log_type);
+
+  // Called as each log store is done reading its logs.
+  void OnLogStoreLoaded();
+
   // Encodes the textual log data from |local_list| and writes it to the given
   // pref list, along with list size and checksum.  Logs will be stored starting
   // with the most recent, and working backward until at least
   // |list_length_limit| logs and |byte_limit| bytes of logs have been
-  // stored. At least one of those two arguments must be non-zero.
+  // stored. At least one of those two arguments must be non-zero. Only used by
+  // tests now, which check that the lists written by earlier versions are
+  // recalled.
   static void WriteLogsToPrefList(const std::vector<std::string>& local_list,
                                   size_t list_length_limit,
                                   size_t byte_limit,
@@ -71,6 +95,16 @@ class MetricsLogSerializer : public MetricsLogManager::LogSerializer {
   FRIEND_TEST_ALL_PREFIXES(MetricsLogSerializerTest, CorruptSizeOfLogList);
   FRIEND_TEST_ALL_PREFIXES(MetricsLogSerializerTest, CorruptChecksumOfLogList);
 
+  scoped_refptr<MetricsLogStore> initial_log_store_;
+  scoped_refptr<MetricsLogStore> ongoing_log_store_;
+
+  // The number of log stores still reading their logs, and the callback to run
+  // once none is.
+  int pending_loads_;
+  base::Closure loaded_callback_;
+
+  base::WeakPtrFactory<MetricsLogSerializer> weak_ptr_factory_;
+
   DISALLOW_COPY_AND_ASSIGN(MetricsLogSerializer);
 };
 
@@ -0,0 +1,299 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/metrics/metrics_log_store.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+
+#include "base/bind.h"
+#include "base/file_util.h"
+#include "base/files/file_enumerator.h"
+#include "base/files/important_file_writer.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/md5.h"
+#include "base/metrics/histogram.h"
+#include "base/pickle.h"
+#include "base/sequenced_task_runner.h"
+#include "base/strings/string_number_conversions.h"
+#include "chrome/browser/metrics/compression_utils.h"
+
+namespace {
+
+const base::FilePath::CharType kIndexFileName[] = FILE_PATH_LITERAL("Index");
+const base::FilePath::CharType kLogFilePattern[] = FILE_PATH_LITERAL("*.gz");
+
+// Bumped when the format of the index changes. An index of another version
+// is ignored, and the logs it lists are deleted.
+const int kIndexVersion = 1;
+
+// Logs are handed to the compressor, and its output written out, in chunks of
+// this many bytes.
+const size_t kCompressionChunkSize = 64 * 1024;
+
+void RecordReadStatus(MetricsLogStore::ReadStatus status) {
+  UMA_HISTOGRAM_ENUMERATION("UMA.PersistentLogStoreRead", status,
+                            MetricsLogStore::END_READ_STATUS);
+}
+
+// Writes out and clears the compressor's |output|, accounting for it in the
+// file's |size| and |context|.
+bool FlushOutput(FILE* file,
+                 std::string* output,
+                 base::MD5Context* context,
+                 uint64* size) {
+  if (output->empty())
+    return true;
+  if (fwrite(output->data(), 1, output->size(), file) != output->size())
+    return false;
+  base::MD5Update(context, *output);
+  *size += output->size();
+  output->clear();
+  return true;
+}
+
+}  // namespace
+
+MetricsLogStore::Entry::Entry()
+    : id(0),
+      file_size(0) {
+}
+
+MetricsLogStore::MetricsLogStore(
+    const base::FilePath& directory,
+    size_t count_limit,
+    size_t min_bytes,
+    size_t max_bytes,
+    const scoped_refptr<base::SequencedTaskRunner>& task_runner)
+    : directory_(directory),
+      count_limit_(count_limit),
+      min_bytes_(min_bytes),
+      max_bytes_(max_bytes),
+      task_runner_(task_runner),
+      index_read_(false),
+      next_id_(0),
+      loading_started_(false),
+      loaded_(false) {
+  DCHECK(count_limit_ > 0 || min_bytes_ > 0);
+  DCHECK_LE(min_bytes_, max_bytes_);
+}
+
+void MetricsLogStore::StartLoading(const base::Closure& loaded_callback) {
+  DCHECK(!loading_started_);
+  loading_started_ = true;
+  task_runner_->PostTaskAndReply(
+      FROM_HERE,
+      base::Bind(&MetricsLogStore::LoadLogsOnTaskRunner, this),
+      base::Bind(&MetricsLogStore::OnLogsLoaded, this, loaded_callback));
+}
+
+void MetricsLogStore::TakeLoadedLogs(std::vector<std::string>* logs) {
+  DCHECK(loaded_);
+  logs->insert(logs->end(), loaded_logs_.begin(), loaded_logs_.end());
+  loaded_logs_.clear();
+}
+
+void MetricsLogStore::StoreLogs(const std::vector<std::string>& logs) {
+  task_runner_->PostTask(
+      FROM_HERE, base::Bind(&MetricsLogStore::WriteLogs, this, logs));
+}
+
+MetricsLogStore::~MetricsLogStore() {
+}
+
+void MetricsLogStore::LoadLogs(std::vector<std::string>* logs) {
+  DCHECK(task_runner_->RunsTasksOnCurrentThread());
+  ReadIndex();
+
+  std::vector<Entry> entries;
+  std::string data;
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    const Entry& entry = entries_[i];
+    if (!file_util::ReadFileToString(GetLogFilePath(entry.id), &data)) {
+      RecordReadStatus(LOG_FILE_MISSING);
+      continue;
+    }
+    if (data.size() != entry.file_size ||
+        base::MD5String(data) != entry.file_hash) {
+      RecordReadStatus(CHECKSUM_CORRUPTION);
+      continue;
+    }
+    logs->push_back(std::string());
+    if (!chrome::GzipUncompress(data, &logs->back())) {
+      logs->pop_back();
+      RecordReadStatus(DECODE_FAIL);
+      continue;
+    }
+    RecordReadStatus(READ_SUCCESS);
+    entries.push_back(entry);
+  }
+  // The files of the logs which could not be read go on the next write.
+  entries_.swap(entries);
+}
+
+void MetricsLogStore::LoadLogsOnTaskRunner() {
+  LoadLogs(&loaded_logs_);
+}
+
+void MetricsLogStore::OnLogsLoaded(const base::Closure& loaded_callback) {
+  loaded_ = true;
+  loaded_callback.Run();
+}
+
+void MetricsLogStore::WriteLogs(const std::vector<std::string>& logs) {
+  DCHECK(task_runner_->RunsTasksOnCurrentThread());
+  ReadIndex();
+  if (!logs.empty() && !file_util::CreateDirectory(directory_))
+    return;
+
+  std::map<std::string, Entry> stored_entries;
+  for (size_t i = 0; i < entries_.size(); ++i)
+    stored_entries[entries_[i].log_hash] = entries_[i];
+
+  // Keep the most recent logs up to the count limit, and at least to the
+  // minimum number of bytes, but never past the maximum.
+  std::vector<Entry> entries;
+  size_t bytes_used = 0;
+  for (std::vector<std::string>::const_reverse_iterator it = logs.rbegin();
+       it != logs.rend(); ++it) {
+    if (bytes_used >= min_bytes_ && entries.size() >= count_limit_)
+      break;
+
+    std::string log_hash = base::MD5String(*it);
+    std::map<std::string, Entry>::const_iterator stored =
+        stored_entries.find(log_hash);
+    Entry entry;
+    if (stored != stored_entries.end()) {
+      entry = stored->second;
+    } else {
+      entry.log_hash = log_hash;
+      if (!WriteLogFile(*it, &entry))
+        continue;
+      stored_entries[log_hash] = entry;
+    }
+    if (bytes_used + entry.file_size > max_bytes_)
+      break;
+    bytes_used += entry.file_size;
+    entries.push_back(entry);
+  }
+  std::reverse(entries.begin(), entries.end());
+  entries_.swap(entries);
+
+  // The index is replaced before the files it no longer lists are deleted, so
+  // that it never lists a deleted file.
+  if (WriteIndex())
+    DeleteUnlistedFiles();
+}
+
+void MetricsLogStore::ReadIndex() {
+  if (index_read_)
+    return;
+  index_read_ = true;
+
+  std::string data;
+  if (!file_util::ReadFileToString(directory_.Append(kIndexFileName), &data)) {
+    RecordReadStatus(INDEX_MISSING);
+    return;
+  }
+
+  Pickle pickle(data.data(), static_cast<int>(data.size()));
+  PickleIterator iter(pickle);
+  int version;
+  int64 next_id;
+  uint32 count;
+  if (!iter.ReadInt(&version) || version != kIndexVersion ||
+      !iter.ReadInt64(&next_id) || !iter.ReadUInt32(&count)) {
+    RecordReadStatus(INDEX_CORRUPTION);
+    return;
+  }
+  std::vector<Entry> entries;
+  for (uint32 i = 0; i < count; ++i) {
+    Entry entry;
+    if (!iter.ReadInt64(&entry.id) ||
+        !iter.ReadString(&entry.log_hash) ||
+        !iter.ReadUInt64(&entry.file_size) ||
+        !iter.ReadString(&entry.file_hash) ||
+        entry.id >= next_id) {
+      RecordReadStatus(INDEX_CORRUPTION);
+      return;
+    }
+    entries.push_back(entry);
+  }
+  entries_.swap(entries);
+  next_id_ = next_id;
+}
+
+bool MetricsLogStore::WriteIndex() {
+  Pickle pickle;
+  pickle.WriteInt(kIndexVersion);
+  pickle.WriteInt64(next_id_);
+  pickle.WriteUInt32(static_cast<uint32>(entries_.size()));
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    pickle.WriteInt64(entries_[i].id);
+    pickle.WriteString(entries_[i].log_hash);
+    pickle.WriteUInt64(entries_[i].file_size);
+    pickle.WriteString(entries_[i].file_hash);
+  }
+  return base::ImportantFileWriter::WriteFileAtomically(
+      directory_.Append(kIndexFileName),
+      std::string(static_cast<const char*>(pickle.data()), pickle.size()));
+}
+
+bool MetricsLogStore::WriteLogFile(const std::string& log, Entry* entry) {
+  entry->id = next_id_++;
+  base::FilePath path = GetLogFilePath(entry->id);
+  FILE* file = file_util::OpenFile(path, "wb");
+  if (!file)
+    return false;
+
+  // The log is compressed and written out a chunk at a time, so that neither
+  // a second copy of it nor its whole compressed form is held in memory.
+  chrome::GzipCompressor compressor;
+  base::MD5Context context;
+  base::MD5Init(&context);
+  entry->file_size = 0;
+  std::string output;
+  bool success = true;
+  for (size_t offset = 0; success && offset < log.size();
+       offset += kCompressionChunkSize) {
+    success = compressor.Write(
+        log.data() + offset,
+        std::min(kCompressionChunkSize, log.size() - offset),
+        &output) &&
+        FlushOutput(file, &output, &context, &entry->file_size);
+  }
+  success = success && compressor.Finish(&output) &&
+      FlushOutput(file, &output, &context, &entry->file_size);
+  success = file_util::CloseFile(file) && success;
+  if (!success) {
+    base::DeleteFile(path, false);
+    return false;
+  }
+
+  base::MD5Digest digest;
+  base::MD5Final(&digest, &context);
+  entry->file_hash = base::MD5DigestToBase16(digest);
+  return true;
+}
+
+base::FilePath MetricsLogStore::GetLogFilePath(int64 id) const {
+  return directory_.AppendASCII(base::Int64ToString(id) + ".gz");
+}
+
+void MetricsLogStore::DeleteUnlistedFiles() {
+  std::set<base::FilePath> listed_files;
+  for (size_t i = 0; i < entries_.size(); ++i)
+    listed_files.insert(GetLogFilePath(entries_[i].id));
+
+  base::FileEnumerator files(directory_, false, base::FileEnumerator::FILES,
+                             kLogFilePattern);
+  for (base::FilePath path = files.Next(); !path.empty(); path = files.Next()) {
+    if (listed_files.find(path) == listed_files.end())
+      base::DeleteFile(path, false);
+  }
+}
@@ -0,0 +1,127 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_METRICS_METRICS_LOG_STORE_H_
+#define CHROME_BROWSER_METRICS_METRICS_LOG_STORE_H_
+
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/callback_forward.h"
+#include "base/files/file_path.h"
+#include "base/gtest_prod_util.h"
+#include "base/memory/ref_counted.h"
+
+namespace base {
+class SequencedTaskRunner;
+}
+
+// Persists the unsent metrics logs of one type in a directory of their own,
+// one gzip-compressed file per log, along with an index listing the logs
+// oldest first. Logs are compressed in chunks as they are written out, and a
+// log which is already on disk is not written again, so persisting the unsent
+// logs repeatedly only costs the new ones. All file access happens on the
+// task runner.
+class MetricsLogStore : public base::RefCountedThreadSafe<MetricsLogStore> {
+ public:
+  // Used to produce a histogram that keeps track of the status of reading
+  // the stored logs.
+  enum ReadStatus {
+    READ_SUCCESS,         // A stored log was read back.
+    INDEX_MISSING,        // There is no index, so nothing was stored.
+    INDEX_CORRUPTION,     // The index could not be parsed.
+    LOG_FILE_MISSING,     // A log listed in the index could not be read.
+    CHECKSUM_CORRUPTION,  // A log file does not match the index.
+    DECODE_FAIL,          // A log file could not be uncompressed.
+    END_READ_STATUS       // Number of bins to use to create the histogram.
+  };
+
+  // The newest logs are kept, up to |count_limit| logs, or more if they take
+  // less than |min_bytes| on disk. The logs kept never take more than
+  // |max_bytes| on disk.
+  MetricsLogStore(const base::FilePath& directory,
+                  size_t count_limit,
+                  size_t min_bytes,
+                  size_t max_bytes,
+                  const scoped_refptr<base::SequencedTaskRunner>& task_runner);
+
+  // Starts reading the stored logs on the task runner, and runs
+  // |loaded_callback| on the calling thread once they are read.
+  void StartLoading(const base::Closure& loaded_callback);
+
+  // Appends the logs read by StartLoading() to |logs|, oldest first. Must not
+  // be called before the loaded callback has run.
+  void TakeLoadedLogs(std::vector<std::string>* logs);
+
+  // Replaces the stored logs with the newest of |logs|, which are oldest
+  // first, on the task runner.
+  void StoreLogs(const std::vector<std::string>& logs);
+
+ private:
+  friend class base::RefCountedThreadSafe<MetricsLogStore>;
+  FRIEND_TEST_ALL_PREFIXES(MetricsLogStoreTest, StoreAndLoad);
+  FRIEND_TEST_ALL_PREFIXES(MetricsLogStoreTest, CountLimit);
+  FRIEND_TEST_ALL_PREFIXES(MetricsLogStoreTest, ByteLimits);
+  FRIEND_TEST_ALL_PREFIXES(MetricsLogStoreTest, StoredLogsAreNotRewritten);
+  FRIEND_TEST_ALL_PREFIXES(MetricsLogStoreTest, CorruptLogFile);
+  FRIEND_TEST_ALL_PREFIXES(MetricsLogStoreTest, CorruptIndex);
+
+  // A log listed in the index.
+  struct Entry {
+    Entry();
+
+    // Names the file, which is "<id>.gz".
+    int64 id;
+    // The MD5 of the uncompressed log, by which stored logs are recognized.
+    std::string log_hash;
+    // The size and the MD5 of the file.
+    uint64 file_size;
+    std::string file_hash;
+  };
+
+  ~MetricsLogStore();
+
+  // Reads the stored logs into |logs|, oldest first, dropping those which
+  // cannot be read. Runs on the task runner.
+  void LoadLogs(std::vector<std::string>* logs);
+
+  // Does the work of StartLoading() and StoreLogs() on the task runner.
+  void LoadLogsOnTaskRunner();
+  void WriteLogs(const std::vector<std::string>& logs);
+
+  // Runs on the thread that called StartLoading() once the logs are read.
+  void OnLogsLoaded(const base::Closure& loaded_callback);
+
+  // Reads the index into |entries_|, once.
+  void ReadIndex();
+  bool WriteIndex();
+
+  // Compresses |log| into a new file, describing it in |entry|.
+  bool WriteLogFile(const std::string& log, Entry* entry);
+  base::FilePath GetLogFilePath(int64 id) const;
+
+  // Deletes the files which are not in the index.
+  void DeleteUnlistedFiles();
+
+  const base::FilePath directory_;
+  const size_t count_limit_;
+  const size_t min_bytes_;
+  const size_t max_bytes_;
+  scoped_refptr<base::SequencedTaskRunner> task_runner_;
+
+  // Only touched on the task runner.
+  bool index_read_;
+  std::vector<Entry> entries_;
+  int64 next_id_;
+
+  // The logs read by StartLoading(), handed over once |loaded_| is set.
+  std::vector<std::string> loaded_logs_;
+  bool loading_started_;
+  bool loaded_;
+
+  DISALLOW_COPY_AND_ASSIGN(MetricsLogStore);
+};
+
+#endif  // CHROME_BROWSER_METRICS_METRICS_LOG_STORE_H_
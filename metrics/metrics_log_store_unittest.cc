@@ -0,0 +1,182 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/metrics/metrics_log_store.h"
+
+#include <string>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/bind_helpers.h"
+#include "base/file_util.h"
+#include "base/files/file_enumerator.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/message_loop/message_loop.h"
+#include "base/message_loop/message_loop_proxy.h"
+#include "base/rand_util.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace {
+
+// Random logs barely compress, so each takes a little over its size on disk.
+const size_t kLogSize = 1000;
+
+std::vector<std::string> MakeLogs(size_t count) {
+  std::vector<std::string> logs;
+  for (size_t i = 0; i < count; ++i)
+    logs.push_back(base::RandBytesAsString(kLogSize));
+  return logs;
+}
+
+}  // namespace
+
+class MetricsLogStoreTest : public testing::Test {
+ protected:
+  virtual void SetUp() OVERRIDE {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+  }
+
+  scoped_refptr<MetricsLogStore> CreateStore(size_t count_limit,
+                                             size_t min_bytes,
+                                             size_t max_bytes) {
+    return new MetricsLogStore(temp_dir_.path(), count_limit, min_bytes,
+                               max_bytes, base::MessageLoopProxy::current());
+  }
+
+  // Reads back what |CreateStore()| stores find on disk.
+  std::vector<std::string> LoadLogs() {
+    scoped_refptr<MetricsLogStore> store = CreateStore(100, 0, 1000000);
+    std::vector<std::string> logs;
+    store->LoadLogs(&logs);
+    return logs;
+  }
+
+  int CountLogFiles() {
+    base::FileEnumerator files(temp_dir_.path(), false,
+                               base::FileEnumerator::FILES,
+                               FILE_PATH_LITERAL("*.gz"));
+    int count = 0;
+    for (base::FilePath path = files.Next(); !path.empty();
+         path = files.Next()) {
+      ++count;
+    }
+    return count;
+  }
+
+  base::MessageLoop message_loop_;
+  base::ScopedTempDir temp_dir_;
+};
+
+TEST_F(MetricsLogStoreTest, StoreAndLoad) {
+  std::vector<std::string> logs = MakeLogs(2);
+  // Larger than a compression chunk, and compressible.
+  logs.push_back(std::string(200 * 1000, 'x'));
+
+  scoped_refptr<MetricsLogStore> store = CreateStore(10, 0, 1000000);
+  store->StoreLogs(logs);
+  message_loop_.RunUntilIdle();
+  EXPECT_EQ(3, CountLogFiles());
+
+  store = CreateStore(10, 0, 1000000);
+  store->StartLoading(base::Bind(&base::DoNothing));
+  message_loop_.RunUntilIdle();
+  std::vector<std::string> loaded_logs;
+  store->TakeLoadedLogs(&loaded_logs);
+  EXPECT_TRUE(logs == loaded_logs);
+
+  // Storing nothing deletes the files.
+  store->StoreLogs(std::vector<std::string>());
+  message_loop_.RunUntilIdle();
+  EXPECT_EQ(0, CountLogFiles());
+  EXPECT_TRUE(LoadLogs().empty());
+}
+
+TEST_F(MetricsLogStoreTest, CountLimit) {
+  std::vector<std::string> logs = MakeLogs(3);
+  scoped_refptr<MetricsLogStore> store = CreateStore(2, 0, 1000000);
+  store->WriteLogs(logs);
+
+  std::vector<std::string> loaded_logs = LoadLogs();
+  ASSERT_EQ(2u, loaded_logs.size());
+  EXPECT_EQ(logs[1], loaded_logs[0]);
+  EXPECT_EQ(logs[2], loaded_logs[1]);
+  EXPECT_EQ(2, CountLogFiles());
+}
+
+TEST_F(MetricsLogStoreTest, ByteLimits) {
+  std::vector<std::string> logs = MakeLogs(4);
+
+  // Past the count limit, logs are kept until the minimum bytes are reached.
+  scoped_refptr<MetricsLogStore> store =
+      CreateStore(1, kLogSize * 5 / 2, 1000000);
+  store->WriteLogs(logs);
+  std::vector<std::string> loaded_logs = LoadLogs();
+  ASSERT_EQ(3u, loaded_logs.size());
+  EXPECT_EQ(logs[1], loaded_logs[0]);
+
+  // The maximum bytes are never exceeded.
+  store = CreateStore(4, 0, kLogSize * 5 / 2);
+  store->WriteLogs(logs);
+  loaded_logs = LoadLogs();
+  ASSERT_EQ(2u, loaded_logs.size());
+  EXPECT_EQ(logs[2], loaded_logs[0]);
+  EXPECT_EQ(2, CountLogFiles());
+}
+
+TEST_F(MetricsLogStoreTest, StoredLogsAreNotRewritten) {
+  std::vector<std::string> logs = MakeLogs(2);
+  scoped_refptr<MetricsLogStore> store = CreateStore(10, 0, 1000000);
+  store->WriteLogs(logs);
+  ASSERT_EQ(2u, store->entries_.size());
+  int64 first_id = store->entries_[0].id;
+  int64 second_id = store->entries_[1].id;
+
+  // Only the new log is written.
+  logs.push_back(base::RandBytesAsString(kLogSize));
+  store->WriteLogs(logs);
+  ASSERT_EQ(3u, store->entries_.size());
+  EXPECT_EQ(first_id, store->entries_[0].id);
+  EXPECT_EQ(second_id, store->entries_[1].id);
+  EXPECT_EQ(3, CountLogFiles());
+
+  // A new store picks up from the index.
+  store = CreateStore(10, 0, 1000000);
+  logs.erase(logs.begin());
+  store->WriteLogs(logs);
+  ASSERT_EQ(2u, store->entries_.size());
+  EXPECT_EQ(second_id, store->entries_[0].id);
+  EXPECT_EQ(2, CountLogFiles());
+  EXPECT_TRUE(logs == LoadLogs());
+}
+
+TEST_F(MetricsLogStoreTest, CorruptLogFile) {
+  std::vector<std::string> logs = MakeLogs(2);
+  scoped_refptr<MetricsLogStore> store = CreateStore(10, 0, 1000000);
+  store->WriteLogs(logs);
+  base::FilePath path = store->GetLogFilePath(store->entries_[0].id);
+  std::string junk("junk");
+  ASSERT_EQ(static_cast<int>(junk.size()),
+            file_util::WriteFile(path, junk.data(), junk.size()));
+
+  std::vector<std::string> loaded_logs = LoadLogs();
+  ASSERT_EQ(1u, loaded_logs.size());
+  EXPECT_EQ(logs[1], loaded_logs[0]);
+}
+
+TEST_F(MetricsLogStoreTest, CorruptIndex) {
+  scoped_refptr<MetricsLogStore> store = CreateStore(10, 0, 1000000);
+  store->WriteLogs(MakeLogs(2));
+  std::string junk("junk");
+  ASSERT_EQ(static_cast<int>(junk.size()),
+            file_util::WriteFile(temp_dir_.path().AppendASCII("Index"),
+                                 junk.data(), junk.size()));
+  EXPECT_TRUE(LoadLogs().empty());
+
+  // The files the index no longer lists go on the next write.
+  std::vector<std::string> logs = MakeLogs(1);
+  store = CreateStore(10, 0, 1000000);
+  store->WriteLogs(logs);
+  EXPECT_EQ(1, CountLogFiles());
+  EXPECT_TRUE(logs == LoadLogs());
+}
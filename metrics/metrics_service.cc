@@ -463,6 +463,7 @@ void MetricsService::DiscardOldStabilityStats(PrefService* local_state) {
 
   local_state->ClearPref(prefs::kMetricsInitialLogs);
   local_state->ClearPref(prefs::kMetricsOngoingLogs);
+  MetricsLogSerializer::DiscardPersistedLogs();
 }
 
 MetricsService::MetricsService()
@@ -475,6 +476,7 @@ MetricsService::MetricsService()
       next_window_id_(0),
       self_ptr_factory_(this),
       state_saver_factory_(this),
+      log_serializer_(NULL),
       waiting_for_asynchronous_reporting_step_(false),
       entropy_source_returned_(LAST_ENTROPY_NONE) {
   DCHECK(IsSingleThreaded());
@@ -483,7 +485,8 @@ MetricsService::MetricsService()
   base::Closure callback = base::Bind(&MetricsService::StartScheduledUpload,
                                       self_ptr_factory_.GetWeakPtr());
   scheduler_.reset(new MetricsReportingScheduler(callback));
-  log_manager_.set_log_serializer(new MetricsLogSerializer());
+  log_serializer_ = new MetricsLogSerializer();
+  log_manager_.set_log_serializer(log_serializer_);
   log_manager_.set_max_ongoing_log_store_size(kUploadLogAvoidRetransmitSize);
 
   BrowserChildProcessObserver::Add(this);
@@ -1048,7 +1051,18 @@ void MetricsService::ReceivedProfilerData(
 
 void MetricsService::FinishedReceivingProfilerData() {
   DCHECK_EQ(INIT_TASK_SCHEDULED, state_);
-    state_ = INIT_TASK_DONE;
+
+  // The initial log is sent along with the logs left unsent by earlier
+  // sessions. Those are read in the background, and are normally long read by
+  // now.
+  log_serializer_->WaitForPersistedLogs(
+      base::Bind(&MetricsService::OnInitTaskLoadedPersistedLogs,
+                 self_ptr_factory_.GetWeakPtr()));
+}
+
+void MetricsService::OnInitTaskLoadedPersistedLogs() {
+  DCHECK_EQ(INIT_TASK_SCHEDULED, state_);
+  state_ = INIT_TASK_DONE;
 }
 
 int MetricsService::GetLowEntropySource() {
@@ -32,6 +32,7 @@
 #include "chrome/browser/chromeos/external_metrics.h"
 #endif
 
+class MetricsLogSerializer;
 class MetricsReportingScheduler;
 class PrefService;
 class PrefRegistrySimple;
@@ -257,9 +258,13 @@ class MetricsService
   virtual void ReceivedProfilerData(
       const tracked_objects::ProcessDataSnapshot& process_data,
       int process_type) OVERRIDE;
-  // Callback that moves the state to INIT_TASK_DONE.
+  // Callback that continues the init task by waiting for the logs persisted
+  // by earlier sessions to be read.
   virtual void FinishedReceivingProfilerData() OVERRIDE;
 
+  // Callback that moves the state to INIT_TASK_DONE.
+  void OnInitTaskLoadedPersistedLogs();
+
   // Returns the low entropy source for this client. This is a random value
   // that is non-identifying amongst browser clients. This method will
   // generate the entropy source value if it has not been called before.
@@ -472,6 +477,9 @@ class MetricsService
   // The scheduler for determining when uploads should happen.
   scoped_ptr<MetricsReportingScheduler> scheduler_;
 
+  // Owned by |log_manager_|.
+  MetricsLogSerializer* log_serializer_;
+
   // Indicates that an asynchronous reporting step is running.
   // This is used only for debugging.
   bool waiting_for_asynchronous_reporting_step_;
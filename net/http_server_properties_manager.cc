@@ -5,6 +5,7 @@
 #include "chrome/browser/net/http_server_properties_manager.h"
 
 #include "base/bind.h"
+#include "base/bind_helpers.h"
 #include "base/metrics/histogram.h"
 #include "base/prefs/pref_service.h"
 #include "base/stl_util.h"
@@ -43,6 +44,12 @@ const int kVersionNumber = 2;
 
 typedef std::vector<std::string> StringVector;
 
+template <typename Map>
+void InsertKeys(const Map& map, std::set<net::HostPortPair>* servers) {
+  for (typename Map::const_iterator it = map.begin(); it != map.end(); ++it)
+    servers->insert(it->first);
+}
+
 }  // namespace
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -51,7 +58,10 @@ typedef std::vector<std::string> StringVector;
 HttpServerPropertiesManager::HttpServerPropertiesManager(
     PrefService* pref_service)
     : pref_service_(pref_service),
-      setting_prefs_(false) {
+      setting_prefs_(false),
+      migrating_prefs_(false),
+      store_loaded_(false),
+      cleared_before_store_loaded_(false) {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
   DCHECK(pref_service);
   ui_weak_ptr_factory_.reset(
@@ -66,8 +76,33 @@ HttpServerPropertiesManager::HttpServerPropertiesManager(
                  base::Unretained(this)));
 }
 
+HttpServerPropertiesManager::HttpServerPropertiesManager(
+    PrefService* pref_service,
+    const scoped_refptr<SQLiteHttpServerPropertiesStore>& store)
+    : pref_service_(pref_service),
+      setting_prefs_(false),
+      store_(store),
+      migrating_prefs_(false),
+      store_loaded_(false),
+      cleared_before_store_loaded_(false) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
+  DCHECK(pref_service);
+  DCHECK(store_.get());
+  ui_weak_ptr_factory_.reset(
+      new base::WeakPtrFactory<HttpServerPropertiesManager>(this));
+  ui_weak_ptr_ = ui_weak_ptr_factory_->GetWeakPtr();
+  ui_cache_update_timer_.reset(
+      new base::OneShotTimer<HttpServerPropertiesManager>);
+  // |store_| holds the master data, so later changes to the preferences are
+  // not observed.
+  pref_change_registrar_.Init(pref_service_);
+}
+
 HttpServerPropertiesManager::~HttpServerPropertiesManager() {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  // Hand the last changes to the store, which commits them when it closes.
+  if (store_.get() && http_server_properties_impl_)
+    UpdateStoreFromCacheOnIO(base::Closure());
   io_weak_ptr_factory_.reset();
 }
 
@@ -80,6 +115,13 @@ void HttpServerPropertiesManager::InitializeOnIOThread() {
   io_prefs_update_timer_.reset(
       new base::OneShotTimer<HttpServerPropertiesManager>);
 
+  if (store_.get()) {
+    store_->Load(
+        base::Bind(&HttpServerPropertiesManager::OnStoreLoadedOnIO,
+                   io_weak_ptr_factory_->GetWeakPtr()));
+    return;
+  }
+
   BrowserThread::PostTask(
       BrowserThread::UI,
       FROM_HERE,
@@ -129,6 +171,14 @@ void HttpServerPropertiesManager::Clear(const base::Closure& completion) {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
 
   http_server_properties_impl_->Clear();
+  if (store_.get()) {
+    dirty_servers_.clear();
+    stored_servers_.clear();
+    store_->DeleteAll();
+    // The load may have read the rows already.
+    if (!store_loaded_)
+      cleared_before_store_loaded_ = true;
+  }
   UpdatePrefsFromCacheOnIO(completion);
 }
 
@@ -144,6 +194,7 @@ void HttpServerPropertiesManager::SetSupportsSpdy(
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
 
   http_server_properties_impl_->SetSupportsSpdy(server, support_spdy);
+  MarkServerDirtyOnIO(server);
   ScheduleUpdatePrefsOnIO();
 }
 
@@ -167,6 +218,7 @@ void HttpServerPropertiesManager::SetAlternateProtocol(
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
   http_server_properties_impl_->SetAlternateProtocol(
       server, alternate_port, alternate_protocol);
+  MarkServerDirtyOnIO(server);
   ScheduleUpdatePrefsOnIO();
 }
 
@@ -174,6 +226,7 @@ void HttpServerPropertiesManager::SetBrokenAlternateProtocol(
     const net::HostPortPair& server) {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
   http_server_properties_impl_->SetBrokenAlternateProtocol(server);
+  MarkServerDirtyOnIO(server);
   ScheduleUpdatePrefsOnIO();
 }
 
@@ -198,8 +251,10 @@ bool HttpServerPropertiesManager::SetSpdySetting(
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
   bool persist = http_server_properties_impl_->SetSpdySetting(
       host_port_pair, id, flags, value);
-  if (persist)
+  if (persist) {
+    MarkServerDirtyOnIO(host_port_pair);
     ScheduleUpdatePrefsOnIO();
+  }
   return persist;
 }
 
@@ -207,11 +262,16 @@ void HttpServerPropertiesManager::ClearSpdySettings(
     const net::HostPortPair& host_port_pair) {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
   http_server_properties_impl_->ClearSpdySettings(host_port_pair);
+  MarkServerDirtyOnIO(host_port_pair);
   ScheduleUpdatePrefsOnIO();
 }
 
 void HttpServerPropertiesManager::ClearAllSpdySettings() {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  if (store_.get()) {
+    InsertKeys(http_server_properties_impl_->spdy_settings_map(),
+               &dirty_servers_);
+  }
   http_server_properties_impl_->ClearAllSpdySettings();
   ScheduleUpdatePrefsOnIO();
 }
@@ -234,11 +294,16 @@ void HttpServerPropertiesManager::SetPipelineCapability(
     net::HttpPipelinedHostCapability capability) {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
   http_server_properties_impl_->SetPipelineCapability(origin, capability);
+  MarkServerDirtyOnIO(origin);
   ScheduleUpdatePrefsOnIO();
 }
 
 void HttpServerPropertiesManager::ClearPipelineCapabilities() {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  if (store_.get()) {
+    InsertKeys(http_server_properties_impl_->GetPipelineCapabilityMap(),
+               &dirty_servers_);
+  }
   http_server_properties_impl_->ClearPipelineCapabilities();
   ScheduleUpdatePrefsOnIO();
 }
@@ -435,6 +500,20 @@ void HttpServerPropertiesManager::UpdateCacheFromPrefsOnIO(
   // preferences. Update the cached data with new data from preferences.
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
 
+  // When migrating to |store_|, everything read from the preferences has to be
+  // written out. The maps are consumed below, so collect the servers first.
+  const bool migrated_prefs = store_.get() && migrating_prefs_;
+  if (migrated_prefs) {
+    migrating_prefs_ = false;
+    for (StringVector::const_iterator it = spdy_servers->begin();
+         it != spdy_servers->end(); ++it) {
+      dirty_servers_.insert(net::HostPortPair::FromString(*it));
+    }
+    InsertKeys(*spdy_settings_map, &dirty_servers_);
+    InsertKeys(*alternate_protocol_map, &dirty_servers_);
+    InsertKeys(*pipeline_capability_map, &dirty_servers_);
+  }
+
   UMA_HISTOGRAM_COUNTS("Net.CountOfSpdyServers", spdy_servers->size());
   http_server_properties_impl_->InitializeSpdyServers(spdy_servers, true);
 
@@ -456,8 +535,16 @@ void HttpServerPropertiesManager::UpdateCacheFromPrefsOnIO(
       pipeline_capability_map);
 
   // Update the prefs with what we have read (delete all corrupted prefs).
-  if (detected_corrupted_prefs)
+  if (detected_corrupted_prefs || migrated_prefs)
     ScheduleUpdatePrefsOnIO();
+
+  if (migrated_prefs) {
+    BrowserThread::PostTask(
+        BrowserThread::UI,
+        FROM_HERE,
+        base::Bind(&HttpServerPropertiesManager::ClearPrefsOnUI,
+                   ui_weak_ptr_));
+  }
 }
 
 
@@ -490,6 +577,11 @@ void HttpServerPropertiesManager::UpdatePrefsFromCacheOnIO(
     const base::Closure& completion) {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
 
+  if (store_.get()) {
+    UpdateStoreFromCacheOnIO(completion);
+    return;
+  }
+
   base::ListValue* spdy_server_list = new base::ListValue;
   http_server_properties_impl_->GetSpdyServerList(spdy_server_list);
 
@@ -696,4 +788,151 @@ void HttpServerPropertiesManager::OnHttpServerPropertiesChanged() {
     ScheduleUpdateCacheOnUI();
 }
 
+//
+// SQLiteHttpServerPropertiesStore support.
+//
+void HttpServerPropertiesManager::OnStoreLoadedOnIO(
+    scoped_ptr<SQLiteHttpServerPropertiesStore::ServerPropertiesVector>
+        servers) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  DCHECK(store_.get());
+  store_loaded_ = true;
+
+  if (cleared_before_store_loaded_) {
+    // The rows were read before Clear() deleted them; neither they nor the
+    // preferences may bring the cleared properties back.
+    BrowserThread::PostTask(
+        BrowserThread::UI,
+        FROM_HERE,
+        base::Bind(&HttpServerPropertiesManager::ClearPrefsOnUI,
+                   ui_weak_ptr_));
+    return;
+  }
+
+  if (servers->empty()) {
+    // Nothing stored yet, migrate whatever the preferences hold. This goes
+    // through the same path as a regular load from preferences.
+    migrating_prefs_ = true;
+    BrowserThread::PostTask(
+        BrowserThread::UI,
+        FROM_HERE,
+        base::Bind(&HttpServerPropertiesManager::UpdateCacheFromPrefsOnUI,
+                   ui_weak_ptr_));
+    return;
+  }
+
+  StringVector spdy_servers;
+  net::SpdySettingsMap spdy_settings_map;
+  net::AlternateProtocolMap alternate_protocol_map;
+  net::PipelineCapabilityMap pipeline_capability_map;
+  for (SQLiteHttpServerPropertiesStore::ServerPropertiesVector::const_iterator
+       it = servers->begin(); it != servers->end(); ++it) {
+    stored_servers_.insert(it->server);
+    if (it->supports_spdy)
+      spdy_servers.push_back(it->server.ToString());
+    if (!it->settings.empty())
+      spdy_settings_map[it->server] = it->settings;
+    if (it->has_alternate_protocol)
+      alternate_protocol_map[it->server] = it->alternate_protocol;
+    if (it->pipeline_capability != net::PIPELINE_UNKNOWN)
+      pipeline_capability_map[it->server] = it->pipeline_capability;
+  }
+  UpdateCacheFromPrefsOnIO(&spdy_servers, &spdy_settings_map,
+                           &alternate_protocol_map, &pipeline_capability_map,
+                           false);
+
+  // Drop any stale copy left in the preferences, e.g. by an older version.
+  BrowserThread::PostTask(
+      BrowserThread::UI,
+      FROM_HERE,
+      base::Bind(&HttpServerPropertiesManager::ClearPrefsOnUI, ui_weak_ptr_));
+}
+
+void HttpServerPropertiesManager::MarkServerDirtyOnIO(
+    const net::HostPortPair& server) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  if (store_.get())
+    dirty_servers_.insert(server);
+}
+
+void HttpServerPropertiesManager::GetServerPropertiesOnIO(
+    const net::HostPortPair& server,
+    SQLiteHttpServerPropertiesStore::ServerProperties* properties) const {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  properties->server = server;
+  properties->supports_spdy =
+      http_server_properties_impl_->SupportsSpdy(server);
+  properties->settings = http_server_properties_impl_->GetSpdySettings(server);
+  if (http_server_properties_impl_->HasAlternateProtocol(server)) {
+    properties->alternate_protocol =
+        http_server_properties_impl_->GetAlternateProtocol(server);
+    properties->has_alternate_protocol =
+        net::IsAlternateProtocolValid(properties->alternate_protocol.protocol);
+  }
+  properties->pipeline_capability =
+      http_server_properties_impl_->GetPipelineCapability(server);
+}
+
+void HttpServerPropertiesManager::UpdateStoreFromCacheOnIO(
+    const base::Closure& completion) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  DCHECK(store_.get());
+
+  size_t deleted_servers = 0;
+  for (std::set<net::HostPortPair>::const_iterator it = dirty_servers_.begin();
+       it != dirty_servers_.end(); ++it) {
+    SQLiteHttpServerPropertiesStore::ServerProperties properties;
+    GetServerPropertiesOnIO(*it, &properties);
+    if (properties.IsEmpty()) {
+      if (stored_servers_.erase(*it)) {
+        store_->DeleteServer(*it);
+        ++deleted_servers;
+      }
+    } else {
+      store_->UpdateServer(properties);
+      stored_servers_.insert(*it);
+    }
+  }
+
+  // Servers can also drop out of |http_server_properties_impl_| without being
+  // marked dirty, e.g. when evicted from its bounded pipeline capability
+  // cache. Prune their rows too, so that the store does not grow forever.
+  for (std::set<net::HostPortPair>::iterator it = stored_servers_.begin();
+       it != stored_servers_.end();) {
+    if (dirty_servers_.count(*it)) {
+      ++it;
+      continue;
+    }
+    SQLiteHttpServerPropertiesStore::ServerProperties properties;
+    GetServerPropertiesOnIO(*it, &properties);
+    if (properties.IsEmpty()) {
+      store_->DeleteServer(*it);
+      ++deleted_servers;
+      stored_servers_.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+
+  UMA_HISTOGRAM_COUNTS("Net.HttpServerProperties.DirtyServerCount",
+                       dirty_servers_.size());
+  UMA_HISTOGRAM_COUNTS("Net.HttpServerProperties.DeletedServerCount",
+                       deleted_servers);
+  dirty_servers_.clear();
+
+  if (!completion.is_null()) {
+    store_->Flush(base::Bind(base::IgnoreResult(&BrowserThread::PostTask),
+                             BrowserThread::UI, FROM_HERE, completion));
+  }
+}
+
+void HttpServerPropertiesManager::ClearPrefsOnUI() {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
+  if (!pref_service_->HasPrefPath(prefs::kHttpServerProperties))
+    return;
+  setting_prefs_ = true;
+  pref_service_->ClearPref(prefs::kHttpServerProperties);
+  setting_prefs_ = false;
+}
+
 }  // namespace chrome_browser_net
@@ -5,6 +5,7 @@
 #ifndef CHROME_BROWSER_NET_HTTP_SERVER_PROPERTIES_MANAGER_H_
 #define CHROME_BROWSER_NET_HTTP_SERVER_PROPERTIES_MANAGER_H_
 
+#include <set>
 #include <string>
 #include <vector>
 #include "base/basictypes.h"
@@ -14,6 +15,7 @@
 #include "base/prefs/pref_change_registrar.h"
 #include "base/timer/timer.h"
 #include "base/values.h"
+#include "chrome/browser/net/sqlite_http_server_properties_store.h"
 #include "net/base/host_port_pair.h"
 #include "net/http/http_pipelined_host_capability.h"
 #include "net/http/http_server_properties.h"
@@ -49,6 +51,12 @@ namespace chrome_browser_net {
 // exists in UI, then a potential destruction on IO will come after any task
 // posted to IO from that method on UI. This is used to go through IO before
 // the actual update starts, and grab a WeakPtr.
+//
+// When constructed with a SQLiteHttpServerPropertiesStore, the properties are
+// persisted there instead of in prefs::kHttpServerProperties: only the servers
+// that changed are written, and the data is loaded from the store straight to
+// the IO thread. Existing preferences are migrated to the store and cleared
+// the first time it is used.
 class HttpServerPropertiesManager
     : public net::HttpServerProperties {
  public:
@@ -56,6 +64,11 @@ class HttpServerPropertiesManager
   // PrefService objects must be longer than that of the
   // HttpServerPropertiesManager object. Must be constructed on the UI thread.
   explicit HttpServerPropertiesManager(PrefService* pref_service);
+
+  // As above, but persists the properties in |store|.
+  HttpServerPropertiesManager(
+      PrefService* pref_service,
+      const scoped_refptr<SQLiteHttpServerPropertiesStore>& store);
   virtual ~HttpServerPropertiesManager();
 
   // Initialize |http_server_properties_impl_| and |io_method_factory_| on IO
@@ -209,6 +222,31 @@ class HttpServerPropertiesManager
  private:
   void OnHttpServerPropertiesChanged();
 
+  // ------------------------------------------
+  // SQLiteHttpServerPropertiesStore, IO thread
+
+  // Called with the contents of |store_| once it is loaded.
+  void OnStoreLoadedOnIO(
+      scoped_ptr<SQLiteHttpServerPropertiesStore::ServerPropertiesVector>
+          servers);
+
+  // Remembers that the properties of |server| need to be written to |store_|.
+  // Does nothing when persisting to preferences.
+  void MarkServerDirtyOnIO(const net::HostPortPair& server);
+
+  // Fills |properties| with what |http_server_properties_impl_| holds for
+  // |server|.
+  void GetServerPropertiesOnIO(
+      const net::HostPortPair& server,
+      SQLiteHttpServerPropertiesStore::ServerProperties* properties) const;
+
+  // Writes the properties of the servers in |dirty_servers_| to |store_|, and
+  // deletes the rows of servers that no longer have any properties.
+  void UpdateStoreFromCacheOnIO(const base::Closure& completion);
+
+  // Clears prefs::kHttpServerProperties once it has been migrated to |store_|.
+  void ClearPrefsOnUI();
+
   // ---------
   // UI thread
   // ---------
@@ -242,6 +280,24 @@ class HttpServerPropertiesManager
 
   scoped_ptr<net::HttpServerPropertiesImpl> http_server_properties_impl_;
 
+  // NULL when persisting to preferences.
+  scoped_refptr<SQLiteHttpServerPropertiesStore> store_;
+
+  // Servers changed since the last write to |store_|.
+  std::set<net::HostPortPair> dirty_servers_;
+
+  // Servers that have a row in |store_|, or will once the pending updates are
+  // committed.
+  std::set<net::HostPortPair> stored_servers_;
+
+  // True while the preferences are being loaded to be migrated to |store_|.
+  bool migrating_prefs_;
+
+  // Set once |store_| has been loaded, and if Clear() is called before that,
+  // in which case what was loaded is stale.
+  bool store_loaded_;
+  bool cleared_before_store_loaded_;
+
   DISALLOW_COPY_AND_ASSIGN(HttpServerPropertiesManager);
 };
 
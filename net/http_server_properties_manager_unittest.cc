@@ -5,10 +5,13 @@
 #include "chrome/browser/net/http_server_properties_manager.h"
 
 #include "base/basictypes.h"
+#include "base/files/scoped_temp_dir.h"
 #include "base/message_loop/message_loop.h"
+#include "base/message_loop/message_loop_proxy.h"
 #include "base/prefs/pref_registry_simple.h"
 #include "base/prefs/testing_pref_service.h"
 #include "base/values.h"
+#include "chrome/browser/net/sqlite_http_server_properties_store.h"
 #include "chrome/common/pref_names.h"
 #include "content/public/test/test_browser_thread.h"
 #include "testing/gmock/include/gmock/gmock.h"
@@ -532,6 +535,74 @@ TEST_F(HttpServerPropertiesManagerTest, ShutdownWithPendingUpdatePrefs2) {
   loop_.RunUntilIdle();
 }
 
+// Tests that clearing the properties while the store is still loading does not
+// bring back what the load read.
+TEST(HttpServerPropertiesManagerStoreTest, ClearBeforeStoreLoaded) {
+  base::MessageLoop loop;
+  content::TestBrowserThread ui_thread(BrowserThread::UI, &loop);
+  content::TestBrowserThread io_thread(BrowserThread::IO, &loop);
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  base::FilePath store_path =
+      temp_dir.path().Append(FILE_PATH_LITERAL("Network Properties"));
+  TestingPrefServiceSimple pref_service;
+  pref_service.registry()->RegisterDictionaryPref(
+      prefs::kHttpServerProperties);
+
+  net::HostPortPair spdy_server_mail("mail.google.com", 443);
+  {
+    HttpServerPropertiesManager manager(
+        &pref_service,
+        new SQLiteHttpServerPropertiesStore(store_path,
+                                            base::MessageLoopProxy::current()));
+    manager.InitializeOnIOThread();
+    loop.RunUntilIdle();
+    manager.SetSupportsSpdy(spdy_server_mail, true);
+    manager.ShutdownOnUIThread();
+  }
+  loop.RunUntilIdle();
+
+  {
+    // Loaded as usual.
+    HttpServerPropertiesManager manager(
+        &pref_service,
+        new SQLiteHttpServerPropertiesStore(store_path,
+                                            base::MessageLoopProxy::current()));
+    manager.InitializeOnIOThread();
+    loop.RunUntilIdle();
+    EXPECT_TRUE(manager.SupportsSpdy(spdy_server_mail));
+    manager.ShutdownOnUIThread();
+  }
+  loop.RunUntilIdle();
+
+  {
+    // Cleared before the load is in.
+    HttpServerPropertiesManager manager(
+        &pref_service,
+        new SQLiteHttpServerPropertiesStore(store_path,
+                                            base::MessageLoopProxy::current()));
+    manager.InitializeOnIOThread();
+    manager.Clear();
+    loop.RunUntilIdle();
+    EXPECT_FALSE(manager.SupportsSpdy(spdy_server_mail));
+    manager.ShutdownOnUIThread();
+  }
+  loop.RunUntilIdle();
+
+  {
+    // And the rows are gone for good.
+    HttpServerPropertiesManager manager(
+        &pref_service,
+        new SQLiteHttpServerPropertiesStore(store_path,
+                                            base::MessageLoopProxy::current()));
+    manager.InitializeOnIOThread();
+    loop.RunUntilIdle();
+    EXPECT_FALSE(manager.SupportsSpdy(spdy_server_mail));
+    manager.ShutdownOnUIThread();
+  }
+  loop.RunUntilIdle();
+}
+
 }  // namespace
 
 }  // namespace chrome_browser_net
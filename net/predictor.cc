@@ -15,6 +15,7 @@
 #include "base/compiler_specific.h"
 #include "base/containers/mru_cache.h"
 #include "base/metrics/histogram.h"
+#include "base/pickle.h"
 #include "base/prefs/pref_service.h"
 #include "base/stl_util.h"
 #include "base/strings/string_split.h"
@@ -65,6 +66,8 @@ const double Predictor::kReferrerTrimRatio = 0.97153;
 const int64 Predictor::kDurationBetweenTrimmingsHours = 1;
 const int64 Predictor::kDurationBetweenTrimmingIncrementsSeconds = 15;
 const size_t Predictor::kUrlsTrimmedPerIncrement = 5u;
+const int64 Predictor::kStoreCommitDelaySeconds = 30;
+const size_t Predictor::kMaxReferrers = 2000;
 const size_t Predictor::kMaxSpeculativeParallelResolves = 3;
 const int Predictor::kMaxUnusedSocketLifetimeSecondsWithoutAGet = 10;
 // To control our congestion avoidance system, which discards a queue when
@@ -271,7 +274,10 @@ Predictor::Predictor(bool preconnect_enabled)
       preconnect_enabled_(preconnect_enabled),
       consecutive_omnibox_preconnect_count_(0),
       next_trim_time_(base::TimeTicks::Now() +
-                      TimeDelta::FromHours(kDurationBetweenTrimmingsHours)) {
+                      TimeDelta::FromHours(kDurationBetweenTrimmingsHours)),
+      startup_urls_dirty_(false),
+      store_loaded_(false),
+      discard_loaded_store_(false) {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
 }
 
@@ -299,6 +305,11 @@ void Predictor::RegisterProfilePrefs(
 
 // --------------------- Start UI methods. ------------------------------------
 
+void Predictor::SetStore(const scoped_refptr<PredictorStore>& store) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
+  store_ = store;
+}
+
 void Predictor::InitNetworkPredictor(PrefService* user_prefs,
                                      PrefService* local_state,
                                      IOThread* io_thread,
@@ -506,13 +517,20 @@ void Predictor::Shutdown() {
   shutdown_ = true;
 
   STLDeleteElements(&pending_lookups_);
+  store_commit_timer_.Stop();
 }
 
 void Predictor::DiscardAllResults() {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
   // Delete anything listed so far in this session that shows in about:dns.
   referrers_.clear();
-
+  if (store_.get()) {
+    dirty_referrers_.clear();
+    if (!store_loaded_)
+      discard_loaded_store_ = true;
+    store_->DeleteAll();
+    store_->Commit();
+  }
 
   // Try to delete anything in our work queue.
   while (!work_queue_.IsEmpty()) {
@@ -578,10 +596,24 @@ void Predictor::LearnFromNavigation(const GURL& referring_url,
   DCHECK_NE(target_url, GURL::EmptyGURL());
 
   referrers_[referring_url].SuggestHost(target_url);
+  MarkReferrerDirty(referring_url);
+  EvictReferrersIfNeeded();
   // Possibly do some referrer trimming.
   TrimReferrers();
 }
 
+void Predictor::GetPredictedSubresources(
+    const GURL& url,
+    PredictedSubresources* predictions) const {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  Referrers::const_iterator it = referrers_.find(url);
+  if (it == referrers_.end()) {
+    predictions->clear();
+    return;
+  }
+  it->second.GetPredictions(predictions);
+}
+
 //-----------------------------------------------------------------------------
 // This section supports the about:dns page.
 
@@ -645,6 +677,8 @@ void Predictor::GetHtmlReferrerLists(std::string* output) {
       "<th>Page Load<br>Count</th>"
       "<th>Subresource<br>Navigations</th>"
       "<th>Subresource<br>PreConnects</th>"
+      "<th>PreConnects<br>Used</th>"
+      "<th>PreConnects<br>Wasted</th>"
       "<th>Subresource<br>PreResolves</th>"
       "<th>Expected<br>Connects</th>"
       "<th>Subresource Spec</th></tr>");
@@ -666,9 +700,12 @@ void Predictor::GetHtmlReferrerLists(std::string* output) {
       }
       first_set_of_futures = false;
       base::StringAppendF(output,
-          "<td>%d</td><td>%d</td><td>%d</td><td>%2.3f</td><td>%s</td></tr>",
+          "<td>%d</td><td>%d</td><td>%d</td><td>%d</td><td>%d</td>"
+          "<td>%2.3f</td><td>%s</td></tr>",
           static_cast<int>(future_url->second.navigation_count()),
           static_cast<int>(future_url->second.preconnection_count()),
+          static_cast<int>(future_url->second.preconnection_hit_count()),
+          static_cast<int>(future_url->second.preconnection_waste_count()),
           static_cast<int>(future_url->second.preresolution_count()),
           static_cast<double>(future_url->second.subresource_use_rate()),
           future_url->first.spec().c_str());
@@ -772,6 +809,7 @@ void Predictor::DeserializeReferrers(const base::ListValue& referral_list) {
       referrers_[GURL(motivating_url_spec)].Deserialize(*subresource_list);
     }
   }
+  EvictReferrersIfNeeded();
 }
 
 void Predictor::DeserializeReferrersThenDelete(
@@ -784,6 +822,10 @@ void Predictor::DiscardInitialNavigationHistory() {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
   if (initial_observer_.get())
     initial_observer_->DiscardInitialNavigationHistory();
+  if (store_.get()) {
+    store_->SetStartupUrls(UrlList());
+    store_->Commit();
+  }
 }
 
 void Predictor::FinalizeInitializationOnIOThread(
@@ -808,6 +850,43 @@ void Predictor::FinalizeInitializationOnIOThread(
   // Prefetch these hostnames on startup.
   DnsPrefetchMotivatedList(startup_urls, UrlInfo::STARTUP_LIST_MOTIVATED);
   DeserializeReferrersThenDelete(referral_list);
+
+  if (store_.get()) {
+    // Whatever was still in preferences moves to the store.
+    for (Referrers::const_iterator it = referrers_.begin();
+         it != referrers_.end(); ++it) {
+      MarkReferrerDirty(it->first);
+    }
+    store_->Load(base::Bind(&Predictor::OnStoreLoaded,
+                            weak_factory_->GetWeakPtr()));
+  }
+}
+
+void Predictor::OnStoreLoaded(scoped_ptr<PredictorStore::Data> data) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  store_loaded_ = true;
+  if (discard_loaded_store_ || shutdown_)
+    return;
+
+  DnsPrefetchMotivatedList(data->startup_urls,
+                           UrlInfo::STARTUP_LIST_MOTIVATED);
+  for (std::map<GURL, std::string>::const_iterator it =
+           data->referrers.begin();
+       it != data->referrers.end(); ++it) {
+    // Referrers learned since startup are merged with the stored ones, and
+    // marked dirty so that the merged result gets written.
+    bool learned = referrers_.find(it->first) != referrers_.end();
+    Pickle pickle(it->second.data(), static_cast<int>(it->second.size()));
+    PickleIterator iter(pickle);
+    Referrer* referrer = &referrers_[it->first];
+    if (!referrer->ReadFromPickle(&iter) || learned)
+      MarkReferrerDirty(it->first);
+    if (referrer->empty())
+      referrers_.erase(it->first);
+  }
+  EvictReferrersIfNeeded();
+  UMA_HISTOGRAM_COUNTS("Net.PredictorStore.LoadedReferrers",
+                       data->referrers.size());
 }
 
 //-----------------------------------------------------------------------------
@@ -821,7 +900,10 @@ void Predictor::LearnAboutInitialNavigation(const GURL& url) {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
   if (!predictor_enabled_ || NULL == initial_observer_.get() )
     return;
-  initial_observer_->Append(url, this);
+  if (initial_observer_->Append(url, this) && store_.get()) {
+    startup_urls_dirty_ = true;
+    ScheduleStoreCommit();
+  }
 }
 
 // This API is only used in the browser process.
@@ -884,6 +966,21 @@ void Predictor::SaveStateForNextStartupAndTrim(PrefService* prefs) {
   if (!predictor_enabled_)
     return;
 
+  if (store_.get()) {
+    // Everything but the changes since the last commit is on disk already,
+    // and those are written from the IO thread without waiting for it.
+    if (BrowserThread::CurrentlyOn(BrowserThread::IO)) {
+      FlushStoreOnIOThread();
+    } else {
+      BrowserThread::PostTask(
+          BrowserThread::IO,
+          FROM_HERE,
+          base::Bind(&Predictor::FlushStoreOnIOThread,
+                     base::Unretained(this)));
+    }
+    return;
+  }
+
   base::WaitableEvent completion(true, false);
 
   ListPrefUpdate update_startup_list(prefs, prefs::kDnsPrefetchingStartupList);
@@ -1056,29 +1153,36 @@ void Predictor::PrepareFrameSubresources(const GURL& url,
 
   Referrer* referrer = &(it->second);
   referrer->IncrementUseCount();
+  MarkReferrerDirty(url);
   const UrlInfo::ResolutionMotivation motivation =
       UrlInfo::LEARNED_REFERAL_MOTIVATED;
-  for (Referrer::iterator future_url = referrer->begin();
-       future_url != referrer->end(); ++future_url) {
+  // The most valuable connections are started first.
+  PredictedSubresources predictions;
+  referrer->GetPredictions(&predictions);
+  for (PredictedSubresources::const_iterator prediction = predictions.begin();
+       prediction != predictions.end(); ++prediction) {
+    ReferrerValue* future_value = &(*referrer)[prediction->url];
     SubresourceValue evalution(TOO_NEW);
-    double connection_expectation = future_url->second.subresource_use_rate();
+    double connection_expectation = prediction->expected_connections;
     UMA_HISTOGRAM_CUSTOM_COUNTS("Net.PreconnectSubresourceExpectation",
                                 static_cast<int>(connection_expectation * 100),
                                 10, 5000, 50);
-    future_url->second.ReferrerWasObserved();
+    future_value->ReferrerWasObserved();
     if (preconnect_enabled_ &&
         connection_expectation > kPreconnectWorthyExpectedValue) {
       evalution = PRECONNECTION;
-      future_url->second.IncrementPreconnectionCount();
+      future_value->IncrementPreconnectionCount();
+      // The learned expectation is the smoothed number of connections that
+      // loads of |url| actually made to this subresource.
       int count = static_cast<int>(std::ceil(connection_expectation));
-      if (url.host() == future_url->first.host())
+      if (url.host() == prediction->url.host())
         ++count;
-      PreconnectUrlOnIOThread(future_url->first, first_party_for_cookies,
+      PreconnectUrlOnIOThread(prediction->url, first_party_for_cookies,
                               motivation, count);
     } else if (connection_expectation > kDNSPreresolutionWorthyExpectedValue) {
       evalution = PRERESOLUTION;
-      future_url->second.preresolution_increment();
-      UrlInfo* queued_info = AppendToResolutionQueue(future_url->first,
+      future_value->preresolution_increment();
+      UrlInfo* queued_info = AppendToResolutionQueue(prediction->url,
                                                      motivation);
       if (queued_info)
         queued_info->SetReferringHostname(url);
@@ -1235,12 +1339,89 @@ void Predictor::IncrementalTrimReferrers(bool trim_all_now) {
     urls_being_trimmed_.pop_back();
     if (it == referrers_.end())
       continue;  // Defensive code: It got trimmed away already.
+    MarkReferrerDirty(it->first);
     if (!it->second.Trim(kReferrerTrimRatio, kDiscardableExpectedValue))
       referrers_.erase(it);
   }
   PostIncrementalTrimTask();
 }
 
+void Predictor::EvictReferrersIfNeeded() {
+  if (referrers_.size() <= kMaxReferrers + kMaxReferrers / 8)
+    return;
+
+  std::vector<std::pair<double, GURL> > values;
+  values.reserve(referrers_.size());
+  for (Referrers::const_iterator it = referrers_.begin();
+       it != referrers_.end(); ++it) {
+    values.push_back(std::make_pair(it->second.GetExpectedConnections(),
+                                    it->first));
+  }
+  size_t evict_count = referrers_.size() - kMaxReferrers;
+  std::nth_element(values.begin(), values.begin() + evict_count,
+                   values.end());
+  for (size_t i = 0; i < evict_count; ++i) {
+    referrers_.erase(values[i].second);
+    MarkReferrerDirty(values[i].second);
+  }
+  UMA_HISTOGRAM_COUNTS("Net.PredictorReferrersEvicted", evict_count);
+}
+
+void Predictor::MarkReferrerDirty(const GURL& url) {
+  if (!store_.get())
+    return;
+  dirty_referrers_.insert(url);
+  ScheduleStoreCommit();
+}
+
+void Predictor::ScheduleStoreCommit() {
+  DCHECK(store_.get());
+  if (shutdown_ || store_commit_timer_.IsRunning())
+    return;
+  store_commit_timer_.Start(
+      FROM_HERE, TimeDelta::FromSeconds(kStoreCommitDelaySeconds), this,
+      &Predictor::CommitToStore);
+}
+
+void Predictor::CommitToStore() {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  if (!store_.get())
+    return;
+
+  for (std::set<GURL>::const_iterator url = dirty_referrers_.begin();
+       url != dirty_referrers_.end(); ++url) {
+    Referrers::const_iterator it = referrers_.find(*url);
+    if (it == referrers_.end()) {
+      store_->DeleteReferrer(*url);
+      continue;
+    }
+    Pickle pickle;
+    it->second.WriteToPickle(&pickle);
+    store_->UpdateReferrer(
+        *url, std::string(static_cast<const char*>(pickle.data()),
+                          pickle.size()));
+  }
+  dirty_referrers_.clear();
+
+  if (startup_urls_dirty_ && initial_observer_.get()) {
+    UrlList startup_urls;
+    initial_observer_->GetInitialUrls(&startup_urls);
+    store_->SetStartupUrls(startup_urls);
+  }
+  startup_urls_dirty_ = false;
+
+  store_->Commit();
+}
+
+void Predictor::FlushStoreOnIOThread() {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  store_commit_timer_.Stop();
+  // As with preferences, the next startup resolves what this session started
+  // with, even if no navigation was observed.
+  startup_urls_dirty_ = true;
+  CommitToStore();
+}
+
 // ---------------------- End IO methods. -------------------------------------
 
 //-----------------------------------------------------------------------------
@@ -1288,20 +1469,22 @@ Predictor::InitialObserver::InitialObserver() {
 Predictor::InitialObserver::~InitialObserver() {
 }
 
-void Predictor::InitialObserver::Append(const GURL& url,
+bool Predictor::InitialObserver::Append(const GURL& url,
                                         Predictor* predictor) {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
 
   // TODO(rlp): Do we really need the predictor check here?
   if (NULL == predictor)
-    return;
+    return false;
   if (kStartupResolutionCount <= first_navigations_.size())
-    return;
+    return false;
 
   DCHECK(url.SchemeIsHTTPOrHTTPS());
   DCHECK_EQ(url, Predictor::CanonicalizeUrl(url));
-  if (first_navigations_.find(url) == first_navigations_.end())
-    first_navigations_[url] = base::TimeTicks::Now();
+  if (first_navigations_.find(url) != first_navigations_.end())
+    return false;
+  first_navigations_[url] = base::TimeTicks::Now();
+  return true;
 }
 
 void Predictor::InitialObserver::GetInitialDnsResolutionList(
@@ -1320,6 +1503,15 @@ void Predictor::InitialObserver::GetInitialDnsResolutionList(
   }
 }
 
+void Predictor::InitialObserver::GetInitialUrls(UrlList* urls) const {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  urls->clear();
+  for (FirstNavigations::const_iterator it = first_navigations_.begin();
+       it != first_navigations_.end(); ++it) {
+    urls->push_back(it->first);
+  }
+}
+
 void Predictor::InitialObserver::GetFirstResolutionsHtml(
     std::string* output) {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
@@ -26,8 +26,11 @@
 #include <vector>
 
 #include "base/gtest_prod_util.h"
+#include "base/memory/ref_counted.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/memory/weak_ptr.h"
+#include "base/timer/timer.h"
+#include "chrome/browser/net/predictor_store.h"
 #include "chrome/browser/net/referrer.h"
 #include "chrome/browser/net/timed_cache.h"
 #include "chrome/browser/net/url_info.h"
@@ -114,6 +117,11 @@ class Predictor {
 
   // ------------- Start UI thread methods.
 
+  // Makes the predictor persist what it learns to |store| during the session,
+  // instead of to preferences at shutdown. State found in preferences is
+  // moved to |store|. Must be called before InitNetworkPredictor().
+  void SetStore(const scoped_refptr<PredictorStore>& store);
+
   virtual void InitNetworkPredictor(PrefService* user_prefs,
                                     PrefService* local_state,
                                     IOThread* io_thread,
@@ -163,6 +171,11 @@ class Predictor {
   // canonicalized to not have a path.
   void LearnFromNavigation(const GURL& referring_url, const GURL& target_url);
 
+  // Fill |predictions| with the subresources that a load of |url| is expected
+  // to need, most expected connections first. |url| should be canonicalized.
+  void GetPredictedSubresources(const GURL& url,
+                                PredictedSubresources* predictions) const;
+
   // When displaying info in about:dns, the following API is called.
   static void PredictorGetHtmlInfo(Predictor* predictor, std::string* output);
 
@@ -214,7 +227,8 @@ class Predictor {
                                 UrlInfo::ResolutionMotivation motivation);
 
   // May be called from either the IO or UI thread and will PostTask
-  // to the IO thread if necessary.
+  // to the IO thread if necessary. With a store, this only posts the commit
+  // of the last changes, and does not wait for the IO thread.
   void SaveStateForNextStartupAndTrim(PrefService* prefs);
 
   void SaveDnsPrefetchStateForNextStartupAndTrim(
@@ -295,6 +309,7 @@ class Predictor {
   FRIEND_TEST_ALL_PREFIXES(PredictorTest, PriorityQueuePushPopTest);
   FRIEND_TEST_ALL_PREFIXES(PredictorTest, PriorityQueueReorderTest);
   FRIEND_TEST_ALL_PREFIXES(PredictorTest, ReferrerSerializationTrimTest);
+  FRIEND_TEST_ALL_PREFIXES(PredictorTest, BoundedReferrersTest);
   friend class WaitForResolutionHelper;  // For testing.
 
   class LookupRequest;
@@ -338,8 +353,9 @@ class Predictor {
     // Recording of when we observed each navigation.
     typedef std::map<GURL, base::TimeTicks> FirstNavigations;
 
-    // Potentially add a new URL to our startup list.
-    void Append(const GURL& url, Predictor* predictor);
+    // Potentially add a new URL to our startup list. Returns true if it was
+    // added.
+    bool Append(const GURL& url, Predictor* predictor);
 
     // Get an HTML version of our current planned first_navigations_.
     void GetFirstResolutionsHtml(std::string* output);
@@ -347,6 +363,9 @@ class Predictor {
     // Persist the current first_navigations_ for storage in a list.
     void GetInitialDnsResolutionList(base::ListValue* startup_list);
 
+    // Returns the current first_navigations_, for a PredictorStore.
+    void GetInitialUrls(UrlList* urls) const;
+
     // Discards all initial loading history.
     void DiscardInitialNavigationHistory() { first_navigations_.clear(); }
 
@@ -385,6 +404,12 @@ class Predictor {
   static const int64 kDurationBetweenTrimmingIncrementsSeconds;
   // Number of referring URLs processed in an incremental trimming.
   static const size_t kUrlsTrimmedPerIncrement;
+  // Upper bound on the number of referrers kept. Each holds a bounded list of
+  // subresources, so this bounds the memory used by what is learned.
+  static const size_t kMaxReferrers;
+  // Delay between a change and its commit to the store, so that the
+  // referrers a page load touches are written together.
+  static const int64 kStoreCommitDelaySeconds;
 
   // Only for testing. Returns true if hostname has been successfully resolved
   // (name found).
@@ -458,6 +483,26 @@ class Predictor {
   // continue with them shortly (i.e., it yeilds and continues).
   void IncrementalTrimReferrers(bool trim_all_now);
 
+  // Once there are more than kMaxReferrers referrers, by some slack so that
+  // the cost is amortized, evicts those expected to make the fewest
+  // connections.
+  void EvictReferrersIfNeeded();
+
+  // Merges what |store_| holds into the current state.
+  void OnStoreLoaded(scoped_ptr<PredictorStore::Data> data);
+
+  // Notes that the referrer for |url| changed, or was removed, and schedules
+  // a commit to |store_|.
+  void MarkReferrerDirty(const GURL& url);
+  void ScheduleStoreCommit();
+
+  // Writes the referrers changed since the last commit, and the startup list
+  // if it changed, to |store_|.
+  void CommitToStore();
+
+  // Commits the last changes at shutdown.
+  void FlushStoreOnIOThread();
+
   // ------------- End IO thread methods.
 
   scoped_ptr<InitialObserver> initial_observer_;
@@ -530,6 +575,19 @@ class Predictor {
   // A time after which we need to do more trimming of referrers.
   base::TimeTicks next_trim_time_;
 
+  // Where the referrers and startup list are persisted, if set.
+  scoped_refptr<PredictorStore> store_;
+
+  // Changes not yet committed to |store_|.
+  std::set<GURL> dirty_referrers_;
+  bool startup_urls_dirty_;
+  base::OneShotTimer<Predictor> store_commit_timer_;
+
+  // True once |store_| finished loading. If results are discarded before
+  // then, |discard_loaded_store_| is set so that the stale data is dropped.
+  bool store_loaded_;
+  bool discard_loaded_store_;
+
   scoped_ptr<base::WeakPtrFactory<Predictor> > weak_factory_;
 
   DISALLOW_COPY_AND_ASSIGN(Predictor);
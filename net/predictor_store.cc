@@ -0,0 +1,328 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/net/predictor_store.h"
+
+#include <string.h>
+
+#include "base/bind.h"
+#include "base/file_util.h"
+#include "base/files/important_file_writer.h"
+#include "base/hash.h"
+#include "base/logging.h"
+#include "base/metrics/histogram.h"
+#include "base/pickle.h"
+#include "base/sequenced_task_runner.h"
+#include "base/time/time.h"
+
+namespace chrome_browser_net {
+
+namespace {
+
+const uint32 kFileMagic = 0x50524544;  // "PRED"
+const uint32 kFileVersion = 2;
+const size_t kHeaderSize = 2 * sizeof(uint32);
+
+// Anything larger is garbage rather than an entry.
+const uint32 kMaxEntrySize = 1024 * 1024;
+
+// The file is compacted once it is more than twice as large as it was after
+// the last compaction, and larger than this.
+const int64 kMinSizeToCompact = 64 * 1024;
+
+enum EntryType {
+  // A referrer URL and its serialized Referrer, or an empty string if the
+  // referrer was deleted.
+  ENTRY_REFERRER,
+  // The list of URLs to resolve at startup.
+  ENTRY_STARTUP_URLS,
+};
+
+void AppendUint32(uint32 value, std::string* output) {
+  output->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+uint32 ReadUint32(const char* data) {
+  uint32 value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+void AppendHeader(std::string* output) {
+  AppendUint32(kFileMagic, output);
+  AppendUint32(kFileVersion, output);
+}
+
+// Entries are prefixed with their size and hash, so that the start of the
+// next entry can be found again after a torn one.
+void AppendEntry(const Pickle& pickle, std::string* output) {
+  const char* data = static_cast<const char*>(pickle.data());
+  AppendUint32(static_cast<uint32>(pickle.size()), output);
+  AppendUint32(base::Hash(data, pickle.size()), output);
+  output->append(data, pickle.size());
+}
+
+void AppendReferrerEntry(const GURL& url,
+                         const std::string& serialized,
+                         std::string* output) {
+  Pickle pickle;
+  pickle.WriteInt(ENTRY_REFERRER);
+  pickle.WriteString(url.spec());
+  pickle.WriteString(serialized);
+  AppendEntry(pickle, output);
+}
+
+void AppendStartupUrlsEntry(const chrome_common_net::UrlList& urls,
+                            std::string* output) {
+  Pickle pickle;
+  pickle.WriteInt(ENTRY_STARTUP_URLS);
+  pickle.WriteInt(static_cast<int>(urls.size()));
+  for (size_t i = 0; i < urls.size(); ++i)
+    pickle.WriteString(urls[i].spec());
+  AppendEntry(pickle, output);
+}
+
+// Writes |data| as a file that has nothing to compact.
+void EncodeData(const PredictorStore::Data& data, std::string* output) {
+  AppendHeader(output);
+  AppendStartupUrlsEntry(data.startup_urls, output);
+  for (std::map<GURL, std::string>::const_iterator it = data.referrers.begin();
+       it != data.referrers.end(); ++it) {
+    AppendReferrerEntry(it->first, it->second, output);
+  }
+}
+
+// Applies the entry starting at |offset| in |contents| to |data|, and sets
+// |entry_size| to the number of bytes it takes. Returns false, leaving |data|
+// untouched, if there is no readable entry at |offset|.
+bool DecodeEntry(const std::string& contents,
+                 size_t offset,
+                 PredictorStore::Data* data,
+                 size_t* entry_size) {
+  if (contents.size() - offset < 2 * sizeof(uint32))
+    return false;
+  const uint32 size = ReadUint32(contents.data() + offset);
+  const uint32 hash = ReadUint32(contents.data() + offset + sizeof(uint32));
+  offset += 2 * sizeof(uint32);
+  if (size < sizeof(uint32) || size > kMaxEntrySize ||
+      size > contents.size() - offset ||
+      base::Hash(contents.data() + offset, size) != hash) {
+    return false;
+  }
+  Pickle pickle(contents.data() + offset, size);
+
+  PickleIterator iter(pickle);
+  int type;
+  if (!iter.ReadInt(&type))
+    return false;
+  switch (type) {
+    case ENTRY_REFERRER: {
+      std::string url_spec;
+      std::string serialized;
+      if (!iter.ReadString(&url_spec) || !iter.ReadString(&serialized))
+        return false;
+      GURL url(url_spec);
+      if (!url.is_valid())
+        break;
+      if (serialized.empty())
+        data->referrers.erase(url);
+      else
+        data->referrers[url].swap(serialized);
+      break;
+    }
+    case ENTRY_STARTUP_URLS: {
+      int count;
+      if (!iter.ReadInt(&count) || count < 0)
+        return false;
+      chrome_common_net::UrlList startup_urls;
+      for (int i = 0; i < count; ++i) {
+        std::string url_spec;
+        if (!iter.ReadString(&url_spec))
+          return false;
+        GURL url(url_spec);
+        if (url.has_host() && url.has_scheme())
+          startup_urls.push_back(url);
+      }
+      data->startup_urls.swap(startup_urls);
+      break;
+    }
+    default:
+      return false;
+  }
+  *entry_size = 2 * sizeof(uint32) + size;
+  return true;
+}
+
+// Applies the entries of |contents| to |data|. Returns false if |contents|
+// is not a predictor file, or holds bytes that are not part of any entry, as
+// an interrupted append leaves behind. Reading resumes at the next entry
+// found after such bytes, so that later appends are not lost.
+bool DecodeData(const std::string& contents, PredictorStore::Data* data) {
+  if (contents.size() < kHeaderSize ||
+      ReadUint32(contents.data()) != kFileMagic ||
+      ReadUint32(contents.data() + sizeof(uint32)) != kFileVersion) {
+    return false;
+  }
+
+  bool valid = true;
+  size_t offset = kHeaderSize;
+  while (offset < contents.size()) {
+    size_t entry_size;
+    if (DecodeEntry(contents, offset, data, &entry_size)) {
+      offset += entry_size;
+    } else {
+      valid = false;
+      ++offset;
+    }
+  }
+  return valid;
+}
+
+// Rewrites |path| with just the live contents of |data|, and returns the new
+// size of the file.
+int64 WriteCompacted(const base::FilePath& path,
+                     const PredictorStore::Data& data) {
+  std::string compacted;
+  EncodeData(data, &compacted);
+  if (!base::ImportantFileWriter::WriteFileAtomically(path, compacted))
+    LOG(WARNING) << "Failed to compact " << path.value();
+  return static_cast<int64>(compacted.size());
+}
+
+}  // namespace
+
+PredictorStore::Data::Data() {
+}
+
+PredictorStore::Data::~Data() {
+}
+
+PredictorStore::PredictorStore(
+    const base::FilePath& path,
+    const scoped_refptr<base::SequencedTaskRunner>& background_task_runner)
+    : path_(path),
+      background_task_runner_(background_task_runner),
+      compacted_size_(0) {
+}
+
+PredictorStore::~PredictorStore() {
+  DCHECK(pending_.empty()) << "Commit() should have been called.";
+}
+
+void PredictorStore::Load(const LoadedCallback& loaded_callback) {
+  scoped_ptr<Data> data(new Data);
+  Data* data_ptr = data.get();
+  background_task_runner_->PostTaskAndReply(
+      FROM_HERE,
+      base::Bind(&PredictorStore::LoadOnBackgroundThread, this, data_ptr),
+      base::Bind(loaded_callback, base::Passed(&data)));
+}
+
+void PredictorStore::UpdateReferrer(const GURL& url,
+                                    const std::string& serialized) {
+  DCHECK(!serialized.empty());
+  AppendReferrerEntry(url, serialized, &pending_);
+}
+
+void PredictorStore::DeleteReferrer(const GURL& url) {
+  AppendReferrerEntry(url, std::string(), &pending_);
+}
+
+void PredictorStore::SetStartupUrls(const chrome_common_net::UrlList& urls) {
+  AppendStartupUrlsEntry(urls, &pending_);
+}
+
+void PredictorStore::DeleteAll() {
+  // Nothing batched so far matters anymore. The file is rewritten rather than
+  // appended to, so that the deleted data does not linger on disk.
+  pending_.clear();
+  background_task_runner_->PostTask(
+      FROM_HERE,
+      base::Bind(&PredictorStore::DeleteAllOnBackgroundThread, this));
+}
+
+void PredictorStore::Commit() {
+  if (pending_.empty())
+    return;
+  std::string entries;
+  entries.swap(pending_);
+  background_task_runner_->PostTask(
+      FROM_HERE,
+      base::Bind(&PredictorStore::AppendOnBackgroundThread, this, entries));
+}
+
+void PredictorStore::LoadOnBackgroundThread(Data* data) {
+  DCHECK(background_task_runner_->RunsTasksOnCurrentThread());
+
+  base::TimeTicks start = base::TimeTicks::Now();
+  std::string contents;
+  if (!base::ReadFileToString(path_, &contents))
+    return;
+  UMA_HISTOGRAM_COUNTS("Net.PredictorStore.SizeInKB", contents.size() / 1024);
+
+  bool valid = DecodeData(contents, data);
+  std::string compacted;
+  EncodeData(*data, &compacted);
+  compacted_size_ = static_cast<int64>(compacted.size());
+  if (!valid || NeedsCompaction(static_cast<int64>(contents.size()))) {
+    if (!base::ImportantFileWriter::WriteFileAtomically(path_, compacted))
+      LOG(WARNING) << "Failed to compact " << path_.value();
+  }
+
+  UMA_HISTOGRAM_TIMES("Net.PredictorStore.LoadTime",
+                      base::TimeTicks::Now() - start);
+}
+
+void PredictorStore::AppendOnBackgroundThread(const std::string& entries) {
+  DCHECK(background_task_runner_->RunsTasksOnCurrentThread());
+
+  int written;
+  if (base::PathExists(path_)) {
+    written = file_util::AppendToFile(path_, entries.data(),
+                                      static_cast<int>(entries.size()));
+  } else {
+    std::string contents;
+    AppendHeader(&contents);
+    contents.append(entries);
+    written = file_util::WriteFile(path_, contents.data(),
+                                   static_cast<int>(contents.size())) -
+              static_cast<int>(kHeaderSize);
+  }
+  // A partial write is skipped, and compacted away, at the next load.
+  if (written != static_cast<int>(entries.size()))
+    LOG(WARNING) << "Failed to write to " << path_.value();
+
+  // Referrers are rewritten every time they are trimmed, so the file would
+  // keep growing over a long session if it were only compacted on load.
+  int64 file_size;
+  if (!file_util::GetFileSize(path_, &file_size) ||
+      !NeedsCompaction(file_size)) {
+    return;
+  }
+  base::TimeTicks start = base::TimeTicks::Now();
+  std::string contents;
+  if (!base::ReadFileToString(path_, &contents))
+    return;
+  Data data;
+  DecodeData(contents, &data);
+  compacted_size_ = WriteCompacted(path_, data);
+  UMA_HISTOGRAM_TIMES("Net.PredictorStore.CompactTime",
+                      base::TimeTicks::Now() - start);
+}
+
+void PredictorStore::DeleteAllOnBackgroundThread() {
+  DCHECK(background_task_runner_->RunsTasksOnCurrentThread());
+
+  std::string contents;
+  AppendHeader(&contents);
+  if (!base::ImportantFileWriter::WriteFileAtomically(path_, contents))
+    LOG(WARNING) << "Failed to clear " << path_.value();
+  compacted_size_ = static_cast<int64>(contents.size());
+}
+
+bool PredictorStore::NeedsCompaction(int64 file_size) const {
+  return file_size > 2 * compacted_size_ && file_size > kMinSizeToCompact;
+}
+
+}  // namespace chrome_browser_net
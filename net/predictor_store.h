@@ -0,0 +1,95 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_NET_PREDICTOR_STORE_H_
+#define CHROME_BROWSER_NET_PREDICTOR_STORE_H_
+
+#include <map>
+#include <string>
+
+#include "base/callback_forward.h"
+#include "base/files/file_path.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "chrome/common/net/predictor_common.h"
+#include "url/gurl.h"
+
+namespace base {
+class SequencedTaskRunner;
+}
+
+namespace chrome_browser_net {
+
+// Persists what the Predictor learned in a binary file that is appended to
+// from the background task runner throughout the session, so that nothing
+// needs to be serialized at shutdown beyond the changes since the last
+// commit. The file is a log of length-prefixed pickled entries, which is
+// compacted whenever most of it has been superseded.
+//
+// Must be used from a single thread; the loaded callback is run on it.
+class PredictorStore : public base::RefCountedThreadSafe<PredictorStore> {
+ public:
+  // The state found on disk. Referrers are kept serialized, as written by
+  // Referrer::WriteToPickle().
+  struct Data {
+    Data();
+    ~Data();
+
+    chrome_common_net::UrlList startup_urls;
+    std::map<GURL, std::string> referrers;
+  };
+
+  typedef base::Callback<void(scoped_ptr<Data>)> LoadedCallback;
+
+  PredictorStore(
+      const base::FilePath& path,
+      const scoped_refptr<base::SequencedTaskRunner>& background_task_runner);
+
+  // Reads the file, and returns its contents to |loaded_callback|.
+  void Load(const LoadedCallback& loaded_callback);
+
+  // The following methods batch a change, which is written by Commit().
+  void UpdateReferrer(const GURL& url, const std::string& serialized);
+  void DeleteReferrer(const GURL& url);
+  void SetStartupUrls(const chrome_common_net::UrlList& urls);
+  void DeleteAll();
+
+  // Appends the batched changes to the file on the background task runner.
+  void Commit();
+
+  bool HasPendingChanges() const { return !pending_.empty(); }
+
+ private:
+  friend class base::RefCountedThreadSafe<PredictorStore>;
+
+  ~PredictorStore();
+
+  // Reads the file into |data|, and compacts it when most of it is stale.
+  void LoadOnBackgroundThread(Data* data);
+
+  // Appends |entries| to the file, and compacts it when most of it is stale.
+  void AppendOnBackgroundThread(const std::string& entries);
+
+  // Truncates the file to an empty log.
+  void DeleteAllOnBackgroundThread();
+
+  // Returns true if a file of |file_size| bytes should be compacted.
+  bool NeedsCompaction(int64 file_size) const;
+
+  const base::FilePath path_;
+  scoped_refptr<base::SequencedTaskRunner> background_task_runner_;
+
+  // Encoded entries waiting for Commit().
+  std::string pending_;
+
+  // Size of the file after it was last compacted. Only used on the background
+  // task runner.
+  int64 compacted_size_;
+
+  DISALLOW_COPY_AND_ASSIGN(PredictorStore);
+};
+
+}  // namespace chrome_browser_net
+
+#endif  // CHROME_BROWSER_NET_PREDICTOR_STORE_H_
@@ -0,0 +1,199 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+
+#include "base/bind.h"
+#include "base/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/message_loop/message_loop_proxy.h"
+#include "base/run_loop.h"
+#include "chrome/browser/net/predictor_store.h"
+#include "content/public/test/test_browser_thread_bundle.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace chrome_browser_net {
+
+class PredictorStoreTest : public testing::Test {
+ protected:
+  virtual void SetUp() OVERRIDE {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    path_ = temp_dir_.path().AppendASCII("Network Predictor");
+    CreateStore();
+  }
+
+  virtual void TearDown() OVERRIDE {
+    store_ = NULL;
+    base::RunLoop().RunUntilIdle();
+  }
+
+  void CreateStore() {
+    store_ = new PredictorStore(path_, base::MessageLoopProxy::current());
+  }
+
+  scoped_ptr<PredictorStore::Data> Load() {
+    base::RunLoop run_loop;
+    store_->Load(base::Bind(&PredictorStoreTest::OnLoaded,
+                            base::Unretained(this),
+                            &run_loop));
+    run_loop.Run();
+    return data_.Pass();
+  }
+
+  void OnLoaded(base::RunLoop* run_loop,
+                scoped_ptr<PredictorStore::Data> data) {
+    data_ = data.Pass();
+    run_loop->Quit();
+  }
+
+  content::TestBrowserThreadBundle thread_bundle_;
+  base::ScopedTempDir temp_dir_;
+  base::FilePath path_;
+  scoped_refptr<PredictorStore> store_;
+  scoped_ptr<PredictorStore::Data> data_;
+};
+
+TEST_F(PredictorStoreTest, EmptyLoad) {
+  scoped_ptr<PredictorStore::Data> data = Load();
+  ASSERT_TRUE(data.get());
+  EXPECT_TRUE(data->startup_urls.empty());
+  EXPECT_TRUE(data->referrers.empty());
+}
+
+TEST_F(PredictorStoreTest, PersistsChanges) {
+  const GURL a("http://a.com/");
+  const GURL b("http://b.com/");
+  chrome_common_net::UrlList startup_urls;
+  startup_urls.push_back(a);
+
+  store_->UpdateReferrer(a, "first");
+  store_->UpdateReferrer(b, "b");
+  store_->SetStartupUrls(startup_urls);
+  store_->Commit();
+  EXPECT_FALSE(store_->HasPendingChanges());
+  store_->UpdateReferrer(a, "second");
+  store_->DeleteReferrer(b);
+  store_->Commit();
+  base::RunLoop().RunUntilIdle();
+
+  CreateStore();
+  scoped_ptr<PredictorStore::Data> data = Load();
+  ASSERT_EQ(1u, data->startup_urls.size());
+  EXPECT_EQ(a, data->startup_urls[0]);
+  ASSERT_EQ(1u, data->referrers.size());
+  EXPECT_EQ("second", data->referrers[a]);
+}
+
+TEST_F(PredictorStoreTest, DeleteAll) {
+  const GURL a("http://a.com/");
+  const GURL b("http://b.com/");
+
+  store_->UpdateReferrer(a, "a");
+  store_->Commit();
+  store_->UpdateReferrer(b, "b");
+  store_->DeleteAll();
+  store_->Commit();
+  base::RunLoop().RunUntilIdle();
+
+  // The referrers are gone from the file, not just superseded.
+  std::string contents;
+  ASSERT_TRUE(base::ReadFileToString(path_, &contents));
+  EXPECT_EQ(std::string::npos, contents.find(a.spec()));
+  EXPECT_EQ(std::string::npos, contents.find(b.spec()));
+
+  CreateStore();
+  scoped_ptr<PredictorStore::Data> data = Load();
+  EXPECT_TRUE(data->referrers.empty());
+}
+
+// An append interrupted halfway leaves a truncated entry behind, which is
+// dropped and compacted away at the next load.
+TEST_F(PredictorStoreTest, TruncatedEntry) {
+  const GURL a("http://a.com/");
+  const GURL b("http://b.com/");
+
+  store_->UpdateReferrer(a, "a");
+  store_->Commit();
+  base::RunLoop().RunUntilIdle();
+
+  store_->UpdateReferrer(b, "b");
+  store_->Commit();
+  base::RunLoop().RunUntilIdle();
+  std::string contents;
+  ASSERT_TRUE(base::ReadFileToString(path_, &contents));
+  contents.resize(contents.size() - 3);
+  ASSERT_EQ(static_cast<int>(contents.size()),
+            file_util::WriteFile(path_, contents.data(), contents.size()));
+
+  CreateStore();
+  scoped_ptr<PredictorStore::Data> data = Load();
+  ASSERT_EQ(1u, data->referrers.size());
+  EXPECT_EQ("a", data->referrers[a]);
+
+  // Entries appended after the compaction are read back, rather than being
+  // hidden behind the truncated one.
+  store_->UpdateReferrer(b, "b");
+  store_->Commit();
+  base::RunLoop().RunUntilIdle();
+  CreateStore();
+  data = Load();
+  EXPECT_EQ(2u, data->referrers.size());
+}
+
+// Entries appended after a torn one, before the file is loaded again, are
+// still read back.
+TEST_F(PredictorStoreTest, ResyncAfterTornEntry) {
+  const GURL a("http://a.com/");
+  const GURL b("http://b.com/");
+  const GURL c("http://c.com/");
+
+  store_->UpdateReferrer(a, "a");
+  store_->Commit();
+  base::RunLoop().RunUntilIdle();
+  std::string contents;
+  ASSERT_TRUE(base::ReadFileToString(path_, &contents));
+  const size_t valid_size = contents.size();
+
+  store_->UpdateReferrer(b, "b");
+  store_->Commit();
+  base::RunLoop().RunUntilIdle();
+  ASSERT_TRUE(base::ReadFileToString(path_, &contents));
+  contents.resize(valid_size + (contents.size() - valid_size) / 2);
+  ASSERT_EQ(static_cast<int>(contents.size()),
+            file_util::WriteFile(path_, contents.data(), contents.size()));
+
+  store_->UpdateReferrer(c, "c");
+  store_->Commit();
+  base::RunLoop().RunUntilIdle();
+
+  CreateStore();
+  scoped_ptr<PredictorStore::Data> data = Load();
+  ASSERT_EQ(2u, data->referrers.size());
+  EXPECT_EQ("a", data->referrers[a]);
+  EXPECT_EQ("c", data->referrers[c]);
+}
+
+// Rewriting the same referrers over and over does not grow the file without
+// bound, even when it is never loaded again.
+TEST_F(PredictorStoreTest, CompactsOnAppend) {
+  const GURL a("http://a.com/");
+  const std::string serialized(1024, 'x');
+
+  for (int i = 0; i < 1000; ++i) {
+    store_->UpdateReferrer(a, serialized);
+    store_->Commit();
+  }
+  base::RunLoop().RunUntilIdle();
+
+  int64 file_size = 0;
+  ASSERT_TRUE(file_util::GetFileSize(path_, &file_size));
+  EXPECT_GT(200 * 1024, file_size);
+
+  CreateStore();
+  scoped_ptr<PredictorStore::Data> data = Load();
+  ASSERT_EQ(1u, data->referrers.size());
+  EXPECT_EQ(serialized, data->referrers[a]);
+}
+
+}  // namespace chrome_browser_net
@@ -679,4 +679,54 @@ TEST_F(PredictorTest, DiscardPredictorResults) {
   predictor.Shutdown();
 }
 
+TEST_F(PredictorTest, PredictedSubresourcesTest) {
+  Predictor predictor(true);
+  predictor.SetHostResolver(host_resolver_.get());
+
+  GURL referrer("http://test_referrer");
+  GURL host_1("http://test_1");
+  GURL host_2("http://test_2");
+  predictor.LearnFromNavigation(referrer, host_1);
+  predictor.LearnFromNavigation(referrer, host_2);
+  predictor.LearnFromNavigation(referrer, host_2);
+
+  PredictedSubresources predictions;
+  predictor.GetPredictedSubresources(GURL("http://unknown"), &predictions);
+  EXPECT_TRUE(predictions.empty());
+
+  predictor.GetPredictedSubresources(referrer, &predictions);
+  ASSERT_EQ(2U, predictions.size());
+  EXPECT_EQ(host_2, predictions[0].url);
+  EXPECT_EQ(host_1, predictions[1].url);
+  EXPECT_GT(predictions[0].expected_connections,
+            predictions[1].expected_connections);
+  EXPECT_LE(predictions[0].confidence, 1.0);
+  EXPECT_GT(predictions[1].confidence, 0.0);
+
+  predictor.Shutdown();
+}
+
+TEST_F(PredictorTest, BoundedReferrersTest) {
+  Predictor predictor(true);
+  predictor.SetHostResolver(host_resolver_.get());
+
+  // A referrer that is seen a lot is kept, however many others show up.
+  GURL valuable("http://valuable");
+  GURL subresource("http://subresource");
+  for (int i = 0; i < 10; ++i)
+    predictor.LearnFromNavigation(valuable, subresource);
+
+  for (size_t i = 0; i < 2 * Predictor::kMaxReferrers; ++i) {
+    GURL referrer("http://referrer" + base::Uint64ToString(i));
+    predictor.LearnFromNavigation(referrer, subresource);
+    EXPECT_LE(predictor.referrers_.size(),
+              Predictor::kMaxReferrers + Predictor::kMaxReferrers / 8);
+  }
+  EXPECT_GE(predictor.referrers_.size(), Predictor::kMaxReferrers);
+  EXPECT_TRUE(predictor.referrers_.find(valuable) !=
+              predictor.referrers_.end());
+
+  predictor.Shutdown();
+}
+
 }  // namespace chrome_browser_net
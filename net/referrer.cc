@@ -6,9 +6,13 @@
 
 #include <limits.h>
 
+#include <algorithm>
+
 #include "base/compiler_specific.h"
 #include "base/logging.h"
 #include "base/message_loop/message_loop.h"
+#include "base/metrics/histogram.h"
+#include "base/pickle.h"
 #include "base/values.h"
 #include "chrome/browser/net/predictor.h"
 
@@ -50,6 +54,23 @@ static const double kWeightingForOldConnectsExpectedValue = 0.66;
 // a starting point.
 static const double kInitialConnectsExpectedValue = 2.0;
 
+namespace {
+
+bool MoreExpectedConnections(const PredictedSubresource& a,
+                             const PredictedSubresource& b) {
+  return a.expected_connections > b.expected_connections;
+}
+
+}  // namespace
+
+PredictedSubresource::PredictedSubresource(const GURL& url,
+                                           double expected_connections,
+                                           double confidence)
+    : url(url),
+      expected_connections(expected_connections),
+      confidence(confidence) {
+}
+
 Referrer::Referrer() : use_count_(1) {}
 
 void Referrer::SuggestHost(const GURL& url) {
@@ -103,6 +124,26 @@ void Referrer::DeleteLeastUseful() {
     erase(least_useful_url);
 }
 
+void Referrer::GetPredictions(PredictedSubresources* predictions) const {
+  predictions->clear();
+  predictions->reserve(size());
+  for (const_iterator it = begin(); it != end(); ++it) {
+    double confidence = std::min(
+        1.0, static_cast<double>(it->second.navigation_count()) / use_count_);
+    predictions->push_back(PredictedSubresource(
+        it->first, it->second.subresource_use_rate(), confidence));
+  }
+  std::stable_sort(predictions->begin(), predictions->end(),
+                   MoreExpectedConnections);
+}
+
+double Referrer::GetExpectedConnections() const {
+  double expected_connections = 0.0;
+  for (const_iterator it = begin(); it != end(); ++it)
+    expected_connections += it->second.subresource_use_rate();
+  return expected_connections;
+}
+
 bool Referrer::Trim(double reduce_rate, double threshold) {
   std::vector<GURL> discarded_urls;
   for (SubresourceMap::iterator it = begin(); it != end(); ++it) {
@@ -157,6 +198,31 @@ Value* Referrer::Serialize() const {
   return subresource_list;
 }
 
+void Referrer::WriteToPickle(Pickle* pickle) const {
+  pickle->WriteInt(static_cast<int>(size()));
+  for (const_iterator it = begin(); it != end(); ++it) {
+    pickle->WriteString(it->first.spec());
+    pickle->WriteFloat(static_cast<float>(it->second.subresource_use_rate()));
+  }
+}
+
+bool Referrer::ReadFromPickle(PickleIterator* iter) {
+  int count;
+  if (!iter->ReadInt(&count) || count < 0)
+    return false;
+  for (int i = 0; i < count; ++i) {
+    std::string url_spec;
+    float rate;
+    if (!iter->ReadString(&url_spec) || !iter->ReadFloat(&rate))
+      return false;
+    // As in Deserialize(), above.
+    GURL url(url_spec);
+    SuggestHost(url);
+    (*this)[url].SetSubresourceUseRate(rate);
+  }
+  return true;
+}
+
 //------------------------------------------------------------------------------
 
 ReferrerValue::ReferrerValue()
@@ -164,6 +230,9 @@ ReferrerValue::ReferrerValue()
       navigation_count_(0),
       preconnection_count_(0),
       preresolution_count_(0),
+      preconnection_hit_count_(0),
+      preconnection_waste_count_(0),
+      preconnection_pending_(false),
       subresource_use_rate_(kInitialConnectsExpectedValue) {
 }
 
@@ -172,9 +241,19 @@ void ReferrerValue::SubresourceIsNeeded() {
   DCHECK_LE(kWeightingForOldConnectsExpectedValue, 1.0);
   ++navigation_count_;
   subresource_use_rate_ += 1 - kWeightingForOldConnectsExpectedValue;
+  if (preconnection_pending_) {
+    preconnection_pending_ = false;
+    ++preconnection_hit_count_;
+    UMA_HISTOGRAM_BOOLEAN("Net.PreconnectSubresourceUsed", true);
+  }
 }
 
 void ReferrerValue::ReferrerWasObserved() {
+  if (preconnection_pending_) {
+    preconnection_pending_ = false;
+    ++preconnection_waste_count_;
+    UMA_HISTOGRAM_BOOLEAN("Net.PreconnectSubresourceUsed", false);
+  }
   subresource_use_rate_ *= kWeightingForOldConnectsExpectedValue;
   // Note: the use rate is temporarilly possibly incorect, as we need to find
   // out if we really end up connecting.  This will happen in a few hundred
@@ -16,12 +16,16 @@
 #define CHROME_BROWSER_NET_REFERRER_H_
 
 #include <map>
+#include <vector>
 
 #include "base/basictypes.h"
 #include "base/time/time.h"
 #include "net/base/host_port_pair.h"
 #include "url/gurl.h"
 
+class Pickle;
+class PickleIterator;
+
 namespace base {
 class Value;
 }
@@ -42,20 +46,31 @@ class ReferrerValue {
   base::Time birth_time() const { return birth_time_; }
 
   // Record the fact that we navigated to the associated subresource URL.  This
-  // will increase the value of the expected subresource_use_rate_
+  // will increase the value of the expected subresource_use_rate_, and counts
+  // a pending preconnection as used.
   void SubresourceIsNeeded();
 
   // Record the fact that the referrer of this subresource was observed. This
   // will diminish the expected subresource_use_rate_ (and will only be
   // counteracted later if we really needed this subresource as a consequence
-  // of our associated referrer.)
+  // of our associated referrer.)  A preconnection made at the previous
+  // observation that was never used is counted as wasted.
   void ReferrerWasObserved();
 
   int64 navigation_count() const { return navigation_count_; }
   double subresource_use_rate() const { return subresource_use_rate_; }
 
   int64 preconnection_count() const { return preconnection_count_; }
-  void IncrementPreconnectionCount() { ++preconnection_count_; }
+  void IncrementPreconnectionCount() {
+    ++preconnection_count_;
+    preconnection_pending_ = true;
+  }
+
+  // The outcomes of the preconnections made for this subresource.
+  int64 preconnection_hit_count() const { return preconnection_hit_count_; }
+  int64 preconnection_waste_count() const {
+    return preconnection_waste_count_;
+  }
 
   int64 preresolution_count() const { return preresolution_count_; }
   void preresolution_increment() { ++preresolution_count_; }
@@ -78,6 +93,14 @@ class ReferrerValue {
   // of its referrer.
   int64 preresolution_count_;
 
+  // The number of preconnections that were, and were not, followed by a
+  // navigation to this item before its referrer was observed again.
+  int64 preconnection_hit_count_;
+  int64 preconnection_waste_count_;
+
+  // True from a preconnection until it is counted as a hit or a waste.
+  bool preconnection_pending_;
+
   // A smoothed estimate of the expected number of connections that will be made
   // to this subresource.
   double subresource_use_rate_;
@@ -89,6 +112,24 @@ class ReferrerValue {
 // around.
 typedef std::map<GURL, ReferrerValue> SubresourceMap;
 
+//------------------------------------------------------------------------------
+// What a Referrer predicts about one of its subresources.
+struct PredictedSubresource {
+  PredictedSubresource(const GURL& url,
+                       double expected_connections,
+                       double confidence);
+
+  GURL url;
+
+  // The smoothed number of connections a load of the referrer makes to |url|.
+  double expected_connections;
+
+  // The fraction of the loads of the referrer during this session that
+  // needed |url|, from 0 to 1.
+  double confidence;
+};
+typedef std::vector<PredictedSubresource> PredictedSubresources;
+
 //------------------------------------------------------------------------------
 // There is one Referrer instance for each hostname that has acted as an HTTP
 // referer (note mispelling is intentional) for a hostname that was otherwise
@@ -109,6 +150,14 @@ class Referrer : public SubresourceMap {
   // discarded to make room for this insertion.
   void SuggestHost(const GURL& url);
 
+  // Fill |predictions| with the subresources, most expected connections
+  // first.
+  void GetPredictions(PredictedSubresources* predictions) const;
+
+  // The number of connections a load of this referrer is expected to make,
+  // which is how valuable it is to keep.
+  double GetExpectedConnections() const;
+
   // Trim the Referrer, by first diminishing (scaling down) the subresource
   // use expectation for each ReferredValue.
   // Returns true if expected use rate is greater than the threshold.
@@ -118,6 +167,11 @@ class Referrer : public SubresourceMap {
   base::Value* Serialize() const;
   void Deserialize(const base::Value& referrers);
 
+  // The same, in the compact binary form used by PredictorStore. Returns
+  // false if |iter| does not hold a complete list.
+  void WriteToPickle(Pickle* pickle) const;
+  bool ReadFromPickle(PickleIterator* iter);
+
  private:
   // Helper function for pruning list.  Metric for usefulness is "large accrued
   // value," in the form of latency_ savings associated with a host name.  We
@@ -0,0 +1,475 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/net/sqlite_http_server_properties_store.h"
+
+#include <map>
+
+#include "base/basictypes.h"
+#include "base/bind.h"
+#include "base/file_util.h"
+#include "base/files/file_path.h"
+#include "base/logging.h"
+#include "base/metrics/histogram.h"
+#include "base/pickle.h"
+#include "base/sequenced_task_runner.h"
+#include "base/synchronization/lock.h"
+#include "sql/error_delegate_util.h"
+#include "sql/meta_table.h"
+#include "sql/statement.h"
+#include "sql/transaction.h"
+
+namespace chrome_browser_net {
+
+namespace {
+
+// Version number of the database.
+const int kCurrentVersionNumber = 1;
+const int kCompatibleVersionNumber = 1;
+
+// Commit this long after the first change of a batch.
+const int kCommitIntervalMs = 10 * 1000;
+
+// Commit right away once this many servers have pending changes.
+const size_t kCommitAfterBatchSize = 512;
+
+bool InitTable(sql::Connection* db) {
+  if (db->DoesTableExist("servers"))
+    return true;
+  return db->Execute("CREATE TABLE servers ("
+                     "host_port TEXT NOT NULL UNIQUE PRIMARY KEY,"
+                     "supports_spdy INTEGER NOT NULL,"
+                     "alternate_port INTEGER,"
+                     "alternate_protocol INTEGER,"
+                     "pipeline_capability INTEGER NOT NULL,"
+                     "spdy_settings BLOB)");
+}
+
+// SPDY settings are stored as a pickled list of (id, value) pairs. As with the
+// preferences, only persisted settings are stored, so the flags are implied.
+void SerializeSettings(const net::SettingsMap& settings, Pickle* pickle) {
+  pickle->WriteUInt32(static_cast<uint32>(settings.size()));
+  for (net::SettingsMap::const_iterator it = settings.begin();
+       it != settings.end(); ++it) {
+    pickle->WriteUInt32(static_cast<uint32>(it->first));
+    pickle->WriteUInt32(it->second.second);
+  }
+}
+
+bool DeserializeSettings(const std::string& blob, net::SettingsMap* settings) {
+  if (blob.empty())
+    return true;
+  Pickle pickle(blob.data(), blob.size());
+  PickleIterator iter(pickle);
+  uint32 count = 0;
+  if (!iter.ReadUInt32(&count))
+    return false;
+  for (uint32 i = 0; i < count; ++i) {
+    uint32 id = 0;
+    uint32 value = 0;
+    if (!iter.ReadUInt32(&id) || !iter.ReadUInt32(&value))
+      return false;
+    (*settings)[static_cast<net::SpdySettingsIds>(id)] =
+        net::SettingsFlagsAndValue(net::SETTINGS_FLAG_PERSISTED, value);
+  }
+  return true;
+}
+
+}  // namespace
+
+SQLiteHttpServerPropertiesStore::ServerProperties::ServerProperties()
+    : supports_spdy(false),
+      has_alternate_protocol(false),
+      pipeline_capability(net::PIPELINE_UNKNOWN) {
+}
+
+SQLiteHttpServerPropertiesStore::ServerProperties::~ServerProperties() {
+}
+
+bool SQLiteHttpServerPropertiesStore::ServerProperties::IsEmpty() const {
+  return !supports_spdy && settings.empty() && !has_alternate_protocol &&
+      pipeline_capability == net::PIPELINE_UNKNOWN;
+}
+
+// This class is designed to be shared between any calling threads and the
+// background task runner. It coalesces updates per server and commits them on
+// a timer.
+class SQLiteHttpServerPropertiesStore::Backend
+    : public base::RefCountedThreadSafe<
+          SQLiteHttpServerPropertiesStore::Backend> {
+ public:
+  Backend(
+      const base::FilePath& path,
+      const scoped_refptr<base::SequencedTaskRunner>& background_task_runner)
+      : path_(path),
+        delete_all_pending_(false),
+        commit_scheduled_(false),
+        background_task_runner_(background_task_runner),
+        corruption_detected_(false) {}
+
+  void Load(const LoadedCallback& loaded_callback);
+  void UpdateServer(const ServerProperties& properties);
+  void DeleteServer(const net::HostPortPair& server);
+  void DeleteAll();
+  void Flush(const base::Closure& callback);
+
+  // Commits any pending operations and closes the database. This must be
+  // called before the object is destructed.
+  void Close();
+
+ private:
+  friend class base::RefCountedThreadSafe<
+      SQLiteHttpServerPropertiesStore::Backend>;
+
+  // A pending update for a server. |deleted| means the row is removed.
+  struct PendingUpdate {
+    PendingUpdate() : deleted(false) {}
+
+    bool deleted;
+    ServerProperties properties;
+  };
+  typedef std::map<net::HostPortPair, PendingUpdate> PendingUpdateMap;
+
+  // You should call Close() before destructing this object.
+  ~Backend() {
+    DCHECK(!db_.get()) << "Close should have already been called.";
+    DCHECK(pending_.empty() && !delete_all_pending_);
+  }
+
+  void LoadOnDBThread(ServerPropertiesVector* servers);
+  bool EnsureDatabaseVersion();
+
+  // Records |update| for |server| and schedules a commit.
+  void BatchUpdate(const net::HostPortPair& server,
+                   const PendingUpdate& update);
+
+  // Commits the pending updates to the database.
+  void Commit();
+
+  // Close() executed on the background thread.
+  void InternalBackgroundClose();
+
+  void DatabaseErrorCallback(int error, sql::Statement* stmt);
+  void KillDatabase();
+
+  base::FilePath path_;
+  scoped_ptr<sql::Connection> db_;
+  sql::MetaTable meta_table_;
+
+  PendingUpdateMap pending_;
+  bool delete_all_pending_;
+  bool commit_scheduled_;
+  // Guards |pending_|, |delete_all_pending_| and |commit_scheduled_|.
+  base::Lock lock_;
+
+  scoped_refptr<base::SequencedTaskRunner> background_task_runner_;
+
+  // Indicates if the kill-database callback has been scheduled.
+  bool corruption_detected_;
+
+  DISALLOW_COPY_AND_ASSIGN(Backend);
+};
+
+void SQLiteHttpServerPropertiesStore::Backend::Load(
+    const LoadedCallback& loaded_callback) {
+  scoped_ptr<ServerPropertiesVector> servers(new ServerPropertiesVector);
+  ServerPropertiesVector* servers_ptr = servers.get();
+
+  background_task_runner_->PostTaskAndReply(
+      FROM_HERE,
+      base::Bind(&Backend::LoadOnDBThread, this, servers_ptr),
+      base::Bind(loaded_callback, base::Passed(&servers)));
+}
+
+void SQLiteHttpServerPropertiesStore::Backend::LoadOnDBThread(
+    ServerPropertiesVector* servers) {
+  DCHECK(background_task_runner_->RunsTasksOnCurrentThread());
+
+  // This method should be called only once per instance.
+  DCHECK(!db_.get());
+
+  base::TimeTicks start = base::TimeTicks::Now();
+
+  const base::FilePath dir = path_.DirName();
+  if (!base::PathExists(dir) && !file_util::CreateDirectory(dir))
+    return;
+
+  db_.reset(new sql::Connection);
+  db_->set_histogram_tag("HttpServerProperties");
+
+  // Unretained to avoid a ref loop with db_.
+  db_->set_error_callback(
+      base::Bind(&Backend::DatabaseErrorCallback, base::Unretained(this)));
+
+  if (!db_->Open(path_) || !EnsureDatabaseVersion() ||
+      !InitTable(db_.get())) {
+    LOG(WARNING) << "Unable to open the HTTP server properties DB.";
+    if (corruption_detected_)
+      KillDatabase();
+    meta_table_.Reset();
+    db_.reset();
+    return;
+  }
+
+  sql::Statement smt(db_->GetUniqueStatement(
+      "SELECT host_port, supports_spdy, alternate_port, alternate_protocol, "
+      "pipeline_capability, spdy_settings FROM servers"));
+  if (!smt.is_valid()) {
+    if (corruption_detected_)
+      KillDatabase();
+    meta_table_.Reset();
+    db_.reset();
+    return;
+  }
+
+  while (smt.Step()) {
+    ServerProperties properties;
+    properties.server = net::HostPortPair::FromString(smt.ColumnString(0));
+    if (properties.server.host().empty())
+      continue;
+    properties.supports_spdy = smt.ColumnBool(1);
+    if (smt.ColumnType(3) != sql::COLUMN_TYPE_NULL) {
+      properties.alternate_protocol.port =
+          static_cast<uint16>(smt.ColumnInt(2));
+      properties.alternate_protocol.protocol =
+          static_cast<net::AlternateProtocol>(smt.ColumnInt(3));
+      properties.has_alternate_protocol =
+          net::IsAlternateProtocolValid(properties.alternate_protocol.protocol);
+    }
+    properties.pipeline_capability =
+        static_cast<net::HttpPipelinedHostCapability>(smt.ColumnInt(4));
+    std::string settings_blob;
+    smt.ColumnBlobAsString(5, &settings_blob);
+    if (!DeserializeSettings(settings_blob, &properties.settings))
+      properties.settings.clear();
+    servers->push_back(properties);
+  }
+
+  UMA_HISTOGRAM_COUNTS("Net.HttpServerProperties.DBLoadedCount",
+                       servers->size());
+  UMA_HISTOGRAM_TIMES("Net.HttpServerProperties.DBLoadTime",
+                      base::TimeTicks::Now() - start);
+}
+
+bool SQLiteHttpServerPropertiesStore::Backend::EnsureDatabaseVersion() {
+  if (!meta_table_.Init(
+      db_.get(), kCurrentVersionNumber, kCompatibleVersionNumber)) {
+    return false;
+  }
+
+  if (meta_table_.GetCompatibleVersionNumber() > kCurrentVersionNumber) {
+    LOG(WARNING) << "HTTP server properties database is too new.";
+    return false;
+  }
+
+  // Put future migration cases here.
+
+  return true;
+}
+
+void SQLiteHttpServerPropertiesStore::Backend::DatabaseErrorCallback(
+    int error,
+    sql::Statement* stmt) {
+  DCHECK(background_task_runner_->RunsTasksOnCurrentThread());
+
+  if (!sql::IsErrorCatastrophic(error) || corruption_detected_)
+    return;
+
+  corruption_detected_ = true;
+  background_task_runner_->PostTask(FROM_HERE,
+                                    base::Bind(&Backend::KillDatabase, this));
+}
+
+void SQLiteHttpServerPropertiesStore::Backend::KillDatabase() {
+  DCHECK(background_task_runner_->RunsTasksOnCurrentThread());
+
+  if (db_) {
+    // The properties will be learned again; the database is recreated on the
+    // next run.
+    bool success = db_->RazeAndClose();
+    UMA_HISTOGRAM_BOOLEAN("Net.HttpServerProperties.KillDatabaseResult",
+                          success);
+    meta_table_.Reset();
+    db_.reset();
+  }
+}
+
+void SQLiteHttpServerPropertiesStore::Backend::UpdateServer(
+    const ServerProperties& properties) {
+  PendingUpdate update;
+  update.properties = properties;
+  BatchUpdate(properties.server, update);
+}
+
+void SQLiteHttpServerPropertiesStore::Backend::DeleteServer(
+    const net::HostPortPair& server) {
+  PendingUpdate update;
+  update.deleted = true;
+  BatchUpdate(server, update);
+}
+
+void SQLiteHttpServerPropertiesStore::Backend::DeleteAll() {
+  {
+    base::AutoLock locked(lock_);
+    pending_.clear();
+    delete_all_pending_ = true;
+  }
+  background_task_runner_->PostTask(FROM_HERE,
+                                    base::Bind(&Backend::Commit, this));
+}
+
+void SQLiteHttpServerPropertiesStore::Backend::BatchUpdate(
+    const net::HostPortPair& server,
+    const PendingUpdate& update) {
+  size_t num_pending;
+  bool schedule_commit;
+  {
+    base::AutoLock locked(lock_);
+    pending_[server] = update;
+    num_pending = pending_.size();
+    schedule_commit = !commit_scheduled_;
+    commit_scheduled_ = true;
+  }
+
+  if (schedule_commit) {
+    // We've gotten our first entry for this batch, fire off the timer.
+    background_task_runner_->PostDelayedTask(
+        FROM_HERE,
+        base::Bind(&Backend::Commit, this),
+        base::TimeDelta::FromMilliseconds(kCommitIntervalMs));
+  } else if (num_pending == kCommitAfterBatchSize) {
+    // We've reached a big enough batch, fire off a commit now.
+    background_task_runner_->PostTask(FROM_HERE,
+                                      base::Bind(&Backend::Commit, this));
+  }
+}
+
+void SQLiteHttpServerPropertiesStore::Backend::Flush(
+    const base::Closure& callback) {
+  background_task_runner_->PostTaskAndReply(
+      FROM_HERE, base::Bind(&Backend::Commit, this), callback);
+}
+
+void SQLiteHttpServerPropertiesStore::Backend::Commit() {
+  DCHECK(background_task_runner_->RunsTasksOnCurrentThread());
+
+  PendingUpdateMap updates;
+  bool delete_all;
+  {
+    base::AutoLock locked(lock_);
+    pending_.swap(updates);
+    delete_all = delete_all_pending_;
+    delete_all_pending_ = false;
+    commit_scheduled_ = false;
+  }
+
+  // Maybe an old timer fired or we are already Close()'ed.
+  if (!db_.get() || (updates.empty() && !delete_all))
+    return;
+
+  sql::Transaction transaction(db_.get());
+  if (!transaction.Begin())
+    return;
+
+  if (delete_all && !db_->Execute("DELETE FROM servers")) {
+    NOTREACHED() << "Could not clear the HTTP server properties DB.";
+    return;
+  }
+
+  sql::Statement update_smt(db_->GetCachedStatement(SQL_FROM_HERE,
+      "INSERT OR REPLACE INTO servers (host_port, supports_spdy, "
+      "alternate_port, alternate_protocol, pipeline_capability, spdy_settings) "
+      "VALUES (?,?,?,?,?,?)"));
+  sql::Statement del_smt(db_->GetCachedStatement(SQL_FROM_HERE,
+      "DELETE FROM servers WHERE host_port=?"));
+  if (!update_smt.is_valid() || !del_smt.is_valid())
+    return;
+
+  for (PendingUpdateMap::const_iterator it = updates.begin();
+       it != updates.end(); ++it) {
+    const std::string host_port = it->first.ToString();
+    const ServerProperties& properties = it->second.properties;
+    if (it->second.deleted || properties.IsEmpty()) {
+      del_smt.Reset(true);
+      del_smt.BindString(0, host_port);
+      if (!del_smt.Run())
+        NOTREACHED() << "Could not delete a server from the DB.";
+      continue;
+    }
+
+    update_smt.Reset(true);
+    update_smt.BindString(0, host_port);
+    update_smt.BindBool(1, properties.supports_spdy);
+    if (properties.has_alternate_protocol) {
+      update_smt.BindInt(2, properties.alternate_protocol.port);
+      update_smt.BindInt(3, properties.alternate_protocol.protocol);
+    } else {
+      update_smt.BindNull(2);
+      update_smt.BindNull(3);
+    }
+    update_smt.BindInt(4, properties.pipeline_capability);
+    if (properties.settings.empty()) {
+      update_smt.BindNull(5);
+    } else {
+      Pickle pickle;
+      SerializeSettings(properties.settings, &pickle);
+      update_smt.BindBlob(5, pickle.data(), pickle.size());
+    }
+    if (!update_smt.Run())
+      NOTREACHED() << "Could not update a server in the DB.";
+  }
+  transaction.Commit();
+}
+
+// Fire off a close message to the background thread. We could still have a
+// pending commit timer that will be holding a reference on us, but if/when
+// this fires we will already have been cleaned up and it will be ignored.
+void SQLiteHttpServerPropertiesStore::Backend::Close() {
+  background_task_runner_->PostTask(
+      FROM_HERE, base::Bind(&Backend::InternalBackgroundClose, this));
+}
+
+void SQLiteHttpServerPropertiesStore::Backend::InternalBackgroundClose() {
+  DCHECK(background_task_runner_->RunsTasksOnCurrentThread());
+  // Commit any pending operations.
+  Commit();
+  db_.reset();
+}
+
+SQLiteHttpServerPropertiesStore::SQLiteHttpServerPropertiesStore(
+    const base::FilePath& path,
+    const scoped_refptr<base::SequencedTaskRunner>& background_task_runner)
+    : backend_(new Backend(path, background_task_runner)) {
+}
+
+void SQLiteHttpServerPropertiesStore::Load(
+    const LoadedCallback& loaded_callback) {
+  backend_->Load(loaded_callback);
+}
+
+void SQLiteHttpServerPropertiesStore::UpdateServer(
+    const ServerProperties& properties) {
+  backend_->UpdateServer(properties);
+}
+
+void SQLiteHttpServerPropertiesStore::DeleteServer(
+    const net::HostPortPair& server) {
+  backend_->DeleteServer(server);
+}
+
+void SQLiteHttpServerPropertiesStore::DeleteAll() {
+  backend_->DeleteAll();
+}
+
+void SQLiteHttpServerPropertiesStore::Flush(const base::Closure& callback) {
+  backend_->Flush(callback);
+}
+
+SQLiteHttpServerPropertiesStore::~SQLiteHttpServerPropertiesStore() {
+  backend_->Close();
+  // We release our reference to the Backend, though it will probably still have
+  // a reference if the background thread has not run Close() yet.
+}
+
+}  // namespace chrome_browser_net
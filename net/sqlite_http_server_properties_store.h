@@ -0,0 +1,89 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_NET_SQLITE_HTTP_SERVER_PROPERTIES_STORE_H_
+#define CHROME_BROWSER_NET_SQLITE_HTTP_SERVER_PROPERTIES_STORE_H_
+
+#include <vector>
+
+#include "base/callback_forward.h"
+#include "base/compiler_specific.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "net/base/host_port_pair.h"
+#include "net/http/http_pipelined_host_capability.h"
+#include "net/http/http_server_properties.h"
+
+namespace base {
+class FilePath;
+class SequencedTaskRunner;
+}
+
+namespace chrome_browser_net {
+
+// Persists the properties HttpServerPropertiesManager tracks per server in a
+// SQLite database, one row per server, instead of in the JSON Preferences
+// file. Only servers whose properties changed are written, batched on the
+// background task runner.
+//
+// Can be used from any thread; the loaded and flushed callbacks are run on the
+// thread that called Load() and Flush() respectively.
+class SQLiteHttpServerPropertiesStore
+    : public base::RefCountedThreadSafe<SQLiteHttpServerPropertiesStore> {
+ public:
+  // Everything that is persisted for a single server.
+  struct ServerProperties {
+    ServerProperties();
+    ~ServerProperties();
+
+    // Returns true if there is nothing worth persisting for the server.
+    bool IsEmpty() const;
+
+    net::HostPortPair server;
+    bool supports_spdy;
+    net::SettingsMap settings;
+    bool has_alternate_protocol;
+    net::PortAlternateProtocolPair alternate_protocol;
+    net::HttpPipelinedHostCapability pipeline_capability;
+  };
+  typedef std::vector<ServerProperties> ServerPropertiesVector;
+
+  typedef base::Callback<void(scoped_ptr<ServerPropertiesVector>)>
+      LoadedCallback;
+
+  SQLiteHttpServerPropertiesStore(
+      const base::FilePath& path,
+      const scoped_refptr<base::SequencedTaskRunner>& background_task_runner);
+
+  // Opens the database, and returns every stored server to |loaded_callback|.
+  // Must be called once, before any other method.
+  void Load(const LoadedCallback& loaded_callback);
+
+  // Batches an update of the stored properties for |properties.server|. Only
+  // the latest update per server is written.
+  void UpdateServer(const ServerProperties& properties);
+
+  // Batches the removal of |server|.
+  void DeleteServer(const net::HostPortPair& server);
+
+  // Drops all pending updates and deletes every stored server.
+  void DeleteAll();
+
+  // Commits the pending updates, then runs |callback|.
+  void Flush(const base::Closure& callback);
+
+ private:
+  friend class base::RefCountedThreadSafe<SQLiteHttpServerPropertiesStore>;
+  class Backend;
+
+  virtual ~SQLiteHttpServerPropertiesStore();
+
+  scoped_refptr<Backend> backend_;
+
+  DISALLOW_COPY_AND_ASSIGN(SQLiteHttpServerPropertiesStore);
+};
+
+}  // namespace chrome_browser_net
+
+#endif  // CHROME_BROWSER_NET_SQLITE_HTTP_SERVER_PROPERTIES_STORE_H_
@@ -0,0 +1,159 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/bind.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/memory/ref_counted.h"
+#include "base/message_loop/message_loop.h"
+#include "base/run_loop.h"
+#include "chrome/browser/net/sqlite_http_server_properties_store.h"
+#include "content/public/test/test_browser_thread_bundle.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace chrome_browser_net {
+
+namespace {
+
+const base::FilePath::CharType kStoreFilename[] =
+    FILE_PATH_LITERAL("Network Properties");
+
+}  // namespace
+
+class SQLiteHttpServerPropertiesStoreTest : public testing::Test {
+ public:
+  void Load(SQLiteHttpServerPropertiesStore::ServerPropertiesVector* servers) {
+    base::RunLoop run_loop;
+    store_->Load(base::Bind(&SQLiteHttpServerPropertiesStoreTest::OnLoaded,
+                            base::Unretained(this),
+                            &run_loop));
+    run_loop.Run();
+    servers->swap(servers_);
+    servers_.clear();
+  }
+
+  void OnLoaded(
+      base::RunLoop* run_loop,
+      scoped_ptr<SQLiteHttpServerPropertiesStore::ServerPropertiesVector>
+          servers) {
+    servers_.swap(*servers);
+    run_loop->Quit();
+  }
+
+ protected:
+  virtual void SetUp() {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    CreateStore();
+    SQLiteHttpServerPropertiesStore::ServerPropertiesVector servers;
+    Load(&servers);
+    ASSERT_EQ(0u, servers.size());
+  }
+
+  void CreateStore() {
+    store_ = new SQLiteHttpServerPropertiesStore(
+        temp_dir_.path().Append(kStoreFilename),
+        base::MessageLoopProxy::current());
+  }
+
+  // Destroys the store, which writes its data to disk, and opens it again.
+  void ReopenStore(
+      SQLiteHttpServerPropertiesStore::ServerPropertiesVector* servers) {
+    store_ = NULL;
+    // Make sure we wait until the destructor has run.
+    base::RunLoop().RunUntilIdle();
+    CreateStore();
+    Load(servers);
+  }
+
+  content::TestBrowserThreadBundle thread_bundle_;
+  base::ScopedTempDir temp_dir_;
+  scoped_refptr<SQLiteHttpServerPropertiesStore> store_;
+  SQLiteHttpServerPropertiesStore::ServerPropertiesVector servers_;
+};
+
+TEST_F(SQLiteHttpServerPropertiesStoreTest, TestPersistence) {
+  SQLiteHttpServerPropertiesStore::ServerProperties spdy_server;
+  spdy_server.server = net::HostPortPair("mail.google.com", 443);
+  spdy_server.supports_spdy = true;
+  spdy_server.settings[net::SETTINGS_UPLOAD_BANDWIDTH] =
+      net::SettingsFlagsAndValue(net::SETTINGS_FLAG_PERSISTED, 31337);
+  store_->UpdateServer(spdy_server);
+
+  SQLiteHttpServerPropertiesStore::ServerProperties alternate_server;
+  alternate_server.server = net::HostPortPair("www.google.com", 80);
+  alternate_server.has_alternate_protocol = true;
+  alternate_server.alternate_protocol.port = 443;
+  alternate_server.alternate_protocol.protocol = net::NPN_SPDY_3;
+  alternate_server.pipeline_capability = net::PIPELINE_CAPABLE;
+  store_->UpdateServer(alternate_server);
+
+  SQLiteHttpServerPropertiesStore::ServerPropertiesVector servers;
+  ReopenStore(&servers);
+  ASSERT_EQ(2u, servers.size());
+
+  // Pending updates are committed in server order.
+  const SQLiteHttpServerPropertiesStore::ServerProperties& mail = servers[0];
+  EXPECT_TRUE(mail.server.Equals(spdy_server.server));
+  EXPECT_TRUE(mail.supports_spdy);
+  ASSERT_EQ(1u, mail.settings.size());
+  EXPECT_EQ(31337u, mail.settings.find(net::SETTINGS_UPLOAD_BANDWIDTH)->
+                        second.second);
+  EXPECT_FALSE(mail.has_alternate_protocol);
+  EXPECT_EQ(net::PIPELINE_UNKNOWN, mail.pipeline_capability);
+
+  const SQLiteHttpServerPropertiesStore::ServerProperties& www = servers[1];
+  EXPECT_TRUE(www.server.Equals(alternate_server.server));
+  EXPECT_FALSE(www.supports_spdy);
+  EXPECT_TRUE(www.settings.empty());
+  ASSERT_TRUE(www.has_alternate_protocol);
+  EXPECT_EQ(443, www.alternate_protocol.port);
+  EXPECT_EQ(net::NPN_SPDY_3, www.alternate_protocol.protocol);
+  EXPECT_EQ(net::PIPELINE_CAPABLE, www.pipeline_capability);
+}
+
+TEST_F(SQLiteHttpServerPropertiesStoreTest, TestUpdatesAreCoalesced) {
+  SQLiteHttpServerPropertiesStore::ServerProperties properties;
+  properties.server = net::HostPortPair("mail.google.com", 443);
+  properties.supports_spdy = true;
+  store_->UpdateServer(properties);
+  properties.supports_spdy = false;
+  properties.pipeline_capability = net::PIPELINE_INCAPABLE;
+  store_->UpdateServer(properties);
+
+  SQLiteHttpServerPropertiesStore::ServerPropertiesVector servers;
+  ReopenStore(&servers);
+  ASSERT_EQ(1u, servers.size());
+  EXPECT_FALSE(servers[0].supports_spdy);
+  EXPECT_EQ(net::PIPELINE_INCAPABLE, servers[0].pipeline_capability);
+
+  // An update leaving nothing to persist removes the server.
+  properties.pipeline_capability = net::PIPELINE_UNKNOWN;
+  store_->UpdateServer(properties);
+  ReopenStore(&servers);
+  EXPECT_EQ(0u, servers.size());
+}
+
+TEST_F(SQLiteHttpServerPropertiesStoreTest, TestDelete) {
+  SQLiteHttpServerPropertiesStore::ServerProperties properties;
+  properties.supports_spdy = true;
+  properties.server = net::HostPortPair("mail.google.com", 443);
+  store_->UpdateServer(properties);
+  properties.server = net::HostPortPair("www.google.com", 443);
+  store_->UpdateServer(properties);
+
+  base::RunLoop run_loop;
+  store_->Flush(run_loop.QuitClosure());
+  run_loop.Run();
+
+  store_->DeleteServer(net::HostPortPair("mail.google.com", 443));
+  SQLiteHttpServerPropertiesStore::ServerPropertiesVector servers;
+  ReopenStore(&servers);
+  ASSERT_EQ(1u, servers.size());
+  EXPECT_EQ("www.google.com", servers[0].server.host());
+
+  store_->DeleteAll();
+  ReopenStore(&servers);
+  EXPECT_EQ(0u, servers.size());
+}
+
+}  // namespace chrome_browser_net
@@ -4,6 +4,7 @@
 
 #include "chrome/browser/net/sqlite_server_bound_cert_store.h"
 
+#include <algorithm>
 #include <list>
 #include <set>
 
@@ -40,6 +41,8 @@ class SQLiteServerBoundCertStore::Backend
       : path_(path),
         num_pending_(0),
         force_keep_session_state_(false),
+        commit_interval_(
+            SQLiteServerBoundCertStore::GetCommitInterval(base::TimeDelta())),
         background_task_runner_(background_task_runner),
         special_storage_policy_(special_storage_policy),
         corruption_detected_(false) {}
@@ -122,7 +125,11 @@ class SQLiteServerBoundCertStore::Backend
   PendingOperationsList::size_type num_pending_;
   // True if the persistent store should skip clear on exit rules.
   bool force_keep_session_state_;
-  // Guard |pending_|, |num_pending_| and |force_keep_session_state_|.
+  // Delay before committing a new batch. Adjusted after every commit so that
+  // committing takes a small, bounded share of the background task runner.
+  base::TimeDelta commit_interval_;
+  // Guard |pending_|, |num_pending_|, |force_keep_session_state_| and
+  // |commit_interval_|.
   base::Lock lock_;
 
   // Cache of origins we have certificates stored for.
@@ -444,8 +451,6 @@ void SQLiteServerBoundCertStore::Backend::DeleteServerBoundCert(
 void SQLiteServerBoundCertStore::Backend::BatchOperation(
     PendingOperation::OperationType op,
     const net::DefaultServerBoundCertStore::ServerBoundCert& cert) {
-  // Commit every 30 seconds.
-  static const int kCommitIntervalMs = 30 * 1000;
   // Commit right away if we have more than 512 outstanding operations.
   static const size_t kCommitAfterBatchSize = 512;
 
@@ -453,10 +458,12 @@ void SQLiteServerBoundCertStore::Backend::BatchOperation(
   scoped_ptr<PendingOperation> po(new PendingOperation(op, cert));
 
   PendingOperationsList::size_type num_pending;
+  base::TimeDelta commit_interval;
   {
     base::AutoLock locked(lock_);
     pending_.push_back(po.release());
     num_pending = ++num_pending_;
+    commit_interval = commit_interval_;
   }
 
   if (num_pending == 1) {
@@ -464,7 +471,7 @@ void SQLiteServerBoundCertStore::Backend::BatchOperation(
     background_task_runner_->PostDelayedTask(
         FROM_HERE,
         base::Bind(&Backend::Commit, this),
-        base::TimeDelta::FromMilliseconds(kCommitIntervalMs));
+        commit_interval);
   } else if (num_pending == kCommitAfterBatchSize) {
     // We've reached a big enough batch, fire off a commit now.
     background_task_runner_->PostTask(FROM_HERE,
@@ -497,6 +504,8 @@ void SQLiteServerBoundCertStore::Backend::Commit() {
   if (!del_smt.is_valid())
     return;
 
+  base::TimeTicks start = base::TimeTicks::Now();
+
   sql::Transaction transaction(db_.get());
   if (!transaction.Begin())
     return;
@@ -535,6 +544,17 @@ void SQLiteServerBoundCertStore::Backend::Commit() {
     }
   }
   transaction.Commit();
+
+  base::TimeDelta commit_interval =
+      SQLiteServerBoundCertStore::GetCommitInterval(
+          base::TimeTicks::Now() - start);
+  UMA_HISTOGRAM_CUSTOM_TIMES("DomainBoundCerts.DBCommitInterval",
+                             commit_interval,
+                             base::TimeDelta::FromSeconds(1),
+                             base::TimeDelta::FromMinutes(5),
+                             50);
+  base::AutoLock locked(lock_);
+  commit_interval_ = commit_interval;
 }
 
 // Fire off a close message to the background thread. We could still have a
@@ -632,6 +652,23 @@ void SQLiteServerBoundCertStore::SetForceKeepSessionState() {
   backend_->SetForceKeepSessionState();
 }
 
+// static
+base::TimeDelta SQLiteServerBoundCertStore::GetCommitInterval(
+    base::TimeDelta commit_time) {
+  // Wait 30 seconds, as always, but longer in proportion to how long
+  // committing takes when that is slow, so that slow disks get larger
+  // batches. Fast disks never commit more often than before.
+  static const int kDefaultCommitIntervalMs = 30 * 1000;
+  static const int kMaxCommitIntervalMs = 2 * 60 * 1000;
+  static const int kCommitIntervalPerCommitTime = 50;
+  base::TimeDelta commit_interval = commit_time * kCommitIntervalPerCommitTime;
+  commit_interval = std::max(
+      commit_interval,
+      base::TimeDelta::FromMilliseconds(kDefaultCommitIntervalMs));
+  return std::min(commit_interval,
+                  base::TimeDelta::FromMilliseconds(kMaxCommitIntervalMs));
+}
+
 SQLiteServerBoundCertStore::~SQLiteServerBoundCertStore() {
   backend_->Close();
   // We release our reference to the Backend, though it will probably still have
@@ -8,6 +8,7 @@
 #include "base/callback_forward.h"
 #include "base/compiler_specific.h"
 #include "base/memory/ref_counted.h"
+#include "base/time/time.h"
 #include "net/ssl/default_server_bound_cert_store.h"
 
 namespace base {
@@ -41,6 +42,10 @@ class SQLiteServerBoundCertStore
       const net::DefaultServerBoundCertStore::ServerBoundCert& cert) OVERRIDE;
   virtual void SetForceKeepSessionState() OVERRIDE;
 
+  // Returns how long operations are batched before they are committed, given
+  // that the last commit took |commit_time|. Exposed for testing.
+  static base::TimeDelta GetCommitInterval(base::TimeDelta commit_time);
+
  protected:
   virtual ~SQLiteServerBoundCertStore();
 
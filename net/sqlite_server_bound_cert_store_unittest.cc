@@ -471,3 +471,19 @@ TEST_F(SQLiteServerBoundCertStoreTest, TestRSADiscarded) {
   // Make sure we wait until the destructor has run.
   base::RunLoop().RunUntilIdle();
 }
+
+TEST(SQLiteServerBoundCertStoreCommitTest, GetCommitInterval) {
+  // Fast commits keep the default interval.
+  EXPECT_EQ(base::TimeDelta::FromSeconds(30),
+            SQLiteServerBoundCertStore::GetCommitInterval(base::TimeDelta()));
+  EXPECT_EQ(base::TimeDelta::FromSeconds(30),
+            SQLiteServerBoundCertStore::GetCommitInterval(
+                base::TimeDelta::FromMilliseconds(20)));
+  // Slow ones lengthen it, up to a bound.
+  EXPECT_EQ(base::TimeDelta::FromSeconds(50),
+            SQLiteServerBoundCertStore::GetCommitInterval(
+                base::TimeDelta::FromSeconds(1)));
+  EXPECT_EQ(base::TimeDelta::FromMinutes(2),
+            SQLiteServerBoundCertStore::GetCommitInterval(
+                base::TimeDelta::FromMinutes(1)));
+}
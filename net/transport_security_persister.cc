@@ -4,12 +4,15 @@
 
 #include "chrome/browser/net/transport_security_persister.h"
 
+#include <algorithm>
+#include <set>
+
 #include "base/base64.h"
 #include "base/bind.h"
+#include "base/bind_helpers.h"
 #include "base/file_util.h"
 #include "base/files/file_path.h"
 #include "base/json/json_reader.h"
-#include "base/json/json_writer.h"
 #include "base/message_loop/message_loop.h"
 #include "base/path_service.h"
 #include "base/values.h"
@@ -27,13 +30,6 @@ using net::TransportSecurityState;
 
 namespace {
 
-ListValue* SPKIHashesToListValue(const HashValueVector& hashes) {
-  ListValue* pins = new ListValue;
-  for (size_t i = 0; i != hashes.size(); i++)
-    pins->Append(new StringValue(hashes[i].ToString()));
-  return pins;
-}
-
 void SPKIHashesFromListValue(const ListValue& pins, HashValueVector* hashes) {
   size_t num_pins = pins.GetSize();
   for (size_t i = 0; i < num_pins; ++i) {
@@ -46,16 +42,8 @@ void SPKIHashesFromListValue(const ListValue& pins, HashValueVector* hashes) {
   }
 }
 
-// This function converts the binary hashes to a base64 string which we can
-// include in a JSON file.
-std::string HashedDomainToExternalString(const std::string& hashed) {
-  std::string out;
-  base::Base64Encode(hashed, &out);
-  return out;
-}
-
-// This inverts |HashedDomainToExternalString|, above. It turns an external
-// string (from a JSON file) into an internal (binary) string.
+// Turns an external string (from a JSON file) into an internal (binary)
+// string.
 std::string ExternalStringToHashedDomain(const std::string& external) {
   std::string out;
   if (!base::Base64Decode(external, &out) ||
@@ -81,20 +69,44 @@ const char kDefault[] = "default";
 const char kPinningOnly[] = "pinning-only";
 const char kCreated[] = "created";
 
+// How long to wait after a change before writing it.
+const int kWriteDelaySeconds = 10;
+
+// The log is folded into a new snapshot once it grows past half the size of
+// the snapshot, or this size for small snapshots.
+const size_t kMinLogSizeToSnapshot = 16 * 1024;
+
+void AppendToLog(const base::FilePath& path,
+                 const std::string& data,
+                 bool create) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::FILE));
+  int size = static_cast<int>(data.size());
+  int written = create ? file_util::WriteFile(path, data.data(), size) :
+                         file_util::AppendToFile(path, data.data(), size);
+  // A partial write is detected, and discarded, when the log is read.
+  if (written != size)
+    LOG(WARNING) << "Failed to write to " << path.value();
+}
+
 }  // namespace
 
 class TransportSecurityPersister::Loader {
  public:
   Loader(const base::WeakPtr<TransportSecurityPersister>& persister,
-         const base::FilePath& path)
+         const base::FilePath& path,
+         const base::FilePath& log_path)
       : persister_(persister),
         path_(path),
+        log_path_(log_path),
         state_valid_(false) {
   }
 
   void Load() {
     DCHECK(BrowserThread::CurrentlyOn(BrowserThread::FILE));
     state_valid_ = base::ReadFileToString(path_, &state_);
+    // The log is optional.
+    if (state_valid_ && !base::ReadFileToString(log_path_, &log_))
+      log_.clear();
   }
 
   void CompleteLoad() {
@@ -105,15 +117,17 @@ class TransportSecurityPersister::Loader {
 
     if (!persister_.get() || !state_valid_)
       return;
-    persister_->CompleteLoad(state_);
+    persister_->CompleteLoad(state_, log_);
   }
 
  private:
   base::WeakPtr<TransportSecurityPersister> persister_;
 
   base::FilePath path_;
+  base::FilePath log_path_;
 
   std::string state_;
+  std::string log_;
   bool state_valid_;
 
   DISALLOW_COPY_AND_ASSIGN(Loader);
@@ -127,13 +141,18 @@ TransportSecurityPersister::TransportSecurityPersister(
       writer_(profile_path.AppendASCII("TransportSecurity"),
               BrowserThread::GetMessageLoopProxyForThread(BrowserThread::FILE)
                   .get()),
+      log_path_(profile_path.AppendASCII("TransportSecurity-log")),
+      log_size_(0),
+      generation_(0),
+      snapshot_needed_(true),
       readonly_(readonly),
       weak_ptr_factory_(this) {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
 
   transport_security_state_->SetDelegate(this);
 
-  Loader* loader = new Loader(weak_ptr_factory_.GetWeakPtr(), writer_.path());
+  Loader* loader = new Loader(weak_ptr_factory_.GetWeakPtr(), writer_.path(),
+                              log_path_);
   BrowserThread::PostTaskAndReply(
       BrowserThread::FILE, FROM_HERE,
       base::Bind(&Loader::Load, base::Unretained(loader)),
@@ -143,8 +162,10 @@ TransportSecurityPersister::TransportSecurityPersister(
 TransportSecurityPersister::~TransportSecurityPersister() {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
 
-  if (writer_.HasPendingWrite())
-    writer_.DoScheduledWrite();
+  if (write_timer_.IsRunning()) {
+    write_timer_.Stop();
+    WriteChanges();
+  }
 
   transport_security_state_->SetDelegate(NULL);
 }
@@ -154,67 +175,208 @@ void TransportSecurityPersister::StateIsDirty(
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
   DCHECK_EQ(transport_security_state_, state);
 
-  if (!readonly_)
-    writer_.ScheduleWrite(this);
+  if (!readonly_ && !write_timer_.IsRunning()) {
+    write_timer_.Start(FROM_HERE,
+                       base::TimeDelta::FromSeconds(kWriteDelaySeconds),
+                       this, &TransportSecurityPersister::WriteChanges);
+  }
 }
 
 bool TransportSecurityPersister::SerializeData(std::string* output) {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
 
-  DictionaryValue toplevel;
+  TransportSecuritySnapshot::RecordMap records;
   base::Time now = base::Time::Now();
   TransportSecurityState::Iterator state(*transport_security_state_);
   for (; state.HasNext(); state.Advance()) {
-    const std::string& hostname = state.hostname();
-    const TransportSecurityState::DomainState& domain_state =
-        state.domain_state();
-
-    DictionaryValue* serialized = new DictionaryValue;
-    serialized->SetBoolean(kStsIncludeSubdomains,
-                           domain_state.sts_include_subdomains);
-    serialized->SetBoolean(kPkpIncludeSubdomains,
-                           domain_state.pkp_include_subdomains);
-    serialized->SetDouble(kCreated, domain_state.created.ToDoubleT());
-    serialized->SetDouble(kExpiry, domain_state.upgrade_expiry.ToDoubleT());
-    serialized->SetDouble(kDynamicSPKIHashesExpiry,
-                          domain_state.dynamic_spki_hashes_expiry.ToDoubleT());
-
-    switch (domain_state.upgrade_mode) {
-      case TransportSecurityState::DomainState::MODE_FORCE_HTTPS:
-        serialized->SetString(kMode, kForceHTTPS);
-        break;
-      case TransportSecurityState::DomainState::MODE_DEFAULT:
-        serialized->SetString(kMode, kDefault);
-        break;
-      default:
-        NOTREACHED() << "DomainState with unknown mode";
-        delete serialized;
-        continue;
+    std::string record;
+    if (!TransportSecuritySnapshot::EncodeDomainState(state.domain_state(),
+                                                      now, &record)) {
+      NOTREACHED() << "DomainState with unknown mode";
+      continue;
     }
+    records[state.hostname()].swap(record);
+  }
 
-    serialized->Set(kStaticSPKIHashes,
-                    SPKIHashesToListValue(domain_state.static_spki_hashes));
+  TransportSecuritySnapshot::Build(generation_, records, output);
+  return true;
+}
 
-    if (now < domain_state.dynamic_spki_hashes_expiry) {
-      serialized->Set(kDynamicSPKIHashes,
-                      SPKIHashesToListValue(domain_state.dynamic_spki_hashes));
+bool TransportSecurityPersister::LoadEntries(const std::string& serialized,
+                                             bool* dirty) {
+  return LoadEntriesAndLog(serialized, std::string(), dirty);
+}
+
+bool TransportSecurityPersister::LoadEntriesAndLog(
+    const std::string& serialized,
+    const std::string& log,
+    bool* dirty) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+
+  transport_security_state_->ClearDynamicData();
+  logged_records_.clear();
+  log_size_ = 0;
+  snapshot_needed_ = true;
+
+  if (!TransportSecuritySnapshot::IsSnapshot(serialized)) {
+    snapshot_data_.clear();
+    snapshot_.Init(snapshot_data_);
+    if (!Deserialize(serialized, dirty, transport_security_state_))
+      return false;
+    // Rewrite the state written by an earlier version as a snapshot.
+    *dirty = true;
+    return true;
+  }
+
+  snapshot_data_ = serialized;
+  if (!snapshot_.Init(snapshot_data_)) {
+    snapshot_data_.clear();
+    return false;
+  }
+  generation_ = snapshot_.generation();
+
+  // A log that cannot be appended to is folded into a new snapshot.
+  bool dirtied =
+      !TransportSecuritySnapshot::ReadLog(log, generation_, &logged_records_);
+  snapshot_needed_ = dirtied;
+  log_size_ = log.size();
+
+  const base::Time now(base::Time::Now());
+  for (size_t i = 0; i < snapshot_.size(); ++i) {
+    base::StringPiece hashed_host;
+    base::StringPiece record;
+    if (!snapshot_.GetEntry(i, &hashed_host, &record)) {
+      dirtied = true;
+      continue;
     }
+    std::string hashed = hashed_host.as_string();
+    if (logged_records_.count(hashed))
+      continue;
+    if (!AddRecord(hashed, record, now))
+      dirtied = true;
+  }
+  for (TransportSecuritySnapshot::RecordMap::const_iterator it =
+           logged_records_.begin(); it != logged_records_.end(); ++it) {
+    if (!it->second.empty() && !AddRecord(it->first, it->second, now))
+      dirtied = true;
+  }
 
-    toplevel.Set(HashedDomainToExternalString(hostname), serialized);
+  *dirty = dirtied;
+  return true;
+}
+
+bool TransportSecurityPersister::AddRecord(const std::string& hashed_host,
+                                           const base::StringPiece& record,
+                                           const base::Time& now) {
+  TransportSecurityState::DomainState domain_state;
+  if (!TransportSecuritySnapshot::DecodeDomainState(record, &domain_state)) {
+    LOG(WARNING) << "Could not parse an entry; skipping entry";
+    return false;
   }
 
-  base::JSONWriter::WriteWithOptions(&toplevel,
-                                     base::JSONWriter::OPTIONS_PRETTY_PRINT,
-                                     output);
+  if (domain_state.upgrade_expiry <= now &&
+      domain_state.dynamic_spki_hashes_expiry <= now) {
+    return false;
+  }
+
+  transport_security_state_->AddOrUpdateEnabledHosts(hashed_host,
+                                                     domain_state);
   return true;
 }
 
-bool TransportSecurityPersister::LoadEntries(const std::string& serialized,
-                                             bool* dirty) {
+bool TransportSecurityPersister::GetPersistedRecord(
+    const std::string& hashed_host,
+    base::StringPiece* record) const {
+  TransportSecuritySnapshot::RecordMap::const_iterator it =
+      logged_records_.find(hashed_host);
+  if (it == logged_records_.end())
+    return snapshot_.FindRecord(hashed_host, record);
+  if (it->second.empty())
+    return false;
+  record->set(it->second.data(), it->second.size());
+  return true;
+}
+
+void TransportSecurityPersister::WriteChanges() {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
 
-  transport_security_state_->ClearDynamicData();
-  return Deserialize(serialized, dirty, transport_security_state_);
+  // Find the entries that differ from what is on disk.
+  TransportSecuritySnapshot::RecordMap changes;
+  std::set<std::string> hosts;
+  base::Time now = base::Time::Now();
+  TransportSecurityState::Iterator state(*transport_security_state_);
+  for (; state.HasNext(); state.Advance()) {
+    std::string record;
+    if (!TransportSecuritySnapshot::EncodeDomainState(state.domain_state(),
+                                                      now, &record)) {
+      continue;
+    }
+    hosts.insert(state.hostname());
+    base::StringPiece persisted;
+    if (!GetPersistedRecord(state.hostname(), &persisted) ||
+        persisted != record) {
+      changes[state.hostname()].swap(record);
+    }
+  }
+
+  // And the entries that are on disk but no longer in the state.
+  base::StringPiece unused;
+  for (size_t i = 0; i < snapshot_.size(); ++i) {
+    base::StringPiece hashed_host;
+    if (!snapshot_.GetEntry(i, &hashed_host, NULL))
+      continue;
+    std::string hashed = hashed_host.as_string();
+    if (!hosts.count(hashed) && GetPersistedRecord(hashed, &unused))
+      changes[hashed] = std::string();
+  }
+  for (TransportSecuritySnapshot::RecordMap::const_iterator it =
+           logged_records_.begin(); it != logged_records_.end(); ++it) {
+    if (!it->second.empty() && !hosts.count(it->first))
+      changes[it->first] = std::string();
+  }
+
+  if (changes.empty() && !snapshot_needed_)
+    return;
+
+  std::string log;
+  for (TransportSecuritySnapshot::RecordMap::const_iterator it =
+           changes.begin(); it != changes.end(); ++it) {
+    TransportSecuritySnapshot::AppendLogEntry(generation_, it->first,
+                                              it->second, &log);
+  }
+
+  const size_t max_log_size =
+      std::max(snapshot_data_.size() / 2, kMinLogSizeToSnapshot);
+  if (snapshot_needed_ || log_size_ + log.size() > max_log_size) {
+    // Generations must not repeat across runs, or the entries of an old log
+    // that failed to be deleted could apply to the new snapshot.
+    generation_ = std::max(generation_ + 1,
+        static_cast<uint64>(base::Time::Now().ToInternalValue()));
+    std::string data;
+    SerializeData(&data);
+    writer_.WriteNow(data);
+    // The log is deleted after the snapshot is written; should that fail,
+    // its entries are stale for the new generation anyway.
+    BrowserThread::PostTask(
+        BrowserThread::FILE, FROM_HERE,
+        base::Bind(base::IgnoreResult(&base::DeleteFile), log_path_, false));
+
+    snapshot_data_.swap(data);
+    snapshot_.Init(snapshot_data_);
+    logged_records_.clear();
+    log_size_ = 0;
+    snapshot_needed_ = false;
+    return;
+  }
+
+  BrowserThread::PostTask(
+      BrowserThread::FILE, FROM_HERE,
+      base::Bind(&AppendToLog, log_path_, log, log_size_ == 0));
+  log_size_ += log.size();
+  for (TransportSecuritySnapshot::RecordMap::iterator it = changes.begin();
+       it != changes.end(); ++it) {
+    logged_records_[it->first].swap(it->second);
+  }
 }
 
 // static
@@ -326,11 +488,12 @@ bool TransportSecurityPersister::Deserialize(const std::string& serialized,
   return true;
 }
 
-void TransportSecurityPersister::CompleteLoad(const std::string& state) {
+void TransportSecurityPersister::CompleteLoad(const std::string& state,
+                                              const std::string& log) {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
 
   bool dirty = false;
-  if (!LoadEntries(state, &dirty)) {
+  if (!LoadEntriesAndLog(state, log, &dirty)) {
     LOG(ERROR) << "Failed to deserialize state: " << state;
     return;
   }
@@ -21,14 +21,16 @@
 //
 // TransportSecurityState calls...
 // TransportSecurityPersister::StateIsDirty
-//   since the callback isn't allowed to block or reenter, we schedule a Task
-//   on the file thread after some small amount of time
+//   since the callback isn't allowed to block or reenter, we start a timer
+//   and write after some small amount of time
 //
 // ...
 //
-// TransportSecurityPersister::SerializeState
-//   copies the current state of the TransportSecurityState, serializes
-//   and writes to disk.
+// TransportSecurityPersister::WriteChanges
+//   compares the current state of the TransportSecurityState with what is on
+//   disk, and appends the entries that changed to a log on the file thread.
+//   Once the log has grown large enough, a new snapshot of the whole state
+//   is written instead and the log is discarded.
 
 #ifndef CHROME_BROWSER_NET_TRANSPORT_SECURITY_PERSISTER_H_
 #define CHROME_BROWSER_NET_TRANSPORT_SECURITY_PERSISTER_H_
@@ -38,13 +40,14 @@
 #include "base/files/file_path.h"
 #include "base/files/important_file_writer.h"
 #include "base/memory/weak_ptr.h"
+#include "base/timer/timer.h"
+#include "chrome/browser/net/transport_security_snapshot.h"
 #include "net/http/transport_security_state.h"
 
 // Reads and updates on-disk TransportSecurity state.
 // Must be created, used and destroyed only on the IO thread.
 class TransportSecurityPersister
-    : public net::TransportSecurityState::Delegate,
-      public base::ImportantFileWriter::DataSerializer {
+    : public net::TransportSecurityState::Delegate {
  public:
   TransportSecurityPersister(net::TransportSecurityState* state,
                              const base::FilePath& profile_path,
@@ -54,10 +57,37 @@ class TransportSecurityPersister
   // Called by the TransportSecurityState when it changes its state.
   virtual void StateIsDirty(net::TransportSecurityState*) OVERRIDE;
 
-  // ImportantFileWriter::DataSerializer:
+  // Serializes |transport_security_state_| into |*output| as a snapshot
+  // (see TransportSecuritySnapshot). Returns true if all DomainStates were
+  // serialized correctly.
   //
-  // Serializes |transport_security_state_| into |*output|. Returns true if
-  // all DomainStates were serialized correctly.
+  // Each DomainState is stored under
+  // SHA256(net::TransportSecurityState::CanonicalizeHost(domain)).
+  // The reason for hashing them is so that the stored state does not
+  // trivially reveal a user's browsing history to an attacker reading the
+  // serialized state on disk.
+  bool SerializeData(std::string* output);
+
+  // Clears any existing non-static entries, and then re-populates
+  // |transport_security_state_| from a snapshot, or from the JSON dictionary
+  // written by earlier versions.
+  //
+  // Sets |*dirty| to true if the new state differs from the persisted
+  // state; false otherwise.
+  bool LoadEntries(const std::string& serialized, bool* dirty);
+
+ private:
+  class Loader;
+
+  // Like LoadEntries(), additionally applying the changes recorded in |log|
+  // on top of the snapshot in |serialized|.
+  bool LoadEntriesAndLog(const std::string& serialized,
+                         const std::string& log,
+                         bool* dirty);
+
+  // Populates |state| from the JSON string |serialized|, the format used
+  // before snapshots. Returns true if all entries were parsed and
+  // deserialized correctly.
   //
   // The serialization format is JSON; the JSON represents a dictionary of
   // host:DomainState pairs (host is a string). The DomainState is
@@ -79,25 +109,7 @@ class TransportSecurityPersister
   //         legacy key synonym "bad_preloaded_spki_hashes"
   //     "dynamic_spki_hashes": list of strings
   //
-  // The JSON dictionary keys are strings containing
-  // Base64(SHA256(net::TransportSecurityState::CanonicalizeHost(domain))).
-  // The reason for hashing them is so that the stored state does not
-  // trivially reveal a user's browsing history to an attacker reading the
-  // serialized state on disk.
-  virtual bool SerializeData(std::string* data) OVERRIDE;
-
-  // Clears any existing non-static entries, and then re-populates
-  // |transport_security_state_|.
-  //
-  // Sets |*dirty| to true if the new state differs from the persisted
-  // state; false otherwise.
-  bool LoadEntries(const std::string& serialized, bool* dirty);
-
- private:
-  class Loader;
-
-  // Populates |state| from the JSON string |serialized|. Returns true if
-  // all entries were parsed and deserialized correctly.
+  // The JSON dictionary keys are Base64 encoded hashed hosts.
   //
   // Sets |*dirty| to true if the new state differs from the persisted
   // state; false otherwise.
@@ -105,13 +117,48 @@ class TransportSecurityPersister
                           bool* dirty,
                           net::TransportSecurityState* state);
 
-  void CompleteLoad(const std::string& state);
+  // Adds the entry in |record| for |hashed_host| to
+  // |transport_security_state_|, unless it has expired. Returns false if the
+  // entry was dropped.
+  bool AddRecord(const std::string& hashed_host,
+                 const base::StringPiece& record,
+                 const base::Time& now);
+
+  // Returns the record on disk for |hashed_host|. Returns false if there is
+  // none.
+  bool GetPersistedRecord(const std::string& hashed_host,
+                          base::StringPiece* record) const;
+
+  // Writes the changes made since the last write, as an append to the log
+  // or, when the log has grown too large, as a new snapshot.
+  void WriteChanges();
+
+  void CompleteLoad(const std::string& state, const std::string& log);
 
   net::TransportSecurityState* transport_security_state_;
 
-  // Helper for safely writing the data.
+  // Helper for safely writing snapshots.
   base::ImportantFileWriter writer_;
 
+  // The log of changes made since the last snapshot.
+  const base::FilePath log_path_;
+
+  // Delays writes, so that changes made close together are written once.
+  base::OneShotTimer<TransportSecurityPersister> write_timer_;
+
+  // The snapshot on disk, and the log entries written on top of it.
+  std::string snapshot_data_;
+  TransportSecuritySnapshot snapshot_;
+  TransportSecuritySnapshot::RecordMap logged_records_;
+  size_t log_size_;
+
+  // Generation of |snapshot_data_|, which log entries are tagged with.
+  uint64 generation_;
+
+  // True if the next write must be a snapshot, because there is none on disk
+  // yet or the log cannot be appended to.
+  bool snapshot_needed_;
+
   // Whether or not we're in read-only mode.
   const bool readonly_;
 
@@ -209,3 +209,38 @@ TEST_F(TransportSecurityPersisterTest, PublicKeyHashes) {
   EXPECT_EQ(0, memcmp(domain_state.dynamic_spki_hashes[0].data(), sha1.data(),
                       sha1.size()));
 }
+
+TEST_F(TransportSecurityPersisterTest, WritesLogAndSnapshot) {
+  // Let the initial load find that there is nothing on disk.
+  message_loop_.RunUntilIdle();
+
+  const base::Time expiry =
+      base::Time::Now() + base::TimeDelta::FromSeconds(1000);
+  state_.AddHSTS("example.com", expiry, false);
+  // Destroying the persister writes the pending change as a first snapshot.
+  persister_.reset();
+  message_loop_.RunUntilIdle();
+  const base::FilePath log_path =
+      temp_dir_.path().AppendASCII("TransportSecurity-log");
+  EXPECT_FALSE(base::PathExists(log_path));
+
+  persister_.reset(
+      new TransportSecurityPersister(&state_, temp_dir_.path(), false));
+  message_loop_.RunUntilIdle();
+  state_.AddHSTS("example.net", expiry, false);
+  // A small change only goes to the log.
+  persister_.reset();
+  message_loop_.RunUntilIdle();
+  EXPECT_TRUE(base::PathExists(log_path));
+
+  TransportSecurityState state;
+  persister_.reset(
+      new TransportSecurityPersister(&state, temp_dir_.path(), false));
+  message_loop_.RunUntilIdle();
+  TransportSecurityState::DomainState domain_state;
+  EXPECT_TRUE(state.GetDomainState("example.com", false, &domain_state));
+  EXPECT_TRUE(state.GetDomainState("example.net", false, &domain_state));
+  EXPECT_EQ(TransportSecurityState::DomainState::MODE_FORCE_HTTPS,
+            domain_state.upgrade_mode);
+  persister_.reset();
+}
@@ -0,0 +1,308 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/net/transport_security_snapshot.h"
+
+#include <string.h>
+
+#include "base/logging.h"
+#include "base/pickle.h"
+#include "base/time/time.h"
+#include "crypto/sha2.h"
+#include "net/cert/x509_certificate.h"
+
+using net::HashValue;
+using net::HashValueVector;
+using net::TransportSecurityState;
+
+namespace {
+
+const uint32 kSnapshotMagic = 0x54534e50;  // "TSNP"
+const uint32 kSnapshotVersion = 1;
+
+// magic, version, generation, count and padding, which keeps the index and
+// the records that follow it 8-byte aligned.
+const size_t kHeaderSize = 4 + 4 + 8 + 4 + 4;
+const size_t kIndexEntrySize = crypto::kSHA256Length + 4 + 4;
+
+// The largest log entry that is accepted; anything bigger is garbage.
+const uint32 kMaxLogEntrySize = 1024 * 1024;
+
+template <typename T>
+T ReadValue(const char* data) {
+  T value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+template <typename T>
+void AppendValue(T value, std::string* output) {
+  output->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void WriteHashes(const HashValueVector& hashes, Pickle* pickle) {
+  pickle->WriteInt(static_cast<int>(hashes.size()));
+  for (size_t i = 0; i < hashes.size(); ++i) {
+    pickle->WriteInt(hashes[i].tag);
+    pickle->WriteBytes(hashes[i].data(), hashes[i].size());
+  }
+}
+
+bool ReadHashes(PickleIterator* iter, HashValueVector* hashes) {
+  int count;
+  if (!iter->ReadInt(&count) || count < 0)
+    return false;
+  for (int i = 0; i < count; ++i) {
+    int tag;
+    const char* data;
+    if (!iter->ReadInt(&tag) ||
+        (tag != net::HASH_VALUE_SHA1 && tag != net::HASH_VALUE_SHA256)) {
+      return false;
+    }
+    HashValue hash(static_cast<net::HashValueTag>(tag));
+    if (!iter->ReadBytes(&data, hash.size()))
+      return false;
+    memcpy(hash.data(), data, hash.size());
+    hashes->push_back(hash);
+  }
+  return true;
+}
+
+// Returns true if |data| holds exactly one pickle, so that reading it does
+// not depend on anything past its end.
+bool IsWholePickle(const base::StringPiece& data) {
+  if (data.size() < sizeof(uint32))
+    return false;
+  return ReadValue<uint32>(data.data()) + sizeof(uint32) == data.size();
+}
+
+}  // namespace
+
+TransportSecuritySnapshot::TransportSecuritySnapshot()
+    : generation_(0),
+      count_(0) {
+}
+
+TransportSecuritySnapshot::~TransportSecuritySnapshot() {
+}
+
+// static
+bool TransportSecuritySnapshot::IsSnapshot(const base::StringPiece& data) {
+  return data.size() >= sizeof(uint32) &&
+         ReadValue<uint32>(data.data()) == kSnapshotMagic;
+}
+
+bool TransportSecuritySnapshot::Init(const base::StringPiece& data) {
+  data_.clear();
+  generation_ = 0;
+  count_ = 0;
+
+  if (data.size() < kHeaderSize || !IsSnapshot(data) ||
+      ReadValue<uint32>(data.data() + 4) != kSnapshotVersion) {
+    return false;
+  }
+  uint64 generation = ReadValue<uint64>(data.data() + 8);
+  size_t count = ReadValue<uint32>(data.data() + 16);
+  if (count > (data.size() - kHeaderSize) / kIndexEntrySize)
+    return false;
+
+  // The records are only checked when they are read, so that opening a
+  // snapshot does not depend on its size.
+  data_ = data;
+  generation_ = generation;
+  count_ = count;
+  return true;
+}
+
+bool TransportSecuritySnapshot::GetEntry(size_t index,
+                                         base::StringPiece* hashed_host,
+                                         base::StringPiece* record) const {
+  DCHECK_LT(index, count_);
+  const char* entry = data_.data() + kHeaderSize + index * kIndexEntrySize;
+  size_t offset = ReadValue<uint32>(entry + crypto::kSHA256Length);
+  size_t size = ReadValue<uint32>(entry + crypto::kSHA256Length + 4);
+  if (offset > data_.size() || size > data_.size() - offset)
+    return false;
+  if (hashed_host)
+    hashed_host->set(entry, crypto::kSHA256Length);
+  if (record)
+    record->set(data_.data() + offset, size);
+  return true;
+}
+
+bool TransportSecuritySnapshot::FindRecord(const std::string& hashed_host,
+                                           base::StringPiece* record) const {
+  if (hashed_host.size() != crypto::kSHA256Length)
+    return false;
+
+  size_t low = 0;
+  size_t high = count_;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    const char* entry = data_.data() + kHeaderSize + middle * kIndexEntrySize;
+    int result = memcmp(entry, hashed_host.data(), crypto::kSHA256Length);
+    if (result == 0)
+      return GetEntry(middle, NULL, record);
+    if (result < 0)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  return false;
+}
+
+// static
+void TransportSecuritySnapshot::Build(uint64 generation,
+                                      const RecordMap& records,
+                                      std::string* output) {
+  uint32 count = 0;
+  size_t records_size = 0;
+  for (RecordMap::const_iterator it = records.begin(); it != records.end();
+       ++it) {
+    DCHECK_EQ(crypto::kSHA256Length, it->first.size());
+    if (it->second.empty())
+      continue;
+    ++count;
+    records_size += it->second.size();
+  }
+
+  output->clear();
+  output->reserve(kHeaderSize + count * kIndexEntrySize + records_size);
+  AppendValue(kSnapshotMagic, output);
+  AppendValue(kSnapshotVersion, output);
+  AppendValue(generation, output);
+  AppendValue(count, output);
+  AppendValue(static_cast<uint32>(0), output);
+
+  // |records| is sorted by hashed host already, which gives the index order.
+  uint32 offset = kHeaderSize + count * kIndexEntrySize;
+  for (RecordMap::const_iterator it = records.begin(); it != records.end();
+       ++it) {
+    if (it->second.empty())
+      continue;
+    output->append(it->first);
+    AppendValue(offset, output);
+    AppendValue(static_cast<uint32>(it->second.size()), output);
+    offset += it->second.size();
+  }
+  for (RecordMap::const_iterator it = records.begin(); it != records.end();
+       ++it) {
+    output->append(it->second);
+  }
+}
+
+// static
+void TransportSecuritySnapshot::AppendLogEntry(uint64 generation,
+                                               const std::string& hashed_host,
+                                               const std::string& record,
+                                               std::string* log) {
+  Pickle pickle;
+  pickle.WriteUInt64(generation);
+  pickle.WriteString(hashed_host);
+  pickle.WriteString(record);
+  AppendValue(static_cast<uint32>(pickle.size()), log);
+  log->append(static_cast<const char*>(pickle.data()), pickle.size());
+}
+
+// static
+bool TransportSecuritySnapshot::ReadLog(const base::StringPiece& log,
+                                        uint64 generation,
+                                        RecordMap* records) {
+  size_t offset = 0;
+  while (offset < log.size()) {
+    if (log.size() - offset < sizeof(uint32))
+      return false;
+    uint32 size = ReadValue<uint32>(log.data() + offset);
+    offset += sizeof(uint32);
+    if (size > kMaxLogEntrySize || size > log.size() - offset)
+      return false;
+    base::StringPiece data(log.data() + offset, size);
+    offset += size;
+    if (!IsWholePickle(data))
+      return false;
+
+    Pickle pickle(data.data(), data.size());
+    PickleIterator iter(pickle);
+    uint64 entry_generation;
+    std::string hashed_host;
+    std::string record;
+    if (!iter.ReadUInt64(&entry_generation) ||
+        !iter.ReadString(&hashed_host) ||
+        !iter.ReadString(&record) ||
+        hashed_host.size() != crypto::kSHA256Length) {
+      return false;
+    }
+    if (entry_generation == generation)
+      (*records)[hashed_host].swap(record);
+  }
+  return true;
+}
+
+// static
+bool TransportSecuritySnapshot::EncodeDomainState(
+    const TransportSecurityState::DomainState& domain_state,
+    const base::Time& now,
+    std::string* record) {
+  if (domain_state.upgrade_mode !=
+          TransportSecurityState::DomainState::MODE_FORCE_HTTPS &&
+      domain_state.upgrade_mode !=
+          TransportSecurityState::DomainState::MODE_DEFAULT) {
+    return false;
+  }
+
+  Pickle pickle;
+  pickle.WriteBool(domain_state.sts_include_subdomains);
+  pickle.WriteBool(domain_state.pkp_include_subdomains);
+  pickle.WriteInt(domain_state.upgrade_mode);
+  pickle.WriteInt64(domain_state.created.ToInternalValue());
+  pickle.WriteInt64(domain_state.upgrade_expiry.ToInternalValue());
+  pickle.WriteInt64(domain_state.dynamic_spki_hashes_expiry.ToInternalValue());
+  WriteHashes(domain_state.static_spki_hashes, &pickle);
+  WriteHashes(now < domain_state.dynamic_spki_hashes_expiry ?
+                  domain_state.dynamic_spki_hashes : HashValueVector(),
+              &pickle);
+  record->assign(static_cast<const char*>(pickle.data()), pickle.size());
+  return true;
+}
+
+// static
+bool TransportSecuritySnapshot::DecodeDomainState(
+    const base::StringPiece& record,
+    TransportSecurityState::DomainState* domain_state) {
+  if (!IsWholePickle(record))
+    return false;
+
+  Pickle pickle(record.data(), record.size());
+  PickleIterator iter(pickle);
+  int upgrade_mode;
+  int64 created;
+  int64 upgrade_expiry;
+  int64 dynamic_spki_hashes_expiry;
+  if (!iter.ReadBool(&domain_state->sts_include_subdomains) ||
+      !iter.ReadBool(&domain_state->pkp_include_subdomains) ||
+      !iter.ReadInt(&upgrade_mode) ||
+      !iter.ReadInt64(&created) ||
+      !iter.ReadInt64(&upgrade_expiry) ||
+      !iter.ReadInt64(&dynamic_spki_hashes_expiry) ||
+      !ReadHashes(&iter, &domain_state->static_spki_hashes) ||
+      !ReadHashes(&iter, &domain_state->dynamic_spki_hashes)) {
+    return false;
+  }
+
+  switch (upgrade_mode) {
+    case TransportSecurityState::DomainState::MODE_FORCE_HTTPS:
+    case TransportSecurityState::DomainState::MODE_DEFAULT:
+      domain_state->upgrade_mode =
+          static_cast<TransportSecurityState::DomainState::UpgradeMode>(
+              upgrade_mode);
+      break;
+    default:
+      return false;
+  }
+  domain_state->created = base::Time::FromInternalValue(created);
+  domain_state->upgrade_expiry = base::Time::FromInternalValue(upgrade_expiry);
+  domain_state->dynamic_spki_hashes_expiry =
+      base::Time::FromInternalValue(dynamic_spki_hashes_expiry);
+  return true;
+}
@@ -0,0 +1,105 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_NET_TRANSPORT_SECURITY_SNAPSHOT_H_
+#define CHROME_BROWSER_NET_TRANSPORT_SECURITY_SNAPSHOT_H_
+
+#include <map>
+#include <string>
+
+#include "base/basictypes.h"
+#include "base/strings/string_piece.h"
+#include "net/http/transport_security_state.h"
+
+namespace base {
+class Time;
+}
+
+// The binary form in which TransportSecurityPersister stores the dynamic
+// TransportSecurityState entries, keyed by hashed host.
+//
+// A snapshot is laid out as
+//   header:  uint32 magic, uint32 version, uint64 generation, uint32 count,
+//            uint32 padding
+//   index:   |count| entries of {char hashed_host[32], uint32 offset,
+//            uint32 size}, sorted by hashed host
+//   records: the encoded DomainStates the index points at.
+// Records are addressed by their offset from the start of the snapshot, so it
+// can be memory mapped and searched in place.
+//
+// Changes made since a snapshot was written go to an append-only log, a
+// sequence of length-prefixed entries that each carry the generation of the
+// snapshot they apply to. Entries for any other generation are stale, which
+// makes it safe to replace the snapshot before deleting the log.
+class TransportSecuritySnapshot {
+ public:
+  // Maps hashed hosts to encoded records. An empty record stands for a
+  // deleted entry.
+  typedef std::map<std::string, std::string> RecordMap;
+
+  TransportSecuritySnapshot();
+  ~TransportSecuritySnapshot();
+
+  // Returns true if |data| starts with the snapshot magic number.
+  static bool IsSnapshot(const base::StringPiece& data);
+
+  // Points this object at |data|, which is not copied and must outlive it.
+  // Returns false if the header or the index is malformed.
+  bool Init(const base::StringPiece& data);
+
+  uint64 generation() const { return generation_; }
+  size_t size() const { return count_; }
+
+  // Returns the |index|th entry, in hashed host order. Returns false if the
+  // entry points outside of the snapshot.
+  bool GetEntry(size_t index,
+                base::StringPiece* hashed_host,
+                base::StringPiece* record) const;
+
+  // Binary searches the index for |hashed_host|.
+  bool FindRecord(const std::string& hashed_host,
+                  base::StringPiece* record) const;
+
+  // Writes a snapshot holding the non-deleted |records| to |output|.
+  static void Build(uint64 generation,
+                    const RecordMap& records,
+                    std::string* output);
+
+  // Appends to |log| an entry that sets |hashed_host| to |record|, or deletes
+  // it if |record| is empty.
+  static void AppendLogEntry(uint64 generation,
+                             const std::string& hashed_host,
+                             const std::string& record,
+                             std::string* log);
+
+  // Adds the entries of |log| that apply to |generation| to |records|, later
+  // entries replacing earlier ones. Returns false if |log| ends with a
+  // truncated or malformed entry, as an interrupted append leaves behind;
+  // the entries before it are still added.
+  static bool ReadLog(const base::StringPiece& log,
+                      uint64 generation,
+                      RecordMap* records);
+
+  // Encodes |domain_state| into |record|. Dynamic pins are left out once
+  // they have expired at |now|. Returns false if the state has an unknown
+  // upgrade mode.
+  static bool EncodeDomainState(
+      const net::TransportSecurityState::DomainState& domain_state,
+      const base::Time& now,
+      std::string* record);
+
+  // Decodes a record written by EncodeDomainState().
+  static bool DecodeDomainState(
+      const base::StringPiece& record,
+      net::TransportSecurityState::DomainState* domain_state);
+
+ private:
+  base::StringPiece data_;
+  uint64 generation_;
+  size_t count_;
+
+  DISALLOW_COPY_AND_ASSIGN(TransportSecuritySnapshot);
+};
+
+#endif  // CHROME_BROWSER_NET_TRANSPORT_SECURITY_SNAPSHOT_H_
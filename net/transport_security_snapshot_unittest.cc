@@ -0,0 +1,135 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/net/transport_security_snapshot.h"
+
+#include <string>
+
+#include "base/time/time.h"
+#include "crypto/sha2.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using net::TransportSecurityState;
+
+namespace {
+
+std::string HashedHost(const char* host) {
+  return crypto::SHA256HashString(host);
+}
+
+std::string EncodeHSTS(const base::Time& expiry) {
+  TransportSecurityState::DomainState domain_state;
+  domain_state.upgrade_mode =
+      TransportSecurityState::DomainState::MODE_FORCE_HTTPS;
+  domain_state.upgrade_expiry = expiry;
+  std::string record;
+  EXPECT_TRUE(TransportSecuritySnapshot::EncodeDomainState(
+      domain_state, base::Time::Now(), &record));
+  return record;
+}
+
+}  // namespace
+
+TEST(TransportSecuritySnapshotTest, EncodeDecode) {
+  const base::Time now = base::Time::Now();
+  TransportSecurityState::DomainState domain_state;
+  domain_state.upgrade_mode =
+      TransportSecurityState::DomainState::MODE_FORCE_HTTPS;
+  domain_state.sts_include_subdomains = true;
+  domain_state.created = now;
+  domain_state.upgrade_expiry = now + base::TimeDelta::FromSeconds(1000);
+  domain_state.dynamic_spki_hashes_expiry = domain_state.upgrade_expiry;
+  net::HashValue hash(net::HASH_VALUE_SHA256);
+  memset(hash.data(), 7, hash.size());
+  domain_state.dynamic_spki_hashes.push_back(hash);
+
+  std::string record;
+  ASSERT_TRUE(TransportSecuritySnapshot::EncodeDomainState(domain_state, now,
+                                                           &record));
+  TransportSecurityState::DomainState decoded;
+  ASSERT_TRUE(TransportSecuritySnapshot::DecodeDomainState(record, &decoded));
+  EXPECT_EQ(TransportSecurityState::DomainState::MODE_FORCE_HTTPS,
+            decoded.upgrade_mode);
+  EXPECT_TRUE(decoded.sts_include_subdomains);
+  EXPECT_FALSE(decoded.pkp_include_subdomains);
+  EXPECT_EQ(domain_state.created, decoded.created);
+  EXPECT_EQ(domain_state.upgrade_expiry, decoded.upgrade_expiry);
+  ASSERT_EQ(1u, decoded.dynamic_spki_hashes.size());
+  EXPECT_TRUE(decoded.dynamic_spki_hashes[0].Equals(hash));
+
+  // Expired pins are dropped.
+  ASSERT_TRUE(TransportSecuritySnapshot::EncodeDomainState(
+      domain_state, now + base::TimeDelta::FromSeconds(2000), &record));
+  TransportSecurityState::DomainState expired;
+  ASSERT_TRUE(TransportSecuritySnapshot::DecodeDomainState(record, &expired));
+  EXPECT_TRUE(expired.dynamic_spki_hashes.empty());
+
+  // Truncated records are rejected.
+  record.resize(record.size() - 4);
+  EXPECT_FALSE(TransportSecuritySnapshot::DecodeDomainState(record, &decoded));
+}
+
+TEST(TransportSecuritySnapshotTest, BuildAndFind) {
+  const base::Time expiry =
+      base::Time::Now() + base::TimeDelta::FromSeconds(1000);
+  TransportSecuritySnapshot::RecordMap records;
+  records[HashedHost("a.com")] = EncodeHSTS(expiry);
+  records[HashedHost("b.com")] = EncodeHSTS(expiry);
+  records[HashedHost("c.com")] = EncodeHSTS(expiry);
+  records[HashedHost("deleted.com")] = std::string();
+
+  std::string data;
+  TransportSecuritySnapshot::Build(42, records, &data);
+  EXPECT_TRUE(TransportSecuritySnapshot::IsSnapshot(data));
+
+  TransportSecuritySnapshot snapshot;
+  ASSERT_TRUE(snapshot.Init(data));
+  EXPECT_EQ(42u, snapshot.generation());
+  ASSERT_EQ(3u, snapshot.size());
+
+  base::StringPiece record;
+  ASSERT_TRUE(snapshot.FindRecord(HashedHost("b.com"), &record));
+  EXPECT_EQ(records[HashedHost("b.com")], record.as_string());
+  EXPECT_FALSE(snapshot.FindRecord(HashedHost("deleted.com"), &record));
+  EXPECT_FALSE(snapshot.FindRecord(HashedHost("d.com"), &record));
+
+  // Entries come back in hashed host order.
+  base::StringPiece previous;
+  for (size_t i = 0; i < snapshot.size(); ++i) {
+    base::StringPiece hashed_host;
+    ASSERT_TRUE(snapshot.GetEntry(i, &hashed_host, &record));
+    EXPECT_LT(previous, hashed_host);
+    previous = hashed_host;
+  }
+
+  EXPECT_FALSE(snapshot.Init(data.substr(0, 30)));
+  EXPECT_FALSE(snapshot.Init("{}"));
+}
+
+TEST(TransportSecuritySnapshotTest, ReadLog) {
+  const base::Time expiry =
+      base::Time::Now() + base::TimeDelta::FromSeconds(1000);
+  const std::string a = HashedHost("a.com");
+  const std::string b = HashedHost("b.com");
+
+  std::string log;
+  TransportSecuritySnapshot::AppendLogEntry(1, a, EncodeHSTS(expiry), &log);
+  TransportSecuritySnapshot::AppendLogEntry(2, a, EncodeHSTS(expiry), &log);
+  TransportSecuritySnapshot::AppendLogEntry(2, b, EncodeHSTS(expiry), &log);
+  TransportSecuritySnapshot::AppendLogEntry(2, a, std::string(), &log);
+
+  // Only the entries for the requested generation apply, latest first.
+  TransportSecuritySnapshot::RecordMap records;
+  EXPECT_TRUE(TransportSecuritySnapshot::ReadLog(log, 2, &records));
+  ASSERT_EQ(2u, records.size());
+  EXPECT_TRUE(records[a].empty());
+  EXPECT_FALSE(records[b].empty());
+
+  // A torn append keeps the entries before it.
+  records.clear();
+  EXPECT_FALSE(TransportSecuritySnapshot::ReadLog(
+      base::StringPiece(log.data(), log.size() - 3), 2, &records));
+  EXPECT_EQ(2u, records.size());
+  EXPECT_FALSE(records[a].empty());
+}
@@ -27,6 +27,8 @@ const int kSampleIntervalInSeconds = 10;
 // collections; this can be overridden by using the kPerformanceMonitorGathering
 // switch with an associated (positive integer) value.
 const int kDefaultGatherIntervalInSeconds = 120;
+// The interval at which the stored metrics are compacted.
+const int kCompactionIntervalInMinutes = 60;
 
 // Unit values (for use in metric, and on the UI side).
 
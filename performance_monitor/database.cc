@@ -4,6 +4,8 @@
 
 #include "chrome/browser/performance_monitor/database.h"
 
+#include <algorithm>
+
 #include "base/file_util.h"
 #include "base/files/file_path.h"
 #include "base/json/json_reader.h"
@@ -15,6 +17,7 @@
 #include "base/strings/utf_string_conversions.h"
 #include "base/time/time.h"
 #include "chrome/browser/performance_monitor/key_builder.h"
+#include "chrome/browser/performance_monitor/time_series.h"
 #include "chrome/common/chrome_paths.h"
 #include "content/public/browser/browser_thread.h"
 #include "third_party/leveldatabase/src/include/leveldb/db.h"
@@ -30,11 +33,107 @@ const char kEventDb[] = "Events";
 const char kStateDb[] = "Configuration";
 const char kActiveIntervalDb[] = "Active Interval";
 const char kMetricDb[] = "Metrics";
+const char kMetricBlockDb[] = "Metric Blocks";
+const char kRollupDb[] = "Metric Rollups";
 const double kDefaultMaxValue = 0.0;
 
 // If the db is quiet for this number of minutes, then it is considered down.
 const base::TimeDelta kActiveIntervalTimeout = base::TimeDelta::FromMinutes(5);
 
+// Statistics are compacted once they are this old, so that the last block of
+// a series is not rewritten for every statistic.
+const base::TimeDelta kCompactionDelay = base::TimeDelta::FromMinutes(10);
+
+// The number of statistics encoded together. At the default gathering
+// interval, a block holds about eight hours of one metric.
+const size_t kSamplesPerBlock = 256;
+
+// How long the compacted statistics themselves are kept. Older data is only
+// available through the rollups.
+const base::TimeDelta kMetricRetention = base::TimeDelta::FromDays(14);
+
+struct RollupInfo {
+  // Identifies the resolution in rollup keys; do not change.
+  char key_char;
+  int64 width_in_microseconds;
+  // 0 if the rollups are kept forever.
+  int retention_in_days;
+};
+
+const RollupInfo kRollups[] = {
+  { 'm', base::Time::kMicrosecondsPerMinute, 60 },
+  { 'h', base::Time::kMicrosecondsPerHour, 730 },
+  { 'd', base::Time::kMicrosecondsPerDay, 0 },
+};
+COMPILE_ASSERT(arraysize(kRollups) == Database::ROLLUP_NUMBER_OF_RESOLUTIONS,
+               rollups_must_match_resolutions);
+
+// The aggregate of the statistics in one rollup.
+struct Rollup {
+  Rollup() : count(0), sum(0.0), min(0.0), max(0.0) {}
+
+  void Add(double value) {
+    min = count ? std::min(min, value) : value;
+    max = count ? std::max(max, value) : value;
+    sum += value;
+    ++count;
+  }
+
+  void Merge(const Rollup& other) {
+    if (!other.count)
+      return;
+    min = count ? std::min(min, other.min) : other.min;
+    max = count ? std::max(max, other.max) : other.max;
+    sum += other.sum;
+    count += other.count;
+  }
+
+  int64 count;
+  double sum;
+  double min;
+  double max;
+};
+
+std::string EncodeRollup(const Rollup& rollup) {
+  std::string data(4 * sizeof(int64), '\0');
+  memcpy(&data[0], &rollup.count, sizeof(int64));
+  memcpy(&data[sizeof(int64)], &rollup.sum, sizeof(double));
+  memcpy(&data[2 * sizeof(int64)], &rollup.min, sizeof(double));
+  memcpy(&data[3 * sizeof(int64)], &rollup.max, sizeof(double));
+  return data;
+}
+
+bool DecodeRollup(const std::string& data, Rollup* rollup) {
+  if (data.size() != 4 * sizeof(int64))
+    return false;
+  memcpy(&rollup->count, &data[0], sizeof(int64));
+  memcpy(&rollup->sum, &data[sizeof(int64)], sizeof(double));
+  memcpy(&rollup->min, &data[2 * sizeof(int64)], sizeof(double));
+  memcpy(&rollup->max, &data[3 * sizeof(int64)], sizeof(double));
+  return rollup->count > 0;
+}
+
+base::Time GetRollupStart(const base::Time& time, const RollupInfo& info) {
+  int64 value = time.ToInternalValue();
+  return base::Time::FromInternalValue(
+      value - value % info.width_in_microseconds);
+}
+
+// Adds the deletion of the keys of |db| in [|start_key|, |end_key|) to
+// |batch|.
+void DeleteKeysInRange(leveldb::DB* db,
+                       const leveldb::ReadOptions& read_options,
+                       const std::string& start_key,
+                       const std::string& end_key,
+                       leveldb::WriteBatch* batch) {
+  scoped_ptr<leveldb::Iterator> it(db->NewIterator(read_options));
+  for (it->Seek(start_key);
+       it->Valid() && it->key().ToString() < end_key;
+       it->Next()) {
+    batch->Delete(it->key());
+  }
+}
+
 TimeRange ActiveIntervalToTimeRange(const std::string& start_time,
                                     const std::string& end_time) {
   int64 start_time_int = 0;
@@ -301,6 +400,15 @@ Database::MetricTypeSet Database::GetActiveMetrics(const base::Time& start,
     // Stats in the timerange from any activity makes the metric active.
     if (metric_it->Valid() && metric_it->key().ToString() <= metric_end_key) {
       active_metrics.insert(*possible_it);
+      continue;
+    }
+    std::vector<Series> all_series = GetAllSeries(*possible_it);
+    for (std::vector<Series>::const_iterator series = all_series.begin();
+         series != all_series.end(); ++series) {
+      if (HasMetricBlocks(*series, start, end)) {
+        active_metrics.insert(*possible_it);
+        break;
+      }
     }
   }
 
@@ -359,6 +467,8 @@ scoped_ptr<Database::MetricVector> Database::GetStatsForActivityAndMetric(
     const base::Time& end) {
   CHECK(!content::BrowserThread::CurrentlyOn(content::BrowserThread::UI));
   scoped_ptr<MetricVector> results(new MetricVector());
+  base::Time last_compacted_time = ReadMetricBlocks(
+      Series(metric_type, activity), start, end, results.get());
   std::string start_key =
       key_builder_->CreateMetricKey(start, metric_type, activity);
   std::string end_key =
@@ -380,6 +490,9 @@ scoped_ptr<Database::MetricVector> Database::GetStatsForActivityAndMetric(
                    << ". Erasing metric from database.";
         continue;
       }
+      // Left behind by an interrupted compaction.
+      if (metric.time <= last_compacted_time)
+        continue;
       results->push_back(metric);
     }
   }
@@ -393,6 +506,17 @@ Database::MetricVectorMap Database::GetStatsForMetricByActivity(
     const base::Time& end) {
   CHECK(!content::BrowserThread::CurrentlyOn(content::BrowserThread::UI));
   MetricVectorMap results;
+  std::map<std::string, base::Time> last_compacted_times;
+  std::vector<Series> all_series = GetAllSeries(metric_type);
+  for (std::vector<Series>::const_iterator series = all_series.begin();
+       series != all_series.end(); ++series) {
+    linked_ptr<MetricVector> metrics(new MetricVector());
+    last_compacted_times[series->second] =
+        ReadMetricBlocks(*series, start, end, metrics.get());
+    if (!metrics->empty())
+      results[series->second] = metrics;
+  }
+
   std::string start_key =
       key_builder_->CreateMetricKey(start, metric_type, std::string());
   std::string end_key =
@@ -416,12 +540,105 @@ Database::MetricVectorMap Database::GetStatsForMetricByActivity(
                  << ". Erasing metric from database.";
       continue;
     }
+    if (metric.time <= last_compacted_times[split_key.activity])
+      continue;
     results[split_key.activity]->push_back(metric);
   }
   metric_db_->Write(write_options_, &invalid_entries);
   return results;
 }
 
+scoped_ptr<Database::MetricVector> Database::GetRollupsForActivityAndMetric(
+    const std::string& activity,
+    MetricType metric_type,
+    RollupResolution resolution,
+    const base::Time& start,
+    const base::Time& end) {
+  CHECK(!content::BrowserThread::CurrentlyOn(content::BrowserThread::UI));
+  DCHECK_LT(resolution, ROLLUP_NUMBER_OF_RESOLUTIONS);
+  const RollupInfo& info = kRollups[resolution];
+  base::Time rollup_start = GetRollupStart(start, info);
+
+  std::map<base::Time, Rollup> rollups;
+  std::string end_key = key_builder_->CreateRollupKey(
+      info.key_char, metric_type, activity, end);
+  scoped_ptr<leveldb::Iterator> it(rollup_db_->NewIterator(read_options_));
+  for (it->Seek(key_builder_->CreateRollupKey(
+           info.key_char, metric_type, activity, rollup_start));
+       it->Valid() && it->key().ToString() <= end_key;
+       it->Next()) {
+    Rollup rollup;
+    if (DecodeRollup(it->value().ToString(), &rollup)) {
+      rollups[key_builder_->TimeFromMetricBlockOrRollupKey(
+          it->key().ToString())].Merge(rollup);
+    }
+  }
+
+  // The statistics which are not compacted yet are rolled up here.
+  std::string last_block_key;
+  std::string last_block;
+  base::Time last_compacted_time = GetLastMetricBlock(
+      Series(metric_type, activity), &last_block_key, &last_block);
+  std::string metric_end_key =
+      key_builder_->CreateMetricKey(end, metric_type, activity);
+  it.reset(metric_db_->NewIterator(read_options_));
+  for (it->Seek(key_builder_->CreateMetricKey(rollup_start, metric_type,
+                                              activity));
+       it->Valid() && it->key().ToString() <= metric_end_key;
+       it->Next()) {
+    MetricKey split_key = key_builder_->SplitMetricKey(it->key().ToString());
+    if (split_key.activity != activity)
+      continue;
+    Metric metric(metric_type, split_key.time, it->value().ToString());
+    if (!metric.IsValid() || metric.time <= last_compacted_time)
+      continue;
+    rollups[GetRollupStart(metric.time, info)].Add(metric.value);
+  }
+
+  scoped_ptr<MetricVector> results(new MetricVector());
+  for (std::map<base::Time, Rollup>::const_iterator rollup = rollups.begin();
+       rollup != rollups.end(); ++rollup) {
+    results->push_back(Metric(metric_type, rollup->first,
+                              rollup->second.sum / rollup->second.count));
+  }
+  return results.Pass();
+}
+
+bool Database::CompactMetrics() {
+  CHECK(!content::BrowserThread::CurrentlyOn(content::BrowserThread::UI));
+  base::Time now = clock_->GetTime();
+  base::Time compact_before = now - kCompactionDelay;
+
+  // The metric db is ordered by metric and then time, so the statistics of
+  // each series are gathered in time order.
+  std::map<Series, MetricVector> metrics_to_compact;
+  leveldb::WriteBatch compacted_entries;
+  scoped_ptr<leveldb::Iterator> it(metric_db_->NewIterator(read_options_));
+  for (it->SeekToFirst(); it->Valid(); it->Next()) {
+    MetricKey split_key = key_builder_->SplitMetricKey(it->key().ToString());
+    Metric metric(split_key.type, split_key.time, it->value().ToString());
+    if (metric.time >= compact_before)
+      continue;
+    compacted_entries.Delete(it->key());
+    if (!metric.IsValid())
+      continue;
+    metrics_to_compact[Series(split_key.type, split_key.activity)].push_back(
+        metric);
+  }
+
+  bool success = true;
+  for (std::map<Series, MetricVector>::const_iterator series =
+           metrics_to_compact.begin();
+       series != metrics_to_compact.end(); ++series) {
+    success = CompactSeries(series->first, series->second) && success;
+  }
+  // The statistics are only deleted once their blocks are written. If that
+  // does not happen, the next compaction skips those that made it.
+  if (success)
+    success = metric_db_->Write(write_options_, &compacted_entries).ok();
+  return ApplyRetention(now) && success;
+}
+
 Database::Database(const base::FilePath& path)
     : key_builder_(new KeyBuilder()),
       path_(path),
@@ -439,6 +656,187 @@ Database::Database(const base::FilePath& path)
 Database::~Database() {
 }
 
+std::vector<Database::Series> Database::GetAllSeries(MetricType metric_type) {
+  std::vector<Series> results;
+  for (RecentMap::const_iterator it = recent_map_.begin();
+       it != recent_map_.end(); ++it) {
+    RecentKey split_key = key_builder_->SplitRecentKey(it->second);
+    if (metric_type == METRIC_UNDEFINED || split_key.type == metric_type)
+      results.push_back(Series(split_key.type, split_key.activity));
+  }
+  return results;
+}
+
+base::Time Database::ReadMetricBlocks(const Series& series,
+                                      const base::Time& start,
+                                      const base::Time& end,
+                                      MetricVector* results) {
+  base::Time last_block_time;
+  std::string end_key = key_builder_->CreateMetricBlockKey(
+      series.first, series.second, base::Time::FromInternalValue(kint64max));
+  scoped_ptr<leveldb::Iterator> it(
+      metric_block_db_->NewIterator(read_options_));
+  for (it->Seek(key_builder_->CreateMetricBlockKey(series.first, series.second,
+                                                   start));
+       it->Valid() && it->key().ToString() <= end_key;
+       it->Next()) {
+    std::string block = it->value().ToString();
+    TimeSeriesDecoder decoder(block);
+    base::Time time;
+    double value;
+    bool past_end = false;
+    while (decoder.Next(&time, &value)) {
+      if (time > end) {
+        past_end = true;
+        break;
+      }
+      if (time >= start)
+        results->push_back(Metric(series.first, time, value));
+    }
+    last_block_time = key_builder_->TimeFromMetricBlockOrRollupKey(
+        it->key().ToString());
+    if (past_end)
+      break;
+  }
+  return last_block_time;
+}
+
+bool Database::HasMetricBlocks(const Series& series,
+                               const base::Time& start,
+                               const base::Time& end) {
+  std::string end_key = key_builder_->CreateMetricBlockKey(
+      series.first, series.second, base::Time::FromInternalValue(kint64max));
+  scoped_ptr<leveldb::Iterator> it(
+      metric_block_db_->NewIterator(read_options_));
+  it->Seek(key_builder_->CreateMetricBlockKey(series.first, series.second,
+                                              start));
+  if (!it->Valid() || it->key().ToString() > end_key)
+    return false;
+  std::string block = it->value().ToString();
+  TimeSeriesDecoder decoder(block);
+  base::Time time;
+  double value;
+  return decoder.Next(&time, &value) && time <= end;
+}
+
+base::Time Database::GetLastMetricBlock(const Series& series,
+                                        std::string* key,
+                                        std::string* block) {
+  key->clear();
+  block->clear();
+  std::string start_key = key_builder_->CreateMetricBlockKey(
+      series.first, series.second, base::Time());
+  std::string end_key = key_builder_->CreateMetricBlockKey(
+      series.first, series.second, base::Time::FromInternalValue(kint64max));
+  scoped_ptr<leveldb::Iterator> it(
+      metric_block_db_->NewIterator(read_options_));
+  it->Seek(end_key);
+  if (it->Valid())
+    it->Prev();
+  else
+    it->SeekToLast();
+  if (!it->Valid() || it->key().ToString() < start_key)
+    return base::Time();
+  *key = it->key().ToString();
+  *block = it->value().ToString();
+  return key_builder_->TimeFromMetricBlockOrRollupKey(*key);
+}
+
+bool Database::CompactSeries(const Series& series,
+                             const MetricVector& metrics) {
+  std::string last_block_key;
+  std::string last_block;
+  base::Time last_compacted_time =
+      GetLastMetricBlock(series, &last_block_key, &last_block);
+
+  TimeSeriesEncoder encoder;
+  leveldb::WriteBatch blocks;
+  // Fill up the last block rather than leave a small one behind every
+  // compaction.
+  TimeSeriesDecoder decoder(last_block);
+  if (!last_block_key.empty() && decoder.sample_count() < kSamplesPerBlock) {
+    base::Time time;
+    double value;
+    while (decoder.Next(&time, &value))
+      encoder.Append(time, value);
+    blocks.Delete(last_block_key);
+  }
+
+  std::map<std::string, Rollup> rollups;
+  for (MetricVector::const_iterator metric = metrics.begin();
+       metric != metrics.end(); ++metric) {
+    // Compacted already by an interrupted compaction.
+    if (!last_block_key.empty() && metric->time <= last_compacted_time)
+      continue;
+    encoder.Append(metric->time, metric->value);
+    if (encoder.sample_count() == kSamplesPerBlock) {
+      base::Time last_time = encoder.last_time();
+      blocks.Put(key_builder_->CreateMetricBlockKey(series.first,
+                                                    series.second, last_time),
+                 encoder.Finish());
+    }
+    for (size_t i = 0; i < arraysize(kRollups); ++i) {
+      rollups[key_builder_->CreateRollupKey(
+          kRollups[i].key_char, series.first, series.second,
+          GetRollupStart(metric->time, kRollups[i]))].Add(metric->value);
+    }
+  }
+  if (encoder.sample_count() > 0) {
+    base::Time last_time = encoder.last_time();
+    blocks.Put(key_builder_->CreateMetricBlockKey(series.first, series.second,
+                                                  last_time),
+               encoder.Finish());
+  }
+
+  leveldb::WriteBatch rollup_updates;
+  for (std::map<std::string, Rollup>::iterator it = rollups.begin();
+       it != rollups.end(); ++it) {
+    std::string value;
+    Rollup rollup;
+    if (rollup_db_->Get(read_options_, it->first, &value).ok() &&
+        DecodeRollup(value, &rollup)) {
+      it->second.Merge(rollup);
+    }
+    rollup_updates.Put(it->first, EncodeRollup(it->second));
+  }
+
+  // Should the rollups fail to be written after the blocks, the statistics
+  // are missing from them; rolling them up again could count them twice.
+  return metric_block_db_->Write(write_options_, &blocks).ok() &&
+         rollup_db_->Write(write_options_, &rollup_updates).ok();
+}
+
+bool Database::ApplyRetention(const base::Time& now) {
+  leveldb::WriteBatch expired_blocks;
+  leveldb::WriteBatch expired_rollups;
+  std::vector<Series> all_series = GetAllSeries(METRIC_UNDEFINED);
+  for (std::vector<Series>::const_iterator series = all_series.begin();
+       series != all_series.end(); ++series) {
+    // Blocks are keyed by their last statistic, so these hold nothing newer.
+    DeleteKeysInRange(
+        metric_block_db_.get(), read_options_,
+        key_builder_->CreateMetricBlockKey(series->first, series->second,
+                                           base::Time()),
+        key_builder_->CreateMetricBlockKey(series->first, series->second,
+                                           now - kMetricRetention),
+        &expired_blocks);
+    for (size_t i = 0; i < arraysize(kRollups); ++i) {
+      if (!kRollups[i].retention_in_days)
+        continue;
+      DeleteKeysInRange(
+          rollup_db_.get(), read_options_,
+          key_builder_->CreateRollupKey(kRollups[i].key_char, series->first,
+                                        series->second, base::Time()),
+          key_builder_->CreateRollupKey(
+              kRollups[i].key_char, series->first, series->second,
+              now - base::TimeDelta::FromDays(kRollups[i].retention_in_days)),
+          &expired_rollups);
+    }
+  }
+  return metric_block_db_->Write(write_options_, &expired_blocks).ok() &&
+         rollup_db_->Write(write_options_, &expired_rollups).ok();
+}
+
 bool Database::InitDBs() {
   CHECK(!content::BrowserThread::CurrentlyOn(content::BrowserThread::UI));
   leveldb::Options open_options;
@@ -464,8 +862,15 @@ bool Database::InitDBs() {
   event_db_ = SafelyOpenDatabase(open_options,
                                  kEventDb,
                                  true);  // fix if damaged
+  metric_block_db_ = SafelyOpenDatabase(open_options,
+                                        kMetricBlockDb,
+                                        true);  // fix if damaged
+  rollup_db_ = SafelyOpenDatabase(open_options,
+                                  kRollupDb,
+                                  true);  // fix if damaged
   return recent_db_ && max_value_db_ && state_db_ &&
-         active_interval_db_ && metric_db_ && event_db_;
+         active_interval_db_ && metric_db_ && event_db_ &&
+         metric_block_db_ && rollup_db_;
 }
 
 scoped_ptr<leveldb::DB> Database::SafelyOpenDatabase(
@@ -536,6 +941,8 @@ scoped_ptr<leveldb::DB> Database::SafelyOpenDatabase(
 bool Database::Close() {
   CHECK(!content::BrowserThread::CurrentlyOn(content::BrowserThread::UI));
   metric_db_.reset();
+  metric_block_db_.reset();
+  rollup_db_.reset();
   event_db_.reset();
   recent_db_.reset();
   max_value_db_.reset();
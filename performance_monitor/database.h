@@ -5,8 +5,10 @@
 #ifndef CHROME_BROWSER_PERFORMANCE_MONITOR_DATABASE_H_
 #define CHROME_BROWSER_PERFORMANCE_MONITOR_DATABASE_H_
 
+#include <map>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/files/file_path.h"
@@ -91,11 +93,27 @@ class DatabaseTestHelper;
 // Value: Statistic
 //
 // Metric DB:
-// Stores the statistics for different metrics. Having the time before the
-// activity ensures that the search space can only be as large as the time
-// interval.
+// Stores the statistics for different metrics that have not been compacted
+// yet. Having the time before the activity ensures that the search space can
+// only be as large as the time interval.
 // Key: Metric - Time - Activity
 // Value: Statistic
+//
+// Metric Block DB:
+// Stores the compacted statistics, as blocks of up to kSamplesPerBlock samples
+// of one (metric, activity) pair encoded by TimeSeriesEncoder. CompactMetrics()
+// moves the statistics older than kCompactionDelay here, and deletes the
+// blocks older than kMetricRetention. Keying blocks by their last time lets a
+// range query start at the first block it needs.
+// Key: Metric - Activity - Time of the last statistic in the block
+// Value: Encoded block
+//
+// Rollup DB:
+// Stores the aggregates of the compacted statistics over each minute, hour
+// and day, so that views over weeks or months do not read every statistic.
+// Each resolution has its own retention period.
+// Key: Resolution - Metric - Activity - Start time of the rollup
+// Value: Count, sum, min and max of the statistics
 class Database {
  public:
   typedef std::set<EventType> EventTypeSet;
@@ -106,6 +124,14 @@ class Database {
 
   static const char kDatabaseSequenceToken[];
 
+  // The widths over which metrics are rolled up.
+  enum RollupResolution {
+    ROLLUP_MINUTE,
+    ROLLUP_HOUR,
+    ROLLUP_DAY,
+    ROLLUP_NUMBER_OF_RESOLUTIONS
+  };
+
   // The class that the database will use to infer time. Abstracting out the
   // time mechanism allows for easy testing and mock data insetion.
   class Clock {
@@ -224,6 +250,29 @@ class Database {
         metric_type, base::Time(), clock_->GetTime());
   }
 
+  // Query given |metric_type| and |activity| at |resolution|. Each returned
+  // metric is the mean of the statistics in one rollup, at its start time.
+  scoped_ptr<MetricVector> GetRollupsForActivityAndMetric(
+      const std::string& activity,
+      MetricType metric_type,
+      RollupResolution resolution,
+      const base::Time& start,
+      const base::Time& end);
+
+  scoped_ptr<MetricVector> GetRollupsForActivityAndMetric(
+      MetricType metric_type,
+      RollupResolution resolution,
+      const base::Time& start,
+      const base::Time& end) {
+    return GetRollupsForActivityAndMetric(kProcessChromeAggregate, metric_type,
+                                          resolution, start, end);
+  }
+
+  // Moves the statistics older than kCompactionDelay to encoded blocks,
+  // updates the rollups with them, and drops the blocks and rollups which are
+  // past their retention period. Meant to be called periodically.
+  bool CompactMetrics();
+
   // Returns the active time intervals that overlap with the time interval
   // defined by |start| and |end|.
   std::vector<TimeRange> GetActiveIntervals(const base::Time& start,
@@ -241,6 +290,9 @@ class Database {
   typedef std::map<std::string, std::string> RecentMap;
   typedef std::map<std::string, double> MaxValueMap;
 
+  // A (metric, activity) pair.
+  typedef std::pair<MetricType, std::string> Series;
+
   // By default, the database uses a clock that simply returns the current time.
   class SystemClock : public Clock {
    public:
@@ -268,6 +320,36 @@ class Database {
   // Load max values from the db into the max_value_map_.
   void LoadMaxValues();
 
+  // Returns the series of |metric_type| that have ever been added to, or all
+  // of them for METRIC_UNDEFINED.
+  std::vector<Series> GetAllSeries(MetricType metric_type);
+
+  // Appends the compacted statistics of |series| in [|start|, |end|] to
+  // |results|. Returns the time of the last statistic in the blocks that
+  // were read, so that uncompacted duplicates of them can be skipped.
+  base::Time ReadMetricBlocks(const Series& series,
+                              const base::Time& start,
+                              const base::Time& end,
+                              MetricVector* results);
+
+  // Returns true if |series| has compacted statistics in [|start|, |end|].
+  bool HasMetricBlocks(const Series& series,
+                       const base::Time& start,
+                       const base::Time& end);
+
+  // Returns the time of the last compacted statistic of |series|, and the
+  // key and contents of the block that holds it.
+  base::Time GetLastMetricBlock(const Series& series,
+                                std::string* key,
+                                std::string* block);
+
+  // Writes |metrics| of |series| to blocks and adds them to the rollups,
+  // skipping any that were compacted before.
+  bool CompactSeries(const Series& series, const MetricVector& metrics);
+
+  // Deletes the blocks and rollups past their retention period.
+  bool ApplyRetention(const base::Time& now);
+
   // Mark the database as being active for the current time.
   void UpdateActiveInterval();
   // Updates the max_value_map_ and max_value_db_ if the value is greater than
@@ -306,6 +388,10 @@ class Database {
 
   scoped_ptr<leveldb::DB> metric_db_;
 
+  scoped_ptr<leveldb::DB> metric_block_db_;
+
+  scoped_ptr<leveldb::DB> rollup_db_;
+
   scoped_ptr<leveldb::DB> event_db_;
 
   leveldb::ReadOptions read_options_;
@@ -64,6 +64,12 @@ class DatabaseTestHelper {
   size_t GetNumberOfEventEntries() {
     return GetNumberOfEntries(database_->event_db_.get());
   }
+  size_t GetNumberOfMetricBlockEntries() {
+    return GetNumberOfEntries(database_->metric_block_db_.get());
+  }
+  size_t GetNumberOfRollupEntries() {
+    return GetNumberOfEntries(database_->rollup_db_.get());
+  }
 
  private:
   // Returns the number of entries in a given database.
@@ -92,6 +98,9 @@ class TestingClock : public Database::Clock {
   virtual base::Time GetTime() OVERRIDE {
     return base::Time::FromInternalValue(++counter_);
   }
+  void Advance(const base::TimeDelta& delta) {
+    counter_ += delta.InMicroseconds();
+  }
  private:
   int64 counter_;
 };
@@ -272,6 +281,106 @@ TEST(PerformanceMonitorDatabaseSetupTest,
   EXPECT_TRUE(active_interval.empty());
 }
 
+TEST(PerformanceMonitorDatabaseSetupTest, CompactMetrics) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  TestingClock* clock = new TestingClock();
+  clock->Advance(base::TimeDelta::FromDays(1));
+  base::Time start = clock->GetTime();
+  scoped_ptr<Database> db = Database::Create(temp_dir.path());
+  db->set_clock(scoped_ptr<Database::Clock>(clock));
+  DatabaseTestHelper helper(db.get());
+
+  // A sample a minute, as in the field.
+  for (int i = 0; i < 300; ++i) {
+    db->AddMetric(Metric(METRIC_CPU_USAGE,
+                         start + base::TimeDelta::FromMinutes(i),
+                         static_cast<double>(i % 7)));
+  }
+  clock->Advance(base::TimeDelta::FromHours(6));
+  ASSERT_TRUE(db->CompactMetrics());
+  EXPECT_EQ(0u, helper.GetNumberOfMetricEntries());
+  EXPECT_EQ(2u, helper.GetNumberOfMetricBlockEntries());
+
+  // Statistics added since are read along with the compacted ones, and fill
+  // up the last block when they are compacted in turn.
+  db->AddMetric(Metric(METRIC_CPU_USAGE,
+                       start + base::TimeDelta::FromMinutes(300), 7.0));
+  Database::MetricVector stats = *db->GetStatsForActivityAndMetric(
+      METRIC_CPU_USAGE, base::Time(), clock->GetTime());
+  ASSERT_EQ(301u, stats.size());
+  for (int i = 0; i < 301; ++i) {
+    EXPECT_EQ(start + base::TimeDelta::FromMinutes(i), stats[i].time);
+    EXPECT_EQ(i % 7, stats[i].value);
+  }
+  clock->Advance(base::TimeDelta::FromHours(1));
+  ASSERT_TRUE(db->CompactMetrics());
+  EXPECT_EQ(0u, helper.GetNumberOfMetricEntries());
+  EXPECT_EQ(2u, helper.GetNumberOfMetricBlockEntries());
+
+  stats = *db->GetStatsForActivityAndMetric(
+      METRIC_CPU_USAGE, start + base::TimeDelta::FromMinutes(250),
+      start + base::TimeDelta::FromMinutes(259));
+  ASSERT_EQ(10u, stats.size());
+  EXPECT_EQ(250 % 7, stats[0].value);
+
+  Database::MetricTypeSet active_metrics =
+      db->GetActiveMetrics(start, clock->GetTime());
+  EXPECT_EQ(1u, active_metrics.count(METRIC_CPU_USAGE));
+}
+
+TEST(PerformanceMonitorDatabaseSetupTest, Rollups) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  TestingClock* clock = new TestingClock();
+  clock->Advance(base::TimeDelta::FromDays(1) +
+                 base::TimeDelta::FromMinutes(30));
+  base::Time start = clock->GetTime();
+  scoped_ptr<Database> db = Database::Create(temp_dir.path());
+  db->set_clock(scoped_ptr<Database::Clock>(clock));
+  DatabaseTestHelper helper(db.get());
+
+  // Two hours of statistics, of which the first is compacted.
+  for (int i = 0; i < 120; ++i) {
+    db->AddMetric(Metric(METRIC_CPU_USAGE,
+                         start + base::TimeDelta::FromMinutes(i),
+                         i < 60 ? 10.0 : 20.0));
+  }
+  clock->Advance(base::TimeDelta::FromMinutes(70));
+  ASSERT_TRUE(db->CompactMetrics());
+  EXPECT_LT(0u, helper.GetNumberOfRollupEntries());
+
+  // |start| is half past the hour, so the statistics span three hours. The
+  // second mixes compacted and uncompacted statistics.
+  Database::MetricVector stats = *db->GetRollupsForActivityAndMetric(
+      METRIC_CPU_USAGE, Database::ROLLUP_HOUR, start,
+      start + base::TimeDelta::FromHours(2));
+  ASSERT_EQ(3u, stats.size());
+  EXPECT_EQ(10.0, stats[0].value);
+  EXPECT_EQ(15.0, stats[1].value);
+  EXPECT_EQ(20.0, stats[2].value);
+  EXPECT_EQ(base::Time() + base::TimeDelta::FromDays(1), stats[0].time);
+
+  stats = *db->GetRollupsForActivityAndMetric(
+      METRIC_CPU_USAGE, Database::ROLLUP_MINUTE, start,
+      start + base::TimeDelta::FromMinutes(119));
+  ASSERT_EQ(120u, stats.size());
+  EXPECT_EQ(10.0, stats[0].value);
+  EXPECT_EQ(20.0, stats[119].value);
+
+  // The statistics expire long before the hourly rollups.
+  clock->Advance(base::TimeDelta::FromDays(30));
+  ASSERT_TRUE(db->CompactMetrics());
+  EXPECT_EQ(0u, helper.GetNumberOfMetricEntries());
+  EXPECT_EQ(0u, helper.GetNumberOfMetricBlockEntries());
+  EXPECT_TRUE(db->GetStatsForActivityAndMetric(
+      METRIC_CPU_USAGE, base::Time(), clock->GetTime())->empty());
+  stats = *db->GetRollupsForActivityAndMetric(
+      METRIC_CPU_USAGE, Database::ROLLUP_HOUR, start,
+      start + base::TimeDelta::FromHours(2));
+  EXPECT_EQ(3u, stats.size());
+}
+
 ////// PerformanceMonitorDatabaseEventTests ////////////////////////////////////
 TEST_F(PerformanceMonitorDatabaseEventTest, GetAllEvents) {
   Database::EventVector events = db_->GetEvents();
@@ -234,6 +234,34 @@ RecentKey KeyBuilder::SplitRecentKey(const std::string& key) {
                    split[RECENT_ACTIVITY]);
 }
 
+std::string KeyBuilder::CreateMetricBlockKey(const MetricType type,
+                                             const std::string& activity,
+                                             const base::Time& time) {
+  return base::StringPrintf("%c%c%s%c%016" PRId64,
+                            metric_type_to_metric_key_char_[type],
+                            kDelimiter, activity.c_str(),
+                            kDelimiter, time.ToInternalValue());
+}
+
+std::string KeyBuilder::CreateRollupKey(char resolution,
+                                        const MetricType type,
+                                        const std::string& activity,
+                                        const base::Time& time) {
+  return base::StringPrintf("%c%c%c%c%s%c%016" PRId64,
+                            resolution, kDelimiter,
+                            metric_type_to_metric_key_char_[type],
+                            kDelimiter, activity.c_str(),
+                            kDelimiter, time.ToInternalValue());
+}
+
+base::Time KeyBuilder::TimeFromMetricBlockOrRollupKey(const std::string& key) {
+  size_t delimiter = key.rfind(kDelimiter);
+  int64 time = 0;
+  if (delimiter != std::string::npos)
+    base::StringToInt64(key.substr(delimiter + 1), &time);
+  return base::Time::FromInternalValue(time);
+}
+
 MetricKey KeyBuilder::SplitMetricKey(const std::string& key) {
   std::vector<std::string> split;
   base::SplitString(key, kDelimiter, &split);
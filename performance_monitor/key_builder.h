@@ -79,6 +79,23 @@ class KeyBuilder {
   std::string CreateMaxValueKey(const MetricType type,
                                 const std::string& activity);
 
+  // Key Schema: <Metric>-<Activity>-<Time>
+  // The time is that of the last sample in the block, so that seeking to a
+  // time finds the first block which may hold samples from then on.
+  std::string CreateMetricBlockKey(const MetricType type,
+                                   const std::string& activity,
+                                   const base::Time& time);
+
+  // Key Schema: <Resolution>-<Metric>-<Activity>-<Time>
+  // |resolution| is a character identifying the rollup width.
+  std::string CreateRollupKey(char resolution,
+                              const MetricType type,
+                              const std::string& activity,
+                              const base::Time& time);
+
+  // Both of the above end with the time.
+  base::Time TimeFromMetricBlockOrRollupKey(const std::string& key);
+
   EventType EventKeyToEventType(const std::string& key);
   RecentKey SplitRecentKey(const std::string& key);
   MetricKey SplitMetricKey(const std::string& key);
@@ -529,6 +529,12 @@ void PerformanceMonitor::StoreMetricsOnBackgroundThread(
                time_now,
                static_cast<double>(
                    performance_data_for_io_thread.network_bytes_read)));
+
+    if (time_now >= next_compaction_time_) {
+      database_->CompactMetrics();
+      next_compaction_time_ =
+          time_now + base::TimeDelta::FromMinutes(kCompactionIntervalInMinutes);
+    }
   }
 
   BrowserThread::PostTask(
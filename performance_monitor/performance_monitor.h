@@ -199,6 +199,9 @@ class PerformanceMonitor : public content::NotificationObserver {
   // and act on them.
   base::Time next_collection_time_;
 
+  // The next time the stored metrics should be compacted.
+  base::Time next_compaction_time_;
+
   // How long to wait between collections.
   int gather_interval_in_seconds_;
 
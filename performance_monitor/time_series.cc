@@ -0,0 +1,289 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/performance_monitor/time_series.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "base/logging.h"
+
+namespace performance_monitor {
+
+namespace {
+
+// The size of the sample count which starts a block.
+const size_t kHeaderSize = sizeof(uint32);
+
+// Timestamps are in microseconds. The deltas of deltas that do not fit the
+// smaller widths are written in full.
+const int kDeltaOfDeltaBits[] = { 14, 24, 36 };
+
+// Leading zeros are written in 5 bits, and the number of meaningful bits,
+// less one, in 6.
+const int kMaxLeadingZeros = 31;
+const int kLeadingZerosBits = 5;
+const int kMeaningfulBitsBits = 6;
+
+int CountLeadingZeros(uint64 value) {
+  DCHECK_NE(0u, value);
+  int count = 0;
+  while (!(value & (GG_UINT64_C(1) << 63))) {
+    value <<= 1;
+    ++count;
+  }
+  return count;
+}
+
+int CountTrailingZeros(uint64 value) {
+  DCHECK_NE(0u, value);
+  int count = 0;
+  while (!(value & 1)) {
+    value >>= 1;
+    ++count;
+  }
+  return count;
+}
+
+bool FitsInBits(int64 value, int bits) {
+  int64 limit = GG_INT64_C(1) << (bits - 1);
+  return value >= -limit && value < limit;
+}
+
+int64 SignExtend(uint64 value, int bits) {
+  if (bits < 64 && (value & (GG_UINT64_C(1) << (bits - 1))))
+    value |= ~((GG_UINT64_C(1) << bits) - 1);
+  return static_cast<int64>(value);
+}
+
+uint64 DoubleToBits(double value) {
+  uint64 bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+double BitsToDouble(uint64 bits) {
+  double value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+}  // namespace
+
+TimeSeriesEncoder::TimeSeriesEncoder()
+    : data_(kHeaderSize, '\0'),
+      pending_byte_(0),
+      pending_bit_count_(0),
+      sample_count_(0),
+      last_time_(0),
+      last_delta_(0),
+      last_value_bits_(0),
+      last_leading_zeros_(-1),
+      last_trailing_zeros_(-1) {
+}
+
+TimeSeriesEncoder::~TimeSeriesEncoder() {
+}
+
+void TimeSeriesEncoder::Append(const base::Time& time, double value) {
+  int64 time_value = time.ToInternalValue();
+  uint64 value_bits = DoubleToBits(value);
+
+  if (sample_count_ == 0) {
+    WriteBits(static_cast<uint64>(time_value), 64);
+    WriteBits(value_bits, 64);
+  } else {
+    DCHECK_GE(time_value, last_time_);
+    int64 delta = time_value - last_time_;
+    int64 delta_of_delta = delta - last_delta_;
+    last_delta_ = delta;
+    if (delta_of_delta == 0) {
+      WriteBits(0, 1);
+    } else {
+      // The prefix is a run of ones, one per width skipped, ended by a zero
+      // unless the delta of delta is written in full.
+      size_t width = 0;
+      while (width < arraysize(kDeltaOfDeltaBits) &&
+             !FitsInBits(delta_of_delta, kDeltaOfDeltaBits[width])) {
+        ++width;
+      }
+      if (width < arraysize(kDeltaOfDeltaBits)) {
+        WriteBits((GG_UINT64_C(1) << (width + 2)) - 2, width + 2);
+        WriteBits(static_cast<uint64>(delta_of_delta) &
+                      ((GG_UINT64_C(1) << kDeltaOfDeltaBits[width]) - 1),
+                  kDeltaOfDeltaBits[width]);
+      } else {
+        WriteBits(0xf, 4);
+        WriteBits(static_cast<uint64>(delta_of_delta), 64);
+      }
+    }
+
+    uint64 xor_bits = value_bits ^ last_value_bits_;
+    if (xor_bits == 0) {
+      WriteBits(0, 1);
+    } else {
+      int leading_zeros =
+          std::min(CountLeadingZeros(xor_bits), kMaxLeadingZeros);
+      int trailing_zeros = CountTrailingZeros(xor_bits);
+      if (last_leading_zeros_ >= 0 &&
+          leading_zeros >= last_leading_zeros_ &&
+          trailing_zeros >= last_trailing_zeros_) {
+        // The meaningful bits fit in the previous window.
+        WriteBits(2, 2);
+        WriteBits(xor_bits >> last_trailing_zeros_,
+                  64 - last_leading_zeros_ - last_trailing_zeros_);
+      } else {
+        int meaningful_bits = 64 - leading_zeros - trailing_zeros;
+        WriteBits(3, 2);
+        WriteBits(leading_zeros, kLeadingZerosBits);
+        WriteBits(meaningful_bits - 1, kMeaningfulBitsBits);
+        WriteBits(xor_bits >> trailing_zeros, meaningful_bits);
+        last_leading_zeros_ = leading_zeros;
+        last_trailing_zeros_ = trailing_zeros;
+      }
+    }
+  }
+
+  ++sample_count_;
+  last_time_ = time_value;
+  last_value_bits_ = value_bits;
+}
+
+std::string TimeSeriesEncoder::Finish() {
+  if (pending_bit_count_ > 0) {
+    data_.push_back(
+        static_cast<char>(pending_byte_ << (8 - pending_bit_count_)));
+  }
+  uint32 sample_count = static_cast<uint32>(sample_count_);
+  memcpy(&data_[0], &sample_count, sizeof(sample_count));
+
+  std::string block;
+  block.swap(data_);
+  data_.assign(kHeaderSize, '\0');
+  pending_byte_ = 0;
+  pending_bit_count_ = 0;
+  sample_count_ = 0;
+  last_time_ = 0;
+  last_delta_ = 0;
+  last_value_bits_ = 0;
+  last_leading_zeros_ = -1;
+  last_trailing_zeros_ = -1;
+  return block;
+}
+
+void TimeSeriesEncoder::WriteBits(uint64 bits, int count) {
+  DCHECK_LE(count, 64);
+  for (int i = count - 1; i >= 0; --i) {
+    pending_byte_ =
+        static_cast<uint8>((pending_byte_ << 1) | ((bits >> i) & 1));
+    if (++pending_bit_count_ == 8) {
+      data_.push_back(static_cast<char>(pending_byte_));
+      pending_byte_ = 0;
+      pending_bit_count_ = 0;
+    }
+  }
+}
+
+TimeSeriesDecoder::TimeSeriesDecoder(const std::string& block)
+    : block_(block),
+      bit_offset_(kHeaderSize * 8),
+      sample_count_(0),
+      samples_read_(0),
+      last_time_(0),
+      last_delta_(0),
+      last_value_bits_(0),
+      last_leading_zeros_(-1),
+      last_trailing_zeros_(-1) {
+  if (block_.size() >= kHeaderSize) {
+    uint32 sample_count;
+    memcpy(&sample_count, block_.data(), sizeof(sample_count));
+    sample_count_ = sample_count;
+  }
+}
+
+TimeSeriesDecoder::~TimeSeriesDecoder() {
+}
+
+bool TimeSeriesDecoder::Next(base::Time* time, double* value) {
+  if (samples_read_ >= sample_count_)
+    return false;
+
+  uint64 bits;
+  if (samples_read_ == 0) {
+    uint64 value_bits;
+    if (!ReadBits(64, &bits) || !ReadBits(64, &value_bits))
+      return false;
+    last_time_ = static_cast<int64>(bits);
+    last_value_bits_ = value_bits;
+  } else {
+    // Count the ones of the prefix to find the width of the delta of delta.
+    size_t width = 0;
+    while (width <= arraysize(kDeltaOfDeltaBits)) {
+      if (!ReadBits(1, &bits))
+        return false;
+      if (!bits)
+        break;
+      ++width;
+    }
+    int64 delta_of_delta = 0;
+    if (width > 0) {
+      int bit_count = width <= arraysize(kDeltaOfDeltaBits) ?
+          kDeltaOfDeltaBits[width - 1] : 64;
+      if (!ReadBits(bit_count, &bits))
+        return false;
+      delta_of_delta = SignExtend(bits, bit_count);
+    }
+    last_delta_ += delta_of_delta;
+    last_time_ += last_delta_;
+
+    if (!ReadBits(1, &bits))
+      return false;
+    if (bits) {
+      uint64 control;
+      if (!ReadBits(1, &control))
+        return false;
+      if (control) {
+        uint64 leading_zeros;
+        uint64 meaningful_bits;
+        if (!ReadBits(kLeadingZerosBits, &leading_zeros) ||
+            !ReadBits(kMeaningfulBitsBits, &meaningful_bits)) {
+          return false;
+        }
+        ++meaningful_bits;
+        if (leading_zeros + meaningful_bits > 64)
+          return false;
+        last_leading_zeros_ = static_cast<int>(leading_zeros);
+        last_trailing_zeros_ =
+            static_cast<int>(64 - leading_zeros - meaningful_bits);
+      } else if (last_leading_zeros_ < 0) {
+        return false;
+      }
+      int meaningful_bits = 64 - last_leading_zeros_ - last_trailing_zeros_;
+      if (!ReadBits(meaningful_bits, &bits))
+        return false;
+      last_value_bits_ ^= bits << last_trailing_zeros_;
+    }
+  }
+
+  ++samples_read_;
+  *time = base::Time::FromInternalValue(last_time_);
+  *value = BitsToDouble(last_value_bits_);
+  return true;
+}
+
+bool TimeSeriesDecoder::ReadBits(int count, uint64* bits) {
+  DCHECK_LE(count, 64);
+  if (bit_offset_ + count > block_.size() * 8)
+    return false;
+  *bits = 0;
+  for (int i = 0; i < count; ++i) {
+    uint8 byte = static_cast<uint8>(block_[bit_offset_ / 8]);
+    *bits = (*bits << 1) | ((byte >> (7 - bit_offset_ % 8)) & 1);
+    ++bit_offset_;
+  }
+  return true;
+}
+
+}  // namespace performance_monitor
@@ -0,0 +1,88 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_PERFORMANCE_MONITOR_TIME_SERIES_H_
+#define CHROME_BROWSER_PERFORMANCE_MONITOR_TIME_SERIES_H_
+
+#include <string>
+
+#include "base/basictypes.h"
+#include "base/time/time.h"
+
+namespace performance_monitor {
+
+// A block of samples of one metric, encoded column by column in the manner of
+// Facebook's Gorilla: timestamps as bit-packed deltas of deltas, which are
+// zero for regularly gathered metrics, and values as the XOR with the previous
+// value, of which only the meaningful bits are written. Samples must be
+// appended in increasing time order.
+//
+// The block is laid out as a uint32 sample count followed by the bit stream,
+// which starts with the first timestamp and value in full.
+class TimeSeriesEncoder {
+ public:
+  TimeSeriesEncoder();
+  ~TimeSeriesEncoder();
+
+  void Append(const base::Time& time, double value);
+
+  size_t sample_count() const { return sample_count_; }
+  base::Time last_time() const {
+    return base::Time::FromInternalValue(last_time_);
+  }
+
+  // Returns the encoded block, and resets the encoder.
+  std::string Finish();
+
+ private:
+  void WriteBits(uint64 bits, int count);
+
+  std::string data_;
+  uint8 pending_byte_;
+  int pending_bit_count_;
+
+  size_t sample_count_;
+  int64 last_time_;
+  int64 last_delta_;
+  uint64 last_value_bits_;
+  int last_leading_zeros_;
+  int last_trailing_zeros_;
+
+  DISALLOW_COPY_AND_ASSIGN(TimeSeriesEncoder);
+};
+
+// Reads the samples of a block written by TimeSeriesEncoder. |block| is not
+// copied, and must outlive the decoder.
+class TimeSeriesDecoder {
+ public:
+  explicit TimeSeriesDecoder(const std::string& block);
+  ~TimeSeriesDecoder();
+
+  // The number of samples in the block, or 0 if it is malformed.
+  size_t sample_count() const { return sample_count_; }
+
+  // Reads the next sample. Returns false once the block has been read, or if
+  // it is truncated.
+  bool Next(base::Time* time, double* value);
+
+ private:
+  bool ReadBits(int count, uint64* bits);
+
+  const std::string& block_;
+  size_t bit_offset_;
+
+  size_t sample_count_;
+  size_t samples_read_;
+  int64 last_time_;
+  int64 last_delta_;
+  uint64 last_value_bits_;
+  int last_leading_zeros_;
+  int last_trailing_zeros_;
+
+  DISALLOW_COPY_AND_ASSIGN(TimeSeriesDecoder);
+};
+
+}  // namespace performance_monitor
+
+#endif  // CHROME_BROWSER_PERFORMANCE_MONITOR_TIME_SERIES_H_
@@ -0,0 +1,113 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+#include <vector>
+
+#include "base/time/time.h"
+#include "chrome/browser/performance_monitor/time_series.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace performance_monitor {
+
+namespace {
+
+struct Sample {
+  Sample(const base::Time& sample_time, double sample_value)
+      : time(sample_time), value(sample_value) {}
+
+  base::Time time;
+  double value;
+};
+
+std::string Encode(const std::vector<Sample>& samples) {
+  TimeSeriesEncoder encoder;
+  for (size_t i = 0; i < samples.size(); ++i)
+    encoder.Append(samples[i].time, samples[i].value);
+  EXPECT_EQ(samples.size(), encoder.sample_count());
+  return encoder.Finish();
+}
+
+void ExpectDecodes(const std::vector<Sample>& samples,
+                   const std::string& block) {
+  TimeSeriesDecoder decoder(block);
+  ASSERT_EQ(samples.size(), decoder.sample_count());
+  base::Time time;
+  double value;
+  for (size_t i = 0; i < samples.size(); ++i) {
+    ASSERT_TRUE(decoder.Next(&time, &value));
+    EXPECT_EQ(samples[i].time, time);
+    EXPECT_EQ(samples[i].value, value);
+  }
+  EXPECT_FALSE(decoder.Next(&time, &value));
+}
+
+}  // namespace
+
+TEST(PerformanceMonitorTimeSeriesTest, RegularSeriesIsCompact) {
+  std::vector<Sample> samples;
+  base::Time time = base::Time::Now();
+  for (int i = 0; i < 256; ++i) {
+    samples.push_back(Sample(time + base::TimeDelta::FromMinutes(i),
+                             i % 16 < 8 ? 12.5 : 50.0));
+  }
+  std::string block = Encode(samples);
+  ExpectDecodes(samples, block);
+  // A repeated interval costs a bit, and so does an unchanged value.
+  EXPECT_GT(128u, block.size());
+}
+
+TEST(PerformanceMonitorTimeSeriesTest, IrregularSeries) {
+  std::vector<Sample> samples;
+  base::Time time = base::Time::Now();
+  // Deltas of deltas of every width, and values with nothing in common.
+  const int64 kSteps[] = { 1, 1000, 1000000, 60000000,
+                           GG_INT64_C(3600000000),
+                           GG_INT64_C(86400000000000), 7, 7, 0 };
+  const double kValues[] = { 0.0, -1.5, 1e300, 3.0, 3.0000001, 1e-300,
+                             123456.789, 42.0, 42.0 };
+  for (size_t i = 0; i < arraysize(kSteps); ++i) {
+    time += base::TimeDelta::FromMicroseconds(kSteps[i]);
+    samples.push_back(Sample(time, kValues[i]));
+  }
+  ExpectDecodes(samples, Encode(samples));
+}
+
+TEST(PerformanceMonitorTimeSeriesTest, EncoderIsReusable) {
+  std::vector<Sample> samples;
+  samples.push_back(Sample(base::Time::FromInternalValue(10), 1.0));
+  samples.push_back(Sample(base::Time::FromInternalValue(20), 2.0));
+  TimeSeriesEncoder encoder;
+  encoder.Append(base::Time::FromInternalValue(5), 100.0);
+  encoder.Finish();
+  EXPECT_EQ(0u, encoder.sample_count());
+  for (size_t i = 0; i < samples.size(); ++i)
+    encoder.Append(samples[i].time, samples[i].value);
+  ExpectDecodes(samples, encoder.Finish());
+}
+
+TEST(PerformanceMonitorTimeSeriesTest, TruncatedBlock) {
+  std::vector<Sample> samples;
+  base::Time time = base::Time::Now();
+  for (int i = 0; i < 10; ++i)
+    samples.push_back(Sample(time + base::TimeDelta::FromSeconds(i * i), i));
+  std::string block = Encode(samples);
+  block.resize(block.size() - 4);
+
+  TimeSeriesDecoder decoder(block);
+  EXPECT_EQ(10u, decoder.sample_count());
+  base::Time decoded_time;
+  double value;
+  size_t decoded = 0;
+  while (decoder.Next(&decoded_time, &value))
+    ++decoded;
+  EXPECT_GT(10u, decoded);
+
+  std::string empty;
+  TimeSeriesDecoder empty_decoder(empty);
+  EXPECT_EQ(0u, empty_decoder.sample_count());
+  EXPECT_FALSE(empty_decoder.Next(&decoded_time, &value));
+}
+
+}  // namespace performance_monitor
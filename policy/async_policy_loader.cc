@@ -64,6 +64,17 @@ void AsyncPolicyLoader::Reload(bool force) {
     it->second->FilterBundle(bundle.get());
   }
 
+  // Periodic reloads and file events usually find the same policies. Skip
+  // the update then, so that the provider and the PolicyService don't have to
+  // merge and compare them again. Forced reloads always go through, since
+  // RefreshPolicies() waits for them.
+  if (!force && last_bundle_ && bundle->Equals(*last_bundle_)) {
+    ScheduleNextReload(TimeDelta::FromSeconds(kReloadIntervalSeconds));
+    return;
+  }
+  last_bundle_.reset(new PolicyBundle());
+  last_bundle_->CopyFrom(*bundle);
+
   update_callback_.Run(bundle.Pass());
   ScheduleNextReload(TimeDelta::FromSeconds(kReloadIntervalSeconds));
 }
@@ -81,7 +92,10 @@ scoped_ptr<PolicyBundle> AsyncPolicyLoader::InitialLoad() {
   // initial |last_modification_time_|, so that potential changes made before
   // installing the watches can be detected.
   last_modification_time_ = LastModificationTime();
-  return Load();
+  scoped_ptr<PolicyBundle> bundle(Load());
+  last_bundle_.reset(new PolicyBundle());
+  last_bundle_->CopyFrom(*bundle);
+  return bundle.Pass();
 }
 
 void AsyncPolicyLoader::Init(const UpdateCallback& update_callback) {
@@ -64,6 +64,8 @@ class AsyncPolicyLoader {
   // currently being written to, and whose contents are incomplete.
   // A reload is posted periodically, if it hasn't been triggered recently. This
   // makes sure the policies are reloaded if the update events aren't triggered.
+  // Unless |force| is true, the bundle is only passed to the provider if it
+  // differs from the last one.
   void Reload(bool force);
 
   // Passes the current |descriptor| for a domain, which is used to determine
@@ -112,6 +114,10 @@ class AsyncPolicyLoader {
   // Used to get WeakPtrs for the periodic reload task.
   base::WeakPtrFactory<AsyncPolicyLoader> weak_factory_;
 
+  // The last bundle passed to |update_callback_|, or returned by the initial
+  // Load(). Unforced reloads that find the same policies aren't passed on.
+  scoped_ptr<PolicyBundle> last_bundle_;
+
   // Records last known modification timestamp.
   base::Time last_modification_time_;
 
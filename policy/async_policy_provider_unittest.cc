@@ -202,6 +202,32 @@ TEST_F(AsyncPolicyProviderTest, RefreshPoliciesDuringReload) {
   provider_->RemoveObserver(&observer);
 }
 
+TEST_F(AsyncPolicyProviderTest, SkipUnchangedReload) {
+  MockConfigurationPolicyObserver observer;
+  provider_->AddObserver(&observer);
+
+  // A periodic reload that finds the same policies doesn't update them.
+  EXPECT_CALL(*loader_, MockLoad()).WillOnce(Return(&initial_bundle_));
+  EXPECT_CALL(observer, OnUpdatePolicy(provider_.get())).Times(0);
+  loader_->Reload(false);
+  loop_.RunUntilIdle();
+  Mock::VerifyAndClearExpectations(loader_);
+  Mock::VerifyAndClearExpectations(&observer);
+
+  PolicyBundle reloaded_bundle;
+  SetPolicy(&reloaded_bundle, "policy", "reloaded");
+  EXPECT_CALL(*loader_, LastModificationTime())
+      .WillRepeatedly(Return(base::Time()));
+  EXPECT_CALL(*loader_, MockLoad()).WillOnce(Return(&reloaded_bundle));
+  EXPECT_CALL(observer, OnUpdatePolicy(provider_.get())).Times(1);
+  loader_->Reload(false);
+  loop_.RunUntilIdle();
+  EXPECT_TRUE(provider_->policies().Equals(reloaded_bundle));
+  Mock::VerifyAndClearExpectations(&observer);
+
+  provider_->RemoveObserver(&observer);
+}
+
 TEST_F(AsyncPolicyProviderTest, Shutdown) {
   EXPECT_CALL(*loader_, MockLoad()).WillRepeatedly(Return(&initial_bundle_));
 
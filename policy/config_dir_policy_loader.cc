@@ -57,6 +57,20 @@ PolicyLoadStatus JsonErrorToPolicyLoadStatus(int status) {
 
 }  // namespace
 
+struct ConfigDirPolicyLoader::ConfigFile {
+  ConfigFile() : size(0), has_error(false), error(POLICY_LOAD_STATUS_STARTED) {}
+
+  // The fingerprint of the file. It is read again when these change.
+  base::Time last_modified;
+  int64 size;
+
+  // Whether the file couldn't be loaded, and why.
+  bool has_error;
+  PolicyLoadStatus error;
+
+  PolicyBundle policies;
+};
+
 ConfigDirPolicyLoader::ConfigDirPolicyLoader(
     scoped_refptr<base::SequencedTaskRunner> task_runner,
     const base::FilePath& config_dir,
@@ -76,12 +90,17 @@ void ConfigDirPolicyLoader::InitOnBackgroundThread() {
 
 scoped_ptr<PolicyBundle> ConfigDirPolicyLoader::Load() {
   scoped_ptr<PolicyBundle> bundle(new PolicyBundle());
+  ConfigFileMap config_files;
   LoadFromPath(config_dir_.Append(kMandatoryConfigDir),
                POLICY_LEVEL_MANDATORY,
-               bundle.get());
+               bundle.get(),
+               &config_files);
   LoadFromPath(config_dir_.Append(kRecommendedConfigDir),
                POLICY_LEVEL_RECOMMENDED,
-               bundle.get());
+               bundle.get(),
+               &config_files);
+  // Files that are gone are dropped.
+  config_files_.swap(config_files);
   return bundle.Pass();
 }
 
@@ -117,7 +136,8 @@ base::Time ConfigDirPolicyLoader::LastModificationTime() {
 
 void ConfigDirPolicyLoader::LoadFromPath(const base::FilePath& path,
                                          PolicyLevel level,
-                                         PolicyBundle* bundle) {
+                                         PolicyBundle* bundle,
+                                         ConfigFileMap* config_files) {
   // Enumerate the files and sort them lexicographically.
   std::set<base::FilePath> files;
   base::FileEnumerator file_enumerator(path, false,
@@ -139,37 +159,67 @@ void ConfigDirPolicyLoader::LoadFromPath(const base::FilePath& path,
   for (std::set<base::FilePath>::reverse_iterator config_file_iter =
            files.rbegin(); config_file_iter != files.rend();
        ++config_file_iter) {
-    JSONFileValueSerializer deserializer(*config_file_iter);
-    deserializer.set_allow_trailing_comma(true);
-    int error_code = 0;
-    std::string error_msg;
-    scoped_ptr<base::Value> value(
-        deserializer.Deserialize(&error_code, &error_msg));
-    if (!value.get()) {
-      LOG(WARNING) << "Failed to read configuration file "
-                   << config_file_iter->value() << ": " << error_msg;
-      status.Add(JsonErrorToPolicyLoadStatus(error_code));
-      continue;
-    }
-    base::DictionaryValue* dictionary_value = NULL;
-    if (!value->GetAsDictionary(&dictionary_value)) {
-      LOG(WARNING) << "Expected JSON dictionary in configuration file "
-                   << config_file_iter->value();
-      status.Add(POLICY_LOAD_STATUS_PARSE_ERROR);
-      continue;
-    }
+    linked_ptr<ConfigFile> config_file =
+        ReadConfigFile(*config_file_iter, level);
+    (*config_files)[*config_file_iter] = config_file;
+    if (config_file->has_error)
+      status.Add(config_file->error);
+    else
+      bundle->MergeFrom(config_file->policies);
+  }
+}
+
+linked_ptr<ConfigDirPolicyLoader::ConfigFile>
+ConfigDirPolicyLoader::ReadConfigFile(const base::FilePath& path,
+                                      PolicyLevel level) {
+  base::PlatformFileInfo info;
+  const bool has_info = file_util::GetFileInfo(path, &info);
+  ConfigFileMap::const_iterator cached = config_files_.find(path);
+  if (has_info && cached != config_files_.end() &&
+      cached->second->last_modified == info.last_modified &&
+      cached->second->size == info.size) {
+    return cached->second;
+  }
 
-    // Detach the "3rdparty" node.
-    scoped_ptr<base::Value> third_party;
-    if (dictionary_value->Remove("3rdparty", &third_party))
-      Merge3rdPartyPolicy(third_party.get(), level, bundle);
+  linked_ptr<ConfigFile> config_file(new ConfigFile());
+  if (has_info) {
+    config_file->last_modified = info.last_modified;
+    config_file->size = info.size;
+  }
 
-    // Add chrome policy.
-    PolicyMap policy_map;
-    policy_map.LoadFrom(dictionary_value, level, scope_);
-    bundle->Get(PolicyNamespace(POLICY_DOMAIN_CHROME, std::string()))
-        .MergeFrom(policy_map);
+  JSONFileValueSerializer deserializer(path);
+  deserializer.set_allow_trailing_comma(true);
+  int error_code = 0;
+  std::string error_msg;
+  scoped_ptr<base::Value> value(
+      deserializer.Deserialize(&error_code, &error_msg));
+  if (!value.get()) {
+    LOG(WARNING) << "Failed to read configuration file "
+                 << path.value() << ": " << error_msg;
+    config_file->has_error = true;
+    config_file->error = JsonErrorToPolicyLoadStatus(error_code);
+    return config_file;
   }
+  base::DictionaryValue* dictionary_value = NULL;
+  if (!value->GetAsDictionary(&dictionary_value)) {
+    LOG(WARNING) << "Expected JSON dictionary in configuration file "
+                 << path.value();
+    config_file->has_error = true;
+    config_file->error = POLICY_LOAD_STATUS_PARSE_ERROR;
+    return config_file;
+  }
+
+  // Detach the "3rdparty" node.
+  scoped_ptr<base::Value> third_party;
+  if (dictionary_value->Remove("3rdparty", &third_party))
+    Merge3rdPartyPolicy(third_party.get(), level, &config_file->policies);
+
+  // Add chrome policy.
+  PolicyMap policy_map;
+  policy_map.LoadFrom(dictionary_value, level, scope_);
+  config_file->policies.Get(PolicyNamespace(POLICY_DOMAIN_CHROME,
+                                            std::string())).Swap(&policy_map);
+  return config_file;
 }
 
 void ConfigDirPolicyLoader::Merge3rdPartyPolicy(
@@ -5,8 +5,11 @@
 #ifndef CHROME_BROWSER_POLICY_CONFIG_DIR_POLICY_LOADER_H_
 #define CHROME_BROWSER_POLICY_CONFIG_DIR_POLICY_LOADER_H_
 
+#include <map>
+
 #include "base/files/file_path.h"
 #include "base/files/file_path_watcher.h"
+#include "base/memory/linked_ptr.h"
 #include "chrome/browser/policy/async_policy_loader.h"
 #include "chrome/browser/policy/policy_types.h"
 
@@ -34,10 +37,22 @@ class ConfigDirPolicyLoader : public AsyncPolicyLoader {
   virtual base::Time LastModificationTime() OVERRIDE;
 
  private:
+  // The policies read from a config file, and the file's fingerprint when they
+  // were read.
+  struct ConfigFile;
+  typedef std::map<base::FilePath, linked_ptr<ConfigFile> > ConfigFileMap;
+
   // Loads the policy files at |path| into the |bundle|, with the given |level|.
+  // The files read are added to |config_files|.
   void LoadFromPath(const base::FilePath& path,
                     PolicyLevel level,
-                    PolicyBundle* bundle);
+                    PolicyBundle* bundle,
+                    ConfigFileMap* config_files);
+
+  // Reads the policies in the file at |path|, with the given |level|. Returns
+  // the ConfigFile of the previous Load() if the file hasn't changed since.
+  linked_ptr<ConfigFile> ReadConfigFile(const base::FilePath& path,
+                                        PolicyLevel level);
 
   // Merges the 3rd party |policies| into the |bundle|, with the given |level|.
   void Merge3rdPartyPolicy(const base::Value* policies,
@@ -53,6 +68,10 @@ class ConfigDirPolicyLoader : public AsyncPolicyLoader {
   // Policies loaded by this provider will have this scope.
   PolicyScope scope_;
 
+  // The files read by the last Load(), so that the ones that haven't changed
+  // aren't parsed again on every reload.
+  ConfigFileMap config_files_;
+
   // Watchers for events on the mandatory and recommended subdirectories of
   // |config_dir_|.
   base::FilePathWatcher mandatory_watcher_;
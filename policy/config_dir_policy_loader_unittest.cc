@@ -233,4 +233,51 @@ TEST_F(ConfigDirPolicyLoaderTest, ReadPrefsMergePrefs) {
   EXPECT_TRUE(bundle->Equals(expected_bundle));
 }
 
+// Files that haven't changed since the last load are not read again.
+TEST_F(ConfigDirPolicyLoaderTest, ReadChangedFilesOnly) {
+  base::DictionaryValue test_dict_bar;
+  test_dict_bar.SetString("HomepageLocation", "http://bar.com");
+  harness_.WriteConfigFile(test_dict_bar, "policy");
+  const base::FilePath file_path(
+      harness_.test_dir().Append(kMandatoryPath).AppendASCII("policy"));
+  const base::Time kTime = base::Time::Now() - base::TimeDelta::FromHours(1);
+  ASSERT_TRUE(file_util::TouchFile(file_path, kTime, kTime));
+
+  ConfigDirPolicyLoader loader(
+      loop_.message_loop_proxy(), harness_.test_dir(), POLICY_SCOPE_USER);
+  scoped_ptr<PolicyBundle> bundle(loader.Load());
+  ASSERT_TRUE(bundle.get());
+  PolicyBundle expected_bundle;
+  expected_bundle.Get(PolicyNamespace(POLICY_DOMAIN_CHROME, std::string()))
+      .LoadFrom(&test_dict_bar, POLICY_LEVEL_MANDATORY, POLICY_SCOPE_USER);
+  EXPECT_TRUE(bundle->Equals(expected_bundle));
+
+  // Contents of the same size with the same modification time aren't noticed.
+  base::DictionaryValue test_dict_foo;
+  test_dict_foo.SetString("HomepageLocation", "http://foo.com");
+  harness_.WriteConfigFile(test_dict_foo, "policy");
+  ASSERT_TRUE(file_util::TouchFile(file_path, kTime, kTime));
+  bundle = loader.Load();
+  ASSERT_TRUE(bundle.get());
+  EXPECT_TRUE(bundle->Equals(expected_bundle));
+
+  // The file is read again once its modification time changes.
+  const base::Time kLaterTime = kTime + base::TimeDelta::FromMinutes(1);
+  ASSERT_TRUE(file_util::TouchFile(file_path, kLaterTime, kLaterTime));
+  bundle = loader.Load();
+  ASSERT_TRUE(bundle.get());
+  PolicyBundle expected_bundle_foo;
+  expected_bundle_foo.Get(
+      PolicyNamespace(POLICY_DOMAIN_CHROME, std::string()))
+      .LoadFrom(&test_dict_foo, POLICY_LEVEL_MANDATORY, POLICY_SCOPE_USER);
+  EXPECT_TRUE(bundle->Equals(expected_bundle_foo));
+
+  // Removed files are dropped.
+  ASSERT_TRUE(base::DeleteFile(file_path, false));
+  bundle = loader.Load();
+  ASSERT_TRUE(bundle.get());
+  const PolicyBundle kEmptyBundle;
+  EXPECT_TRUE(bundle->Equals(kEmptyBundle));
+}
+
 }  // namespace policy
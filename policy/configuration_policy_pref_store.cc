@@ -80,6 +80,18 @@ void ConfigurationPolicyPrefStore::OnPolicyUpdated(
     const PolicyMap& current) {
   DCHECK_EQ(POLICY_DOMAIN_CHROME, ns.domain);
   DCHECK(ns.component_id.empty());
+
+  // Only the policies at |level_| feed this store. Don't run the handlers
+  // again if none of those changed.
+  PolicyMap previous_at_level;
+  previous_at_level.CopyFrom(previous);
+  previous_at_level.FilterLevel(level_);
+  PolicyMap current_at_level;
+  current_at_level.CopyFrom(current);
+  current_at_level.FilterLevel(level_);
+  if (previous_at_level.Equals(current_at_level))
+    return;
+
   Refresh();
 }
 
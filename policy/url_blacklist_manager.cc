@@ -41,7 +41,9 @@ namespace policy {
 
 namespace {
 
-// Maximum filters per policy. Filters over this index are ignored.
+// Maximum filters with a path or a port per policy. Those are matched with a
+// URLMatcher, which is expensive to build; further ones are ignored. Filters
+// that only name a host aren't limited.
 const size_t kMaxFiltersPerPolicy = 1000;
 
 const char kServiceLoginAuth[] = "/ServiceLoginAuth";
@@ -61,6 +63,13 @@ bool IsSigninFlowURL(const GURL& url) {
 
 #endif  // !defined(OS_CHROMEOS)
 
+// Returns |host| with a leading dot, as the URLMatcher canonicalizes hosts.
+std::string CanonicalizeHost(const std::string& host) {
+  if (!host.empty() && host[0] == '.')
+    return host;
+  return "." + host;
+}
+
 // A task that builds the blacklist on the FILE thread.
 scoped_ptr<URLBlacklist> BuildBlacklist(scoped_ptr<base::ListValue> block,
                                         scoped_ptr<base::ListValue> allow) {
@@ -86,8 +95,7 @@ struct URLBlacklist::FilterComponents {
   bool allow;
 };
 
-URLBlacklist::URLBlacklist() : id_(0),
-                               url_matcher_(new URLMatcher) {
+URLBlacklist::URLBlacklist() : url_matcher_(new URLMatcher) {
 }
 
 URLBlacklist::~URLBlacklist() {
@@ -96,8 +104,7 @@ URLBlacklist::~URLBlacklist() {
 void URLBlacklist::AddFilters(bool allow,
                               const base::ListValue* list) {
   URLMatcherConditionSet::Vector all_conditions;
-  size_t size = std::min(kMaxFiltersPerPolicy, list->GetSize());
-  for (size_t i = 0; i < size; ++i) {
+  for (size_t i = 0; i < list->GetSize(); ++i) {
     std::string pattern;
     bool success = list->GetString(i, &pattern);
     DCHECK(success);
@@ -110,11 +117,22 @@ void URLBlacklist::AddFilters(bool allow,
       continue;
     }
 
-    all_conditions.push_back(
-        CreateConditionSet(url_matcher_.get(), ++id_, components.scheme,
-                           components.host, components.match_subdomains,
-                           components.port, components.path));
-    filters_[id_] = components;
+    URLMatcherConditionSet::ID id =
+        static_cast<URLMatcherConditionSet::ID>(filters_.size() + 1);
+    if (components.path.empty() && components.port == 0) {
+      if (components.match_subdomains)
+        subdomain_filters_[components.host].push_back(id);
+      else
+        host_filters_[CanonicalizeHost(components.host)].push_back(id);
+    } else {
+      if (all_conditions.size() == kMaxFiltersPerPolicy)
+        continue;
+      all_conditions.push_back(
+          CreateConditionSet(url_matcher_.get(), id, components.scheme,
+                             components.host, components.match_subdomains,
+                             components.port, components.path));
+    }
+    filters_.push_back(components);
   }
   url_matcher_->AddConditionSets(all_conditions);
 }
@@ -128,15 +146,25 @@ void URLBlacklist::Allow(const base::ListValue* filters) {
 }
 
 bool URLBlacklist::IsURLBlocked(const GURL& url) const {
+  const FilterComponents* max = NULL;
+
+  // Look up the host filters for the host and for each of its parent domains,
+  // then weigh them against the filters with a path or a port.
+  const std::string host = CanonicalizeHost(url.host());
+  FindHostFilter(host_filters_, host, url.scheme(), &max);
+  if (!subdomain_filters_.empty()) {
+    FindHostFilter(subdomain_filters_, std::string(), url.scheme(), &max);
+    for (size_t dot = host.find('.'); dot != std::string::npos;
+         dot = host.find('.', dot + 1)) {
+      FindHostFilter(subdomain_filters_, host.substr(dot), url.scheme(), &max);
+    }
+  }
+
   std::set<URLMatcherConditionSet::ID> matching_ids =
       url_matcher_->MatchURL(url);
-
-  const FilterComponents* max = NULL;
   for (std::set<URLMatcherConditionSet::ID>::iterator id = matching_ids.begin();
        id != matching_ids.end(); ++id) {
-    std::map<int, FilterComponents>::const_iterator it = filters_.find(*id);
-    DCHECK(it != filters_.end());
-    const FilterComponents& filter = it->second;
+    const FilterComponents& filter = GetFilter(*id);
     if (!max || FilterTakesPrecedence(filter, *max))
       max = &filter;
   }
@@ -291,6 +319,31 @@ bool URLBlacklist::FilterTakesPrecedence(const FilterComponents& lhs,
   return false;
 }
 
+const URLBlacklist::FilterComponents& URLBlacklist::GetFilter(
+    URLMatcherConditionSet::ID id) const {
+  DCHECK_GT(id, 0);
+  DCHECK_LE(static_cast<size_t>(id), filters_.size());
+  return filters_[id - 1];
+}
+
+void URLBlacklist::FindHostFilter(const HostFilterMap& host_filters,
+                                  const std::string& host,
+                                  const std::string& scheme,
+                                  const FilterComponents** max) const {
+  HostFilterMap::const_iterator it = host_filters.find(host);
+  if (it == host_filters.end())
+    return;
+  for (std::vector<URLMatcherConditionSet::ID>::const_iterator id =
+           it->second.begin();
+       id != it->second.end(); ++id) {
+    const FilterComponents& filter = GetFilter(*id);
+    if (!filter.scheme.empty() && filter.scheme != scheme)
+      continue;
+    if (!*max || FilterTakesPrecedence(filter, **max))
+      *max = &filter;
+  }
+}
+
 URLBlacklistManager::URLBlacklistManager(PrefService* pref_service)
     : ui_weak_ptr_factory_(this),
       pref_service_(pref_service),
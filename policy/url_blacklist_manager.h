@@ -5,8 +5,8 @@
 #ifndef CHROME_BROWSER_POLICY_URL_BLACKLIST_MANAGER_H_
 #define CHROME_BROWSER_POLICY_URL_BLACKLIST_MANAGER_H_
 
-#include <map>
 #include <string>
+#include <vector>
 
 #include "base/basictypes.h"
 #include "base/callback_forward.h"
@@ -36,6 +36,11 @@ namespace policy {
 
 // Contains a set of filters to block and allow certain URLs, and matches GURLs
 // against this set. The filters are currently kept in memory.
+//
+// Filters that only name a host, optionally with a scheme, are looked up by
+// the suffixes of the URL's host in hash maps, so that lists of many hosts
+// stay cheap to build and to match. Filters with a path or a port are matched
+// with a URLMatcher.
 class URLBlacklist {
  public:
   URLBlacklist();
@@ -56,7 +61,7 @@ class URLBlacklist {
   // Returns true if the URL is blocked.
   bool IsURLBlocked(const GURL& url) const;
 
-  // Returns the number of items in the list.
+  // Returns the number of filters in the list.
   size_t Size() const;
 
   // Splits a URL filter into its components. A GURL isn't used because these
@@ -91,12 +96,38 @@ class URLBlacklist {
  private:
   struct FilterComponents;
 
+  // Maps a host to the IDs of the host filters for it.
+  typedef base::hash_map<std::string,
+                         std::vector<extensions::URLMatcherConditionSet::ID> >
+      HostFilterMap;
+
   // Returns true if |lhs| takes precedence over |rhs|.
   static bool FilterTakesPrecedence(const FilterComponents& lhs,
                                     const FilterComponents& rhs);
 
-  extensions::URLMatcherConditionSet::ID id_;
-  std::map<extensions::URLMatcherConditionSet::ID, FilterComponents> filters_;
+  // Returns the filter with the given |id|.
+  const FilterComponents& GetFilter(
+      extensions::URLMatcherConditionSet::ID id) const;
+
+  // Replaces |*max| with the filters listed for |host| in |host_filters| that
+  // apply to |scheme| and take precedence over it.
+  void FindHostFilter(const HostFilterMap& host_filters,
+                      const std::string& host,
+                      const std::string& scheme,
+                      const FilterComponents** max) const;
+
+  // All the filters. The filter with ID |id| is at |filters_[id - 1]|.
+  std::vector<FilterComponents> filters_;
+
+  // Host filters that match only the host itself, keyed by the host with a
+  // leading dot, as the URLMatcher canonicalizes it.
+  HostFilterMap host_filters_;
+
+  // Host filters that match subdomains too, keyed by the host with a leading
+  // dot, or by the empty string for filters that match all hosts.
+  HostFilterMap subdomain_filters_;
+
+  // Matches the filters that have a path or a port.
   scoped_ptr<extensions::URLMatcher> url_matcher_;
 
   DISALLOW_COPY_AND_ASSIGN(URLBlacklist);
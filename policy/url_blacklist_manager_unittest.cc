@@ -10,6 +10,7 @@
 #include "base/message_loop/message_loop.h"
 #include "base/prefs/pref_registry_simple.h"
 #include "base/prefs/testing_pref_service.h"
+#include "base/strings/stringprintf.h"
 #include "chrome/common/pref_names.h"
 #include "content/public/test/test_browser_thread.h"
 #include "google_apis/gaia/gaia_urls.h"
@@ -487,6 +488,61 @@ TEST_F(URLBlacklistManagerTest, BlockAllWithExceptions) {
   EXPECT_FALSE(blacklist.IsURLBlocked(GURL("https://very.safe/path")));
 }
 
+TEST_F(URLBlacklistManagerTest, ManyHostFilters) {
+  URLBlacklist blacklist;
+
+  // Filters that only name a host aren't limited per policy.
+  scoped_ptr<base::ListValue> blocked(new base::ListValue);
+  for (int i = 0; i < 5000; ++i)
+    blocked->Append(new base::StringValue(base::StringPrintf("h%d.com", i)));
+  blacklist.Block(blocked.get());
+  EXPECT_EQ(5000u, blacklist.Size());
+  EXPECT_TRUE(blacklist.IsURLBlocked(GURL("http://h0.com")));
+  EXPECT_TRUE(blacklist.IsURLBlocked(GURL("http://www.h4999.com/path")));
+  EXPECT_FALSE(blacklist.IsURLBlocked(GURL("http://h5000.com")));
+  EXPECT_FALSE(blacklist.IsURLBlocked(GURL("http://xh1.com")));
+  EXPECT_FALSE(blacklist.IsURLBlocked(GURL("http://h1.com.evil")));
+
+  // Filters with a path or a port still are.
+  blocked.reset(new base::ListValue);
+  for (int i = 0; i < 1500; ++i) {
+    blocked->Append(
+        new base::StringValue(base::StringPrintf("p%d.com/path", i)));
+  }
+  blacklist.Block(blocked.get());
+  EXPECT_EQ(6000u, blacklist.Size());
+  EXPECT_TRUE(blacklist.IsURLBlocked(GURL("http://p999.com/path")));
+  EXPECT_FALSE(blacklist.IsURLBlocked(GURL("http://p1000.com/path")));
+
+  // Host filters and filters with a path override each other by the usual
+  // precedence rules.
+  scoped_ptr<base::ListValue> allowed(new base::ListValue);
+  allowed->Append(new base::StringValue("h1.com/public"));
+  allowed->Append(new base::StringValue("https://.h2.com"));
+  allowed->Append(new base::StringValue("h3.com:8080"));
+  blacklist.Allow(allowed.get());
+  EXPECT_FALSE(blacklist.IsURLBlocked(GURL("http://h1.com/public")));
+  EXPECT_FALSE(blacklist.IsURLBlocked(GURL("http://www.h1.com/public")));
+  EXPECT_TRUE(blacklist.IsURLBlocked(GURL("http://h1.com/private")));
+  EXPECT_FALSE(blacklist.IsURLBlocked(GURL("https://h2.com/")));
+  EXPECT_TRUE(blacklist.IsURLBlocked(GURL("http://h2.com/")));
+  EXPECT_TRUE(blacklist.IsURLBlocked(GURL("https://www.h2.com/")));
+  EXPECT_FALSE(blacklist.IsURLBlocked(GURL("http://h3.com:8080/")));
+  EXPECT_TRUE(blacklist.IsURLBlocked(GURL("http://h3.com/")));
+
+  // A more specific host filter overrides a filter with a path for a parent
+  // domain.
+  blocked.reset(new base::ListValue);
+  blocked->Append(new base::StringValue("example.com/path"));
+  blacklist.Block(blocked.get());
+  allowed.reset(new base::ListValue);
+  allowed->Append(new base::StringValue("www.example.com"));
+  blacklist.Allow(allowed.get());
+  EXPECT_TRUE(blacklist.IsURLBlocked(GURL("http://example.com/path")));
+  EXPECT_TRUE(blacklist.IsURLBlocked(GURL("http://s.example.com/path")));
+  EXPECT_FALSE(blacklist.IsURLBlocked(GURL("http://www.example.com/path")));
+}
+
 TEST_F(URLBlacklistManagerTest, DontBlockResources) {
   scoped_ptr<URLBlacklist> blacklist(new URLBlacklist());
   scoped_ptr<base::ListValue> blocked(new base::ListValue);
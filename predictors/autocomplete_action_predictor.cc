@@ -68,6 +68,7 @@ AutocompleteActionPredictor::AutocompleteActionPredictor(Profile* profile)
     : profile_(profile),
       main_profile_predictor_(NULL),
       incognito_predictor_(NULL),
+      lookup_cursor_(&user_text_trie_),
       initialized_(false) {
   if (profile_->IsOffTheRecord()) {
     main_profile_predictor_ = AutocompleteActionPredictorFactory::GetForProfile(
@@ -280,6 +281,7 @@ void AutocompleteActionPredictor::DeleteAllRows() {
 
   db_cache_.clear();
   db_id_cache_.clear();
+  user_text_trie_.Clear();
 
   if (table_.get()) {
     content::BrowserThread::PostTask(content::BrowserThread::DB, FROM_HERE,
@@ -305,6 +307,7 @@ void AutocompleteActionPredictor::DeleteRowsWithURLs(
       DCHECK(id_it != db_id_cache_.end());
       id_list.push_back(id_it->second);
       db_id_cache_.erase(id_it);
+      user_text_trie_.Remove(it->first.user_text, it->first.url);
       db_cache_.erase(it++);
     } else {
       ++it;
@@ -340,16 +343,22 @@ void AutocompleteActionPredictor::OnOmniboxOpenedUrl(const OmniboxLog& log) {
   std::vector<AutocompleteActionPredictorTable::Row> rows_to_add;
   std::vector<AutocompleteActionPredictorTable::Row> rows_to_update;
 
+  // The transitional matches were recorded one keystroke at a time, so a
+  // single cursor walks the trie about once for all of them.
+  UserTextTrie::Cursor cursor(&user_text_trie_);
   for (std::vector<TransitionalMatch>::const_iterator it =
         transitional_matches_.begin(); it != transitional_matches_.end();
         ++it) {
     if (!StartsWith(lower_user_text, it->user_text, true))
       continue;
 
+    DCHECK(it->user_text.length() >= kMinimumUserTextLength);
+    cursor.MoveTo(it->user_text);
+    const UserTextTrie::URLCountsMap* urls = cursor.urls();
+
     // Add entries to the database for those matches.
     for (std::vector<GURL>::const_iterator url_it = it->urls.begin();
           url_it != it->urls.end(); ++url_it) {
-      DCHECK(it->user_text.length() >= kMinimumUserTextLength);
       const DBCacheKey key = { it->user_text, *url_it };
       const bool is_hit = (*url_it == opened_url);
 
@@ -357,8 +366,15 @@ void AutocompleteActionPredictor::OnOmniboxOpenedUrl(const OmniboxLog& log) {
       row.user_text = key.user_text;
       row.url = key.url;
 
-      DBCacheMap::iterator it = db_cache_.find(key);
-      if (it == db_cache_.end()) {
+      const UserTextTrie::Counts* counts = NULL;
+      if (urls) {
+        UserTextTrie::URLCountsMap::const_iterator counts_it =
+            urls->find(key.url);
+        if (counts_it != urls->end())
+          counts = &counts_it->second;
+      }
+
+      if (!counts) {
         row.id = base::GenerateGUID();
         row.number_of_hits = is_hit ? 1 : 0;
         row.number_of_misses = is_hit ? 0 : 1;
@@ -367,8 +383,8 @@ void AutocompleteActionPredictor::OnOmniboxOpenedUrl(const OmniboxLog& log) {
       } else {
         DCHECK(db_id_cache_.find(key) != db_id_cache_.end());
         row.id = db_id_cache_.find(key)->second;
-        row.number_of_hits = it->second.number_of_hits + (is_hit ? 1 : 0);
-        row.number_of_misses = it->second.number_of_misses + (is_hit ? 0 : 1);
+        row.number_of_hits = counts->number_of_hits + (is_hit ? 1 : 0);
+        row.number_of_misses = counts->number_of_misses + (is_hit ? 0 : 1);
 
         rows_to_update.push_back(row);
       }
@@ -407,6 +423,9 @@ void AutocompleteActionPredictor::AddAndUpdateRows(
 
     db_cache_[key] = value;
     db_id_cache_[key] = it->id;
+    user_text_trie_.Set(key.user_text, key.url,
+                        UserTextTrie::Counts(value.number_of_hits,
+                                             value.number_of_misses));
     UMA_HISTOGRAM_ENUMERATION("AutocompleteActionPredictor.DatabaseAction",
                               DATABASE_ACTION_ADD, DATABASE_ACTION_COUNT);
   }
@@ -420,6 +439,9 @@ void AutocompleteActionPredictor::AddAndUpdateRows(
 
     db_it->second.number_of_hits = it->number_of_hits;
     db_it->second.number_of_misses = it->number_of_misses;
+    user_text_trie_.Set(key.user_text, key.url,
+                        UserTextTrie::Counts(it->number_of_hits,
+                                             it->number_of_misses));
     UMA_HISTOGRAM_ENUMERATION("AutocompleteActionPredictor.DatabaseAction",
                               DATABASE_ACTION_UPDATE, DATABASE_ACTION_COUNT);
   }
@@ -445,6 +467,9 @@ void AutocompleteActionPredictor::CreateCaches(
     const DBCacheValue value = { it->number_of_hits, it->number_of_misses };
     db_cache_[key] = value;
     db_id_cache_[key] = it->id;
+    user_text_trie_.Set(key.user_text, key.url,
+                        UserTextTrie::Counts(value.number_of_hits,
+                                             value.number_of_misses));
   }
 
   // If the history service is ready, delete any old or invalid entries.
@@ -513,6 +538,7 @@ void AutocompleteActionPredictor::DeleteOldIdsFromCaches(
       DCHECK(id_it != db_id_cache_.end());
       id_list->push_back(id_it->second);
       db_id_cache_.erase(id_it);
+      user_text_trie_.Remove(it->first.user_text, it->first.url);
       db_cache_.erase(it++);
     } else {
       ++it;
@@ -529,6 +555,13 @@ void AutocompleteActionPredictor::CopyFromMainProfile() {
 
   db_cache_ = main_profile_predictor_->db_cache_;
   db_id_cache_ = main_profile_predictor_->db_id_cache_;
+  user_text_trie_.Clear();
+  for (DBCacheMap::const_iterator it = db_cache_.begin();
+       it != db_cache_.end(); ++it) {
+    user_text_trie_.Set(it->first.user_text, it->first.url,
+                        UserTextTrie::Counts(it->second.number_of_hits,
+                                             it->second.number_of_misses));
+  }
   FinishInitialization();
 }
 
@@ -551,28 +584,40 @@ double AutocompleteActionPredictor::CalculateConfidence(
     const string16& user_text,
     const AutocompleteMatch& match,
     bool* is_in_db) const {
-  const DBCacheKey key = { user_text, match.destination_url };
-
   *is_in_db = false;
   if (user_text.length() < kMinimumUserTextLength)
     return 0.0;
 
-  const DBCacheMap::const_iterator iter = db_cache_.find(key);
-  if (iter == db_cache_.end())
+  lookup_cursor_.MoveTo(user_text);
+  const UserTextTrie::URLCountsMap* urls = lookup_cursor_.urls();
+  if (!urls)
+    return 0.0;
+
+  const UserTextTrie::URLCountsMap::const_iterator iter =
+      urls->find(match.destination_url);
+  if (iter == urls->end())
     return 0.0;
 
   *is_in_db = true;
-  return CalculateConfidenceForDbEntry(iter);
+  return CalculateConfidenceForCounts(iter->second.number_of_hits,
+                                      iter->second.number_of_misses);
 }
 
 double AutocompleteActionPredictor::CalculateConfidenceForDbEntry(
     DBCacheMap::const_iterator iter) const {
-  const DBCacheValue& value = iter->second;
-  if (value.number_of_hits < kMinimumNumberOfHits)
+  return CalculateConfidenceForCounts(iter->second.number_of_hits,
+                                      iter->second.number_of_misses);
+}
+
+// static
+double AutocompleteActionPredictor::CalculateConfidenceForCounts(
+    int number_of_hits,
+    int number_of_misses) {
+  if (number_of_hits < kMinimumNumberOfHits)
     return 0.0;
 
-  const double number_of_hits = static_cast<double>(value.number_of_hits);
-  return number_of_hits / (number_of_hits + value.number_of_misses);
+  const double hits = static_cast<double>(number_of_hits);
+  return hits / (hits + number_of_misses);
 }
 
 AutocompleteActionPredictor::TransitionalMatch::TransitionalMatch() {
@@ -14,6 +14,7 @@
 #include "base/strings/string16.h"
 #include "chrome/browser/history/history_types.h"
 #include "chrome/browser/predictors/autocomplete_action_predictor_table.h"
+#include "chrome/browser/predictors/user_text_trie.h"
 #include "components/browser_context_keyed_service/browser_context_keyed_service.h"
 #include "content/public/browser/navigation_controller.h"
 #include "content/public/browser/notification_observer.h"
@@ -208,6 +209,10 @@ class AutocompleteActionPredictor
   // Calculates the confidence for an entry in the DBCacheMap.
   double CalculateConfidenceForDbEntry(DBCacheMap::const_iterator iter) const;
 
+  // Calculates the confidence for the given hit and miss counts.
+  static double CalculateConfidenceForCounts(int number_of_hits,
+                                             int number_of_misses);
+
   Profile* profile_;
 
   // Set when this is a predictor for an incognito profile.
@@ -237,6 +242,12 @@ class AutocompleteActionPredictor
   DBCacheMap db_cache_;
   DBIdCacheMap db_id_cache_;
 
+  // Mirrors |db_cache_| indexed by user text. CalculateConfidence runs for
+  // every match on every keystroke, and |lookup_cursor_| lets it reuse the
+  // walk done for the previous, shorter, user text.
+  UserTextTrie user_text_trie_;
+  mutable UserTextTrie::Cursor lookup_cursor_;
+
   bool initialized_;
 
   DISALLOW_COPY_AND_ASSIGN(AutocompleteActionPredictor);
@@ -641,6 +641,9 @@ void ResourcePrefetchPredictor::PopulatePrefetcherRequest(
 
     ResourcePrefetcher::Request* req = new ResourcePrefetcher::Request(
         it->resource_url);
+    // The score orders resources by type and position on the page; weigh it
+    // by how likely the resource is to be used at all.
+    req->priority = confidence * it->score;
     requests->push_back(req);
   }
 }
@@ -1040,6 +1043,7 @@ void ResourcePrefetchPredictor::ReportAccuracyStats(
   }
 
   int prefetch_cancelled = 0, prefetch_failed = 0, prefetch_not_started = 0;
+  int64 used_bytes = 0, wasted_bytes = 0;
   // 'a_' -> actual, 'p_' -> predicted.
   int p_cache_a_cache = 0, p_cache_a_network = 0, p_cache_a_notused = 0,
       p_network_a_cache = 0, p_network_a_network = 0, p_network_a_notused = 0;
@@ -1059,6 +1063,9 @@ void ResourcePrefetchPredictor::ReportAccuracyStats(
         req->usage_status =
             ResourcePrefetcher::Request::USAGE_STATUS_FROM_NETWORK;
       }
+      used_bytes += req->bytes_read;
+    } else {
+      wasted_bytes += req->bytes_read;
     }
 
     switch (req->prefetch_status) {
@@ -1147,6 +1154,17 @@ void ResourcePrefetchPredictor::ReportAccuracyStats(
       "PrefetchNotStarted",
       prefetch_not_started * 100.0 / (prefetch_not_started + total_prefetched));
 
+  // Absolute hit and waste counts, for tuning the prefetch thresholds.
+  UMA_HISTOGRAM_COUNTS_100("ResourcePrefetchPredictor.PrefetchHitCount",
+                           p_cache_a_cache + p_cache_a_network +
+                           p_network_a_cache + p_network_a_network);
+  UMA_HISTOGRAM_COUNTS_100("ResourcePrefetchPredictor.PrefetchWasteCount",
+                           p_cache_a_notused + p_network_a_notused);
+  UMA_HISTOGRAM_COUNTS("ResourcePrefetchPredictor.PrefetchUsedKB",
+                       static_cast<int>(used_bytes / 1024));
+  UMA_HISTOGRAM_COUNTS("ResourcePrefetchPredictor.PrefetchWastedKB",
+                       static_cast<int>(wasted_bytes / 1024));
+
 #undef RPP_HISTOGRAM_PERCENTAGE
 }
 
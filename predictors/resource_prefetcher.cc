@@ -2,10 +2,12 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <algorithm>
 #include <iterator>
 
 #include "chrome/browser/predictors/resource_prefetcher.h"
 
+#include "base/metrics/histogram.h"
 #include "base/stl_util.h"
 #include "content/public/browser/browser_thread.h"
 #include "net/base/io_buffer.h"
@@ -15,6 +17,19 @@ namespace {
 // The size of the buffer used to read the resource.
 static const size_t kResourceBufferSizeBytes = 50000;
 
+// The amount of data that needs to be read before the throughput is sampled
+// and the number of requests in flight is adapted.
+static const int64 kMinBytesPerThroughputSample = 64 * 1024;
+
+// Relative throughput change that is considered significant when adapting
+// the number of requests in flight.
+static const double kThroughputChangeThreshold = 0.1;
+
+bool HasHigherPriority(const predictors::ResourcePrefetcher::Request* x,
+                       const predictors::ResourcePrefetcher::Request* y) {
+  return x->priority > y->priority;
+}
+
 }  // namespace
 
 namespace predictors {
@@ -22,13 +37,17 @@ namespace predictors {
 ResourcePrefetcher::Request::Request(const GURL& i_resource_url)
     : resource_url(i_resource_url),
       prefetch_status(PREFETCH_STATUS_NOT_STARTED),
-      usage_status(USAGE_STATUS_NOT_REQUESTED) {
+      usage_status(USAGE_STATUS_NOT_REQUESTED),
+      priority(0.0f),
+      bytes_read(0) {
 }
 
 ResourcePrefetcher::Request::Request(const Request& other)
     : resource_url(other.resource_url),
       prefetch_status(other.prefetch_status),
-      usage_status(other.usage_status) {
+      usage_status(other.usage_status),
+      priority(other.priority),
+      bytes_read(other.bytes_read) {
 }
 
 ResourcePrefetcher::ResourcePrefetcher(
@@ -42,12 +61,20 @@ ResourcePrefetcher::ResourcePrefetcher(
           config_(config),
           navigation_id_(navigation_id),
           key_type_(key_type),
-          request_vector_(requests.Pass()) {
+          request_vector_(requests.Pass()),
+          max_inflight_requests_(
+              config_.max_prefetches_inflight_per_navigation),
+          sample_bytes_read_(0),
+          last_sample_throughput_(0.0),
+          last_adjustment_(-1) {
   CHECK(content::BrowserThread::CurrentlyOn(content::BrowserThread::IO));
   DCHECK(request_vector_.get());
 
   std::copy(request_vector_->begin(), request_vector_->end(),
             std::back_inserter(request_queue_));
+  // std::list::sort is stable, so equally useful resources keep the order in
+  // which the predictor listed them.
+  request_queue_.sort(HasHigherPriority);
 }
 
 ResourcePrefetcher::~ResourcePrefetcher() {
@@ -61,6 +88,7 @@ void ResourcePrefetcher::Start() {
 
   CHECK_EQ(state_, INITIALIZED);
   state_ = RUNNING;
+  sample_start_time_ = base::TimeTicks::Now();
 
   TryToLaunchPrefetchRequests();
 }
@@ -72,6 +100,13 @@ void ResourcePrefetcher::Stop() {
     return;
 
   state_ = STOPPED;
+
+  // The navigation is now issuing its own requests. Let the prefetches that
+  // are still in flight complete, but behind those.
+  for (std::map<net::URLRequest*, Request*>::iterator it =
+       inflight_requests_.begin(); it != inflight_requests_.end(); ++it) {
+    it->first->SetPriority(net::IDLE);
+  }
 }
 
 void ResourcePrefetcher::TryToLaunchPrefetchRequests() {
@@ -86,7 +121,7 @@ void ResourcePrefetcher::TryToLaunchPrefetchRequests() {
     // for which the max_prefetches_inflight_per_host_per_navigation limit has
     // not been reached. Try to launch as many requests as possible.
     while ((static_cast<int>(inflight_requests_.size()) <
-                config_.max_prefetches_inflight_per_navigation) &&
+                max_inflight_requests_) &&
            request_available) {
       std::list<Request*>::iterator request_it = request_queue_.begin();
       for (; request_it != request_queue_.end(); ++request_it) {
@@ -180,6 +215,16 @@ void ResourcePrefetcher::ReadFullResponse(net::URLRequest* request) {
 
 bool ResourcePrefetcher::ShouldContinueReadingRequest(net::URLRequest* request,
                                                       int bytes_read) {
+  if (bytes_read > 0) {
+    std::map<net::URLRequest*, Request*>::iterator request_it =
+        inflight_requests_.find(request);
+    DCHECK(request_it != inflight_requests_.end());
+    request_it->second->bytes_read += bytes_read;
+    sample_bytes_read_ += bytes_read;
+    if (sample_bytes_read_ >= kMinBytesPerThroughputSample)
+      UpdateMaxInflightRequests();
+  }
+
   if (bytes_read == 0) {  // When bytes_read == 0, no more data.
     if (request->was_cached())
       FinishRequest(request, Request::PREFETCH_STATUS_FROM_CACHE);
@@ -191,6 +236,38 @@ bool ResourcePrefetcher::ShouldContinueReadingRequest(net::URLRequest* request,
   return true;
 }
 
+void ResourcePrefetcher::UpdateMaxInflightRequests() {
+  const base::TimeDelta elapsed = base::TimeTicks::Now() - sample_start_time_;
+  if (elapsed <= base::TimeDelta())
+    return;
+
+  const double throughput = sample_bytes_read_ / elapsed.InSecondsF();
+
+  // Hill climb: keep moving the limit in the same direction while that
+  // improves throughput and reverse when it made things worse. When it makes
+  // no difference, the extra requests only compete with the navigation, so
+  // move towards fewer. The first sample probes downwards since we start at
+  // the maximum.
+  if (last_sample_throughput_ > 0.0) {
+    const double change =
+        (throughput - last_sample_throughput_) / last_sample_throughput_;
+    if (change < -kThroughputChangeThreshold)
+      last_adjustment_ = -last_adjustment_;
+    else if (change < kThroughputChangeThreshold)
+      last_adjustment_ = -1;
+  }
+
+  max_inflight_requests_ = std::max(1, std::min(
+      max_inflight_requests_ + last_adjustment_,
+      config_.max_prefetches_inflight_per_navigation));
+  last_sample_throughput_ = throughput;
+  sample_bytes_read_ = 0;
+  sample_start_time_ = base::TimeTicks::Now();
+
+  UMA_HISTOGRAM_COUNTS_100("ResourcePrefetchPredictor.MaxInflightPrefetches",
+                           max_inflight_requests_);
+}
+
 void ResourcePrefetcher::OnReceivedRedirect(net::URLRequest* request,
                                             const GURL& new_url,
                                             bool* defer_redirect) {
@@ -13,6 +13,7 @@
 #include "base/memory/scoped_ptr.h"
 #include "base/memory/scoped_vector.h"
 #include "base/threading/non_thread_safe.h"
+#include "base/time/time.h"
 #include "chrome/browser/predictors/resource_prefetch_common.h"
 #include "net/url_request/url_request.h"
 #include "url/gurl.h"
@@ -25,9 +26,13 @@ namespace predictors {
 
 // Responsible for prefetching resources for a single navigation based on the
 // input list of resources.
+//  - Issues the requests in order of decreasing |priority|, i.e. the most
+//    useful resources first.
 //  - Limits the max number of resources in flight for any host and also across
-//    hosts.
-//  - When stopped, will wait for the pending requests to finish.
+//    hosts. The limit across hosts is lowered if adding more requests does not
+//    improve the observed throughput, and raised back when it does.
+//  - When stopped, will wait for the pending requests to finish, but lowers
+//    their priority so they yield to the requests of the real navigation.
 //  - Lives entirely on the IO thread.
 class ResourcePrefetcher : public base::NonThreadSafe,
                            public net::URLRequest::Delegate {
@@ -64,6 +69,13 @@ class ResourcePrefetcher : public base::NonThreadSafe,
     GURL resource_url;
     PrefetchStatus prefetch_status;
     UsageStatus usage_status;
+
+    // How useful the resource is predicted to be, higher is better. Requests
+    // with a higher priority are started first.
+    float priority;
+
+    // Number of response bytes read by the prefetch.
+    int64 bytes_read;
   };
   typedef ScopedVector<Request> RequestVector;
 
@@ -122,6 +134,10 @@ class ResourcePrefetcher : public base::NonThreadSafe,
   // returns false, the request should not be referenced again.
   bool ShouldContinueReadingRequest(net::URLRequest* request, int bytes_read);
 
+  // Adjusts |max_inflight_requests_| based on the throughput observed since
+  // the last adjustment.
+  void UpdateMaxInflightRequests();
+
   // net::URLRequest::Delegate methods.
   virtual void OnReceivedRedirect(net::URLRequest* request,
                                   const GURL& new_url,
@@ -153,9 +169,19 @@ class ResourcePrefetcher : public base::NonThreadSafe,
   scoped_ptr<RequestVector> request_vector_;
 
   std::map<net::URLRequest*, Request*> inflight_requests_;
-  std::list<Request*> request_queue_;
+  std::list<Request*> request_queue_;  // Sorted by decreasing priority.
   std::map<std::string, int> host_inflight_counts_;
 
+  // The current limit of requests in flight across hosts. Between 1 and
+  // |config_.max_prefetches_inflight_per_navigation|.
+  int max_inflight_requests_;
+
+  // Throughput bookkeeping for adapting |max_inflight_requests_|.
+  base::TimeTicks sample_start_time_;
+  int64 sample_bytes_read_;
+  double last_sample_throughput_;  // Bytes per second, 0 if not measured.
+  int last_adjustment_;  // +1 or -1.
+
   DISALLOW_COPY_AND_ASSIGN(ResourcePrefetcher);
 };
 
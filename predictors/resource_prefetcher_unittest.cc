@@ -343,4 +343,77 @@ TEST_F(ResourcePrefetcherTest, TestPrefetcherStopped) {
   delete requests_ptr;
 }
 
+TEST_F(ResourcePrefetcherTest, TestPrefetcherPriority) {
+  scoped_ptr<ResourcePrefetcher::RequestVector> requests(
+      new ResourcePrefetcher::RequestVector);
+  requests->push_back(new ResourcePrefetcher::Request(GURL(
+      "http://www.google.com/resource1.png")));
+  requests->back()->priority = 10.0f;
+  requests->push_back(new ResourcePrefetcher::Request(GURL(
+      "http://www.google.com/resource2.css")));
+  requests->back()->priority = 150.0f;
+  requests->push_back(new ResourcePrefetcher::Request(GURL(
+      "http://yahoo.com/resource1.js")));
+  requests->back()->priority = 90.0f;
+  requests->push_back(new ResourcePrefetcher::Request(GURL(
+      "http://www.google.com/resource3.js")));
+  requests->back()->priority = 120.0f;
+  requests->push_back(new ResourcePrefetcher::Request(GURL(
+      "http://yahoo.com/resource2.png")));
+  requests->back()->priority = 5.0f;
+  requests->push_back(new ResourcePrefetcher::Request(GURL(
+      "http://m.google.com/resource1.png")));
+  requests->back()->priority = 60.0f;
+
+  NavigationID navigation_id;
+  navigation_id.render_process_id = 1;
+  navigation_id.render_view_id = 2;
+  navigation_id.main_frame_url = GURL("http://www.google.com");
+
+  // Needed later for comparison.
+  ResourcePrefetcher::RequestVector* requests_ptr = requests.get();
+
+  prefetcher_.reset(new TestResourcePrefetcher(&prefetcher_delegate_,
+                                               config_,
+                                               navigation_id,
+                                               PREFETCH_KEY_TYPE_URL,
+                                               requests.Pass()));
+
+  // The most useful requests go first, subject to the per host limit.
+  AddStartUrlRequestExpectation("http://www.google.com/resource2.css");
+  AddStartUrlRequestExpectation("http://www.google.com/resource3.js");
+  AddStartUrlRequestExpectation("http://yahoo.com/resource1.js");
+  AddStartUrlRequestExpectation("http://m.google.com/resource1.png");
+  AddStartUrlRequestExpectation("http://yahoo.com/resource2.png");
+
+  prefetcher_->Start();
+  CheckPrefetcherState(5, 1, 3);
+
+  AddStartUrlRequestExpectation("http://www.google.com/resource1.png");
+  OnResponse("http://www.google.com/resource3.js");
+  CheckPrefetcherState(5, 0, 3);
+
+  // Stopping lets the inflight requests finish at a lower priority.
+  prefetcher_->Stop();
+  for (std::map<net::URLRequest*, Request*>::const_iterator it =
+       prefetcher_->inflight_requests_.begin();
+       it != prefetcher_->inflight_requests_.end(); ++it) {
+    EXPECT_EQ(net::IDLE, it->first->priority());
+  }
+
+  OnResponse("http://www.google.com/resource2.css");
+  OnResponse("http://yahoo.com/resource1.js");
+  OnResponse("http://m.google.com/resource1.png");
+  OnResponse("http://yahoo.com/resource2.png");
+  CheckPrefetcherState(1, 0, 1);
+
+  EXPECT_CALL(prefetcher_delegate_,
+              ResourcePrefetcherFinished(Eq(prefetcher_.get()),
+                                         Eq(requests_ptr)));
+  OnResponse("http://www.google.com/resource1.png");
+  CheckPrefetcherState(0, 0, 0);
+
+  delete requests_ptr;
+}
+
 }  // namespace predictors
@@ -0,0 +1,195 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/predictors/user_text_trie.h"
+
+#include <vector>
+
+#include "base/logging.h"
+#include "base/stl_util.h"
+
+namespace predictors {
+
+class UserTextTrie::Node {
+ public:
+  typedef std::map<char16, Node*> Children;
+
+  Node() : subtree_entries(0) {}
+  ~Node() { STLDeleteValues(&children); }
+
+  const Node* GetChild(char16 c) const {
+    Children::const_iterator it = children.find(c);
+    return it == children.end() ? NULL : it->second;
+  }
+
+  Children children;
+
+  // Entries whose user text ends at this node.
+  URLCountsMap urls;
+
+  // Number of entries in |urls| of this node and of all its descendants.
+  size_t subtree_entries;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(Node);
+};
+
+UserTextTrie::Cursor::Cursor(const UserTextTrie* trie)
+    : trie_(trie),
+      node_(NULL),
+      depth_(0),
+      generation_(-1) {
+  DCHECK(trie_);
+}
+
+UserTextTrie::Cursor::~Cursor() {
+}
+
+void UserTextTrie::Cursor::MoveTo(const string16& text) {
+  const bool extends_previous = node_ && generation_ == trie_->generation_ &&
+      text.compare(0, text_.length(), text_) == 0;
+  if (extends_previous && depth_ < text_.length()) {
+    // The previous text already fell off the trie, and so does this one.
+    text_ = text;
+    return;
+  }
+
+  const Node* from = trie_->root_.get();
+  size_t offset = 0;
+  if (extends_previous) {
+    from = node_;
+    offset = depth_;
+  }
+  text_ = text;
+  generation_ = trie_->generation_;
+  const Node* node = trie_->FindNode(from, text_, offset, &depth_);
+  // On a miss |depth_| is left short of the text length, which is how the
+  // next keystroke knows that it cannot match either.
+  node_ = node ? node : from;
+}
+
+const UserTextTrie::URLCountsMap* UserTextTrie::Cursor::urls() const {
+  if (!node_ || generation_ != trie_->generation_ || depth_ != text_.length())
+    return NULL;
+  return node_->urls.empty() ? NULL : &node_->urls;
+}
+
+UserTextTrie::UserTextTrie()
+    : root_(new Node),
+      size_(0),
+      generation_(0) {
+}
+
+UserTextTrie::~UserTextTrie() {
+}
+
+void UserTextTrie::Set(const string16& user_text,
+                       const GURL& url,
+                       const Counts& counts) {
+  ++generation_;
+
+  std::vector<Node*> path;
+  path.reserve(user_text.length() + 1);
+  Node* node = root_.get();
+  path.push_back(node);
+  for (size_t i = 0; i < user_text.length(); ++i) {
+    Node*& child = node->children[user_text[i]];
+    if (!child)
+      child = new Node;
+    node = child;
+    path.push_back(node);
+  }
+
+  URLCountsMap::iterator it = node->urls.find(url);
+  if (it != node->urls.end()) {
+    it->second = counts;
+    return;
+  }
+
+  node->urls[url] = counts;
+  ++size_;
+  for (std::vector<Node*>::iterator path_it = path.begin();
+       path_it != path.end(); ++path_it) {
+    ++(*path_it)->subtree_entries;
+  }
+}
+
+void UserTextTrie::Remove(const string16& user_text, const GURL& url) {
+  std::vector<Node*> path;
+  path.reserve(user_text.length() + 1);
+  Node* node = root_.get();
+  path.push_back(node);
+  for (size_t i = 0; i < user_text.length(); ++i) {
+    Node::Children::iterator child = node->children.find(user_text[i]);
+    if (child == node->children.end())
+      return;
+    node = child->second;
+    path.push_back(node);
+  }
+
+  URLCountsMap::iterator it = node->urls.find(url);
+  if (it == node->urls.end())
+    return;
+
+  ++generation_;
+  node->urls.erase(it);
+  --size_;
+
+  for (std::vector<Node*>::iterator path_it = path.begin();
+       path_it != path.end(); ++path_it) {
+    --(*path_it)->subtree_entries;
+  }
+
+  // Prune the branches left empty, deepest first. The root is never removed.
+  for (size_t i = user_text.length(); i > 0; --i) {
+    if (path[i]->subtree_entries > 0)
+      break;
+    Node* parent = path[i - 1];
+    Node::Children::iterator child = parent->children.find(user_text[i - 1]);
+    DCHECK(child != parent->children.end());
+    delete child->second;
+    parent->children.erase(child);
+  }
+}
+
+void UserTextTrie::Clear() {
+  ++generation_;
+  root_.reset(new Node);
+  size_ = 0;
+}
+
+bool UserTextTrie::Get(const string16& user_text,
+                       const GURL& url,
+                       Counts* counts) const {
+  size_t depth = 0;
+  const Node* node = FindNode(root_.get(), user_text, 0, &depth);
+  if (!node)
+    return false;
+  URLCountsMap::const_iterator it = node->urls.find(url);
+  if (it == node->urls.end())
+    return false;
+  if (counts)
+    *counts = it->second;
+  return true;
+}
+
+const UserTextTrie::Node* UserTextTrie::FindNode(const Node* from,
+                                                 const string16& text,
+                                                 size_t offset,
+                                                 size_t* depth) const {
+  DCHECK(from);
+  DCHECK_LE(offset, text.length());
+  const Node* node = from;
+  size_t i = offset;
+  for (; i < text.length(); ++i) {
+    const Node* child = node->GetChild(text[i]);
+    if (!child)
+      break;
+    node = child;
+  }
+  *depth = i;
+  return i == text.length() ? node : NULL;
+}
+
+}  // namespace predictors
@@ -0,0 +1,102 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_PREDICTORS_USER_TEXT_TRIE_H_
+#define CHROME_BROWSER_PREDICTORS_USER_TEXT_TRIE_H_
+
+#include <map>
+
+#include "base/basictypes.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/strings/string16.h"
+#include "url/gurl.h"
+
+namespace predictors {
+
+// A trie over the user text recorded by the AutocompleteActionPredictor. Each
+// node holds the hit/miss counts for the URLs that were navigated to after
+// typing exactly the text leading to that node.
+//
+// Lookups are made through a Cursor, which remembers where the previous lookup
+// ended so that the typical omnibox pattern of appending a character per
+// keystroke only walks the newly typed characters.
+class UserTextTrie {
+ public:
+  struct Counts {
+    Counts() : number_of_hits(0), number_of_misses(0) {}
+    Counts(int hits, int misses)
+        : number_of_hits(hits), number_of_misses(misses) {}
+
+    int number_of_hits;
+    int number_of_misses;
+  };
+
+  typedef std::map<GURL, Counts> URLCountsMap;
+
+  class Node;
+
+  // A position in the trie. A cursor stays usable across mutations of the
+  // trie; it notices them and restarts its next walk from the root.
+  class Cursor {
+   public:
+    explicit Cursor(const UserTextTrie* trie);
+    ~Cursor();
+
+    // Moves the cursor to |text|. When |text| extends the text of the
+    // previous call only the additional characters are walked.
+    void MoveTo(const string16& text);
+
+    // Returns the counts recorded for exactly the current text, or NULL if
+    // there are none.
+    const URLCountsMap* urls() const;
+
+   private:
+    const UserTextTrie* trie_;
+    const Node* node_;
+    string16 text_;
+    // Number of characters of |text_| that |node_| corresponds to. Less than
+    // |text_.length()| when the walk fell off the trie.
+    size_t depth_;
+    int generation_;
+
+    DISALLOW_COPY_AND_ASSIGN(Cursor);
+  };
+
+  UserTextTrie();
+  ~UserTextTrie();
+
+  // Sets the counts for (|user_text|, |url|), replacing any existing entry.
+  void Set(const string16& user_text, const GURL& url, const Counts& counts);
+
+  // Removes the entry for (|user_text|, |url|) if present.
+  void Remove(const string16& user_text, const GURL& url);
+
+  // Removes all entries.
+  void Clear();
+
+  // Looks up a single entry. Returns false if it is not present.
+  bool Get(const string16& user_text, const GURL& url, Counts* counts) const;
+
+  size_t size() const { return size_; }
+
+ private:
+  // Returns the node for |text|, or NULL. The search starts at |from|, which
+  // must correspond to the first |offset| characters of |text|.
+  const Node* FindNode(const Node* from,
+                       const string16& text,
+                       size_t offset,
+                       size_t* depth) const;
+
+  scoped_ptr<Node> root_;
+  size_t size_;
+
+  // Incremented on every mutation so that cursors can detect stale nodes.
+  int generation_;
+
+  DISALLOW_COPY_AND_ASSIGN(UserTextTrie);
+};
+
+}  // namespace predictors
+
+#endif  // CHROME_BROWSER_PREDICTORS_USER_TEXT_TRIE_H_
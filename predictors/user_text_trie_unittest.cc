@@ -0,0 +1,110 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/predictors/user_text_trie.h"
+
+#include "base/strings/utf_string_conversions.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace predictors {
+
+namespace {
+
+const char kUrlA[] = "http://www.testsite.com/a.html";
+const char kUrlB[] = "http://www.testsite.com/b.html";
+
+}  // namespace
+
+TEST(UserTextTrieTest, SetGetRemove) {
+  UserTextTrie trie;
+  trie.Set(ASCIIToUTF16("ju"), GURL(kUrlA), UserTextTrie::Counts(3, 1));
+  trie.Set(ASCIIToUTF16("just"), GURL(kUrlA), UserTextTrie::Counts(2, 0));
+  trie.Set(ASCIIToUTF16("just"), GURL(kUrlB), UserTextTrie::Counts(1, 4));
+  EXPECT_EQ(3u, trie.size());
+
+  UserTextTrie::Counts counts;
+  ASSERT_TRUE(trie.Get(ASCIIToUTF16("just"), GURL(kUrlB), &counts));
+  EXPECT_EQ(1, counts.number_of_hits);
+  EXPECT_EQ(4, counts.number_of_misses);
+  EXPECT_FALSE(trie.Get(ASCIIToUTF16("jus"), GURL(kUrlB), &counts));
+  EXPECT_FALSE(trie.Get(ASCIIToUTF16("ju"), GURL(kUrlB), &counts));
+
+  // Overwriting an entry does not change the size.
+  trie.Set(ASCIIToUTF16("ju"), GURL(kUrlA), UserTextTrie::Counts(5, 1));
+  EXPECT_EQ(3u, trie.size());
+  ASSERT_TRUE(trie.Get(ASCIIToUTF16("ju"), GURL(kUrlA), &counts));
+  EXPECT_EQ(5, counts.number_of_hits);
+
+  trie.Remove(ASCIIToUTF16("just"), GURL(kUrlA));
+  trie.Remove(ASCIIToUTF16("missing"), GURL(kUrlA));
+  EXPECT_EQ(2u, trie.size());
+  EXPECT_FALSE(trie.Get(ASCIIToUTF16("just"), GURL(kUrlA), NULL));
+  EXPECT_TRUE(trie.Get(ASCIIToUTF16("just"), GURL(kUrlB), NULL));
+
+  trie.Clear();
+  EXPECT_EQ(0u, trie.size());
+  EXPECT_FALSE(trie.Get(ASCIIToUTF16("ju"), GURL(kUrlA), NULL));
+}
+
+TEST(UserTextTrieTest, RemovePrunes) {
+  UserTextTrie trie;
+  trie.Set(ASCIIToUTF16("ju"), GURL(kUrlA), UserTextTrie::Counts(3, 1));
+  trie.Set(ASCIIToUTF16("just"), GURL(kUrlA), UserTextTrie::Counts(2, 0));
+  trie.Set(ASCIIToUTF16("just"), GURL(kUrlB), UserTextTrie::Counts(1, 4));
+
+  UserTextTrie::Cursor cursor(&trie);
+  cursor.MoveTo(ASCIIToUTF16("just"));
+  ASSERT_TRUE(cursor.urls());
+  EXPECT_EQ(2u, cursor.urls()->size());
+
+  trie.Remove(ASCIIToUTF16("just"), GURL(kUrlA));
+  cursor.MoveTo(ASCIIToUTF16("just"));
+  ASSERT_TRUE(cursor.urls());
+  EXPECT_EQ(1u, cursor.urls()->size());
+
+  // Removing the last entry below a prefix prunes it, but keeps the entries
+  // of shorter prefixes.
+  trie.Remove(ASCIIToUTF16("just"), GURL(kUrlB));
+  cursor.MoveTo(ASCIIToUTF16("just"));
+  EXPECT_EQ(NULL, cursor.urls());
+  cursor.MoveTo(ASCIIToUTF16("ju"));
+  ASSERT_TRUE(cursor.urls());
+  EXPECT_EQ(1u, cursor.urls()->count(GURL(kUrlA)));
+  EXPECT_EQ(1u, trie.size());
+}
+
+TEST(UserTextTrieTest, CursorFollowsTyping) {
+  UserTextTrie trie;
+  trie.Set(ASCIIToUTF16("ju"), GURL(kUrlA), UserTextTrie::Counts(3, 1));
+  trie.Set(ASCIIToUTF16("just"), GURL(kUrlB), UserTextTrie::Counts(1, 4));
+
+  UserTextTrie::Cursor cursor(&trie);
+  cursor.MoveTo(ASCIIToUTF16("j"));
+  EXPECT_EQ(NULL, cursor.urls());
+  cursor.MoveTo(ASCIIToUTF16("ju"));
+  ASSERT_TRUE(cursor.urls());
+  EXPECT_EQ(1u, cursor.urls()->count(GURL(kUrlA)));
+  cursor.MoveTo(ASCIIToUTF16("just"));
+  ASSERT_TRUE(cursor.urls());
+  EXPECT_EQ(1u, cursor.urls()->count(GURL(kUrlB)));
+
+  // Falling off the trie, then typing more, keeps missing.
+  cursor.MoveTo(ASCIIToUTF16("justx"));
+  EXPECT_EQ(NULL, cursor.urls());
+  cursor.MoveTo(ASCIIToUTF16("justxy"));
+  EXPECT_EQ(NULL, cursor.urls());
+
+  // Backspacing restarts from the root.
+  cursor.MoveTo(ASCIIToUTF16("ju"));
+  ASSERT_TRUE(cursor.urls());
+  EXPECT_EQ(1u, cursor.urls()->count(GURL(kUrlA)));
+
+  // A mutation is picked up by the next move, even when extending.
+  trie.Set(ASCIIToUTF16("justx"), GURL(kUrlA), UserTextTrie::Counts(1, 0));
+  cursor.MoveTo(ASCIIToUTF16("justx"));
+  ASSERT_TRUE(cursor.urls());
+  EXPECT_EQ(1u, cursor.urls()->count(GURL(kUrlA)));
+}
+
+}  // namespace predictors
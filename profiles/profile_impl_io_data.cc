@@ -25,6 +25,7 @@
 #include "chrome/browser/net/connect_interceptor.h"
 #include "chrome/browser/net/http_server_properties_manager.h"
 #include "chrome/browser/net/predictor.h"
+#include "chrome/browser/net/sqlite_http_server_properties_store.h"
 #include "chrome/browser/net/sqlite_server_bound_cert_store.h"
 #include "chrome/browser/profiles/profile.h"
 #include "chrome/common/chrome_constants.h"
@@ -51,6 +52,16 @@
 
 namespace {
 
+// Name of the database holding the HTTP server properties (SPDY support,
+// Alternate-Protocol, ...) in the profile directory.
+const base::FilePath::CharType kHttpServerPropertiesFilename[] =
+    FILE_PATH_LITERAL("Network Properties");
+
+// Name of the file in which the network predictor keeps what it learned, in
+// the profile directory.
+const base::FilePath::CharType kNetworkPredictorFilename[] =
+    FILE_PATH_LITERAL("Network Predictor");
+
 net::BackendType ChooseCacheBackendType() {
   const CommandLine& command_line = *CommandLine::ForCurrentProcess();
   if (command_line.HasSwitch(switches::kUseSimpleCacheBackend)) {
@@ -141,6 +152,16 @@ void ProfileImplIOData::Handle::Init(
   io_data_->app_cache_max_size_ = cache_max_size;
   io_data_->app_media_cache_max_size_ = media_cache_max_size;
 
+  bool persist_predictor = true;
+#if defined(OS_CHROMEOS)
+  persist_predictor = !profile_->IsLoginProfile();
+#endif
+  if (persist_predictor) {
+    predictor->SetStore(new chrome_browser_net::PredictorStore(
+        profile_path.Append(kNetworkPredictorFilename),
+        BrowserThread::GetBlockingPool()->GetSequencedTaskRunner(
+            BrowserThread::GetBlockingPool()->GetSequenceToken())));
+  }
   io_data_->predictor_.reset(predictor);
 
   io_data_->InitializeMetricsEnabledStateOnUIThread();
@@ -294,8 +315,15 @@ void ProfileImplIOData::Handle::LazyInitialize() const {
   // below try to get the ResourceContext pointer.
   initialized_ = true;
   PrefService* pref_service = profile_->GetPrefs();
+  scoped_refptr<chrome_browser_net::SQLiteHttpServerPropertiesStore>
+      http_server_properties_store(
+          new chrome_browser_net::SQLiteHttpServerPropertiesStore(
+              io_data_->profile_path_.Append(kHttpServerPropertiesFilename),
+              BrowserThread::GetBlockingPool()->GetSequencedTaskRunner(
+                  BrowserThread::GetBlockingPool()->GetSequenceToken())));
   io_data_->http_server_properties_manager_ =
-      new chrome_browser_net::HttpServerPropertiesManager(pref_service);
+      new chrome_browser_net::HttpServerPropertiesManager(
+          pref_service, http_server_properties_store);
   io_data_->set_http_server_properties(
       scoped_ptr<net::HttpServerProperties>(
           io_data_->http_server_properties_manager_));
@@ -12,6 +12,7 @@
 #include "base/format_macros.h"
 #include "base/location.h"
 #include "base/message_loop/message_loop.h"
+#include "base/metrics/histogram.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/strings/stringprintf.h"
 #include "base/strings/utf_string_conversions.h"
@@ -81,8 +82,9 @@ class BookmarkComparer {
 // matching child node for many sync nodes.
 class BookmarkNodeFinder {
  public:
-  // Creates an instance with the given parent bookmark node.
-  explicit BookmarkNodeFinder(const BookmarkNode* parent_node);
+  // Creates an instance with the children of the given parent bookmark node,
+  // from |first_index| on.
+  BookmarkNodeFinder(const BookmarkNode* parent_node, int first_index);
 
   // Finds the bookmark node that matches the given url, title and folder
   // attribute. Returns the matching node if one exists; NULL otherwise. If a
@@ -117,9 +119,10 @@ class ScopedAssociationUpdater {
   DISALLOW_COPY_AND_ASSIGN(ScopedAssociationUpdater);
 };
 
-BookmarkNodeFinder::BookmarkNodeFinder(const BookmarkNode* parent_node)
+BookmarkNodeFinder::BookmarkNodeFinder(const BookmarkNode* parent_node,
+                                       int first_index)
     : parent_node_(parent_node) {
-  for (int i = 0; i < parent_node_->child_count(); ++i) {
+  for (int i = first_index; i < parent_node_->child_count(); ++i) {
     child_nodes_.insert(parent_node_->GetChild(i));
   }
 }
@@ -458,6 +461,10 @@ syncer::SyncError BookmarkModelAssociator::BuildAssociations(
   local_merge_result->set_num_items_deleted(
       ApplyDeletesFromSyncJournal(&trans));
 
+  int num_sync_nodes = 0;
+  int num_folders = 0;
+  int num_unordered_folders = 0;
+
   while (!dfs_stack.empty()) {
     int64 sync_parent_id = dfs_stack.top();
     dfs_stack.pop();
@@ -475,8 +482,15 @@ syncer::SyncError BookmarkModelAssociator::BuildAssociations(
 
     const BookmarkNode* parent_node = GetChromeNodeFromSyncId(sync_parent_id);
     DCHECK(parent_node->is_folder());
+    ++num_folders;
 
-    BookmarkNodeFinder node_finder(parent_node);
+    // The children of the bookmark parent node before |index| are the ones
+    // already matched, in order, so the child at |index| is the first that is
+    // left. The children are usually in the same order in both models, so
+    // that child is tried first, and the finder, which indexes all the
+    // children left, is only built for the folders where it does not match.
+    // Once built, the finder is used for the rest of the folder.
+    scoped_ptr<BookmarkNodeFinder> node_finder;
 
     std::vector<int64> children;
     sync_parent.GetChildIds(&children);
@@ -493,11 +507,24 @@ syncer::SyncError BookmarkModelAssociator::BuildAssociations(
             model_type());
       }
 
+      ++num_sync_nodes;
       const BookmarkNode* child_node = NULL;
-      child_node = node_finder.FindBookmarkNode(
-          GURL(sync_child_node.GetBookmarkSpecifics().url()),
-          sync_child_node.GetTitle(),
-          sync_child_node.GetIsFolder());
+      const GURL sync_child_url(sync_child_node.GetBookmarkSpecifics().url());
+      if (!node_finder.get() && index < parent_node->child_count() &&
+          NodeMatchesSyncData(parent_node->GetChild(index), sync_child_url,
+                              sync_child_node.GetTitle(),
+                              sync_child_node.GetIsFolder())) {
+        child_node = parent_node->GetChild(index);
+      } else {
+        if (!node_finder.get()) {
+          node_finder.reset(new BookmarkNodeFinder(parent_node, index));
+          ++num_unordered_folders;
+        }
+        child_node = node_finder->FindBookmarkNode(
+            sync_child_url,
+            sync_child_node.GetTitle(),
+            sync_child_node.GetIsFolder());
+      }
       if (child_node) {
         Associate(child_node, sync_child_id);
 
@@ -506,7 +533,8 @@ syncer::SyncError BookmarkModelAssociator::BuildAssociations(
         // TODO(sync): Only modify the bookmark model if necessary.
         BookmarkChangeProcessor::UpdateBookmarkWithSyncData(
             sync_child_node, bookmark_model_, child_node, profile_);
-        bookmark_model_->Move(child_node, parent_node, index);
+        if (parent_node->GetChild(index) != child_node)
+          bookmark_model_->Move(child_node, parent_node, index);
         local_merge_result->set_num_items_modified(
             local_merge_result->num_items_modified() + 1);
       } else {
@@ -549,9 +577,27 @@ syncer::SyncError BookmarkModelAssociator::BuildAssociations(
   syncer_merge_result->set_num_items_after_association(
       bm_root.GetTotalNodeCount());
 
+  // The association time depends on how many nodes there are to match, and
+  // on how many folders had to be matched out of order.
+  UMA_HISTOGRAM_COUNTS("Sync.BookmarkAssociationSyncNodes", num_sync_nodes);
+  if (num_folders > 0) {
+    UMA_HISTOGRAM_PERCENTAGE("Sync.BookmarkAssociationUnorderedFolders",
+                             100 * num_unordered_folders / num_folders);
+  }
+
   return syncer::SyncError();
 }
 
+// static
+bool BookmarkModelAssociator::NodeMatchesSyncData(const BookmarkNode* node,
+                                                  const GURL& url,
+                                                  const std::string& title,
+                                                  bool is_folder) {
+  // Matches the nodes that BookmarkComparer finds equal to the sync data.
+  return node->is_folder() == is_folder && node->url() == url &&
+      node->GetTitle() == UTF8ToUTF16(title);
+}
+
 struct FolderInfo {
   FolderInfo(const BookmarkNode* f, const BookmarkNode* p, int64 id)
       : folder(f), parent(p), sync_id(id) {}
@@ -587,7 +633,7 @@ int64 BookmarkModelAssociator::ApplyDeletesFromSyncJournal(
     const BookmarkNode* parent = dfs_stack.top();
     dfs_stack.pop();
 
-    BookmarkNodeFinder finder(parent);
+    BookmarkNodeFinder finder(parent, 0);
     // Iterate through journals from back to front. Remove matched journal by
     // moving an unmatched journal at the tail to its position so that we can
     // read unmatched journals off the head in next loop.
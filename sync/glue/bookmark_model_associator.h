@@ -19,6 +19,7 @@
 
 class BookmarkModel;
 class BookmarkNode;
+class GURL;
 class Profile;
 
 namespace syncer {
@@ -135,6 +136,13 @@ class BookmarkModelAssociator
       const BookmarkNode* permanent_node,
       const std::string& tag) WARN_UNUSED_RESULT;
 
+  // Returns true if |node| has the given url, title and folder attribute, as
+  // the BookmarkNodeFinder matches them.
+  static bool NodeMatchesSyncData(const BookmarkNode* node,
+                                  const GURL& url,
+                                  const std::string& title,
+                                  bool is_folder);
+
   // Compare the properties of a pair of nodes from either domain.
   bool NodesMatch(const BookmarkNode* bookmark,
                   const syncer::BaseNode* sync_node) const;
@@ -87,7 +87,13 @@ bool TypedUrlModelAssociator::FixupURLAndGetVisits(
     ++num_db_errors_;
     return false;
   }
+  FixupURLAndVisits(url, visits);
+  return true;
+}
 
+void TypedUrlModelAssociator::FixupURLAndVisits(
+    history::URLRow* url,
+    history::VisitVector* visits) {
   // Sometimes (due to a bug elsewhere in the history or sync code, or due to
   // a crash between adding a URL to the history database and updating the
   // visit DB) the visit vector for a URL can be empty. If this happens, just
@@ -109,7 +115,6 @@ bool TypedUrlModelAssociator::FixupURLAndGetVisits(
   // crashes/bugs can cause them to mismatch), so just set it here.
   url->set_last_visit(visits->back().visit_time);
   DCHECK(CheckVisitOrdering(*visits));
-  return true;
 }
 
 bool TypedUrlModelAssociator::ShouldIgnoreUrl(const GURL& url) {
@@ -201,12 +206,33 @@ syncer::SyncError TypedUrlModelAssociator::DoAssociateModels() {
           model_type());
     }
 
-    // Get all the visits.
+    // Get all the visits, with as few queries as possible. Should that fail,
+    // get the visits of each URL on its own, so that only the URLs whose
+    // visits can't be read are left out.
+    std::set<history::URLID> url_ids;
+    for (history::URLRows::const_iterator ix = typed_urls.begin();
+         ix != typed_urls.end(); ++ix)
+      url_ids.insert(ix->id());
+    DCHECK_EQ(typed_urls.size(), url_ids.size());
     std::map<history::URLID, history::VisitVector> visit_vectors;
+    ++num_db_accesses_;
+    bool visits_loaded = history_backend_->GetMostRecentVisitsForURLs(
+        url_ids, kMaxVisitsToFetch, &visit_vectors);
+    if (!visits_loaded) {
+      ++num_db_errors_;
+      visit_vectors.clear();
+    }
     for (history::URLRows::iterator ix = typed_urls.begin();
          ix != typed_urls.end();) {
-      DCHECK_EQ(0U, visit_vectors.count(ix->id()));
-      if (!FixupURLAndGetVisits(&(*ix), &(visit_vectors[ix->id()])) ||
+      bool url_visits_loaded = true;
+      if (visits_loaded) {
+        FixupURLAndVisits(&(*ix), &(visit_vectors[ix->id()]));
+      } else {
+        DCHECK_EQ(0U, visit_vectors.count(ix->id()));
+        url_visits_loaded =
+            FixupURLAndGetVisits(&(*ix), &(visit_vectors[ix->id()]));
+      }
+      if (!url_visits_loaded ||
           ShouldIgnoreUrl(ix->url()) ||
           ShouldIgnoreVisits(visit_vectors[ix->id()])) {
         // Ignore this URL if we couldn't load the visits or if there's some
@@ -159,6 +159,11 @@ class TypedUrlModelAssociator : public AssociatorInterface {
   bool FixupURLAndGetVisits(history::URLRow* url,
                             history::VisitVector* visits);
 
+  // Compensates as FixupURLAndGetVisits() does for the visits of |url| that
+  // have already been fetched, as GetMostRecentVisitsForURL() returns them.
+  static void FixupURLAndVisits(history::URLRow* url,
+                                history::VisitVector* visits);
+
   // Updates the passed |url_row| based on the values in |specifics|. Fields
   // that are not contained in |specifics| (such as typed_count) are left
   // unchanged.
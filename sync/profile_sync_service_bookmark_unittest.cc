@@ -1109,6 +1109,41 @@ TEST_F(ProfileSyncServiceBookmarkTest, MergeDuplicates) {
   ExpectModelMatch();
 }
 
+// Model association matches the children of a folder in order while they
+// are in the same order in both models, and looks for the rest of them when
+// they are not. Check that the children end up in the order of the server
+// either way, duplicates included.
+TEST_F(ProfileSyncServiceBookmarkTest, MergeReorderedChildren) {
+  LoadBookmarkModel(DELETE_EXISTING_STORAGE, SAVE_TO_STORAGE);
+  StartSync();
+
+  const BookmarkNode* folder = model_->AddFolder(model_->other_node(), 0,
+                                                 ASCIIToUTF16("folder"));
+  for (int i = 0; i < 20; ++i) {
+    if (i % 7 == 3) {
+      model_->AddURL(folder, i, ASCIIToUTF16("Dup"), GURL("http://dup.com/"));
+    } else {
+      model_->AddURL(folder, i, ASCIIToUTF16("Title " + base::IntToString(i)),
+                     GURL("http://" + base::IntToString(i) + ".com/"));
+    }
+  }
+  ExpectModelMatch();
+
+  // Reorder the children and add one while sync is stopped.
+  StopSync();
+  model_->Move(folder->GetChild(15), folder, 5);
+  model_->Move(folder->GetChild(10), folder, 0);
+  model_->AddURL(folder, 8, ASCIIToUTF16("Extra"), GURL("http://extra.com/"));
+
+  StartSync();
+  ASSERT_EQ(21, folder->child_count());
+  EXPECT_EQ(ASCIIToUTF16("Title 0"), folder->GetChild(0)->GetTitle());
+  EXPECT_EQ(ASCIIToUTF16("Dup"), folder->GetChild(10)->GetTitle());
+  EXPECT_EQ(ASCIIToUTF16("Title 15"), folder->GetChild(15)->GetTitle());
+  EXPECT_EQ(ASCIIToUTF16("Extra"), folder->GetChild(20)->GetTitle());
+  ExpectModelMatch();
+}
+
 TEST_F(ProfileSyncServiceBookmarkTest, ApplySyncDeletesFromJournal) {
   // Initialize sync model and bookmark model as:
   // URL 0
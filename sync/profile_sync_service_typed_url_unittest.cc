@@ -2,6 +2,8 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <map>
+#include <set>
 #include <vector>
 
 #include "testing/gtest/include/gtest/gtest.h"
@@ -78,6 +80,22 @@ class HistoryBackendMock : public HistoryBackend {
   MOCK_METHOD3(GetMostRecentVisitsForURL, bool(history::URLID id,
                                                int max_visits,
                                                history::VisitVector* visits));
+  // Reads the visits of each URL with GetMostRecentVisitsForURL(), so that
+  // the tests set up the visits of each URL the same way for both.
+  virtual bool GetMostRecentVisitsForURLs(
+      const std::set<history::URLID>& ids,
+      int max_visits_per_url,
+      std::map<history::URLID, history::VisitVector>* visits) OVERRIDE {
+    for (std::set<history::URLID>::const_iterator id = ids.begin();
+         id != ids.end(); ++id) {
+      history::VisitVector url_visits;
+      if (!GetMostRecentVisitsForURL(*id, max_visits_per_url, &url_visits))
+        return false;
+      if (!url_visits.empty())
+        (*visits)[*id] = url_visits;
+    }
+    return true;
+  }
   MOCK_METHOD2(UpdateURL, bool(history::URLID id, const history::URLRow& url));
   MOCK_METHOD3(AddVisits, bool(const GURL& url,
                                const std::vector<history::VisitInfo>& visits,
@@ -0,0 +1,184 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/task_manager/process_sampler.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/location.h"
+#include "base/process/process_metrics.h"
+#include "base/sequenced_task_runner.h"
+#include "base/task_runner_util.h"
+
+#if defined(OS_MACOSX)
+#include "content/public/browser/browser_child_process_host.h"
+#endif
+
+namespace task_manager {
+
+namespace {
+
+// The most passes the memory of a process goes without being sampled.
+const int kMaxMemoryIntervalPasses = 8;
+
+// The time one pass may spend reading memory usage.
+const int kMemoryBudgetMs = 25;
+
+// Private memory that moved by less than this fraction is considered stable.
+const size_t kStableMemoryDivisor = 64;
+
+bool IsMemoryStable(const ProcessSample& before, const ProcessSample& after) {
+  if (!before.is_memory_valid)
+    return false;
+  size_t delta = before.private_bytes > after.private_bytes ?
+      before.private_bytes - after.private_bytes :
+      after.private_bytes - before.private_bytes;
+  return delta <= before.private_bytes / kStableMemoryDivisor;
+}
+
+}  // namespace
+
+ProcessSample::ProcessSample()
+    : cpu_usage(0),
+      is_memory_valid(false),
+      private_bytes(0),
+      shared_bytes(0),
+      physical_memory(0) {
+}
+
+ProcessSampler::ProcessState::ProcessState()
+    : handle(base::kNullProcessHandle),
+      memory_interval(1),
+      passes_until_memory(0) {
+}
+
+ProcessSampler::ProcessState::~ProcessState() {
+  // The metrics refer to the handle.
+  metrics.reset();
+  if (handle != base::kNullProcessHandle)
+    base::CloseProcessHandle(handle);
+}
+
+ProcessSampler::ProcessSampler(
+    const scoped_refptr<base::SequencedTaskRunner>& task_runner)
+    : task_runner_(task_runner),
+      memory_budget_(base::TimeDelta::FromMilliseconds(kMemoryBudgetMs)) {
+}
+
+void ProcessSampler::AddProcess(base::ProcessHandle process) {
+  // Open a handle of our own while the caller's keeps the process, and so its
+  // id, from going away.
+  scoped_ptr<ProcessState> state(new ProcessState());
+  if (!base::OpenPrivilegedProcessHandle(base::GetProcId(process),
+                                         &state->handle)) {
+    return;
+  }
+  state->metrics.reset(
+#if !defined(OS_MACOSX)
+      base::ProcessMetrics::CreateProcessMetrics(state->handle));
+#else
+      base::ProcessMetrics::CreateProcessMetrics(
+          state->handle, content::BrowserChildProcessHost::GetPortProvider()));
+#endif
+  task_runner_->PostTask(
+      FROM_HERE,
+      base::Bind(&ProcessSampler::AddProcessOnSequence, this, process,
+                 base::Passed(&state)));
+}
+
+void ProcessSampler::RemoveProcess(base::ProcessHandle process) {
+  task_runner_->PostTask(
+      FROM_HERE,
+      base::Bind(&ProcessSampler::RemoveProcessOnSequence, this, process));
+}
+
+void ProcessSampler::Sample(const SnapshotCallback& callback) {
+  base::PostTaskAndReplyWithResult(
+      task_runner_.get(),
+      FROM_HERE,
+      base::Bind(&ProcessSampler::SampleProcesses, this),
+      callback);
+}
+
+ProcessSampler::~ProcessSampler() {
+}
+
+void ProcessSampler::AddProcessOnSequence(base::ProcessHandle process,
+                                          scoped_ptr<ProcessState> state) {
+  states_[process] = make_linked_ptr(state.release());
+}
+
+void ProcessSampler::RemoveProcessOnSequence(base::ProcessHandle process) {
+  states_.erase(process);
+}
+
+scoped_ptr<ProcessSnapshot> ProcessSampler::SampleProcesses() {
+  std::vector<std::pair<int, ProcessState*> > memory_due;
+  for (StateMap::iterator it = states_.begin(); it != states_.end(); ++it) {
+    ProcessState* state = it->second.get();
+    // GetCPUUsage() returns the usage since it was last called, so it is
+    // called on every pass lest the value spans several of them.
+    state->last_sample.cpu_usage = state->metrics->GetCPUUsage();
+    if (--state->passes_until_memory <= 0)
+      memory_due.push_back(std::make_pair(state->passes_until_memory, state));
+  }
+
+  // The most overdue go first, so that none starve when over budget.
+  std::sort(memory_due.begin(), memory_due.end());
+  base::TimeTicks start = base::TimeTicks::Now();
+  for (size_t i = 0; i < memory_due.size(); ++i) {
+    if (base::TimeTicks::Now() - start > memory_budget_)
+      break;
+    SampleMemory(memory_due[i].second);
+  }
+
+  scoped_ptr<ProcessSnapshot> snapshot(new ProcessSnapshot());
+  for (StateMap::const_iterator it = states_.begin(); it != states_.end();
+       ++it) {
+    (*snapshot)[it->first] = it->second->last_sample;
+  }
+  return snapshot.Pass();
+}
+
+void ProcessSampler::SampleMemory(ProcessState* state) {
+  ProcessSample sample = state->last_sample;
+  base::WorkingSetKBytes ws_usage;
+  if (!state->metrics->GetWorkingSetKBytes(&ws_usage)) {
+    // Retried on the next pass.
+    state->passes_until_memory = 1;
+    return;
+  }
+#if defined(OS_LINUX)
+  // Private and shared memory come from the same smaps walk as the working
+  // set, so do not walk it twice. Private memory is also resident.
+  sample.private_bytes = ws_usage.priv * 1024;
+  sample.shared_bytes = ws_usage.shared * 1024;
+  sample.physical_memory = ws_usage.priv * 1024;
+#else
+  if (!state->metrics->GetMemoryBytes(&sample.private_bytes,
+                                      &sample.shared_bytes)) {
+    state->passes_until_memory = 1;
+    return;
+  }
+  // Memory = working_set.private + working_set.shareable.
+  // We exclude the shared memory.
+  sample.physical_memory = state->metrics->GetWorkingSetSize();
+  sample.physical_memory -= ws_usage.shared * 1024;
+#endif
+  sample.is_memory_valid = true;
+
+  if (IsMemoryStable(state->last_sample, sample)) {
+    state->memory_interval =
+        std::min(state->memory_interval * 2, kMaxMemoryIntervalPasses);
+  } else {
+    state->memory_interval = 1;
+  }
+  state->passes_until_memory = state->memory_interval;
+  state->last_sample = sample;
+}
+
+}  // namespace task_manager
@@ -0,0 +1,122 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_TASK_MANAGER_PROCESS_SAMPLER_H_
+#define CHROME_BROWSER_TASK_MANAGER_PROCESS_SAMPLER_H_
+
+#include <map>
+
+#include "base/basictypes.h"
+#include "base/callback.h"
+#include "base/gtest_prod_util.h"
+#include "base/memory/linked_ptr.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/process/process_handle.h"
+#include "base/time/time.h"
+
+namespace base {
+class ProcessMetrics;
+class SequencedTaskRunner;
+}
+
+namespace task_manager {
+
+// The values sampled for one process.
+struct ProcessSample {
+  ProcessSample();
+
+  double cpu_usage;
+
+  // Memory is costly to read on some platforms (smaps on Linux), so it is
+  // sampled less often than the CPU usage. These hold the last values read.
+  bool is_memory_valid;
+  size_t private_bytes;
+  size_t shared_bytes;
+  size_t physical_memory;
+};
+
+// The samples of all the processes, taken in one pass. Snapshots are not
+// modified once they are handed out.
+typedef std::map<base::ProcessHandle, ProcessSample> ProcessSnapshot;
+
+// Samples the CPU and memory usage of processes on a background sequence, so
+// that the /proc parsing and system calls do not run on the UI thread.
+//
+// The sampler keeps its own handle to each process it is told about, so that
+// the caller may close its handle at any time, and its own
+// base::ProcessMetrics, which are only touched on that sequence. Processes are
+// added and removed in the same order as samples are requested, so a sample
+// only ever covers the processes added and not yet removed when it was
+// requested, and a process added again under a handle value that was reused
+// starts afresh.
+class ProcessSampler : public base::RefCountedThreadSafe<ProcessSampler> {
+ public:
+  typedef base::Callback<void(scoped_ptr<ProcessSnapshot>)> SnapshotCallback;
+
+  explicit ProcessSampler(
+      const scoped_refptr<base::SequencedTaskRunner>& task_runner);
+
+  // Starts sampling |process|, whose samples are keyed by |process|.
+  void AddProcess(base::ProcessHandle process);
+
+  // Stops sampling |process| and forgets its state.
+  void RemoveProcess(base::ProcessHandle process);
+
+  // Samples the processes on the task runner, and runs |callback| with the
+  // snapshot on the calling thread.
+  void Sample(const SnapshotCallback& callback);
+
+ private:
+  friend class base::RefCountedThreadSafe<ProcessSampler>;
+  FRIEND_TEST_ALL_PREFIXES(ProcessSamplerTest, RemoveProcess);
+  FRIEND_TEST_ALL_PREFIXES(ProcessSamplerTest, RemoveProcessWhileSampling);
+  FRIEND_TEST_ALL_PREFIXES(ProcessSamplerTest, MemoryIsSampledLessOften);
+
+  // The state kept for each sampled process.
+  struct ProcessState {
+    ProcessState();
+    ~ProcessState();
+
+    // The sampler's own handle to the process, closed with the state.
+    base::ProcessHandle handle;
+    scoped_ptr<base::ProcessMetrics> metrics;
+    ProcessSample last_sample;
+
+    // The number of passes between memory samples, which grows while the
+    // memory usage is stable.
+    int memory_interval;
+    // The passes left until the memory is due; negative if it is overdue.
+    int passes_until_memory;
+  };
+
+  typedef std::map<base::ProcessHandle, linked_ptr<ProcessState> > StateMap;
+
+  ~ProcessSampler();
+
+  // Do the work of AddProcess() and RemoveProcess() on the task runner.
+  void AddProcessOnSequence(base::ProcessHandle process,
+                            scoped_ptr<ProcessState> state);
+  void RemoveProcessOnSequence(base::ProcessHandle process);
+
+  // Does the sampling for Sample(). Runs on the task runner.
+  scoped_ptr<ProcessSnapshot> SampleProcesses();
+
+  // Reads the memory usage of |state|'s process, and adapts its interval.
+  void SampleMemory(ProcessState* state);
+
+  scoped_refptr<base::SequencedTaskRunner> task_runner_;
+
+  StateMap states_;
+
+  // The time a pass may spend reading memory usage. Processes left over are
+  // sampled first on the next pass.
+  base::TimeDelta memory_budget_;
+
+  DISALLOW_COPY_AND_ASSIGN(ProcessSampler);
+};
+
+}  // namespace task_manager
+
+#endif  // CHROME_BROWSER_TASK_MANAGER_PROCESS_SAMPLER_H_
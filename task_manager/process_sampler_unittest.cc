@@ -0,0 +1,117 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/task_manager/process_sampler.h"
+
+#include "base/bind.h"
+#include "base/message_loop/message_loop.h"
+#include "base/message_loop/message_loop_proxy.h"
+#include "base/run_loop.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace task_manager {
+
+namespace {
+
+void SaveSnapshot(scoped_ptr<ProcessSnapshot>* result,
+                  const base::Closure& quit_closure,
+                  scoped_ptr<ProcessSnapshot> snapshot) {
+  *result = snapshot.Pass();
+  quit_closure.Run();
+}
+
+}  // namespace
+
+class ProcessSamplerTest : public testing::Test {
+ protected:
+  ProcessSamplerTest()
+      : sampler_(new ProcessSampler(base::MessageLoopProxy::current())) {
+  }
+
+  // Samples on the message loop, and returns the snapshot.
+  scoped_ptr<ProcessSnapshot> Sample() {
+    scoped_ptr<ProcessSnapshot> snapshot;
+    base::RunLoop run_loop;
+    sampler_->Sample(base::Bind(&SaveSnapshot, &snapshot,
+                                run_loop.QuitClosure()));
+    run_loop.Run();
+    return snapshot.Pass();
+  }
+
+  base::MessageLoop message_loop_;
+  scoped_refptr<ProcessSampler> sampler_;
+};
+
+TEST_F(ProcessSamplerTest, Sample) {
+  sampler_->AddProcess(base::GetCurrentProcessHandle());
+  scoped_ptr<ProcessSnapshot> snapshot = Sample();
+
+  ASSERT_TRUE(snapshot.get());
+  ASSERT_EQ(1u, snapshot->size());
+  const ProcessSample& sample = (*snapshot)[base::GetCurrentProcessHandle()];
+  EXPECT_TRUE(sample.is_memory_valid);
+  EXPECT_LT(0u, sample.private_bytes);
+  EXPECT_LT(0u, sample.physical_memory);
+}
+
+TEST_F(ProcessSamplerTest, RemoveProcess) {
+  sampler_->AddProcess(base::GetCurrentProcessHandle());
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(1u, sampler_->states_.size());
+
+  sampler_->RemoveProcess(base::GetCurrentProcessHandle());
+  base::RunLoop().RunUntilIdle();
+  EXPECT_TRUE(sampler_->states_.empty());
+  EXPECT_TRUE(Sample()->empty());
+}
+
+TEST_F(ProcessSamplerTest, RemoveProcessWhileSampling) {
+  sampler_->AddProcess(base::GetCurrentProcessHandle());
+
+  // The sample requested before the process is removed still covers it, with
+  // the sampler's own handle, and the state goes once it is done.
+  scoped_ptr<ProcessSnapshot> snapshot;
+  base::RunLoop run_loop;
+  sampler_->Sample(base::Bind(&SaveSnapshot, &snapshot,
+                              run_loop.QuitClosure()));
+  sampler_->RemoveProcess(base::GetCurrentProcessHandle());
+  run_loop.Run();
+  ASSERT_TRUE(snapshot.get());
+  EXPECT_EQ(1u, snapshot->size());
+  base::RunLoop().RunUntilIdle();
+  EXPECT_TRUE(sampler_->states_.empty());
+
+  // Added again, the process starts afresh.
+  sampler_->AddProcess(base::GetCurrentProcessHandle());
+  base::RunLoop().RunUntilIdle();
+  ASSERT_EQ(1u, sampler_->states_.size());
+  EXPECT_FALSE(sampler_->states_.begin()->second->last_sample.is_memory_valid);
+}
+
+TEST_F(ProcessSamplerTest, MemoryIsSampledLessOften) {
+  sampler_->AddProcess(base::GetCurrentProcessHandle());
+  base::RunLoop().RunUntilIdle();
+  sampler_->SampleProcesses();
+  ProcessSampler::ProcessState* state =
+      sampler_->states_[base::GetCurrentProcessHandle()].get();
+  EXPECT_EQ(1, state->passes_until_memory);
+
+  // Pretend the memory usage has been stable.
+  state->memory_interval = 4;
+  state->passes_until_memory = 4;
+  state->last_sample.private_bytes = 1;
+  for (int i = 3; i > 0; --i) {
+    sampler_->SampleProcesses();
+    EXPECT_EQ(i, state->passes_until_memory);
+    EXPECT_EQ(1u, state->last_sample.private_bytes);
+  }
+  scoped_ptr<ProcessSnapshot> snapshot = sampler_->SampleProcesses();
+  EXPECT_NE(1u, state->last_sample.private_bytes);
+  EXPECT_EQ(state->last_sample.private_bytes,
+            (*snapshot)[base::GetCurrentProcessHandle()].private_bytes);
+  // The usage moved, so the memory is sampled on every pass again.
+  EXPECT_EQ(1, state->memory_interval);
+}
+
+}  // namespace task_manager
@@ -8,13 +8,13 @@
 #include "base/i18n/number_formatting.h"
 #include "base/i18n/rtl.h"
 #include "base/prefs/pref_registry_simple.h"
-#include "base/process/process_metrics.h"
 #include "base/rand_util.h"
 #include "base/stl_util.h"
 #include "base/strings/string16.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/strings/stringprintf.h"
 #include "base/strings/utf_string_conversions.h"
+#include "base/threading/sequenced_worker_pool.h"
 #include "chrome/browser/browser_process.h"
 #include "chrome/browser/extensions/extension_process_manager.h"
 #include "chrome/browser/extensions/extension_system.h"
@@ -47,10 +47,6 @@
 #include "ui/base/text/bytes_formatting.h"
 #include "ui/gfx/image/image_skia.h"
 
-#if defined(OS_MACOSX)
-#include "content/public/browser/browser_child_process_host.h"
-#endif
-
 using content::BrowserThread;
 using content::ResourceRequestInfo;
 using content::WebContents;
@@ -92,6 +88,15 @@ int ValueCompareMember(const TaskManagerModel* model,
       OrderUnavailableValue(value1_valid, value2_valid);
 }
 
+bool ProcessSamplesDiffer(const task_manager::ProcessSample& sample1,
+                          const task_manager::ProcessSample& sample2) {
+  return sample1.cpu_usage != sample2.cpu_usage ||
+      sample1.is_memory_valid != sample2.is_memory_valid ||
+      sample1.private_bytes != sample2.private_bytes ||
+      sample1.shared_bytes != sample2.shared_bytes ||
+      sample1.physical_memory != sample2.physical_memory;
+}
+
 string16 FormatStatsSize(const WebKit::WebCache::ResourceTypeStat& stat) {
   return l10n_util::GetStringFUTF16(IDS_TASK_MANAGER_CACHE_SIZE_CELL_TEXT,
       ui::FormatBytesWithUnits(stat.size, ui::DATA_UNITS_KIBIBYTE, false),
@@ -227,14 +232,7 @@ TaskManagerModel::PerResourceValues::~PerResourceValues() {
 }
 
 TaskManagerModel::PerProcessValues::PerProcessValues()
-    : is_cpu_usage_valid(false),
-      cpu_usage(0),
-      is_private_and_shared_valid(false),
-      private_bytes(0),
-      shared_bytes(0),
-      is_physical_memory_valid(false),
-      physical_memory(0),
-      is_video_memory_valid(false),
+    : is_video_memory_valid(false),
       video_memory(0),
       video_memory_has_duplicates(false),
       is_gdi_handles_valid(false),
@@ -258,7 +256,13 @@ TaskManagerModel::TaskManagerModel(TaskManager* task_manager)
       listen_requests_(0),
       update_state_(IDLE),
       goat_salt_(base::RandUint64()),
-      last_unique_id_(0) {
+      last_unique_id_(0),
+      process_sample_pending_(false) {
+  base::SequencedWorkerPool* pool = BrowserThread::GetBlockingPool();
+  process_sampler_ = new task_manager::ProcessSampler(
+      pool->GetSequencedTaskRunnerWithShutdownBehavior(
+          pool->GetSequenceToken(),
+          base::SequencedWorkerPool::CONTINUE_ON_SHUTDOWN));
   AddResourceProvider(
       new task_manager::BrowserProcessResourceProvider(task_manager));
   AddResourceProvider(
@@ -546,47 +550,31 @@ string16 TaskManagerModel::GetResourceV8MemoryAllocatedSize(
 
 bool TaskManagerModel::GetPrivateMemory(int index, size_t* result) const {
   *result = 0;
-  base::ProcessHandle handle = GetResource(index)->GetProcess();
-  if (!CachePrivateAndSharedMemory(handle))
+  const task_manager::ProcessSample* sample =
+      GetMemorySample(GetResource(index)->GetProcess());
+  if (!sample)
     return false;
-  *result = per_process_cache_[handle].private_bytes;
+  *result = sample->private_bytes;
   return true;
 }
 
 bool TaskManagerModel::GetSharedMemory(int index, size_t* result) const {
   *result = 0;
-  base::ProcessHandle handle = GetResource(index)->GetProcess();
-  if (!CachePrivateAndSharedMemory(handle))
+  const task_manager::ProcessSample* sample =
+      GetMemorySample(GetResource(index)->GetProcess());
+  if (!sample)
     return false;
-  *result = per_process_cache_[handle].shared_bytes;
+  *result = sample->shared_bytes;
   return true;
 }
 
 bool TaskManagerModel::GetPhysicalMemory(int index, size_t* result) const {
   *result = 0;
-
-  base::ProcessHandle handle = GetResource(index)->GetProcess();
-  PerProcessValues& values(per_process_cache_[handle]);
-
-  if (!values.is_physical_memory_valid) {
-    base::WorkingSetKBytes ws_usage;
-    MetricsMap::const_iterator iter = metrics_map_.find(handle);
-    if (iter == metrics_map_.end() ||
-        !iter->second->GetWorkingSetKBytes(&ws_usage))
-      return false;
-
-    values.is_physical_memory_valid = true;
-#if defined(OS_LINUX)
-    // On Linux private memory is also resident. Just use it.
-    values.physical_memory = ws_usage.priv * 1024;
-#else
-    // Memory = working_set.private + working_set.shareable.
-    // We exclude the shared memory.
-    values.physical_memory = iter->second->GetWorkingSetSize();
-    values.physical_memory -= ws_usage.shared * 1024;
-#endif
-  }
-  *result = values.physical_memory;
+  const task_manager::ProcessSample* sample =
+      GetMemorySample(GetResource(index)->GetProcess());
+  if (!sample)
+    return false;
+  *result = sample->physical_memory;
   return true;
 }
 
@@ -971,6 +959,7 @@ void TaskManagerModel::AddResource(Resource* resource) {
     group_entries = new ResourceList();
     group_map_[process] = group_entries;
     group_entries->push_back(resource);
+    process_sampler_->AddProcess(process);
 
     // Not part of a group, just put at the end of the list.
     resources_.push_back(resource);
@@ -989,19 +978,6 @@ void TaskManagerModel::AddResource(Resource* resource) {
     resources_.insert(++iter, resource);
   }
 
-  // Create the ProcessMetrics for this process if needed (not in map).
-  if (metrics_map_.find(process) == metrics_map_.end()) {
-    base::ProcessMetrics* pm =
-#if !defined(OS_MACOSX)
-        base::ProcessMetrics::CreateProcessMetrics(process);
-#else
-        base::ProcessMetrics::CreateProcessMetrics(
-            process, content::BrowserChildProcessHost::GetPortProvider());
-#endif
-
-    metrics_map_[process] = pm;
-  }
-
   // Notify the table that the contents have changed for it to redraw.
   FOR_EACH_OBSERVER(TaskManagerModelObserver, observer_list_,
                     OnItemsAdded(new_entry_index, 1));
@@ -1027,13 +1003,11 @@ void TaskManagerModel::RemoveResource(Resource* resource) {
     delete group_entries;
     group_map_.erase(process);
 
-    // Nobody is using this process, we don't need the process metrics anymore.
-    MetricsMap::iterator pm_iter = metrics_map_.find(process);
-    DCHECK(pm_iter != metrics_map_.end());
-    if (pm_iter != metrics_map_.end()) {
-      delete pm_iter->second;
-      metrics_map_.erase(process);
-    }
+    // Nobody is using this process; the caller may close its handle.
+    process_sampler_->RemoveProcess(process);
+    process_snapshot_.erase(process);
+    if (process_sample_pending_)
+      processes_removed_while_sampling_.insert(process);
   }
 
   // Prepare to remove the entry from the model list.
@@ -1141,10 +1115,16 @@ void TaskManagerModel::Clear() {
     resources_.clear();
 
     // Clear the groups.
+    for (GroupMap::const_iterator iter = group_map_.begin();
+         iter != group_map_.end(); ++iter) {
+      process_sampler_->RemoveProcess(iter->first);
+      if (process_sample_pending_)
+        processes_removed_while_sampling_.insert(iter->first);
+    }
     STLDeleteValues(&group_map_);
 
     // Clear the process related info.
-    STLDeleteValues(&metrics_map_);
+    process_snapshot_.clear();
 
     // Clear the network maps.
     current_byte_count_map_.clear();
@@ -1169,22 +1149,15 @@ void TaskManagerModel::Refresh() {
   per_resource_cache_.clear();
   per_process_cache_.clear();
 
-  // Compute the CPU usage values.
-  // Note that we compute the CPU usage for all resources (instead of doing it
-  // lazily) as process_util::GetCPUUsage() returns the CPU usage since the last
-  // time it was called, and not calling it everytime would skew the value the
-  // next time it is retrieved (as it would be for more than 1 cycle).
-  for (ResourceList::iterator iter = resources_.begin();
-       iter != resources_.end(); ++iter) {
-    base::ProcessHandle process = (*iter)->GetProcess();
-    PerProcessValues& values(per_process_cache_[process]);
-    if (values.is_cpu_usage_valid)
-      continue;
-
-    values.is_cpu_usage_valid = true;
-    MetricsMap::iterator metrics_iter = metrics_map_.find(process);
-    DCHECK(metrics_iter != metrics_map_.end());
-    values.cpu_usage = metrics_iter->second->GetCPUUsage();
+  // Sample the CPU and memory usage off the UI thread; reading them means
+  // parsing /proc on Linux, which is slow for large processes. The rows are
+  // shown with the last sample until this one is in. Sampling is skipped
+  // while the previous one is still running, as the sampler keeps the CPU
+  // usage since its last pass anyway.
+  if (!process_sample_pending_ && !group_map_.empty()) {
+    process_sample_pending_ = true;
+    process_sampler_->Sample(
+        base::Bind(&TaskManagerModel::OnProcessesSampled, this));
   }
 
   // Send a request to refresh GPU memory consumption values
@@ -1330,6 +1303,49 @@ void TaskManagerModel::RefreshCallback() {
       base::TimeDelta::FromMilliseconds(kUpdateTimeMs));
 }
 
+void TaskManagerModel::OnProcessesSampled(
+    scoped_ptr<task_manager::ProcessSnapshot> snapshot) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
+  process_sample_pending_ = false;
+  std::set<base::ProcessHandle> removed_processes;
+  removed_processes.swap(processes_removed_while_sampling_);
+
+  // Processes removed while sampling are dropped, and only the groups whose
+  // values changed are redrawn.
+  task_manager::ProcessSnapshot new_snapshot;
+  std::vector<ResourceList*> changed_groups;
+  for (GroupMap::const_iterator group = group_map_.begin();
+       group != group_map_.end(); ++group) {
+    task_manager::ProcessSnapshot::const_iterator sample =
+        snapshot->find(group->first);
+    if (sample == snapshot->end() ||
+        removed_processes.count(group->first)) {
+      continue;
+    }
+    new_snapshot[group->first] = sample->second;
+
+    task_manager::ProcessSnapshot::const_iterator old_sample =
+        process_snapshot_.find(group->first);
+    if (old_sample == process_snapshot_.end() ||
+        ProcessSamplesDiffer(old_sample->second, sample->second)) {
+      changed_groups.push_back(group->second);
+    }
+  }
+  process_snapshot_.swap(new_snapshot);
+
+  for (std::vector<ResourceList*>::const_iterator group =
+           changed_groups.begin();
+       group != changed_groups.end(); ++group) {
+    ResourceList::const_iterator first =
+        std::find(resources_.begin(), resources_.end(), (*group)->front());
+    DCHECK(first != resources_.end());
+    FOR_EACH_OBSERVER(TaskManagerModelObserver, observer_list_,
+                      OnItemsChanged(
+                          static_cast<int>(first - resources_.begin()),
+                          static_cast<int>((*group)->size())));
+  }
+}
+
 void TaskManagerModel::RefreshVideoMemoryUsageStats() {
   if (pending_video_memory_usage_stats_update_)
     return;
@@ -1421,9 +1437,10 @@ int64 TaskManagerModel::GetNetworkUsage(Resource* resource) const {
 }
 
 double TaskManagerModel::GetCPUUsage(Resource* resource) const {
-  const PerProcessValues& values(per_process_cache_[resource->GetProcess()]);
-  // Returns 0 if not valid, which is fine.
-  return values.cpu_usage;
+  task_manager::ProcessSnapshot::const_iterator sample =
+      process_snapshot_.find(resource->GetProcess());
+  // Returns 0 if not sampled yet, which is fine.
+  return sample == process_snapshot_.end() ? 0 : sample->second.cpu_usage;
 }
 
 string16 TaskManagerModel::GetMemCellText(int64 number) const {
@@ -1440,21 +1457,13 @@ string16 TaskManagerModel::GetMemCellText(int64 number) const {
 #endif
 }
 
-bool TaskManagerModel::CachePrivateAndSharedMemory(
+const task_manager::ProcessSample* TaskManagerModel::GetMemorySample(
     base::ProcessHandle handle) const {
-  PerProcessValues& values(per_process_cache_[handle]);
-  if (values.is_private_and_shared_valid)
-    return true;
-
-  MetricsMap::const_iterator iter = metrics_map_.find(handle);
-  if (iter == metrics_map_.end() ||
-      !iter->second->GetMemoryBytes(&values.private_bytes,
-                                    &values.shared_bytes)) {
-    return false;
-  }
-
-  values.is_private_and_shared_valid = true;
-  return true;
+  task_manager::ProcessSnapshot::const_iterator sample =
+      process_snapshot_.find(handle);
+  if (sample == process_snapshot_.end() || !sample->second.is_memory_valid)
+    return NULL;
+  return &sample->second;
 }
 
 bool TaskManagerModel::CacheWebCoreStats(int index) const {
@@ -6,6 +6,7 @@
 #define CHROME_BROWSER_TASK_MANAGER_TASK_MANAGER_H_
 
 #include <map>
+#include <set>
 #include <vector>
 
 #include "base/basictypes.h"
@@ -17,6 +18,7 @@
 #include "base/strings/string16.h"
 #include "base/timer/timer.h"
 #include "chrome/browser/renderer_host/web_cache_manager.h"
+#include "chrome/browser/task_manager/process_sampler.h"
 #include "chrome/browser/task_manager/resource_provider.h"
 #include "chrome/browser/ui/host_desktop.h"
 #include "content/public/common/gpu_memory_stats.h"
@@ -26,10 +28,6 @@ class PrefRegistrySimple;
 class TaskManagerModel;
 class TaskManagerModelGpuDataManagerObserver;
 
-namespace base {
-class ProcessMetrics;
-}
-
 namespace content {
 class WebContents;
 }
@@ -187,13 +185,11 @@ class TaskManagerModel : public base::RefCountedThreadSafe<TaskManagerModel> {
   string16 GetResourceV8MemoryAllocatedSize(int index) const;
 
   // Gets the private memory (in bytes) that should be displayed for the passed
-  // resource index. Caches the result since this calculation can take time on
-  // some platforms.
+  // resource index, from the last process sample.
   bool GetPrivateMemory(int index, size_t* result) const;
 
   // Gets the shared memory (in bytes) that should be displayed for the passed
-  // resource index. Caches the result since this calculation can take time on
-  // some platforms.
+  // resource index, from the last process sample.
   bool GetSharedMemory(int index, size_t* result) const;
 
   // Gets the physical memory (in bytes) that should be displayed for the passed
@@ -306,7 +302,9 @@ class TaskManagerModel : public base::RefCountedThreadSafe<TaskManagerModel> {
   // changes to the model.
   void ModelChanged();
 
-   // Updates the values for all rows.
+  // Updates the values for all rows. The process values are sampled off the
+  // UI thread; the rows whose process values changed are updated again once
+  // the sample is in.
   void Refresh();
 
   void NotifyResourceTypeStats(
@@ -393,16 +391,6 @@ class TaskManagerModel : public base::RefCountedThreadSafe<TaskManagerModel> {
     PerProcessValues();
     ~PerProcessValues();
 
-    bool is_cpu_usage_valid;
-    double cpu_usage;
-
-    bool is_private_and_shared_valid;
-    size_t private_bytes;
-    size_t shared_bytes;
-
-    bool is_physical_memory_valid;
-    size_t physical_memory;
-
     bool is_video_memory_valid;
     size_t video_memory;
     bool video_memory_has_duplicates;
@@ -420,7 +408,6 @@ class TaskManagerModel : public base::RefCountedThreadSafe<TaskManagerModel> {
   typedef std::vector<scoped_refptr<task_manager::ResourceProvider> >
       ResourceProviderList;
   typedef std::map<base::ProcessHandle, ResourceList*> GroupMap;
-  typedef std::map<base::ProcessHandle, base::ProcessMetrics*> MetricsMap;
   typedef std::map<task_manager::Resource*, int64> ResourceValueMap;
   typedef std::map<task_manager::Resource*,
                    PerResourceValues> PerResourceCache;
@@ -455,6 +442,10 @@ class TaskManagerModel : public base::RefCountedThreadSafe<TaskManagerModel> {
 
   void RefreshVideoMemoryUsageStats();
 
+  // Called with the processes sampled by |process_sampler_|. Notifies the
+  // observers of the rows whose process values changed.
+  void OnProcessesSampled(scoped_ptr<task_manager::ProcessSnapshot> snapshot);
+
   // Returns the network usage (in bytes per seconds) for the specified
   // resource. That's the value retrieved at the last timer's tick.
   int64 GetNetworkUsageForResource(task_manager::Resource* resource) const;
@@ -483,10 +474,10 @@ class TaskManagerModel : public base::RefCountedThreadSafe<TaskManagerModel> {
   // displayed in the task manager's memory cell.
   string16 GetMemCellText(int64 number) const;
 
-  // Verifies the private and shared memory for |handle| is valid in
-  // |per_process_cache_|. Returns true if the data in |per_process_cache_| is
-  // valid.
-  bool CachePrivateAndSharedMemory(base::ProcessHandle handle) const;
+  // Returns the last sample of |handle| if its memory has been sampled, or
+  // NULL.
+  const task_manager::ProcessSample* GetMemorySample(
+      base::ProcessHandle handle) const;
 
   // Verifies |webcore_stats| in |per_resource_cache_|, returning true on
   // success.
@@ -517,9 +508,20 @@ class TaskManagerModel : public base::RefCountedThreadSafe<TaskManagerModel> {
   // the model (but the actual Resources are owned by the ResourceProviders).
   GroupMap group_map_;
 
-  // A map to retrieve the process metrics for a process. The ProcessMetrics are
-  // owned by the model.
-  MetricsMap metrics_map_;
+  // Samples the processes in |group_map_| on a background sequence.
+  scoped_refptr<task_manager::ProcessSampler> process_sampler_;
+
+  // The last process samples. Replaced as a whole when a new sample is in.
+  task_manager::ProcessSnapshot process_snapshot_;
+
+  // Set while |process_sampler_| is sampling, so that a slow sample does not
+  // queue up more.
+  bool process_sample_pending_;
+
+  // The processes removed while |process_sampler_| is sampling. Their handle
+  // values may be reused by processes added since, which the pending sample
+  // must not be attributed to.
+  std::set<base::ProcessHandle> processes_removed_while_sampling_;
 
   // A map that keeps track of the number of bytes read per process since last
   // tick. The Resources are owned by the ResourceProviders.
@@ -260,6 +260,7 @@ bool IsDownloadDisplayable(const content::DownloadItem& item) {
 
 DownloadsDOMHandler::DownloadsDOMHandler(content::DownloadManager* dlm)
     : main_notifier_(dlm, this),
+      live_query_id_(-1),
       update_scheduled_(false),
       weak_ptr_factory_(this) {
   // Create our fileicon data source.
@@ -374,6 +375,7 @@ void DownloadsDOMHandler::OnDownloadRemoved(
 void DownloadsDOMHandler::HandleGetDownloads(const base::ListValue* args) {
   CountDownloadsDOMEvents(DOWNLOADS_DOM_EVENT_GET_DOWNLOADS);
   search_terms_.reset((args && !args->empty()) ? args->DeepCopy() : NULL);
+  UpdateLiveQuery();
   SendCurrentDownloads();
 }
 
@@ -509,21 +511,21 @@ void DownloadsDOMHandler::SendCurrentDownloads() {
   update_scheduled_ = false;
   content::DownloadManager::DownloadVector all_items, filtered_items;
   if (main_notifier_.GetManager()) {
-    main_notifier_.GetManager()->GetAllDownloads(&all_items);
+    if (!index_.get())
+      main_notifier_.GetManager()->GetAllDownloads(&all_items);
     main_notifier_.GetManager()->CheckForHistoryFilesRemoval();
   }
   if (original_notifier_.get() && original_notifier_->GetManager()) {
-    original_notifier_->GetManager()->GetAllDownloads(&all_items);
+    if (!index_.get())
+      original_notifier_->GetManager()->GetAllDownloads(&all_items);
     original_notifier_->GetManager()->CheckForHistoryFilesRemoval();
   }
-  DownloadQuery query;
-  if (search_terms_ && !search_terms_->empty()) {
-    query.AddFilter(DownloadQuery::FILTER_QUERY, *search_terms_.get());
+  if (index_.get()) {
+    index_->GetLiveResults(live_query_id_, &filtered_items);
+  } else {
+    scoped_ptr<DownloadQuery> query(CreateQuery());
+    query->Search(all_items.begin(), all_items.end(), &filtered_items);
   }
-  query.AddFilter(base::Bind(&IsDownloadDisplayable));
-  query.AddSorter(DownloadQuery::SORT_START_TIME, DownloadQuery::DESCENDING);
-  query.Limit(kMaxDownloads);
-  query.Search(all_items.begin(), all_items.end(), &filtered_items);
   base::ListValue results_value;
   for (content::DownloadManager::DownloadVector::const_iterator
        iter = filtered_items.begin(); iter != filtered_items.end(); ++iter) {
@@ -537,6 +539,34 @@ void DownloadsDOMHandler::SendCurrentDownloads() {
   CallDownloadsList(results_value);
 }
 
+scoped_ptr<DownloadQuery> DownloadsDOMHandler::CreateQuery() const {
+  scoped_ptr<DownloadQuery> query(new DownloadQuery);
+  if (search_terms_ && !search_terms_->empty())
+    query->AddFilter(DownloadQuery::FILTER_QUERY, *search_terms_.get());
+  query->AddFilter(base::Bind(&IsDownloadDisplayable));
+  query->AddSorter(DownloadQuery::SORT_START_TIME, DownloadQuery::DESCENDING);
+  query->Limit(kMaxDownloads);
+  return query.Pass();
+}
+
+void DownloadsDOMHandler::UpdateLiveQuery() {
+  if (!index_.get()) {
+    // Without search terms the page shows the newest downloads, which a
+    // search over all of them finds as fast as the index would. Only build
+    // the index once the user searches.
+    if (!search_terms_ || search_terms_->empty())
+      return;
+    index_.reset(new DownloadQueryIndex);
+    if (main_notifier_.GetManager())
+      index_->AddManager(main_notifier_.GetManager());
+    if (original_notifier_.get() && original_notifier_->GetManager())
+      index_->AddManager(original_notifier_->GetManager());
+  } else {
+    index_->RemoveLiveQuery(live_query_id_);
+  }
+  live_query_id_ = index_->AddLiveQuery(CreateQuery());
+}
+
 void DownloadsDOMHandler::ShowDangerPrompt(
     content::DownloadItem* dangerous_item) {
   DownloadDangerPrompt* danger_prompt = DownloadDangerPrompt::Create(
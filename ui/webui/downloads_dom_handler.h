@@ -12,6 +12,7 @@
 #include "base/memory/weak_ptr.h"
 #include "chrome/browser/download/all_download_item_notifier.h"
 #include "chrome/browser/download/download_danger_prompt.h"
+#include "chrome/browser/download/download_query_index.h"
 #include "content/public/browser/download_item.h"
 #include "content/public/browser/download_manager.h"
 #include "content/public/browser/web_ui_message_handler.h"
@@ -111,6 +112,13 @@ class DownloadsDOMHandler : public content::WebUIMessageHandler,
   // Sends the current list of downloads to the page.
   void SendCurrentDownloads();
 
+  // Returns the query for the downloads that the page shows.
+  scoped_ptr<DownloadQuery> CreateQuery() const;
+
+  // Replaces the live query of |index_| with one for |search_terms_|. Creates
+  // |index_| for the first search terms.
+  void UpdateLiveQuery();
+
   // Displays a native prompt asking the user for confirmation after accepting
   // the dangerous download specified by |dangerous|. The function returns
   // immediately, and will invoke DangerPromptAccepted() asynchronously if the
@@ -140,6 +148,12 @@ class DownloadsDOMHandler : public content::WebUIMessageHandler,
   // DownloadManager for the original profile; otherwise, this is NULL.
   scoped_ptr<AllDownloadItemNotifier> original_notifier_;
 
+  // Indexes the downloads of both managers, and keeps the downloads that the
+  // page shows for |search_terms_| so that they are not searched for among
+  // all downloads each time the page is updated. NULL until the first search.
+  scoped_ptr<DownloadQueryIndex> index_;
+  int live_query_id_;
+
   // Whether a call to SendCurrentDownloads() is currently scheduled.
   bool update_scheduled_;
 
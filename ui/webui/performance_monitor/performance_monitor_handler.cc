@@ -329,9 +329,22 @@ void DoGetMetrics(ListValue* results,
         db->GetMaxStatsForActivityAndMetric(*metric_type) * conversion_factor);
 
     // Retrieve all metrics in the database, and aggregate them into a series
-    // of points for each active interval.
-    scoped_ptr<Database::MetricVector> metric_vector =
-        db->GetStatsForActivityAndMetric(*metric_type, start, end);
+    // of points for each active interval. Coarse mean views are built from
+    // the rollups rather than every statistic; the raw statistics are not
+    // kept for long anyway.
+    scoped_ptr<Database::MetricVector> metric_vector;
+    if (aggregation_method == AGGREGATION_METHOD_MEAN &&
+        resolution >= base::TimeDelta::FromDays(1)) {
+      metric_vector = db->GetRollupsForActivityAndMetric(
+          *metric_type, Database::ROLLUP_DAY, start, end);
+    } else if (aggregation_method == AGGREGATION_METHOD_MEAN &&
+               resolution >= base::TimeDelta::FromHours(1)) {
+      metric_vector = db->GetRollupsForActivityAndMetric(
+          *metric_type, Database::ROLLUP_HOUR, start, end);
+    } else {
+      metric_vector =
+          db->GetStatsForActivityAndMetric(*metric_type, start, end);
+    }
 
     scoped_ptr<VectorOfMetricVectors> aggregated_metrics =
         AggregateMetric(*metric_type,